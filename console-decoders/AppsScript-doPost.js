@@ -12,7 +12,7 @@ function doPost(e) {
     // Get all contents
     var json = JSON.parse(e.postData.contents);
 
-    if (json.port == 2)
+    if (json.port == 2 || json.port == 3)
         var ThisSheet = GS.getSheetByName(SheetDate);
     else if (json.port == 5)
         var ThisSheet = GS.getSheetByName('Status');
@@ -31,12 +31,12 @@ function doPost(e) {
     ThisRecord[i++] = json.name;                            // Device Name
     ThisRecord[i++] = json.decoded.payload.battery;         // Battery
 
-    if (json.port == 2) {
+    if (json.port == 2 || json.port == 3) {
         ThisRecord[i++] = json.decoded.payload.latitude;    // Latitude
         ThisRecord[i++] = json.decoded.payload.longitude;   // Longitude
         ThisRecord[i++] = json.decoded.payload.sats;        // Sats
         ThisRecord[i++] = json.decoded.payload.speed;       // Speed
-        //ThisRecord[i++] = json.decoded.payload.accuracy;  // Accuracy stuck at 2.5
+        //ThisRecord[i++] = json.decoded.payload.accuracy;  // Accuracy only measured on port 3
     } else if (json.port == 5) {
         ThisRecord[i++] = json.decoded.payload.last_latitude;    // Latitude
         ThisRecord[i++] = json.decoded.payload.last_longitude;   // Longitude
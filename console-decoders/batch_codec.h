@@ -0,0 +1,492 @@
+// Generated by console-decoders/codec_gen.py from payload_schema.json -- do not edit
+#pragma once
+
+/**
+ * Batch decoders for stored uplinks, host side.
+ *
+ * Each decodes many frames of one message into a column per field, one field
+ * at a time, so the loops are short and straight enough to vectorise.  Values
+ * are the ones unified_decoder.js returns, to the bit: enums stay as their
+ * number, absent optional fields are NaN, hidden fields are kept.  Build with
+ * -ffp-contract=off, as a fused multiply-add rounds differently from JS.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/** Frames are copied into slots this much longer than they can be, so bit reads never need a length check */
+constexpr size_t BATCH_PAD = 8;
+
+/** Big endian bits from any bit offset, up to 32 of them */
+static inline uint32_t batch_bits(const uint8_t *frame, uint32_t pos, uint8_t bits) {
+  uint64_t v = 0;
+  for (int k = 0; k < 8; k++)
+    v = v << 8 | frame[(pos >> 3) + k];
+  return (uint32_t)(v << (pos & 7) >> (64 - bits));
+}
+
+/**
+ * parseFloat(v.toFixed(digits)) from JavaScript, to the bit.  toFixed rounds the
+ * exact binary value half away from zero, and the decimal it prints reads back
+ * as n / 10^digits correctly rounded, which is what the division gives.  Only
+ * values within rounding error of a tie need the exact decimal expansion.
+ */
+static inline double batch_to_fixed(double v, int digits) {
+  static const double scale[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+  double a = fabs(v);
+  double s = a * scale[digits];
+  double n = floor(s);
+  double frac = s - n;
+  if (fabs(frac - 0.5) > 1e-6) {
+    n = frac > 0.5 ? n + 1 : n;
+  } else {
+    // 30 more digits tell a tie from a near miss for any value a field can hold
+    char text[96];
+    snprintf(text, sizeof(text), "%.*f", digits + 30, a);
+    char *dot = strchr(text, '.');
+    bool up = dot[digits + 1] >= '5';
+    n = 0;
+    for (char *c = text; *c && c < dot + 1 + digits; c++)
+      if (*c != '.')
+        n = n * 10 + (*c - '0');
+    if (up)
+      n += 1;
+  }
+  double r = n / scale[digits];
+  return v < 0 ? -r : r;
+}
+
+/** Mapper! (Cargo and Heatmap too): 3 Lat, 3 Long, 2 Altitude (m), 1 Sats (FPort 2) */
+constexpr uint8_t BATCH_MAPPER_PORT = 2;
+constexpr size_t BATCH_MAPPER_MAX_LEN = 9;
+constexpr size_t BATCH_MAPPER_STRIDE = 24;
+
+struct batch_mapper {
+  double *latitude;
+  double *longitude;
+  double *altitude;
+  double *sats;
+  double *accuracy;
+  uint8_t *valid;  // 0 where the decoders return nothing: truncated, or another version
+  uint8_t *end;    // Byte the telemetry tail starts at
+};
+
+/** n frames, BATCH_MAPPER_STRIDE bytes apart and zero padded, with their lengths in len */
+static inline void batch_decode_mapper(const uint8_t *frames, const uint8_t *len, size_t n,
+                                       const struct batch_mapper &out) {
+  const size_t stride = BATCH_MAPPER_STRIDE;
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 0, 24);
+    v = v / 16777215.0;
+    v = v * 180.0;
+    v = v + -90.0;
+    out.latitude[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 24, 24);
+    v = v / 16777215.0;
+    v = v * 360.0;
+    v = v + -180.0;
+    out.longitude[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 48, 16);
+    v = v >= 32768.0 ? v - 65536.0 : v;
+    out.altitude[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 64, 8);
+    out.sats[i] = v;
+  }
+  for (size_t i = 0; i < n; i++)
+    out.accuracy[i] = 2.5;
+  for (size_t i = 0; i < n; i++) {
+    uint32_t bits = 72;
+    out.valid[i] = len[i] * 8u >= bits;
+    out.end[i] = (bits + 7) >> 3;
+  }
+}
+
+/** Mapper payload v2: 1e-6 degree position, optional accuracy, speed and heading (FPort 3) */
+constexpr uint8_t BATCH_MAPPER_V2_PORT = 3;
+constexpr size_t BATCH_MAPPER_V2_MAX_LEN = 14;
+constexpr size_t BATCH_MAPPER_V2_STRIDE = 24;
+
+struct batch_mapper_v2 {
+  double *flags;
+  double *latitude;
+  double *longitude;
+  double *altitude;
+  double *sats;
+  double *accuracy;
+  double *speed;
+  double *heading;
+  uint8_t *valid;  // 0 where the decoders return nothing: truncated, or another version
+  uint8_t *end;    // Byte the telemetry tail starts at
+};
+
+/** n frames, BATCH_MAPPER_V2_STRIDE bytes apart and zero padded, with their lengths in len */
+static inline void batch_decode_mapper_v2(const uint8_t *frames, const uint8_t *len, size_t n,
+                                          const struct batch_mapper_v2 &out) {
+  const size_t stride = BATCH_MAPPER_V2_STRIDE;
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 3, 2);
+    out.flags[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 5, 28);
+    v = v / 1000000.0;
+    v = v + -90.0;
+    v = batch_to_fixed(v, 6);
+    out.latitude[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 33, 29);
+    v = v / 1000000.0;
+    v = v + -180.0;
+    v = batch_to_fixed(v, 6);
+    out.longitude[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 62, 16);
+    v = v >= 32768.0 ? v - 65536.0 : v;
+    out.altitude[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 78, 5);
+    out.sats[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 83, 7);
+    v = v / 2.0;
+    out.accuracy[i] = (uint32_t)out.flags[i] & 1 ? v : 2.5;
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t pos = 83 + ((uint32_t)out.flags[i] & 1 ? 7 : 0);
+    double v = batch_bits(frames + i * stride, pos, 10);
+    v = v * 0.36;
+    v = batch_to_fixed(v, 1);
+    out.speed[i] = (uint32_t)out.flags[i] & 2 ? v : NAN;
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t pos = 83 + ((uint32_t)out.flags[i] & 1 ? 7 : 0) + ((uint32_t)out.flags[i] & 2 ? 10 : 0);
+    double v = batch_bits(frames + i * stride, pos, 9);
+    out.heading[i] = (uint32_t)out.flags[i] & 2 ? v : NAN;
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t bits = 83 + ((uint32_t)out.flags[i] & 1 ? 7 : 0) + ((uint32_t)out.flags[i] & 2 ? 19 : 0);
+    out.valid[i] = len[i] * 8u >= bits && batch_bits(frames + i * stride, 0, 3) == 2;
+    out.end[i] = (bits + 7) >> 3;
+  }
+}
+
+/** System status (FPort 5) */
+constexpr uint8_t BATCH_STATUS_PORT = 5;
+constexpr size_t BATCH_STATUS_MAX_LEN = 9;
+constexpr size_t BATCH_STATUS_STRIDE = 24;
+
+struct batch_status {
+  double *last_latitude;
+  double *last_longitude;
+  double *battery;
+  double *status;
+  double *value;
+  uint8_t *valid;  // 0 where the decoders return nothing: truncated, or another version
+  uint8_t *end;    // Byte the telemetry tail starts at
+};
+
+static inline const char *batch_status_status_name(double v) {
+  if (v == 1)
+    return "BOOT";
+  if (v == 2)
+    return "USB ON";
+  if (v == 3)
+    return "USB OFF";
+  return NULL;
+}
+
+/** n frames, BATCH_STATUS_STRIDE bytes apart and zero padded, with their lengths in len */
+static inline void batch_decode_status(const uint8_t *frames, const uint8_t *len, size_t n,
+                                       const struct batch_status &out) {
+  const size_t stride = BATCH_STATUS_STRIDE;
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 0, 24);
+    v = v / 16777215.0;
+    v = v * 180.0;
+    v = v + -90.0;
+    out.last_latitude[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 24, 24);
+    v = v / 16777215.0;
+    v = v * 360.0;
+    v = v + -180.0;
+    out.last_longitude[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 48, 8);
+    v = v / 100.0;
+    v = v + 2.0;
+    v = batch_to_fixed(v, 2);
+    out.battery[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 56, 8);
+    out.status[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 64, 8);
+    out.value[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t bits = 72;
+    out.valid[i] = len[i] * 8u >= bits;
+    out.end[i] = (bits + 7) >> 3;
+  }
+}
+
+/** Lost GPS (FPort 6) */
+constexpr uint8_t BATCH_GPS_LOST_PORT = 6;
+constexpr size_t BATCH_GPS_LOST_MAX_LEN = 10;
+constexpr size_t BATCH_GPS_LOST_STRIDE = 24;
+
+struct batch_gps_lost {
+  double *last_latitude;
+  double *last_longitude;
+  double *battery;
+  double *sats;
+  double *minutes;
+  uint8_t *valid;  // 0 where the decoders return nothing: truncated, or another version
+  uint8_t *end;    // Byte the telemetry tail starts at
+};
+
+/** n frames, BATCH_GPS_LOST_STRIDE bytes apart and zero padded, with their lengths in len */
+static inline void batch_decode_gps_lost(const uint8_t *frames, const uint8_t *len, size_t n,
+                                         const struct batch_gps_lost &out) {
+  const size_t stride = BATCH_GPS_LOST_STRIDE;
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 0, 24);
+    v = v / 16777215.0;
+    v = v * 180.0;
+    v = v + -90.0;
+    out.last_latitude[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 24, 24);
+    v = v / 16777215.0;
+    v = v * 360.0;
+    v = v + -180.0;
+    out.last_longitude[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 48, 8);
+    v = v / 100.0;
+    v = v + 2.0;
+    v = batch_to_fixed(v, 2);
+    out.battery[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 56, 8);
+    out.sats[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 64, 16);
+    out.minutes[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t bits = 80;
+    out.valid[i] = len[i] * 8u >= bits;
+    out.end[i] = (bits + 7) >> 3;
+  }
+}
+
+/** Device telemetry, alone or appended to a mapper, status or GPS lost frame (FPort 7) */
+constexpr uint8_t BATCH_TELEMETRY_PORT = 7;
+constexpr size_t BATCH_TELEMETRY_MAX_LEN = 8;
+constexpr size_t BATCH_TELEMETRY_STRIDE = 16;
+
+struct batch_telemetry {
+  double *battery;
+  double *uptime;
+  double *airtime;
+  double *frames;
+  double *ack_ratio;
+  double *reset_reason;
+  uint8_t *valid;  // 0 where the decoders return nothing: truncated, or another version
+};
+
+static inline const char *batch_telemetry_ack_ratio_name(double v) {
+  if (v == 127)
+    return "none";
+  return NULL;
+}
+
+static inline const char *batch_telemetry_reset_reason_name(double v) {
+  if (v == 0)
+    return "UNKNOWN";
+  if (v == 1)
+    return "POWERON";
+  if (v == 2)
+    return "EXT";
+  if (v == 3)
+    return "SW";
+  if (v == 4)
+    return "PANIC";
+  if (v == 5)
+    return "INT_WDT";
+  if (v == 6)
+    return "TASK_WDT";
+  if (v == 7)
+    return "WDT";
+  if (v == 8)
+    return "DEEPSLEEP";
+  if (v == 9)
+    return "BROWNOUT";
+  if (v == 10)
+    return "SDIO";
+  return NULL;
+}
+
+/** n frames, BATCH_TELEMETRY_STRIDE bytes apart and zero padded, with their lengths in len */
+static inline void batch_decode_telemetry(const uint8_t *frames, const uint8_t *len, size_t n,
+                                          const struct batch_telemetry &out) {
+  const size_t stride = BATCH_TELEMETRY_STRIDE;
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 0, 8);
+    v = v / 100.0;
+    v = v + 2.0;
+    v = batch_to_fixed(v, 2);
+    out.battery[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 8, 16);
+    out.uptime[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 24, 14);
+    out.airtime[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 38, 15);
+    out.frames[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 53, 7);
+    out.ack_ratio[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double v = batch_bits(frames + i * stride, 60, 4);
+    out.reset_reason[i] = v;
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t bits = 64;
+    out.valid[i] = len[i] * 8u >= bits;
+  }
+}
+
+struct batch_column {
+  const char *name;
+  bool hidden;                           // Left out by the decoders, kept for the optional fields
+  const char *(*enum_name)(double);      // NULL if not an enum
+};
+
+struct batch_message {
+  const char *name;
+  uint8_t port;
+  size_t max_len;
+  size_t stride;
+  int tail;                              // Index in batch_messages, -1 if none
+  size_t columns;
+  const struct batch_column *column;
+  void (*decode)(const uint8_t *frames, const uint8_t *len, size_t n, double *const *column, uint8_t *valid,
+                 uint8_t *end);
+};
+
+static const struct batch_column batch_mapper_columns[] = {
+    {"latitude", false, NULL},
+    {"longitude", false, NULL},
+    {"altitude", false, NULL},
+    {"sats", false, NULL},
+    {"accuracy", false, NULL},
+};
+
+static inline void batch_decode_mapper_columns(const uint8_t *frames, const uint8_t *len, size_t n,
+                                               double *const *column, uint8_t *valid, uint8_t *end) {
+  batch_decode_mapper(frames, len, n, {column[0], column[1], column[2], column[3], column[4], valid, end});
+}
+
+static const struct batch_column batch_mapper_v2_columns[] = {
+    {"flags", true, NULL},
+    {"latitude", false, NULL},
+    {"longitude", false, NULL},
+    {"altitude", false, NULL},
+    {"sats", false, NULL},
+    {"accuracy", false, NULL},
+    {"speed", false, NULL},
+    {"heading", false, NULL},
+};
+
+static inline void batch_decode_mapper_v2_columns(const uint8_t *frames, const uint8_t *len, size_t n,
+                                                  double *const *column, uint8_t *valid, uint8_t *end) {
+  batch_decode_mapper_v2(frames, len, n, {column[0], column[1], column[2], column[3], column[4], column[5], column[6],
+                                          column[7], valid, end});
+}
+
+static const struct batch_column batch_status_columns[] = {
+    {"last_latitude", false, NULL},
+    {"last_longitude", false, NULL},
+    {"battery", false, NULL},
+    {"status", false, batch_status_status_name},
+    {"value", false, NULL},
+};
+
+static inline void batch_decode_status_columns(const uint8_t *frames, const uint8_t *len, size_t n,
+                                               double *const *column, uint8_t *valid, uint8_t *end) {
+  batch_decode_status(frames, len, n, {column[0], column[1], column[2], column[3], column[4], valid, end});
+}
+
+static const struct batch_column batch_gps_lost_columns[] = {
+    {"last_latitude", false, NULL},
+    {"last_longitude", false, NULL},
+    {"battery", false, NULL},
+    {"sats", false, NULL},
+    {"minutes", false, NULL},
+};
+
+static inline void batch_decode_gps_lost_columns(const uint8_t *frames, const uint8_t *len, size_t n,
+                                                 double *const *column, uint8_t *valid, uint8_t *end) {
+  batch_decode_gps_lost(frames, len, n, {column[0], column[1], column[2], column[3], column[4], valid, end});
+}
+
+static const struct batch_column batch_telemetry_columns[] = {
+    {"battery", false, NULL},
+    {"uptime", false, NULL},
+    {"airtime", false, NULL},
+    {"frames", false, NULL},
+    {"ack_ratio", false, batch_telemetry_ack_ratio_name},
+    {"reset_reason", false, batch_telemetry_reset_reason_name},
+};
+
+static inline void batch_decode_telemetry_columns(const uint8_t *frames, const uint8_t *len, size_t n,
+                                                  double *const *column, uint8_t *valid, uint8_t *end) {
+  (void)end;
+  batch_decode_telemetry(frames, len, n, {column[0], column[1], column[2], column[3], column[4], column[5], valid});
+}
+
+static const struct batch_message batch_messages[] = {
+    {"mapper", BATCH_MAPPER_PORT, BATCH_MAPPER_MAX_LEN, BATCH_MAPPER_STRIDE, 4, 5, batch_mapper_columns,
+     batch_decode_mapper_columns},
+    {"mapper_v2", BATCH_MAPPER_V2_PORT, BATCH_MAPPER_V2_MAX_LEN, BATCH_MAPPER_V2_STRIDE, 4, 8, batch_mapper_v2_columns,
+     batch_decode_mapper_v2_columns},
+    {"status", BATCH_STATUS_PORT, BATCH_STATUS_MAX_LEN, BATCH_STATUS_STRIDE, 4, 5, batch_status_columns,
+     batch_decode_status_columns},
+    {"gps_lost", BATCH_GPS_LOST_PORT, BATCH_GPS_LOST_MAX_LEN, BATCH_GPS_LOST_STRIDE, 4, 5, batch_gps_lost_columns,
+     batch_decode_gps_lost_columns},
+    {"telemetry", BATCH_TELEMETRY_PORT, BATCH_TELEMETRY_MAX_LEN, BATCH_TELEMETRY_STRIDE, -1, 6, batch_telemetry_columns,
+     batch_decode_telemetry_columns},
+};
+
+constexpr size_t BATCH_MESSAGES = 5;
@@ -0,0 +1,331 @@
+// Decodes stored uplinks in bulk, for reprocessing history after a decoder or schema change.
+//
+//   c++ -O2 -std=c++17 -ffp-contract=off -o batch_decode batch_decode.cpp
+//   ./batch_decode --out columns frames.bin
+//   ./batch_decode --hex --json frames.txt > decoded.jsonl
+//   ./batch_decode --bench 1000000
+//
+// Input is packed frames, each a port byte, a length byte and the payload, or
+// with --hex one "port hexpayload" per line.  The frames are sorted by
+// message into fixed size slots and decoded a column at a time by
+// batch_codec.h, which codec_gen.py generates from the same schema as
+// unified_decoder.js, and gives the same values to the bit.
+//
+// --out writes a folder with one file per message and field, native doubles
+// like ingest.cpp stores, plus <message>.frame with the input frame each row
+// came from.  Telemetry sent as a tail of another frame is a telemetry row of
+// that frame.  --json prints what the Console decoder returns for each input
+// frame instead, one per line, which is handy to check against it.  --bench
+// decodes that many random frames and reports how many a second.
+
+#include <sys/stat.h>
+
+#include <charconv>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "batch_codec.h"
+
+struct frames {
+  std::vector<uint8_t> port;
+  std::vector<uint8_t> len;
+  std::vector<uint32_t> offset;  // Into bytes
+  std::vector<uint8_t> bytes;
+};
+
+// One message's rows, valid or not, in input order
+struct table {
+  std::vector<std::vector<double>> column;
+  std::vector<uint8_t> valid;
+  std::vector<uint8_t> end;
+  std::vector<uint32_t> frame;  // Input frame of each row
+  std::vector<int32_t> tail;    // Row in the tail message's table, -1 if none
+};
+
+static void add_frame(struct frames &in, uint8_t port, const uint8_t *payload, uint8_t len) {
+  in.port.push_back(port);
+  in.len.push_back(len);
+  in.offset.push_back(in.bytes.size());
+  in.bytes.insert(in.bytes.end(), payload, payload + len);
+}
+
+static bool read_binary(FILE *f, struct frames &in) {
+  uint8_t head[2], payload[255];
+  while (fread(head, 1, 2, f) == 2) {
+    if (fread(payload, 1, head[1], f) != head[1]) {
+      fprintf(stderr, "Frame %zu is cut short\n", in.port.size());
+      return false;
+    }
+    add_frame(in, head[0], payload, head[1]);
+  }
+  return true;
+}
+
+static bool read_hex(FILE *f, struct frames &in) {
+  char line[1024], hex[600];
+  unsigned port;
+  for (size_t n = 1; fgets(line, sizeof(line), f); n++) {
+    if (line[0] == '\n' || line[0] == '#')
+      continue;
+    uint8_t payload[255];
+    size_t len = 0;
+    hex[0] = 0;
+    if (sscanf(line, "%u %599s", &port, hex) < 1 || port > 255 || strlen(hex) % 2 || strlen(hex) > 2 * 255) {
+      fprintf(stderr, "Line %zu: expected a port and hex payload\n", n);
+      return false;
+    }
+    for (; hex[2 * len]; len++)
+      if (sscanf(hex + 2 * len, "%2hhx", &payload[len]) != 1) {
+        fprintf(stderr, "Line %zu: not hex\n", n);
+        return false;
+      }
+    add_frame(in, port, payload, len);
+  }
+  return true;
+}
+
+// Decodes the given frames, from byte `start` of each, into rows appended to t
+static void decode_rows(const struct batch_message &m, const struct frames &in, const std::vector<uint32_t> &which,
+                        const std::vector<uint8_t> &start, struct table &t) {
+  size_t n = which.size(), first = t.valid.size();
+  std::vector<uint8_t> slots(n * m.stride), len(n);
+  for (size_t i = 0; i < n; i++) {
+    uint32_t f = which[i];
+    len[i] = in.len[f] - start[i];
+    memcpy(&slots[i * m.stride], &in.bytes[in.offset[f] + start[i]], len[i] < m.max_len ? len[i] : m.max_len);
+  }
+
+  t.column.resize(m.columns);
+  std::vector<double *> column(m.columns);
+  for (size_t c = 0; c < m.columns; c++) {
+    t.column[c].resize(first + n);
+    column[c] = t.column[c].data() + first;
+  }
+  t.valid.resize(first + n);
+  t.end.resize(first + n);
+  m.decode(slots.data(), len.data(), n, column.data(), t.valid.data() + first, t.end.data() + first);
+  t.frame.insert(t.frame.end(), which.begin(), which.end());
+  t.tail.resize(first + n, -1);
+}
+
+static void decode_all(const struct frames &in, std::vector<struct table> &tables) {
+  tables.assign(BATCH_MESSAGES, table());
+  std::vector<std::vector<uint32_t>> which(BATCH_MESSAGES);
+  for (uint32_t f = 0; f < in.port.size(); f++)
+    for (size_t k = 0; k < BATCH_MESSAGES; k++)
+      if (in.port[f] == batch_messages[k].port)
+        which[k].push_back(f);
+  for (size_t k = 0; k < BATCH_MESSAGES; k++)
+    decode_rows(batch_messages[k], in, which[k], std::vector<uint8_t>(which[k].size()), tables[k]);
+
+  // Then whatever follows a decoded frame, as a row of its tail message
+  for (size_t k = 0; k < BATCH_MESSAGES; k++) {
+    int tail = batch_messages[k].tail;
+    if (tail < 0)
+      continue;
+    struct table &t = tables[k];
+    std::vector<uint32_t> frame;
+    std::vector<uint8_t> start;
+    for (size_t r = 0; r < t.valid.size(); r++)
+      if (t.valid[r] && in.len[t.frame[r]] > t.end[r]) {
+        t.tail[r] = tables[tail].valid.size() + frame.size();
+        frame.push_back(t.frame[r]);
+        start.push_back(t.end[r]);
+      }
+    decode_rows(batch_messages[tail], in, frame, start, tables[tail]);
+  }
+}
+
+// Number.prototype.toString() of JavaScript: shortest round trip digits, exponent only when far from 1
+static void js_number(double v, char *text) {
+  if (v == 0) {
+    strcpy(text, "0");  // Also -0
+    return;
+  }
+  double a = fabs(v);
+  char *end;
+  if (a >= 1e-7 && a < 1e21) {
+    end = std::to_chars(text, text + 63, v, std::chars_format::fixed).ptr;
+  } else {
+    end = std::to_chars(text, text + 63, v, std::chars_format::scientific).ptr;
+    char *e = strchr(text, 'e');
+    if (e[1] == '+' || e[2] == '0') {
+      // 1e+21 and 1e-7, where C++ writes 1e+21 and 1e-07
+      char *digits = e + 2;
+      while (*digits == '0' && digits[1])
+        digits++;
+      memmove(e + 2, digits, end - digits);
+      end -= digits - (e + 2);
+    }
+  }
+  *end = 0;
+}
+
+static void print_row(const struct batch_message &m, const struct table &t, size_t r, const struct table *tail_table,
+                      const struct batch_message *tail_message, bool *first) {
+  char number[64];
+  for (size_t c = 0; c < m.columns; c++) {
+    double v = t.column[c][r];
+    const struct batch_column *column = &m.column[c];
+    if (column->hidden || isnan(v))
+      continue;
+    // A tail field of the same name replaces this one, where this one is
+    if (tail_table) {
+      int32_t row = t.tail[r];
+      for (size_t tc = 0; tc < tail_message->columns; tc++)
+        if (!strcmp(tail_message->column[tc].name, column->name) && !isnan(tail_table->column[tc][row])) {
+          v = tail_table->column[tc][row];
+          column = &tail_message->column[tc];
+        }
+    }
+    const char *name = column->enum_name ? column->enum_name(v) : NULL;
+    if (!name)
+      js_number(v, number);
+    printf(name ? "%s\"%s\":\"%s\"" : "%s\"%s\":%s", *first ? "" : ",", column->name, name ? name : number);
+    *first = false;
+  }
+}
+
+static void print_json(const struct frames &in, const std::vector<struct table> &tables) {
+  // Row of each frame in its message's table
+  std::vector<int32_t> message(in.port.size(), -1), row(in.port.size(), -1);
+  for (size_t k = 0; k < BATCH_MESSAGES; k++)
+    for (size_t r = 0; r < tables[k].frame.size(); r++)
+      if (row[tables[k].frame[r]] < 0 && in.port[tables[k].frame[r]] == batch_messages[k].port) {
+        message[tables[k].frame[r]] = k;
+        row[tables[k].frame[r]] = r;
+      }
+
+  for (size_t f = 0; f < in.port.size(); f++) {
+    bool first = true;
+    putchar('{');
+    if (message[f] >= 0 && tables[message[f]].valid[row[f]]) {
+      const struct batch_message &m = batch_messages[message[f]];
+      const struct table &t = tables[message[f]];
+      int32_t tail = t.tail[row[f]];
+      bool has_tail = tail >= 0 && tables[m.tail].valid[tail];
+      print_row(m, t, row[f], has_tail ? &tables[m.tail] : NULL, has_tail ? &batch_messages[m.tail] : NULL, &first);
+      if (has_tail) {
+        // Fields the frame did not have come after its own
+        struct table rest = tables[m.tail];
+        const struct batch_message &tm = batch_messages[m.tail];
+        for (size_t tc = 0; tc < tm.columns; tc++)
+          for (size_t c = 0; c < m.columns; c++)
+            if (!strcmp(tm.column[tc].name, m.column[c].name) && !isnan(t.column[c][row[f]]))
+              rest.column[tc][tail] = NAN;
+        print_row(tm, rest, tail, NULL, NULL, &first);
+      }
+    }
+    puts("}");
+  }
+}
+
+static bool write_columns(const char *dir, const std::vector<struct table> &tables) {
+  mkdir(dir, 0777);
+  for (size_t k = 0; k < BATCH_MESSAGES; k++) {
+    const struct batch_message &m = batch_messages[k];
+    const struct table &t = tables[k];
+    std::vector<uint32_t> frame;
+    for (size_t r = 0; r < t.valid.size(); r++)
+      if (t.valid[r])
+        frame.push_back(t.frame[r]);
+    if (frame.empty())
+      continue;
+    for (size_t c = 0; c <= m.columns; c++) {
+      if (c < m.columns && m.column[c].hidden)
+        continue;
+      std::string path = std::string(dir) + "/" + m.name + "." + (c < m.columns ? m.column[c].name : "frame");
+      FILE *f = fopen(path.c_str(), "wb");
+      if (!f) {
+        perror(path.c_str());
+        return false;
+      }
+      if (c == m.columns) {
+        fwrite(frame.data(), sizeof(uint32_t), frame.size(), f);
+      } else {
+        for (size_t r = 0; r < t.valid.size(); r++)
+          if (t.valid[r])
+            fwrite(&t.column[c][r], sizeof(double), 1, f);
+      }
+      if (fclose(f)) {
+        perror(path.c_str());
+        return false;
+      }
+    }
+    printf("%s: %zu rows\n", m.name, frame.size());
+  }
+  return true;
+}
+
+static void bench(size_t n) {
+  // Every uplink message alike, a quarter of them with telemetry behind
+  std::mt19937 rng(1);
+  struct frames in;
+  uint8_t payload[255];
+  for (size_t i = 0; i < n; i++) {
+    const struct batch_message &m = batch_messages[i % BATCH_MESSAGES];
+    size_t len = m.max_len + (m.tail >= 0 && rng() % 4 == 0 ? batch_messages[m.tail].max_len : 0);
+    for (size_t b = 0; b < len; b++)
+      payload[b] = rng();
+    if (m.port == BATCH_MAPPER_V2_PORT)
+      payload[0] = (payload[0] & 0x1F) | 2 << 5;
+    add_frame(in, m.port, payload, len);
+  }
+
+  std::vector<struct table> tables;
+  auto t0 = std::chrono::steady_clock::now();
+  decode_all(in, tables);
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  size_t rows = 0;
+  for (const struct table &t : tables)
+    for (uint8_t v : t.valid)
+      rows += v;
+  printf("%zu frames, %zu rows with the tails, in %.3f s: %.0f frames/s\n", n, rows, s, n / s);
+}
+
+int main(int argc, char **argv) {
+  bool hex = false, json = false;
+  const char *out = NULL, *path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--hex")) {
+      hex = true;
+    } else if (!strcmp(argv[i], "--json")) {
+      json = true;
+    } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+      out = argv[++i];
+    } else if (!strcmp(argv[i], "--bench") && i + 1 < argc) {
+      bench(strtoul(argv[++i], NULL, 10));
+      return 0;
+    } else if (argv[i][0] != '-' && !path) {
+      path = argv[i];
+    } else {
+      path = NULL;
+      break;
+    }
+  }
+  if (!path || json == (out != NULL)) {
+    fprintf(stderr, "Usage: %s [--hex] (--json | --out DIR) FILE\n       %s --bench FRAMES\n", argv[0], argv[0]);
+    return 2;
+  }
+
+  FILE *f = strcmp(path, "-") ? fopen(path, hex ? "r" : "rb") : stdin;
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  struct frames in;
+  bool ok = hex ? read_hex(f, in) : read_binary(f, in);
+  fclose(f);
+  if (!ok)
+    return 1;
+
+  std::vector<struct table> tables;
+  decode_all(in, tables);
+  if (json)
+    print_json(in, tables);
+  else if (!write_columns(out, tables))
+    return 1;
+  return 0;
+}
@@ -0,0 +1,897 @@
+import argparse
+import json
+import os
+import pprint
+import shutil
+import subprocess
+import sys
+import textwrap
+
+# Generates the payload codecs from payload_schema.json:
+#
+#   ../main/payload_codec.h      constexpr C++ for the firmware, golden vectors checked by static_assert
+#   payload_codec.py             Python, used by uplink_decoder.py and downlink_encoder.py
+#   unified_decoder.js           Console / ChirpStack decoder (and config downlink encoder)
+#   batch_codec.h                columnar C++ decoders for reprocessing stored uplinks, see batch_decode.cpp
+#
+# The "commands" downlink is a list of id/value pairs rather than a bit field,
+# so it gets its own table and is left out of the JS codec.
+#
+# A message with a "tail" may have that other message appended in the same
+# frame, from the next whole byte; the decoders merge its fields in.
+#
+# Before writing anything, the golden vectors in the schema are run through the
+# Python codec, and through the JS codec too when node is installed.
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SCHEMA = os.path.join(HERE, 'payload_schema.json')
+OUT_H = os.path.join(HERE, '..', 'main', 'payload_codec.h')
+OUT_PY = os.path.join(HERE, 'payload_codec.py')
+OUT_JS = os.path.join(HERE, 'unified_decoder.js')
+OUT_BATCH = os.path.join(HERE, 'batch_codec.h')
+
+GENERATED = 'Generated by console-decoders/codec_gen.py from payload_schema.json -- do not edit'
+
+# Runtime shared by the generated Python module, and exec'd here to check the vectors.
+PY_RUNTIME = r'''
+from decimal import Decimal, ROUND_HALF_UP
+
+
+def _to_fixed(value, digits):
+    # Same rounding as JavaScript toFixed(), so both decoders agree to the bit
+    return float(Decimal(value).quantize(Decimal(1).scaleb(-digits), rounding=ROUND_HALF_UP))
+
+
+def _present(field, raw):
+    when = field.get('when')
+    return when is None or (raw[when['field']] & when['mask']) != 0
+
+
+def _by_port(port, direction):
+    for message in MESSAGES:
+        if message['port'] == port and message['direction'] == direction:
+            return message
+    return None
+
+
+def _by_name(name):
+    for message in MESSAGES:
+        if message['name'] == name:
+            return message
+    raise KeyError(name)
+
+
+def encode_raw(name, raw):
+    """Pack a dict of wire-level integers into bytes"""
+    bits = []
+    for field in _by_name(name)['fields']:
+        if 'bits' not in field or not _present(field, raw):
+            continue
+        value = field['match'] if 'match' in field else raw.get(field['name'], 0)
+        value &= (1 << field['bits']) - 1
+        bits.extend((value >> (field['bits'] - 1 - i)) & 1 for i in range(field['bits']))
+    bits.extend([0] * (-len(bits) % 8))
+    return bytes(int(''.join(map(str, bits[i:i + 8])), 2) for i in range(0, len(bits), 8))
+
+
+def decode_raw(name, payload):
+    """Unpack bytes into a dict of wire-level integers, None if truncated or mismatched"""
+    raw = {}
+    pos = 0
+    for field in _by_name(name)['fields']:
+        if 'bits' not in field:
+            continue
+        if not _present(field, raw):
+            raw[field['name']] = 0
+            continue
+        if pos + field['bits'] > len(payload) * 8:
+            return None
+        value = 0
+        for _ in range(field['bits']):
+            value = (value << 1) | ((payload[pos >> 3] >> (7 - (pos & 7))) & 1)
+            pos += 1
+        if field.get('signed') and value & (1 << (field['bits'] - 1)):
+            value -= 1 << field['bits']
+        if 'match' in field:
+            if value != field['match']:
+                return None
+            continue
+        raw[field['name']] = value
+    return raw
+
+
+def _to_value(field, value):
+    if 'div' in field:
+        value = value / field['div']
+    if 'mul' in field:
+        value = value * field['mul']
+    if 'add' in field:
+        value = value + field['add']
+    if 'round' in field:
+        value = _to_fixed(value, field['round'])
+    return field.get('enum', {}).get(str(value), value)
+
+
+def _from_value(field, value):
+    if 'add' in field:
+        value = value - field['add']
+    if 'mul' in field:
+        value = value / field['mul']
+    if 'div' in field:
+        value = value * field['div']
+    return int(value)
+
+
+def _frame_len(message, raw):
+    """Bytes the frame itself takes, anything after it is the tail"""
+    bits = sum(field['bits'] for field in message['fields'] if 'bits' in field and _present(field, raw))
+    return (bits + 7) // 8
+
+
+def _decode_message(message, payload):
+    decoded = {}
+    raw = decode_raw(message['name'], payload)
+    if raw is None:
+        return decoded
+    for field in message['fields']:
+        if 'const' in field:
+            decoded[field['name']] = field['const']
+        elif field.get('hidden') or 'match' in field:
+            continue
+        elif _present(field, raw):
+            decoded[field['name']] = _to_value(field, raw[field['name']])
+        elif 'default' in field:
+            decoded[field['name']] = field['default']
+    # Another message may ride along after the frame, its fields join the result
+    if decoded and 'tail' in message:
+        decoded.update(_decode_message(_by_name(message['tail']), payload[_frame_len(message, raw):]))
+    return decoded
+
+
+def decode(port, payload, direction='uplink'):
+    """Decode a frame into the same dict the Console decoder produces"""
+    message = _by_port(port, direction)
+    if message is None:
+        return {}
+    return _decode_message(message, payload)
+
+
+def encode(name, values):
+    """Encode a dict of engineering values (as decode() returns them) into bytes"""
+    raw = {}
+    for field in _by_name(name)['fields']:
+        if 'bits' in field and field['name'] in values:
+            raw[field['name']] = _from_value(field, values[field['name']])
+    return encode_raw(name, raw)
+
+
+def _command(key):
+    for command in COMMANDS['list']:
+        if key in (command['id'], command['name']):
+            return command
+    raise KeyError(key)
+
+
+def encode_commands(values):
+    """Encode a list of (name, engineering value) into one command Downlink, raises ValueError when out of bounds"""
+    payload = b''
+    for name, value in values:
+        command = _command(name)
+        raw = round((value - command.get('add', 0)) * command.get('div', 1))
+        if not command['min'] <= raw <= command['max']:
+            raise ValueError('%s out of range' % name)
+        payload += bytes([command['id']]) + raw.to_bytes(command['bits'] // 8, 'big', signed=command.get('signed', False))
+    return payload
+
+
+def decode_commands(payload):
+    """Decode a command Downlink into a list of (name, wire value), None if anything in it is invalid"""
+    commands = []
+    pos = 0
+    while pos < len(payload):
+        try:
+            command = _command(payload[pos])
+        except KeyError:
+            return None
+        size = command['bits'] // 8
+        if pos + 1 + size > len(payload):
+            return None
+        raw = int.from_bytes(payload[pos + 1:pos + 1 + size], 'big', signed=command.get('signed', False))
+        if not command['min'] <= raw <= command['max']:
+            return None
+        commands.append((command['name'], raw))
+        pos += 1 + size
+    return commands
+'''
+
+JS_RUNTIME = r'''
+function readBits(bytes, state, count) {
+  var value = 0;
+  for (var i = 0; i < count; i++, state.pos++)
+    value = value * 2 + ((bytes[state.pos >> 3] >> (7 - (state.pos & 7))) & 1);
+  return value;
+}
+
+function present(field, raw) {
+  return !field.when || (raw[field.when.field] & field.when.mask) != 0;
+}
+
+function findMessage(port, direction) {
+  for (var i = 0; i < MESSAGES.length; i++)
+    if (MESSAGES[i].port == port && MESSAGES[i].direction == direction)
+      return MESSAGES[i];
+  return null;
+}
+
+function findMessageByName(name) {
+  for (var i = 0; i < MESSAGES.length; i++)
+    if (MESSAGES[i].name == name)
+      return MESSAGES[i];
+  return null;
+}
+
+function Decoder(bytes, port) {
+  var message = findMessage(port, "uplink");
+  if (!message)
+    return {};
+  return decodeMessage(message, bytes);
+}
+
+function decodeMessage(message, bytes) {
+  var decoded = {};
+
+  // Wire-level integers first, with length and version checks
+  var raw = {};
+  var state = { pos: 0 };
+  for (var i = 0; i < message.fields.length; i++) {
+    var field = message.fields[i];
+    if (field.bits === undefined)
+      continue;
+    if (!present(field, raw)) {
+      raw[field.name] = 0;
+      continue;
+    }
+    if (state.pos + field.bits > bytes.length * 8)
+      return decoded;
+    var value = readBits(bytes, state, field.bits);
+    if (field.signed && value >= Math.pow(2, field.bits - 1))
+      value -= Math.pow(2, field.bits);
+    if (field.match !== undefined) {
+      if (value != field.match)
+        return decoded;
+      continue;
+    }
+    raw[field.name] = value;
+  }
+
+  // Then engineering units
+  for (var j = 0; j < message.fields.length; j++) {
+    var f = message.fields[j];
+    if (f.const !== undefined) {
+      decoded[f.name] = f.const;
+    } else if (f.hidden || f.match !== undefined) {
+      continue;
+    } else if (present(f, raw)) {
+      var v = raw[f.name];
+      if (f.div !== undefined) v = v / f.div;
+      if (f.mul !== undefined) v = v * f.mul;
+      if (f.add !== undefined) v = v + f.add;
+      if (f.round !== undefined) v = parseFloat(v.toFixed(f.round));
+      if (f.enum && f.enum[v] !== undefined) v = f.enum[v];
+      decoded[f.name] = v;
+    } else if (f.default !== undefined) {
+      decoded[f.name] = f.default;
+    }
+  }
+
+  // Another message may ride along after the frame, its fields join the result
+  if (message.tail) {
+    var tail = decodeMessage(findMessageByName(message.tail), bytes.slice((state.pos + 7) >> 3));
+    for (var key in tail)
+      decoded[key] = tail[key];
+  }
+  return decoded;
+}
+
+// Downlink encoder, engineering values in, bytes out
+function Encoder(values, port) {
+  var message = findMessage(port, "downlink");
+  var bytes = [];
+  var bitCount = 0;
+  if (!message)
+    return bytes;
+  for (var i = 0; i < message.fields.length; i++) {
+    var field = message.fields[i];
+    if (field.bits === undefined)
+      continue;
+    var v = values[field.name] || 0;
+    if (field.add !== undefined) v = v - field.add;
+    if (field.mul !== undefined) v = v / field.mul;
+    if (field.div !== undefined) v = v * field.div;
+    v = v < 0 ? Math.ceil(v) : Math.floor(v);
+    for (var b = field.bits - 1; b >= 0; b--, bitCount++) {
+      if ((bitCount & 7) == 0)
+        bytes.push(0);
+      if (Math.floor(v / Math.pow(2, b)) % 2)
+        bytes[bytes.length - 1] |= 0x80 >> (bitCount & 7);
+    }
+  }
+  return bytes;
+}
+
+// Wrappers for ChirpStack V4:
+function decodeUplink(input) {
+  return {
+    data: Decoder(input.bytes, input.fPort)
+  };
+}
+
+function encodeDownlink(input) {
+  var port = input.fPort || 1;
+  return {
+    fPort: port,
+    bytes: Encoder(input.data, port)
+  };
+}
+'''
+
+
+def c_type(field):
+    bits = field['bits']
+    size = 8 if bits <= 8 else 16 if bits <= 16 else 32
+    return ('int%d_t' if field.get('signed') else 'uint%d_t') % size
+
+
+def c_number(value):
+    return repr(float(value))
+
+
+def wire_fields(message):
+    return [f for f in message['fields'] if 'bits' in f and 'match' not in f]
+
+
+def gen_cpp(messages, commands):
+    out = []
+    w = out.append
+    w('// ' + GENERATED)
+    w('#pragma once')
+    w('')
+    w('/**')
+    w(' * Payload codecs, header-only and allocation-free.')
+    w(' *')
+    w(' * Structs hold wire-level integers; codec_<field>_from() helpers convert')
+    w(' * engineering units with the same arithmetic the decoders use in reverse.')
+    w(' * Golden vectors from the schema are checked at compile time.')
+    w(' */')
+    w('')
+    w('#include <stddef.h>')
+    w('#include <stdint.h>')
+    w('')
+    w('constexpr void codec_put_bits(uint8_t *buf, size_t *pos, uint32_t value, uint8_t bits) {')
+    w('  while (bits) {')
+    w('    uint8_t room = 8 - (*pos & 7);  // Up to a byte at a time')
+    w('    uint8_t n = bits < room ? bits : room;')
+    w('    uint8_t mask = ((1u << n) - 1) << (room - n);')
+    w('    buf[*pos >> 3] = (buf[*pos >> 3] & ~mask) | (((value >> (bits - n)) << (room - n)) & mask);')
+    w('    bits -= n;')
+    w('    *pos += n;')
+    w('  }')
+    w('}')
+    w('')
+    w('constexpr uint32_t codec_get_bits(const uint8_t *buf, size_t *pos, uint8_t bits) {')
+    w('  uint32_t value = 0;')
+    w('  while (bits) {')
+    w('    uint8_t room = 8 - (*pos & 7);')
+    w('    uint8_t n = bits < room ? bits : room;')
+    w('    value = (value << n) | ((buf[*pos >> 3] >> (room - n)) & ((1u << n) - 1));')
+    w('    bits -= n;')
+    w('    *pos += n;')
+    w('  }')
+    w('  return value;')
+    w('}')
+    w('')
+    w('constexpr int32_t codec_sign_extend(uint32_t value, uint8_t bits) {')
+    w('  if (bits >= 32)')
+    w('    return (int32_t)value;')
+    w('  return (int32_t)(value ^ (1u << (bits - 1))) - (int32_t)(1u << (bits - 1));')
+    w('}')
+
+    for m in messages:
+        name = m['name']
+        upper = name.upper()
+        fields = wire_fields(m)
+        all_bits = [f for f in m['fields'] if 'bits' in f]
+        min_bits = sum(f['bits'] for f in all_bits if 'when' not in f)
+        max_bits = sum(f['bits'] for f in all_bits)
+        w('')
+        w('/** %s (%s, FPort %d) */' % (m.get('comment', name), m['direction'], m['port']))
+        w('constexpr uint8_t CODEC_%s_PORT = %d;' % (upper, m['port']))
+        w('constexpr size_t CODEC_%s_MIN_LEN = %d;' % (upper, (min_bits + 7) // 8))
+        w('constexpr size_t CODEC_%s_MAX_LEN = %d;' % (upper, (max_bits + 7) // 8))
+        w('')
+        w('struct codec_%s {' % name)
+        width = max(len(c_type(f)) + len(f['name']) for f in fields) + 2
+        for f in fields:
+            decl = '  %s %s;' % (c_type(f), f['name'])
+            if f.get('comment'):
+                decl = decl.ljust(width + 3) + '  // ' + f['comment']
+            w(decl)
+        w('};')
+
+        for f in fields:
+            if not any(k in f for k in ('div', 'mul', 'add')):
+                continue
+            expr = 'v'
+            if 'add' in f:
+                expr = '(%s %s %s)' % (expr, '+' if f['add'] < 0 else '-', c_number(abs(f['add'])))
+            if 'mul' in f:
+                expr = '%s / %s' % (expr, c_number(f['mul']))
+            if 'div' in f:
+                expr = '%s * %s' % (expr, c_number(f['div']))
+            w('')
+            w('constexpr %s codec_%s_%s_from(double v) {' % (c_type(f), name, f['name']))
+            w('  return (%s)(%s);' % (c_type(f), expr))
+            w('}')
+
+        w('')
+        w('/** Returns the frame length */')
+        w('constexpr size_t codec_encode_%s(uint8_t *buf, const struct codec_%s *m) {' % (name, name))
+        w('  size_t pos = 0;')
+        for f in all_bits:
+            value = str(f['match']) if 'match' in f else '(uint32_t)m->%s' % f['name']
+            if 'when' in f:
+                w('  if (m->%s & %d)' % (f['when']['field'], f['when']['mask']))
+                w('    codec_put_bits(buf, &pos, %s, %d);' % (value, f['bits']))
+            else:
+                w('  codec_put_bits(buf, &pos, %s, %d);' % (value, f['bits']))
+        w('  codec_put_bits(buf, &pos, 0, (8 - (pos & 7)) & 7);')
+        w('  return pos >> 3;')
+        w('}')
+        w('')
+        w('/** False if the frame is truncated or of another version */')
+        w('constexpr bool codec_decode_%s(const uint8_t *buf, size_t len, struct codec_%s *m) {' % (name, name))
+        w('  size_t pos = 0;')
+        for f in all_bits:
+            indent = '  '
+            if 'when' in f:
+                w('  m->%s = 0;' % f['name'])
+                w('  if (m->%s & %d) {' % (f['when']['field'], f['when']['mask']))
+                indent = '    '
+            w('%sif (pos + %d > len * 8)' % (indent, f['bits']))
+            w('%s  return false;' % indent)
+            if 'match' in f:
+                w('%sif (codec_get_bits(buf, &pos, %d) != %d)' % (indent, f['bits'], f['match']))
+                w('%s  return false;' % indent)
+            elif f.get('signed'):
+                w('%sm->%s = codec_sign_extend(codec_get_bits(buf, &pos, %d), %d);' %
+                  (indent, f['name'], f['bits'], f['bits']))
+            else:
+                w('%sm->%s = codec_get_bits(buf, &pos, %d);' % (indent, f['name'], f['bits']))
+            if 'when' in f:
+                w('  }')
+        w('  return true;')
+        w('}')
+
+    gen_cpp_commands(w, commands)
+
+    # Golden vectors: encode must give the bytes, decode must give the struct back
+    w('')
+    w('// Golden vectors, shared with the JS and Python codecs')
+    for m in messages:
+        name = m['name']
+        fields = wire_fields(m)
+        for n, vector in enumerate(m.get('vectors', [])):
+            want = bytes.fromhex(vector['hex'])
+            init = ', '.join('(%s)%d' % (c_type(f), vector['raw'].get(f['name'], 0)) for f in fields)
+            w('')
+            w('constexpr bool codec_golden_%s_%d() {' % (name, n))
+            w('  const uint8_t want[] = {%s};' % ', '.join('0x%02X' % b for b in want))
+            w('  struct codec_%s m = {%s};' % (name, init))
+            w('  struct codec_%s back = {};' % name)
+            w('  uint8_t buf[CODEC_%s_MAX_LEN] = {};' % name.upper())
+            w('  if (codec_encode_%s(buf, &m) != sizeof(want))' % name)
+            w('    return false;')
+            w('  for (size_t i = 0; i < sizeof(want); i++)')
+            w('    if (buf[i] != want[i])')
+            w('      return false;')
+            w('  if (!codec_decode_%s(want, sizeof(want), &back))' % name)
+            w('    return false;')
+            w('  return ' + ' && '.join('back.%s == m.%s' % (f['name'], f['name']) for f in fields) + ';')
+            w('}')
+            w('static_assert(codec_golden_%s_%d(), "%s golden vector %d");' % (name, n, name, n))
+    for n, vector in enumerate(commands.get('vectors', [])):
+        want = bytes.fromhex(vector['hex'])
+        w('')
+        w('constexpr bool codec_golden_command_%d() {' % n)
+        w('  const uint8_t want[] = {%s};' % ', '.join('0x%02X' % b for b in want))
+        w('  const uint8_t id[] = {%s};' % ', '.join('CODEC_CMD_%s' % c[0].upper() for c in vector['raw']))
+        w('  const int32_t value[] = {%s};' % ', '.join(str(c[1]) for c in vector['raw']))
+        w('  size_t pos = 0;')
+        w('  for (size_t i = 0; i < sizeof(id); i++) {')
+        w('    uint8_t got_id = 0;')
+        w('    int32_t got_value = 0;')
+        w('    size_t used = codec_decode_command(want + pos, sizeof(want) - pos, &got_id, &got_value);')
+        w('    if (!used || got_id != id[i] || got_value != value[i])')
+        w('      return false;')
+        w('    pos += used;')
+        w('  }')
+        w('  return pos == sizeof(want);')
+        w('}')
+        w('static_assert(codec_golden_command_%d(), "command golden vector %d");' % (n, n))
+    return '\n'.join(out) + '\n'
+
+
+def gen_cpp_commands(w, commands):
+    w('')
+    w('/** %s (downlink, FPort %d) */' % (commands['comment'], commands['port']))
+    w('constexpr uint8_t CODEC_COMMAND_PORT = %d;' % commands['port'])
+    w('')
+    w('enum codec_command_id {')
+    for c in commands['list']:
+        w('  CODEC_CMD_%s = %d,' % (c['name'].upper(), c['id']))
+    w('};')
+    w('')
+    w('/** Wire-level bounds, inclusive */')
+    w('struct codec_command {')
+    w('  uint8_t id;')
+    w('  uint8_t size;  // Bytes after the id')
+    w('  bool is_signed;')
+    w('  int32_t min;')
+    w('  int32_t max;')
+    w('  const char *name;')
+    w('};')
+    w('')
+    w('constexpr struct codec_command codec_commands[] = {')
+    for c in commands['list']:
+        if c['bits'] % 8:
+            raise ValueError('command %s is not whole bytes' % c['name'])
+        w('    {CODEC_CMD_%s, %d, %s, %d, %d, "%s"},' %
+          (c['name'].upper(), c['bits'] // 8, 'true' if c.get('signed') else 'false', c['min'], c['max'], c['name']))
+    w('};')
+    w('constexpr size_t CODEC_COMMANDS = sizeof(codec_commands) / sizeof(codec_commands[0]);')
+    w('')
+    w('/** NULL for an unknown id */')
+    w('constexpr const struct codec_command *codec_command_find(uint8_t id) {')
+    w('  for (size_t i = 0; i < CODEC_COMMANDS; i++)')
+    w('    if (codec_commands[i].id == id)')
+    w('      return &codec_commands[i];')
+    w('  return nullptr;')
+    w('}')
+    w('')
+    w('constexpr bool codec_command_valid(uint8_t id, int32_t value) {')
+    w('  return codec_command_find(id) && value >= codec_command_find(id)->min && value <= codec_command_find(id)->max;')
+    w('}')
+    w('')
+    w('/** Decodes the command at buf, returns the bytes used or 0 if unknown, truncated or out of bounds */')
+    w('constexpr size_t codec_decode_command(const uint8_t *buf, size_t len, uint8_t *id, int32_t *value) {')
+    w('  if (len < 1 || !codec_command_find(buf[0]))')
+    w('    return 0;')
+    w('  const struct codec_command *c = codec_command_find(buf[0]);')
+    w('  if (len < 1u + c->size)')
+    w('    return 0;')
+    w('  size_t pos = 8;')
+    w('  uint32_t raw = codec_get_bits(buf, &pos, c->size * 8);')
+    w('  int32_t v = c->is_signed ? codec_sign_extend(raw, c->size * 8) : (int32_t)raw;')
+    w('  if (!codec_command_valid(c->id, v))')
+    w('    return 0;')
+    w('  *id = c->id;')
+    w('  *value = v;')
+    w('  return 1 + c->size;')
+    w('}')
+
+
+
+BATCH_RUNTIME = r'''
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/** Frames are copied into slots this much longer than they can be, so bit reads never need a length check */
+constexpr size_t BATCH_PAD = 8;
+
+/** Big endian bits from any bit offset, up to 32 of them */
+static inline uint32_t batch_bits(const uint8_t *frame, uint32_t pos, uint8_t bits) {
+  uint64_t v = 0;
+  for (int k = 0; k < 8; k++)
+    v = v << 8 | frame[(pos >> 3) + k];
+  return (uint32_t)(v << (pos & 7) >> (64 - bits));
+}
+
+/**
+ * parseFloat(v.toFixed(digits)) from JavaScript, to the bit.  toFixed rounds the
+ * exact binary value half away from zero, and the decimal it prints reads back
+ * as n / 10^digits correctly rounded, which is what the division gives.  Only
+ * values within rounding error of a tie need the exact decimal expansion.
+ */
+static inline double batch_to_fixed(double v, int digits) {
+  static const double scale[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+  double a = fabs(v);
+  double s = a * scale[digits];
+  double n = floor(s);
+  double frac = s - n;
+  if (fabs(frac - 0.5) > 1e-6) {
+    n = frac > 0.5 ? n + 1 : n;
+  } else {
+    // 30 more digits tell a tie from a near miss for any value a field can hold
+    char text[96];
+    snprintf(text, sizeof(text), "%.*f", digits + 30, a);
+    char *dot = strchr(text, '.');
+    bool up = dot[digits + 1] >= '5';
+    n = 0;
+    for (char *c = text; *c && c < dot + 1 + digits; c++)
+      if (*c != '.')
+        n = n * 10 + (*c - '0');
+    if (up)
+      n += 1;
+  }
+  double r = n / scale[digits];
+  return v < 0 ? -r : r;
+}
+'''.lstrip('\n')
+
+
+def gen_batch(messages):
+    out = []
+    w = out.append
+    w('// ' + GENERATED)
+    w('#pragma once')
+    w('')
+    w('/**')
+    w(' * Batch decoders for stored uplinks, host side.')
+    w(' *')
+    w(' * Each decodes many frames of one message into a column per field, one field')
+    w(' * at a time, so the loops are short and straight enough to vectorise.  Values')
+    w(' * are the ones unified_decoder.js returns, to the bit: enums stay as their')
+    w(' * number, absent optional fields are NaN, hidden fields are kept.  Build with')
+    w(' * -ffp-contract=off, as a fused multiply-add rounds differently from JS.')
+    w(' */')
+    w('')
+    w(BATCH_RUNTIME.rstrip('\n'))
+
+    for m in messages:
+        if m['direction'] != 'uplink':
+            continue
+        name = m['name']
+        upper = name.upper()
+        all_bits = [f for f in m['fields'] if 'bits' in f]
+        columns = [f for f in m['fields'] if 'match' not in f]
+        max_bits = sum(f['bits'] for f in all_bits)
+        w('')
+        w('/** %s (FPort %d) */' % (m.get('comment', name), m['port']))
+        w('constexpr uint8_t BATCH_%s_PORT = %d;' % (upper, m['port']))
+        w('constexpr size_t BATCH_%s_MAX_LEN = %d;' % (upper, (max_bits + 7) // 8))
+        w('constexpr size_t BATCH_%s_STRIDE = %d;' % (upper, ((max_bits + 7) // 8 + 8 + 7) // 8 * 8))
+        w('')
+        w('struct batch_%s {' % name)
+        for f in columns:
+            w('  double *%s;' % f['name'])
+        w('  uint8_t *valid;  // 0 where the decoders return nothing: truncated, or another version')
+        if 'tail' in m:
+            w('  uint8_t *end;    // Byte the %s tail starts at' % m['tail'])
+        w('};')
+
+        for f in columns:
+            if 'enum' not in f:
+                continue
+            w('')
+            w('static inline const char *batch_%s_%s_name(double v) {' % (name, f['name']))
+            for key, text in f['enum'].items():
+                w('  if (v == %s)' % key)
+                w('    return "%s";' % text)
+            w('  return NULL;')
+            w('}')
+
+        # Bit offsets are constants up to the first optional field, then depend on the flags read before
+        w('')
+        w('/** n frames, BATCH_%s_STRIDE bytes apart and zero padded, with their lengths in len */' % upper)
+        head = 'static inline void batch_decode_%s(' % name
+        w(head + 'const uint8_t *frames, const uint8_t *len, size_t n,')
+        w(' ' * len(head) + 'const struct batch_%s &out) {' % name)
+        w('  const size_t stride = BATCH_%s_STRIDE;' % upper)
+        fixed = 0
+        optional = []
+
+        def offset():
+            # Optional fields behind the same flag are added up, to keep the expression short
+            flagged = {}
+            for o in optional:
+                key = (o['when']['field'], o['when']['mask'])
+                flagged[key] = flagged.get(key, 0) + o['bits']
+            return ' + '.join([str(fixed)] + ['((uint32_t)out.%s[i] & %d ? %d : 0)' % (field, mask, bits)
+                                              for (field, mask), bits in flagged.items()])
+
+        def present(f):
+            return '(uint32_t)out.%s[i] & %d' % (f['when']['field'], f['when']['mask'])
+
+        checks = []
+        for f in all_bits:
+            if 'match' in f:
+                checks.append('batch_bits(frames + i * stride, %s, %d) == %d' % (offset(), f['bits'], f['match']))
+            else:
+                w('  for (size_t i = 0; i < n; i++) {')
+                if optional:
+                    w('    uint32_t pos = %s;' % offset())
+                    w('    double v = batch_bits(frames + i * stride, pos, %d);' % f['bits'])
+                else:
+                    w('    double v = batch_bits(frames + i * stride, %d, %d);' % (fixed, f['bits']))
+                if f.get('signed'):
+                    w('    v = v >= %s ? v - %s : v;' % (c_number(2 ** (f['bits'] - 1)), c_number(2 ** f['bits'])))
+                for key, op in (('div', '/'), ('mul', '*'), ('add', '+')):
+                    if key in f:
+                        w('    v = v %s %s;' % (op, c_number(f[key])))
+                if 'round' in f:
+                    w('    v = batch_to_fixed(v, %d);' % f['round'])
+                if 'when' in f:
+                    absent = c_number(f['default']) if 'default' in f else 'NAN'
+                    w('    out.%s[i] = %s ? v : %s;' % (f['name'], present(f), absent))
+                else:
+                    w('    out.%s[i] = v;' % f['name'])
+                w('  }')
+            if 'when' in f:
+                optional.append(f)
+            else:
+                fixed += f['bits']
+        for f in columns:
+            if 'const' in f:
+                w('  for (size_t i = 0; i < n; i++)')
+                w('    out.%s[i] = %s;' % (f['name'], c_number(f['const'])))
+        w('  for (size_t i = 0; i < n; i++) {')
+        w('    uint32_t bits = %s;' % offset())
+        checks.insert(0, 'len[i] * 8u >= bits')
+        w('    out.valid[i] = %s;' % ' && '.join(checks))
+        if 'tail' in m:
+            w('    out.end[i] = (bits + 7) >> 3;')
+        w('  }')
+        w('}')
+
+    # The same decoders by table, for tools that handle every message alike
+    uplinks = [m for m in messages if m['direction'] == 'uplink']
+    names = [m['name'] for m in uplinks]
+    w('')
+    w('struct batch_column {')
+    w('  const char *name;')
+    w('  bool hidden;                           // Left out by the decoders, kept for the optional fields')
+    w('  const char *(*enum_name)(double);      // NULL if not an enum')
+    w('};')
+    w('')
+    w('struct batch_message {')
+    w('  const char *name;')
+    w('  uint8_t port;')
+    w('  size_t max_len;')
+    w('  size_t stride;')
+    w('  int tail;                              // Index in batch_messages, -1 if none')
+    w('  size_t columns;')
+    w('  const struct batch_column *column;')
+    w('  void (*decode)(const uint8_t *frames, const uint8_t *len, size_t n, double *const *column, uint8_t *valid,')
+    w('                 uint8_t *end);')
+    w('};')
+    for m in uplinks:
+        name = m['name']
+        columns = [f for f in m['fields'] if 'match' not in f]
+        w('')
+        w('static const struct batch_column batch_%s_columns[] = {' % name)
+        for f in columns:
+            w('    {"%s", %s, %s},' % (f['name'], 'true' if f.get('hidden') else 'false',
+                                     'batch_%s_%s_name' % (name, f['name']) if 'enum' in f else 'NULL'))
+        w('};')
+        w('')
+        head = 'static inline void batch_decode_%s_columns(' % name
+        w(head + 'const uint8_t *frames, const uint8_t *len, size_t n,')
+        w(' ' * len(head) + 'double *const *column, uint8_t *valid, uint8_t *end) {')
+        members = ['column[%d]' % k for k in range(len(columns))] + ['valid'] + (['end'] if 'tail' in m else [])
+        if 'tail' not in m:
+            w('  (void)end;')
+        call = '  batch_decode_%s(frames, len, n, {' % name
+        for line in textwrap.wrap(', '.join(members) + '});', 118 - len(call), break_on_hyphens=False):
+            w(call + line)
+            call = ' ' * len(call)
+        w('}')
+    w('')
+    w('static const struct batch_message batch_messages[] = {')
+    for m in uplinks:
+        upper = m['name'].upper()
+        w('    {"%s", BATCH_%s_PORT, BATCH_%s_MAX_LEN, BATCH_%s_STRIDE, %d, %d, batch_%s_columns,' %
+          (m['name'], upper, upper, upper, names.index(m['tail']) if 'tail' in m else -1,
+           len([f for f in m['fields'] if 'match' not in f]), m['name']))
+        w('     batch_decode_%s_columns},' % m['name'])
+    w('};')
+    w('')
+    w('constexpr size_t BATCH_MESSAGES = %d;' % len(uplinks))
+    return '\n'.join(out) + '\n'
+
+def tables(messages):
+    # The schema minus the golden vectors, embedded in the generated codecs
+    return [dict((k, v) for k, v in m.items() if k != 'vectors') for m in messages]
+
+
+def gen_py(messages, commands):
+    return ('# ' + GENERATED + '\n' +
+            '#\n# Payload codec for the Mapper, table-driven from the schema below.\n' +
+            PY_RUNTIME.replace('\nfrom decimal', 'from decimal', 1).rstrip('\n') + '\n\n\n' +
+            'MESSAGES = ' + pprint.pformat(tables(messages), width=110, sort_dicts=False) + '\n\n' +
+            'COMMANDS = ' + pprint.pformat(tables([commands])[0], width=110, sort_dicts=False) + '\n')
+
+
+def gen_js(messages):
+    return ('// ' + GENERATED + '\n'
+            '//\n'
+            '// Decoder for MaxPlastix mappers, paste into the Console custom function.\n'
+            '//\n'
+            '// Port 2: 3 Lat, 3 Long, 2 Altitude (m), 1 Sats.\n'
+            '// Port 3: bit-packed v2 Mapper payload with optional accuracy, speed and heading.\n'
+            '// Port 5: System status.  Port 6: Lost GPS.\n'
+            '// Port 7: Telemetry, which may also follow any of the frames above in the same uplink.\n'
+            '// Accuracy is a dummy value required by some Integrations when the device does not send one.\n'
+            '//\n\n' +
+            'var MESSAGES = ' + json.dumps(tables(messages), indent=2) + ';\n' + JS_RUNTIME)
+
+
+def check_vectors(messages, commands, js_source):
+    codec = {'MESSAGES': messages, 'COMMANDS': commands}
+    exec(PY_RUNTIME, codec)
+    failed = False
+    for n, vector in enumerate(commands.get('vectors', [])):
+        raw = [tuple(c) for c in vector['raw']]
+        got = ''.join('%02X%s' % (codec['_command'](name)['id'],
+                                  value.to_bytes(codec['_command'](name)['bits'] // 8, 'big',
+                                                 signed=codec['_command'](name).get('signed', False)).hex().upper())
+                      for name, value in raw)
+        if got != vector['hex'].upper() or codec['decode_commands'](bytes.fromhex(vector['hex'])) != raw:
+            print('command vector %d: encoded %s' % (n, got))
+            failed = True
+    cases = []
+    for m in messages:
+        for n, vector in enumerate(m.get('vectors', [])):
+            got = codec['encode_raw'](m['name'], vector['raw']).hex().upper()
+            back = codec['decode_raw'](m['name'], bytes.fromhex(vector['hex']))
+            want_raw = dict((f['name'], vector['raw'].get(f['name'], 0)) for f in wire_fields(m))
+            if got != vector['hex'].upper() or back != want_raw:
+                print('%s vector %d: encoded %s, decoded %s' % (m['name'], n, got, back))
+                failed = True
+            if m['direction'] == 'uplink':
+                cases.append((m['port'], vector['hex'], codec['decode'](m['port'], bytes.fromhex(vector['hex']))))
+        # The frame with its tail message appended, which both decoders must merge the same way
+        if 'tail' in m and m.get('vectors'):
+            tail = codec['_by_name'](m['tail'])
+            joined = m['vectors'][0]['hex'] + tail['vectors'][0]['hex']
+            decoded = codec['decode'](m['port'], bytes.fromhex(joined))
+            if not set(f['name'] for f in wire_fields(tail)) <= set(decoded):
+                print('%s with %s tail: decoded %s' % (m['name'], tail['name'], decoded))
+                failed = True
+            cases.append((m['port'], joined, decoded))
+
+    node = shutil.which('node')
+    if node:
+        script = js_source + '\nvar cases = ' + json.dumps([[c[0], c[1]] for c in cases]) + ';\n' + \
+            'console.log(JSON.stringify(cases.map(function (c) {\n' + \
+            '  return Decoder(Buffer.from(c[1], "hex"), c[0]);\n})));\n'
+        result = json.loads(subprocess.run([node, '-e', script], check=True, capture_output=True).stdout)
+        for (port, hex_payload, want), got in zip(cases, result):
+            if got != want:
+                print('JS and Python disagree on port %d %s:\n  %s\n  %s' % (port, hex_payload, got, want))
+                failed = True
+    else:
+        print('node not found, JS decoder not checked')
+    return not failed
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Generate the Mapper payload codecs from payload_schema.json.')
+    parser.add_argument('--check', action='store_true', help='Only check the golden vectors, write nothing')
+    args = parser.parse_args()
+
+    with open(SCHEMA) as f:
+        schema = json.load(f)
+    messages = schema['messages']
+    commands = schema['commands']
+    js_source = gen_js(messages)
+    if not check_vectors(messages, commands, js_source):
+        sys.exit('Golden vectors failed, nothing written.')
+    if not args.check:
+        for path, text in ((OUT_H, gen_cpp(messages, commands)), (OUT_PY, gen_py(messages, commands)),
+                           (OUT_JS, js_source), (OUT_BATCH, gen_batch(messages))):
+            with open(path, 'w', newline='\n') as f:
+                f.write(text)
+            print('Wrote ' + os.path.normpath(path))
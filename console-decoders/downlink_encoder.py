@@ -1,13 +1,47 @@
 import base64
 import argparse
-import struct
+import sys
+
+import payload_codec
 
 parser = argparse.ArgumentParser(description='Encode a downlink payload for a Helium mapper.')
 parser.add_argument('--distance', '-d', type=int, help='Map distance interval (meters)')
 parser.add_argument('--time', '-t', type=int, help='Minimum time interval (seconds)')
 parser.add_argument('--cutoffvolts', '-c', type=float, help='Low Voltage Power Off (volts)')
+parser.add_argument('--sf', '-s', type=int, help='Spreading Factor (7 to 10)')
+parser.add_argument('--power', '-p', type=int, help='Tx Power (dBm)')
+parser.add_argument('--deadzone', nargs=2, type=float, metavar=('LAT', 'LON'), help='Deadzone center')
+parser.add_argument('--radius', '-r', type=int, help='Deadzone radius (meters), 0 disables')
 args = parser.parse_args()
 
+# Any of the newer settings needs the command Downlink on its own FPort, which
+# also carries the classic ones.  These are bounds-checked against the schema.
+if args.sf is not None or args.power is not None or args.deadzone or args.radius is not None:
+    commands = []
+    if args.distance:
+        commands.append(('distance', args.distance))
+    if args.time:
+        commands.append(('time_interval', args.time))
+    if args.cutoffvolts:
+        commands.append(('cutoff_volts', args.cutoffvolts))
+    if args.sf is not None:
+        commands.append(('sf', args.sf))
+    if args.power is not None:
+        commands.append(('tx_power', args.power))
+    if args.deadzone:
+        commands.append(('deadzone_lat', args.deadzone[0]))
+        commands.append(('deadzone_lon', args.deadzone[1]))
+    if args.radius is not None:
+        commands.append(('deadzone_radius', args.radius))
+    try:
+        payload = payload_codec.encode_commands(commands)
+    except ValueError as e:
+        parser.error(e)
+    print('FPort %d' % payload_codec.COMMANDS['port'])
+    print(payload.hex(' ').upper())
+    print(str(base64.b64encode(payload), "utf-8"))
+    sys.exit(0)
+
 distance = 0
 if args.distance and args.distance > 0 and args.distance < 0xFFFF:
     distance = args.distance
@@ -23,7 +57,8 @@ if args.cutoffvolts and args.cutoffvolts >= 2.1 and args.cutoffvolts < 4.56:
     cutoffvolts = args.cutoffvolts
     
 
-payload = struct.pack('>HHB', distance, time_interval, int((cutoffvolts - 2.0) * 100))
+payload = payload_codec.encode('config', {'distance': distance, 'time_interval': time_interval,
+                                          'cutoff_volts': cutoffvolts})
 encodedBytes = base64.b64encode(payload)
 encodedStr = str(encodedBytes, "utf-8")
 print(payload.hex(' ').upper())
@@ -0,0 +1,1116 @@
+// Uplink store: takes the same webhook POSTs as AppsScript-doPost.js, for a
+// fleet and for years instead of one spreadsheet.
+//
+//   c++ -O2 -std=c++17 -pthread -o ingest ingest.cpp
+//   ./ingest serve --data uplinks --listen 8080
+//   ./ingest query --data uplinks --dev 044E31696F7F04DE --from 2025-06-01 --to 2025-06-02
+//   ./ingest bench
+//
+// Point the Helium or TTN webhook at http://<host>:8080/.  A POST may carry one
+// uplink or a JSON list of them.  Requests only parse and queue; one writer
+// thread gathers them into batches, computes the derived columns for a whole
+// batch at once, and appends.
+//
+// On disk there is one folder per UTC day with a file per column, laid out as
+// uplink_store.h describes.  If a write is cut short, the next start trims
+// every column to the shortest, so a day never holds a half row.
+//
+//   GET /uplinks?dev=<EUI>&from=<date or time>&to=<date or time>
+//
+// returns the matching rows as a JSON list, oldest first.  Stop the server
+// with Ctrl-C or SIGTERM, which writes out what is queued first.
+
+#include <math.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "uplink_store.h"
+
+#define R_EARTH_M 6378137.0             // As the Apps Script
+#define HTTP_MAX_HEADER 16384           // Bytes
+#define HTTP_MAX_BODY (16 * 1024 * 1024)
+#define HTTP_TIMEOUT_S 30               // For a client that stops sending
+#define JSON_MAX_DEPTH 64
+#define QUERY_END_MS (INT64_C(1) << 62)
+
+// A parsed JSON value, as much of JSON as webhooks need
+struct json {
+  enum { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT } type = NUL;
+  double number = 0;              // Also 1 and 0 for true and false
+  std::string text;               // A string, or a number as it was written
+  std::vector<std::string> keys;  // Of an object, in order
+  std::vector<struct json> items;  // Of an array, or the values of an object
+};
+
+struct json_parser {
+  const char *p;
+  const char *end;
+  int depth;
+};
+
+static void json_space(struct json_parser &in) {
+  while (in.p < in.end && (*in.p == ' ' || *in.p == '\t' || *in.p == '\n' || *in.p == '\r'))
+    in.p++;
+}
+
+static void utf8_append(std::string &out, uint32_t c) {
+  if (c < 0x80) {
+    out += (char)c;
+  } else if (c < 0x800) {
+    out += (char)(0xC0 | c >> 6);
+    out += (char)(0x80 | (c & 0x3F));
+  } else if (c < 0x10000) {
+    out += (char)(0xE0 | c >> 12);
+    out += (char)(0x80 | (c >> 6 & 0x3F));
+    out += (char)(0x80 | (c & 0x3F));
+  } else {
+    out += (char)(0xF0 | c >> 18);
+    out += (char)(0x80 | (c >> 12 & 0x3F));
+    out += (char)(0x80 | (c >> 6 & 0x3F));
+    out += (char)(0x80 | (c & 0x3F));
+  }
+}
+
+static bool json_hex4(struct json_parser &in, uint32_t *c) {
+  if (in.end - in.p < 4)
+    return false;
+  auto r = std::from_chars(in.p, in.p + 4, *c, 16);
+  if (r.ptr != in.p + 4)
+    return false;
+  in.p += 4;
+  return true;
+}
+
+static bool json_string(struct json_parser &in, std::string &out) {
+  in.p++;  // The quote
+  while (in.p < in.end && *in.p != '"') {
+    if ((uint8_t)*in.p < 0x20)
+      return false;
+    if (*in.p != '\\') {
+      out += *in.p++;
+      continue;
+    }
+    if (++in.p == in.end)
+      return false;
+    char e = *in.p++;
+    switch (e) {
+      case '"':
+      case '\\':
+      case '/':
+        out += e;
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'u': {
+        uint32_t c, low;
+        if (!json_hex4(in, &c))
+          return false;
+        // A surrogate pair is one character
+        if (c >= 0xD800 && c < 0xDC00 && in.end - in.p >= 6 && in.p[0] == '\\' && in.p[1] == 'u') {
+          in.p += 2;
+          if (!json_hex4(in, &low) || low < 0xDC00 || low >= 0xE000)
+            return false;
+          c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+        }
+        utf8_append(out, c);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  if (in.p == in.end)
+    return false;
+  in.p++;
+  return true;
+}
+
+static bool json_value(struct json_parser &in, struct json &out) {
+  json_space(in);
+  if (in.p == in.end || ++in.depth > JSON_MAX_DEPTH)
+    return false;
+  bool ok = true;
+  char c = *in.p;
+  if (c == '{' || c == '[') {
+    out.type = c == '{' ? json::OBJECT : json::ARRAY;
+    char close = c == '{' ? '}' : ']';
+    in.p++;
+    json_space(in);
+    if (in.p < in.end && *in.p == close) {
+      in.p++;
+    } else {
+      for (;;) {
+        if (out.type == json::OBJECT) {
+          json_space(in);
+          out.keys.emplace_back();
+          if (in.p == in.end || *in.p != '"' || !json_string(in, out.keys.back()))
+            return false;
+          json_space(in);
+          if (in.p == in.end || *in.p++ != ':')
+            return false;
+        }
+        out.items.emplace_back();
+        if (!json_value(in, out.items.back()))
+          return false;
+        json_space(in);
+        if (in.p == in.end)
+          return false;
+        if (*in.p == ',') {
+          in.p++;
+        } else if (*in.p++ == close) {
+          break;
+        } else {
+          return false;
+        }
+      }
+    }
+  } else if (c == '"') {
+    out.type = json::STRING;
+    ok = json_string(in, out.text);
+  } else if (!strncmp(in.p, "true", std::min<size_t>(4, in.end - in.p)) && in.end - in.p >= 4) {
+    out.type = json::BOOL;
+    out.number = 1;
+    in.p += 4;
+  } else if (!strncmp(in.p, "false", std::min<size_t>(5, in.end - in.p)) && in.end - in.p >= 5) {
+    out.type = json::BOOL;
+    in.p += 5;
+  } else if (!strncmp(in.p, "null", std::min<size_t>(4, in.end - in.p)) && in.end - in.p >= 4) {
+    in.p += 4;
+  } else {
+    const char *start = in.p;
+    while (in.p < in.end && strchr("+-0123456789.eE", *in.p))
+      in.p++;
+    out.type = json::NUMBER;
+    out.text.assign(start, in.p);
+    auto r = std::from_chars(start, in.p, out.number);
+    ok = in.p > start && r.ptr == in.p && r.ec == std::errc();
+  }
+  in.depth--;
+  return ok;
+}
+
+static bool json_parse(const char *text, size_t len, struct json &out) {
+  struct json_parser in = {text, text + len, 0};
+  if (!json_value(in, out))
+    return false;
+  json_space(in);
+  return in.p == in.end;
+}
+
+// Member of an object, NULL when it is missing or this is not an object
+static const struct json *json_get(const struct json *obj, const char *key) {
+  if (!obj || obj->type != json::OBJECT)
+    return NULL;
+  for (size_t i = 0; i < obj->keys.size(); i++)
+    if (obj->keys[i] == key)
+      return &obj->items[i];
+  return NULL;
+}
+
+static void json_escape(std::string &out, const std::string &text) {
+  out += '"';
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (c < 0x20) {
+      char esc[8];
+      snprintf(esc, sizeof(esc), "\\u%04x", c);
+      out += esc;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+// One uplink as the store keeps it
+struct uplink {
+  int64_t time_ms;
+  std::string dev, name, status, hotspot;
+  uint8_t port;
+  double latitude, longitude, hotspot_lat, hotspot_lon;
+  double altitude, sats, speed, accuracy, battery, rssi, snr;
+  uint16_t hotspot_count;
+};
+
+static int64_t now_ms(void) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// An ISO date or time, UTC whatever offset it gives, false if it is neither
+static bool parse_iso(const char *text, int64_t *ms) {
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  int n = 0;
+  if (sscanf(text, "%4d-%2d-%2d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &n) != 3 || n != 10)
+    return false;
+  int frac_ms = 0;
+  const char *t = text + n;
+  if (*t == 'T' || *t == ' ') {
+    if (sscanf(t + 1, "%2d:%2d%n", &tm.tm_hour, &tm.tm_min, &n) != 2)
+      return false;
+    t += 1 + n;
+    if (*t == ':' && sscanf(t + 1, "%2d%n", &tm.tm_sec, &n) == 1) {
+      t += 1 + n;
+      if (*t == '.')
+        for (int scale = 100; isdigit((unsigned char)*++t); scale /= 10)
+          frac_ms += (*t - '0') * scale;
+    }
+  }
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+  *ms = (int64_t)timegm(&tm) * 1000 + frac_ms;
+  return true;
+}
+
+// Helium sends milliseconds, TTN an ISO time with nanoseconds
+static int64_t json_time_ms(const struct json *v) {
+  int64_t ms;
+  if (v && v->type == json::NUMBER)
+    return (int64_t)v->number;
+  if (v && v->type == json::STRING && parse_iso(v->text.c_str(), &ms))
+    return ms;
+  return now_ms();
+}
+
+static double json_number(const struct json *v) {
+  if (!v)
+    return NAN;
+  if (v->type == json::NUMBER || v->type == json::BOOL)
+    return v->number;
+  if (v->type == json::STRING) {
+    char *end;
+    double d = strtod(v->text.c_str(), &end);
+    while (*end == ' ')
+      end++;
+    if (end != v->text.c_str() && !*end)
+      return d;
+  }
+  return NAN;
+}
+
+static std::string json_text(const struct json *v) {
+  if (!v)
+    return "";
+  if (v->type == json::STRING || v->type == json::NUMBER)
+    return v->text;
+  if (v->type == json::BOOL)
+    return v->number ? "True" : "False";
+  return v->type == json::NUL ? "None" : "";
+}
+
+// An object member that is a non-empty object, or NULL
+static const struct json *json_object(const struct json *obj, const char *key) {
+  const struct json *v = json_get(obj, key);
+  return v && v->type == json::OBJECT && !v->items.empty() ? v : NULL;
+}
+
+// One webhook uplink, Helium or TTN v3, false if it is not an object
+static bool normalize(const struct json &msg, struct uplink &u) {
+  if (msg.type != json::OBJECT)
+    return false;
+  const struct json *payload, *port, *when, *ids, *best = NULL;
+  double best_lat = NAN, best_lon = NAN;
+  size_t hotspots = 0;
+  const struct json *up = json_get(&msg, "uplink_message");
+  if (up) {
+    payload = json_object(up, "decoded_payload");
+    port = json_get(up, "f_port");
+    ids = json_get(&msg, "end_device_ids");
+    u.dev = json_text(json_get(ids, "dev_eui"));
+    u.name = json_text(json_get(ids, "device_id"));
+    when = json_get(&msg, "received_at");
+    const struct json *rx = json_get(up, "rx_metadata");
+    if (rx && rx->type == json::ARRAY && !rx->items.empty()) {
+      hotspots = rx->items.size();
+      best = &rx->items[0];
+      u.hotspot = json_text(json_get(json_get(best, "gateway_ids"), "gateway_id"));
+      best_lat = json_number(json_get(json_get(best, "location"), "latitude"));
+      best_lon = json_number(json_get(json_get(best, "location"), "longitude"));
+    }
+  } else {
+    payload = json_object(json_object(&msg, "decoded"), "payload");
+    port = json_get(&msg, "port");
+    u.dev = json_text(json_get(&msg, "dev_eui"));
+    u.name = json_text(json_get(&msg, "name"));
+    when = json_get(&msg, "reported_at");
+    const struct json *list = json_get(&msg, "hotspots");
+    if (list && list->type == json::ARRAY && !list->items.empty()) {
+      hotspots = list->items.size();
+      best = &list->items[0];
+      u.hotspot = json_text(json_get(best, "name"));
+      best_lat = json_number(json_get(best, "lat"));
+      best_lon = json_number(json_get(best, "long"));
+    }
+  }
+  for (char &c : u.dev)
+    c = toupper((unsigned char)c);
+
+  u.time_ms = json_time_ms(when);
+  double p = json_number(port);
+  u.port = isnan(p) ? 0 : (int64_t)p & 0xFF;
+  const struct json *lat = json_get(payload, "latitude"), *lon = json_get(payload, "longitude");
+  u.latitude = json_number(lat ? lat : json_get(payload, "last_latitude"));
+  u.longitude = json_number(lon ? lon : json_get(payload, "last_longitude"));
+  u.altitude = json_number(json_get(payload, "altitude"));
+  u.sats = json_number(json_get(payload, "sats"));
+  u.speed = json_number(json_get(payload, "speed"));
+  u.accuracy = json_number(json_get(payload, "accuracy"));
+  u.battery = json_number(json_get(payload, "battery"));
+  u.status = json_text(json_get(payload, "status"));
+  u.rssi = json_number(json_get(best, "rssi"));
+  u.snr = json_number(json_get(best, "snr"));
+  u.hotspot_lat = best_lat;
+  u.hotspot_lon = best_lon;
+  u.hotspot_count = std::min<size_t>(hotspots, 0xFFFF);
+  return true;
+}
+
+// Whole columns at a time; NaN in, NaN out
+static void haversine_m(const double *lat1, const double *lon1, const double *lat2, const double *lon2, size_t n,
+                        float *out) {
+  const double rad = M_PI / 180;
+  for (size_t i = 0; i < n; i++) {
+    double d_lat = (lat2[i] - lat1[i]) * rad;
+    double d_lon = (lon2[i] - lon1[i]) * rad;
+    double h = sin(d_lat / 2) * sin(d_lat / 2) + cos(lat1[i] * rad) * cos(lat2[i] * rad) * sin(d_lon / 2) * sin(d_lon / 2);
+    out[i] = isnan(h) ? NAN : 2 * R_EARTH_M * asin(sqrt(std::min(h, 1.0)));
+  }
+}
+
+static std::string day_of(int64_t time_ms) {
+  time_t s = (time_t)(time_ms >= 0 ? time_ms / 1000 : (time_ms - 999) / 1000);
+  struct tm tm;
+  char day[16];
+  gmtime_r(&s, &tm);
+  strftime(day, sizeof(day), "%Y-%m-%d", &tm);
+  return day;
+}
+
+// One day's folder, open for appending
+struct partition {
+  std::string path;
+  size_t rows = 0;
+  std::unordered_map<std::string, uint32_t> ids[STORE_COLUMNS];  // Of the text columns
+  std::vector<std::string> names[STORE_COLUMNS];
+};
+
+// Loads a day as far as it is complete, without touching it, so a reader can run while it is appended to
+static void partition_load(struct partition &part, const std::string &path) {
+  part.path = path;
+  for (int c = 0; c < STORE_COLUMNS; c++) {
+    part.ids[c].clear();
+    part.names[c].clear();
+    if (!store_columns[c].text)
+      continue;
+    std::string data;
+    FILE *f = fopen((store_path(path, c) + ".dict").c_str(), "rb");
+    if (f) {
+      char buf[65536];
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.append(buf, n);
+      fclose(f);
+    }
+    // Up to the last whole entry
+    for (size_t start = 0, end; (end = data.find('\n', start)) != std::string::npos; start = end + 1) {
+      part.ids[c].emplace(data.substr(start, end - start), part.names[c].size());
+      part.names[c].push_back(data.substr(start, end - start));
+    }
+  }
+  int all[STORE_COLUMNS];
+  for (int c = 0; c < STORE_COLUMNS; c++)
+    all[c] = c;
+  part.rows = store_rows(path, all, STORE_COLUMNS);
+}
+
+// For the writer only: cuts a torn last dictionary entry and trims every column to the rows all of them hold
+static void partition_repair(const std::string &path) {
+  for (int c = 0; c < STORE_COLUMNS; c++) {
+    if (!store_columns[c].text)
+      continue;
+    std::string file = store_path(path, c) + ".dict";
+    FILE *f = fopen(file.c_str(), "rb");
+    if (!f)
+      continue;
+    long keep = 0, at = 0;
+    for (int ch; (ch = getc(f)) != EOF;) {
+      at++;
+      if (ch == '\n')
+        keep = at;
+    }
+    fclose(f);
+    if (keep != at)
+      truncate(file.c_str(), keep);
+  }
+  int all[STORE_COLUMNS];
+  for (int c = 0; c < STORE_COLUMNS; c++)
+    all[c] = c;
+  size_t rows = store_rows(path, all, STORE_COLUMNS);
+  for (int c = 0; c < STORE_COLUMNS; c++) {
+    size_t want = rows * store_size(store_columns[c].type);
+    if (store_file_size(store_path(path, c)) != want)
+      truncate(store_path(path, c).c_str(), want);
+  }
+}
+
+// A day to append to: the writer's view of it, repaired after a crash
+static void partition_open(struct partition &part, const std::string &path) {
+  std::filesystem::create_directories(path);
+  partition_repair(path);
+  partition_load(part, path);
+}
+
+static bool append_file(const std::string &path, const void *data, size_t size, size_t n) {
+  FILE *f = fopen(path.c_str(), "ab");
+  if (!f)
+    return false;
+  bool ok = fwrite(data, size, n, f) == n;
+  return !fclose(f) && ok;
+}
+
+// Dictionary ids of a text column, adding new values to its .dict file, false if that failed
+static bool partition_encode(struct partition &part, int column, const std::vector<const std::string *> &values,
+                             std::vector<uint32_t> &out) {
+  std::string added;
+  for (const std::string *v : values) {
+    std::string text = *v;
+    std::replace(text.begin(), text.end(), '\n', ' ');
+    auto it = part.ids[column].find(text);
+    if (it == part.ids[column].end()) {
+      it = part.ids[column].emplace(text, part.names[column].size()).first;
+      part.names[column].push_back(text);
+      added += text + '\n';
+    }
+    out.push_back(it->second);
+  }
+  return added.empty() || append_file(store_path(part.path, column) + ".dict", added.data(), 1, added.size());
+}
+
+template <typename T, typename F>
+static bool append_column(const struct partition &part, int column, const std::vector<const struct uplink *> &rows,
+                          F value) {
+  std::vector<T> out;
+  out.reserve(rows.size());
+  for (const struct uplink *u : rows)
+    out.push_back(value(*u));
+  return append_file(store_path(part.path, column), out.data(), sizeof(T), out.size());
+}
+
+static void partition_append(struct partition &part, const std::vector<const struct uplink *> &rows) {
+  size_t n = rows.size();
+  std::vector<double> lat(n), lon(n), hotspot_lat(n), hotspot_lon(n);
+  for (size_t i = 0; i < n; i++) {
+    lat[i] = rows[i]->latitude;
+    lon[i] = rows[i]->longitude;
+    hotspot_lat[i] = rows[i]->hotspot_lat;
+    hotspot_lon[i] = rows[i]->hotspot_lon;
+  }
+  std::vector<float> dist(n);
+  haversine_m(lat.data(), lon.data(), hotspot_lat.data(), hotspot_lon.data(), n, dist.data());
+
+  bool ok = true;
+  for (int c = 0; c < STORE_COLUMNS; c++) {
+    if (store_columns[c].text) {
+      std::vector<const std::string *> text;
+      for (const struct uplink *u : rows)
+        text.push_back(c == COL_DEV ? &u->dev : c == COL_NAME ? &u->name : c == COL_STATUS ? &u->status : &u->hotspot);
+      std::vector<uint32_t> ids;
+      // Without its dictionary entries the ids would be wrong, and later ones with them
+      ok = ok && partition_encode(part, c, text, ids);
+      ok = ok && append_file(store_path(part.path, c), ids.data(), sizeof(uint32_t), n);
+    } else if (c == COL_HOTSPOT_DIST) {
+      ok &= append_file(store_path(part.path, c), dist.data(), sizeof(float), n);
+    }
+  }
+  auto f32 = [](double v) { return (float)v; };
+  ok &= append_column<int64_t>(part, COL_TIME_MS, rows, [](const struct uplink &u) { return u.time_ms; });
+  ok &= append_column<uint8_t>(part, COL_PORT, rows, [](const struct uplink &u) { return u.port; });
+  ok &= append_column<double>(part, COL_LATITUDE, rows, [](const struct uplink &u) { return u.latitude; });
+  ok &= append_column<double>(part, COL_LONGITUDE, rows, [](const struct uplink &u) { return u.longitude; });
+  ok &= append_column<float>(part, COL_ALTITUDE, rows, [&](const struct uplink &u) { return f32(u.altitude); });
+  ok &= append_column<float>(part, COL_SATS, rows, [&](const struct uplink &u) { return f32(u.sats); });
+  ok &= append_column<float>(part, COL_SPEED, rows, [&](const struct uplink &u) { return f32(u.speed); });
+  ok &= append_column<float>(part, COL_ACCURACY, rows, [&](const struct uplink &u) { return f32(u.accuracy); });
+  ok &= append_column<float>(part, COL_BATTERY, rows, [&](const struct uplink &u) { return f32(u.battery); });
+  ok &= append_column<float>(part, COL_RSSI, rows, [&](const struct uplink &u) { return f32(u.rssi); });
+  ok &= append_column<float>(part, COL_SNR, rows, [&](const struct uplink &u) { return f32(u.snr); });
+  ok &= append_column<uint16_t>(part, COL_HOTSPOT_COUNT, rows, [](const struct uplink &u) { return u.hotspot_count; });
+  if (ok) {
+    part.rows += n;
+    return;
+  }
+  // Some columns took the rows and some did not: cut them back to what all of them hold, and the dictionaries too
+  perror(part.path.c_str());
+  partition_open(part, part.path);
+}
+
+struct store {
+  std::string path;
+  std::map<std::string, struct partition> partitions;
+  std::mutex lock;
+};
+
+// One batch: split by day, derive, and append column by column
+static void store_write(struct store &s, const std::vector<struct uplink> &rows) {
+  std::map<std::string, std::vector<const struct uplink *>> by_day;
+  for (const struct uplink &u : rows)
+    by_day[day_of(u.time_ms)].push_back(&u);
+  std::lock_guard<std::mutex> guard(s.lock);
+  for (auto &day : by_day) {
+    auto it = s.partitions.find(day.first);
+    if (it == s.partitions.end()) {
+      it = s.partitions.emplace(day.first, partition()).first;
+      partition_open(it->second, s.path + "/" + day.first);
+    }
+    partition_append(it->second, day.second);
+  }
+}
+
+// Shortest text that reads back as the same double, null for NaN
+static void json_double(std::string &out, double v) {
+  char text[64];
+  if (isnan(v)) {
+    out += "null";
+    return;
+  }
+  *std::to_chars(text, text + sizeof(text) - 1, v).ptr = 0;
+  out += text;
+}
+
+// A float column value without float32 noise
+static void json_float(std::string &out, float v) {
+  char text[32];
+  if (isnan(v)) {
+    out += "null";
+    return;
+  }
+  snprintf(text, sizeof(text), "%.7g", v);
+  out += text;
+}
+
+template <typename T>
+static std::vector<T> read_column(const struct partition &part, int column) {
+  std::vector<T> values(part.rows);
+  if (!store_read(part.path, column, 0, part.rows, values.data()))
+    perror(part.path.c_str());
+  return values;
+}
+
+// The matching rows as a JSON list, oldest first.  Returns how many.
+static size_t store_query(struct store &s, const char *dev, int64_t start_ms, int64_t end_ms, std::string &out) {
+  std::vector<std::string> days;
+  std::error_code err;
+  for (const auto &entry : std::filesystem::directory_iterator(s.path, err))
+    if (entry.path().filename().string().size() == 10)
+      days.push_back(entry.path().filename().string());
+  std::sort(days.begin(), days.end());
+  std::string first = day_of(start_ms), last = day_of(std::min(end_ms, INT64_C(1) << 45));
+  std::string wanted = dev ? dev : "";
+  for (char &c : wanted)
+    c = toupper((unsigned char)c);
+
+  struct found {
+    int64_t time_ms;
+    std::string json;
+  };
+  std::vector<struct found> rows;
+  std::lock_guard<std::mutex> guard(s.lock);
+  for (const std::string &day : days) {
+    if (day < first || day > last)
+      continue;
+    auto it = s.partitions.find(day);
+    struct partition fresh;
+    if (it == s.partitions.end())
+      partition_load(fresh, s.path + "/" + day);  // Maybe a server's, which may be appending to it
+    const struct partition &part = it != s.partitions.end() ? it->second : fresh;
+
+    std::vector<int64_t> times = read_column<int64_t>(part, COL_TIME_MS);
+    std::vector<uint32_t> devs = read_column<uint32_t>(part, COL_DEV);
+    std::vector<size_t> keep;
+    auto dev_id = part.ids[COL_DEV].find(wanted);
+    if (dev && dev_id == part.ids[COL_DEV].end())
+      continue;
+    for (size_t i = 0; i < part.rows; i++)
+      if (times[i] >= start_ms && times[i] < end_ms && (!dev || devs[i] == dev_id->second))
+        keep.push_back(i);
+    if (keep.empty())
+      continue;
+
+    std::vector<std::vector<uint8_t>> columns(STORE_COLUMNS);
+    for (int c = 0; c < STORE_COLUMNS; c++) {
+      columns[c].resize(part.rows * store_size(store_columns[c].type));
+      if (!store_read(part.path, c, 0, part.rows, columns[c].data()))
+        perror(part.path.c_str());
+    }
+    for (size_t i : keep) {
+      std::string row = "{";
+      for (int c = 0; c < STORE_COLUMNS; c++) {
+        const uint8_t *v = &columns[c][i * store_size(store_columns[c].type)];
+        row += c ? ", \"" : "\"";
+        row += store_columns[c].name;
+        row += "\": ";
+        uint32_t u32;
+        uint16_t u16;
+        float f;
+        double d;
+        switch (store_columns[c].type) {
+          case STORE_I64:
+            row += std::to_string(times[i]);
+            break;
+          case STORE_U32:
+            memcpy(&u32, v, 4);
+            json_escape(row, u32 < part.names[c].size() ? part.names[c][u32] : "");
+            break;
+          case STORE_U16:
+            memcpy(&u16, v, 2);
+            row += std::to_string(u16);
+            break;
+          case STORE_U8:
+            row += std::to_string(*v);
+            break;
+          case STORE_F64:
+            memcpy(&d, v, 8);
+            json_double(row, d);
+            break;
+          case STORE_F32:
+            memcpy(&f, v, 4);
+            json_float(row, f);
+            break;
+        }
+      }
+      time_t sec = (time_t)(times[i] >= 0 ? times[i] / 1000 : (times[i] - 999) / 1000);
+      struct tm tm;
+      char when[48];
+      gmtime_r(&sec, &tm);
+      size_t len = strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", &tm);
+      snprintf(when + len, sizeof(when) - len, ".%03d+00:00", (int)(times[i] - (int64_t)sec * 1000));
+      row += ", \"time\": \"";
+      row += when;
+      row += "\"}";
+      rows.push_back({times[i], std::move(row)});
+    }
+  }
+  std::stable_sort(rows.begin(), rows.end(),
+                   [](const struct found &a, const struct found &b) { return a.time_ms < b.time_ms; });
+  out = "[";
+  for (size_t i = 0; i < rows.size(); i++) {
+    out += i ? ",\n" : "\n";
+    out += rows[i].json;
+  }
+  out += rows.empty() ? "]\n" : "\n]\n";
+  return rows.size();
+}
+
+// Gathers queued uplinks into batches of up to `batch` rows, or whatever came within `linger`
+struct writer {
+  struct store *store;
+  size_t batch;
+  std::chrono::milliseconds linger;
+  std::mutex lock;
+  std::condition_variable ready;  // Something queued
+  std::condition_variable idle;   // A batch is on disk
+  std::deque<struct uplink> queue;
+  size_t busy = 0;        // Rows taken from the queue and not yet written
+  bool stopping = false;  // Write out the queue and end
+  std::thread thread;
+};
+
+static void writer_put(struct writer &w, std::vector<struct uplink> &rows) {
+  {
+    std::lock_guard<std::mutex> guard(w.lock);
+    for (struct uplink &u : rows)
+      w.queue.push_back(std::move(u));
+  }
+  w.ready.notify_one();
+}
+
+static void writer_run(struct writer *w) {
+  std::unique_lock<std::mutex> l(w->lock);
+  for (;;) {
+    w->ready.wait(l, [w] { return !w->queue.empty() || w->stopping; });
+    if (w->queue.empty())
+      return;
+    w->ready.wait_until(l, std::chrono::steady_clock::now() + w->linger,
+                        [w] { return w->queue.size() >= w->batch || w->stopping; });
+    size_t n = std::min(w->batch, w->queue.size());
+    std::vector<struct uplink> rows(std::make_move_iterator(w->queue.begin()),
+                                    std::make_move_iterator(w->queue.begin() + n));
+    w->queue.erase(w->queue.begin(), w->queue.begin() + n);
+    w->busy += n;
+    l.unlock();
+    store_write(*w->store, rows);
+    l.lock();
+    w->busy -= n;
+    w->idle.notify_all();
+  }
+}
+
+// Until everything queued so far is on disk
+static void writer_wait(struct writer &w) {
+  std::unique_lock<std::mutex> l(w.lock);
+  w.idle.wait(l, [&w] { return w.queue.empty() && !w.busy; });
+}
+
+static void writer_start(struct writer &w, struct store *s, size_t batch) {
+  w.store = s;
+  w.batch = batch;
+  w.linger = std::chrono::milliseconds(500);
+  w.thread = std::thread(writer_run, &w);
+}
+
+// Writes out what is queued, then ends the thread
+static void writer_stop(struct writer &w) {
+  {
+    std::lock_guard<std::mutex> guard(w.lock);
+    w.stopping = true;
+  }
+  w.ready.notify_one();
+  w.thread.join();
+}
+
+// A date or ISO time, UTC
+static int64_t parse_time(const char *text, int64_t fallback) {
+  int64_t ms;
+  if (!text || !*text)
+    return fallback;
+  return parse_iso(text, &ms) ? ms : now_ms();
+}
+
+static std::string url_decode(const std::string &text) {
+  std::string out;
+  for (size_t i = 0; i < text.size(); i++) {
+    unsigned c;
+    if (text[i] == '+')
+      out += ' ';
+    else if (text[i] == '%' && i + 2 < text.size() && sscanf(text.c_str() + i + 1, "%2x", &c) == 1)
+      out += (char)c, i += 2;
+    else
+      out += text[i];
+  }
+  return out;
+}
+
+static void http_reply(int fd, int code, const std::string &body) {
+  const char *reason = code == 200 ? "OK" : code == 400 ? "Bad Request" : code == 404 ? "Not Found"
+                                        : code == 413 ? "Payload Too Large" : "Not Implemented";
+  char head[160];
+  int len = snprintf(head, sizeof(head), "HTTP/1.0 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n",
+                     code, reason, body.size());
+  std::string out = std::string(head, len) + body;
+  for (size_t sent = 0; sent < out.size();) {
+    ssize_t n = send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0)
+      break;
+    sent += n;
+  }
+}
+
+static void http_error(int fd, int code, const char *message) {
+  std::string body = "{\"error\": ";
+  json_escape(body, message);
+  http_reply(fd, code, body + "}");
+}
+
+// One request a connection, as HTTP/1.0
+static void http_connection(int fd, struct store *s, struct writer *w) {
+  struct timeval timeout = {HTTP_TIMEOUT_S, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  std::string data;
+  size_t head_end;
+  char buf[16384];
+  while ((head_end = data.find("\r\n\r\n")) == std::string::npos && data.size() < HTTP_MAX_HEADER) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      close(fd);
+      return;
+    }
+    data.append(buf, n);
+  }
+  if (head_end == std::string::npos) {
+    http_error(fd, 413, "Header too large");
+    close(fd);
+    return;
+  }
+
+  char method[16] = "", target[4096] = "";
+  sscanf(data.c_str(), "%15s %4095s", method, target);
+  size_t length = 0;
+  for (size_t pos = data.find("\r\n"); pos < head_end; pos = data.find("\r\n", pos + 2))
+    if (!strncasecmp(data.c_str() + pos + 2, "Content-Length:", 15))
+      length = strtoul(data.c_str() + pos + 17, NULL, 10);
+
+  if (!strcmp(method, "POST")) {
+    if (length > HTTP_MAX_BODY) {
+      http_error(fd, 413, "Body too large");
+      close(fd);
+      return;
+    }
+    std::string body = data.substr(head_end + 4);
+    while (body.size() < length) {
+      ssize_t n = recv(fd, buf, std::min(sizeof(buf), length - body.size()), 0);
+      if (n <= 0) {
+        close(fd);
+        return;
+      }
+      body.append(buf, n);
+    }
+    body.resize(length);
+    struct json msg;
+    std::vector<struct uplink> rows;
+    bool ok = json_parse(body.data(), body.size(), msg);
+    if (ok && msg.type == json::ARRAY) {
+      rows.resize(msg.items.size());
+      for (size_t i = 0; i < msg.items.size() && ok; i++)
+        ok = normalize(msg.items[i], rows[i]);
+    } else if (ok) {
+      rows.resize(1);
+      ok = normalize(msg, rows[0]);
+    }
+    if (!ok) {
+      http_error(fd, 400, "Expected an uplink or a list of them, as JSON");
+    } else {
+      size_t n = rows.size();
+      writer_put(*w, rows);
+      http_reply(fd, 200, "{\"queued\": " + std::to_string(n) + "}");
+    }
+  } else if (!strcmp(method, "GET")) {
+    std::string path = target, query;
+    size_t q = path.find('?');
+    if (q != std::string::npos) {
+      query = path.substr(q + 1);
+      path.resize(q);
+    }
+    if (path != "/uplinks") {
+      http_error(fd, 404, "GET /uplinks?dev=&from=&to=");
+    } else {
+      std::map<std::string, std::string> args;
+      for (size_t start = 0; start <= query.size();) {
+        size_t end = query.find('&', start), eq;
+        std::string pair = query.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if ((eq = pair.find('=')) != std::string::npos && !args.count(url_decode(pair.substr(0, eq))))
+          args[url_decode(pair.substr(0, eq))] = url_decode(pair.substr(eq + 1));
+        if (end == std::string::npos)
+          break;
+        start = end + 1;
+      }
+      std::string out;
+      store_query(*s, args.count("dev") && !args["dev"].empty() ? args["dev"].c_str() : NULL,
+                  parse_time(args["from"].c_str(), 0), parse_time(args["to"].c_str(), QUERY_END_MS), out);
+      http_reply(fd, 200, out);
+    }
+  } else {
+    http_error(fd, 501, "POST an uplink, or GET /uplinks");
+  }
+  close(fd);
+}
+
+static int listen_fd = -1;
+
+static void http_accept(struct store *s, struct writer *w) {
+  int fd;
+  while ((fd = accept(listen_fd, NULL, NULL)) >= 0 || errno == EINTR || errno == ECONNABORTED)
+    if (fd >= 0)
+      std::thread(http_connection, fd, s, w).detach();
+}
+
+static int serve(const char *data, int port, size_t batch) {
+  struct store &s = *new store;
+  s.path = data;
+  std::filesystem::create_directories(s.path);
+  listen_fd = socket(AF_INET6, SOCK_STREAM, 0);
+  int off = 0, on = 1;
+  setsockopt(listen_fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));  // IPv4 too
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in6 addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(port);
+  if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(listen_fd, 128)) {
+    perror("listen");
+    return 1;
+  }
+
+  // Only this thread takes the signals, the others inherit them blocked
+  sigset_t stop;
+  sigemptyset(&stop);
+  sigaddset(&stop, SIGINT);
+  sigaddset(&stop, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stop, NULL);
+  // Connections still open at the end may use these, so they outlive this
+  struct writer &w = *new writer;
+  writer_start(w, &s, batch);
+  std::thread server(http_accept, &s, &w);
+  printf("Storing uplinks in %s, listening on port %d\n", data, port);
+  fflush(stdout);
+
+  int sig;
+  sigwait(&stop, &sig);
+  shutdown(listen_fd, SHUT_RDWR);  // Wakes accept()
+  server.join();
+  writer_stop(w);
+  return 0;
+}
+
+// A Helium style webhook for a Mapper uplink, for the benchmark
+static std::string sample_uplink(std::mt19937 &rng, const char *dev, int64_t when_ms) {
+  std::uniform_real_distribution<double> unit(0, 1);
+  char text[512];
+  std::string out;
+  snprintf(text, sizeof(text),
+           "{\"dev_eui\": \"%s\", \"name\": \"mapper-%s\", \"port\": 2, \"reported_at\": %lld, \"decoded\": "
+           "{\"payload\": {\"latitude\": %.17g, \"longitude\": %.17g, \"altitude\": %d, \"sats\": %d, \"accuracy\": "
+           "2.5, \"battery\": 3.9}}, \"hotspots\": [",
+           dev, dev + strlen(dev) - 4, (long long)when_ms, 47 + unit(rng), 8 + unit(rng), 300 + (int)(rng() % 301),
+           4 + (int)(rng() % 9));
+  out = text;
+  for (int i = 0, n = 1 + rng() % 3; i < n; i++) {
+    snprintf(text, sizeof(text),
+             "%s{\"name\": \"hotspot-%d\", \"lat\": %.17g, \"long\": %.17g, \"rssi\": %d, \"snr\": %.17g}",
+             i ? ", " : "", (int)(rng() % 50), 47 + unit(rng), 8 + unit(rng), -120 + (int)(rng() % 61),
+             -15 + 25 * unit(rng));
+    out += text;
+  }
+  return out + "]}";
+}
+
+// Webhook JSON in, rows on disk out, as the server does it minus the socket.
+// False if the query does not find the device's rows.
+static bool bench(const std::string &path, size_t count, unsigned devices) {
+  std::mt19937 rng(1);
+  int64_t start_ms = now_ms() - (int64_t)count * 10;
+  std::vector<std::string> bodies;
+  for (size_t i = 0; i < count; i++) {
+    char dev[32];
+    snprintf(dev, sizeof(dev), "70B3D57ED%07X", (unsigned)(rng() % devices));
+    bodies.push_back(sample_uplink(rng, dev, start_ms + i * 10));
+  }
+
+  struct store s;
+  s.path = path;
+  std::filesystem::create_directories(path);
+  struct writer w;
+  writer_start(w, &s, 4096);
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (const std::string &body : bodies) {
+    struct json msg;
+    std::vector<struct uplink> rows(1);
+    if (json_parse(body.data(), body.size(), msg) && normalize(msg, rows[0]))
+      writer_put(w, rows);
+  }
+  writer_wait(w);
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  printf("Ingest: %zu uplinks in %.2fs, %.0f per second\n", count, elapsed, count / elapsed);
+
+  t0 = std::chrono::steady_clock::now();
+  std::string out;
+  size_t rows = store_query(s, "70B3D57ED0000000", start_ms, start_ms + count * 10, out);
+  printf("Query one device of %u: %zu rows in %.3fs\n", devices, rows,
+         std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+  writer_stop(w);
+  return rows > 0;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s serve [--data DIR] [--listen PORT] [--batch ROWS]\n"
+          "       %s query [--data DIR] [--dev EUI] [--from TIME] [--to TIME]\n"
+          "       %s bench [--data DIR] [--count N] [--devices N]\n",
+          name, name, name);
+}
+
+int main(int argc, char **argv) {
+  const char *mode = argc > 1 ? argv[1] : "", *data = NULL, *dev = NULL, *from = NULL, *to = NULL;
+  unsigned long port = 8080, batch = 4096, count = 50000, devices = 200;
+  for (int i = 2; i < argc; i++) {
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (!value) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (!strcmp(argv[i], "--data"))
+      data = value;
+    else if (!strcmp(argv[i], "--listen"))
+      port = strtoul(value, NULL, 10);
+    else if (!strcmp(argv[i], "--batch"))
+      batch = strtoul(value, NULL, 10);
+    else if (!strcmp(argv[i], "--dev"))
+      dev = value;
+    else if (!strcmp(argv[i], "--from"))
+      from = value;
+    else if (!strcmp(argv[i], "--to"))
+      to = value;
+    else if (!strcmp(argv[i], "--count"))
+      count = strtoul(value, NULL, 10);
+    else if (!strcmp(argv[i], "--devices"))
+      devices = strtoul(value, NULL, 10);
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+    i++;
+  }
+
+  if (!strcmp(mode, "serve") && batch && port < 65536) {
+    return serve(data ? data : "uplinks", port, batch);
+  } else if (!strcmp(mode, "query")) {
+    struct store s;
+    std::string out;
+    s.path = data ? data : "uplinks";
+    store_query(s, dev, parse_time(from, 0), parse_time(to, QUERY_END_MS), out);
+    fputs(out.c_str(), stdout);
+    return 0;
+  } else if (!strcmp(mode, "bench") && count && devices) {
+    if (data)
+      return bench(data, count, devices) ? 0 : 1;
+    char tmp[] = "/tmp/ingest-XXXXXX";
+    if (!mkdtemp(tmp)) {
+      perror("mkdtemp");
+      return 1;
+    }
+    bool ok = bench(tmp, count, devices);
+    std::filesystem::remove_all(tmp);
+    return ok ? 0 : 1;
+  }
+  usage(argv[0]);
+  return 2;
+}
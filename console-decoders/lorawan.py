@@ -0,0 +1,335 @@
+import functools
+import math
+import re
+import struct
+
+# LoRaWAN 1.0.x frames and crypto, for both ends of the link: used by
+# ns_emulator.py as the network server and by its simulated devices.
+#
+# AES is done here in plain Python, so the tools keep needing nothing beyond
+# the standard library.  It is slow (a few thousand blocks a second), which is
+# plenty for a gateway's worth of traffic.
+#
+# Only LoRaWAN 1.0.x is handled: the keys in main/credentials.h without
+# USE_NWK_KEY, which is how the Mapper ships.
+
+MTYPE_JOIN_REQUEST = 0
+MTYPE_JOIN_ACCEPT = 1
+MTYPE_UNCONFIRMED_UP = 2
+MTYPE_UNCONFIRMED_DOWN = 3
+MTYPE_CONFIRMED_UP = 4
+MTYPE_CONFIRMED_DOWN = 5
+
+FCTRL_ADR = 0x80
+FCTRL_ACK = 0x20
+
+# MAC commands, with the length of what follows the CID in each direction
+MAC_LINK_CHECK = 0x02
+MAC_DEVICE_TIME = 0x0D
+MAC_UPLINK_LEN = {0x02: 0, 0x03: 1, 0x04: 0, 0x05: 1, 0x06: 2, 0x07: 1, 0x08: 0, 0x09: 0, 0x0A: 1, 0x0D: 0}
+
+
+class FrameError(Exception):
+    pass
+
+
+def _xtime(a):
+    return ((a << 1) ^ 0x1B) & 0xFF if a & 0x80 else a << 1
+
+
+def _mul(a, b):
+    r = 0
+    while b:
+        if b & 1:
+            r ^= a
+        a = _xtime(a)
+        b >>= 1
+    return r
+
+
+def _make_sbox():
+    # Walks the multiplicative group with generator 3, as in FIPS-197 section 5.1.1
+    sbox = [0x63] * 256
+    p = q = 1
+    while True:
+        p = p ^ _xtime(p)
+        q ^= q << 1
+        q ^= q << 2
+        q ^= q << 4
+        q &= 0xFF
+        if q & 0x80:
+            q ^= 0x09
+        x = q
+        for shift in range(1, 5):
+            x ^= ((q << shift) | (q >> (8 - shift))) & 0xFF
+        sbox[p] = x ^ 0x63
+        if p == 1:
+            return sbox
+
+
+SBOX = _make_sbox()
+INV_SBOX = [SBOX.index(i) for i in range(256)]
+
+
+@functools.lru_cache(maxsize=1024)
+def _expand_key(key):
+    if len(key) != 16:
+        raise ValueError('AES-128 key must be 16 bytes')
+    w = [list(key[i:i + 4]) for i in range(0, 16, 4)]
+    rcon = 1
+    for i in range(4, 44):
+        t = list(w[i - 1])
+        if i % 4 == 0:
+            t = [SBOX[b] for b in t[1:] + t[:1]]
+            t[0] ^= rcon
+            rcon = _xtime(rcon)
+        w.append([a ^ b for a, b in zip(w[i - 4], t)])
+    return tuple(sum(w[r * 4:r * 4 + 4], []) for r in range(11))
+
+
+def aes_encrypt(key, block):
+    rk = _expand_key(key)
+    s = [a ^ b for a, b in zip(block, rk[0])]
+    for r in range(1, 11):
+        s = [SBOX[b] for b in s]
+        s = [s[(i + 4 * (i % 4)) % 16] for i in range(16)]  # ShiftRows
+        if r < 10:
+            m = []
+            for c in range(0, 16, 4):
+                a = s[c:c + 4]
+                m += [_xtime(a[i]) ^ _xtime(a[(i + 1) % 4]) ^ a[(i + 1) % 4] ^ a[(i + 2) % 4] ^ a[(i + 3) % 4]
+                      for i in range(4)]
+            s = m
+        s = [a ^ b for a, b in zip(s, rk[r])]
+    return bytes(s)
+
+
+def aes_decrypt(key, block):
+    rk = _expand_key(key)
+    s = [a ^ b for a, b in zip(block, rk[10])]
+    for r in range(9, -1, -1):
+        s = [s[(i - 4 * (i % 4)) % 16] for i in range(16)]  # InvShiftRows
+        s = [INV_SBOX[b] for b in s]
+        s = [a ^ b for a, b in zip(s, rk[r])]
+        if r > 0:
+            m = []
+            for c in range(0, 16, 4):
+                a = s[c:c + 4]
+                m += [_mul(a[i], 14) ^ _mul(a[(i + 1) % 4], 11) ^ _mul(a[(i + 2) % 4], 13) ^ _mul(a[(i + 3) % 4], 9)
+                      for i in range(4)]
+            s = m
+    return bytes(s)
+
+
+def _shift_left(block):
+    n = int.from_bytes(block, 'big') << 1
+    return (n & ((1 << 128) - 1)).to_bytes(16, 'big'), n >> 128
+
+
+def aes_cmac(key, msg):
+    # RFC 4493
+    k1, carry = _shift_left(aes_encrypt(key, bytes(16)))
+    if carry:
+        k1 = k1[:15] + bytes([k1[15] ^ 0x87])
+    k2, carry = _shift_left(k1)
+    if carry:
+        k2 = k2[:15] + bytes([k2[15] ^ 0x87])
+
+    blocks = max(1, (len(msg) + 15) // 16)
+    last = msg[(blocks - 1) * 16:]
+    if len(last) == 16:
+        last = bytes(a ^ b for a, b in zip(last, k1))
+    else:
+        last = bytes(a ^ b for a, b in zip(last + b'\x80' + bytes(15 - len(last)), k2))
+    x = bytes(16)
+    for i in range(blocks - 1):
+        x = aes_encrypt(key, bytes(a ^ b for a, b in zip(x, msg[i * 16:i * 16 + 16])))
+    return aes_encrypt(key, bytes(a ^ b for a, b in zip(x, last)))
+
+
+def airtime_ms(sf, bw_khz, length, crc=True, preamble=8, cr=1):
+    # Semtech AN1200.13, explicit header, low data rate optimization at SF11 and up on 125kHz
+    t_sym = (1 << sf) / bw_khz
+    de = 1 if sf >= 11 and bw_khz == 125 else 0
+    n = math.ceil((8 * length - 4 * sf + 28 + 16 * crc) / (4 * (sf - 2 * de)))
+    return (preamble + 4.25 + 8 + max(n * (cr + 4), 0)) * t_sym
+
+
+# Channels are in Hz; data rates are (SF, kHz).  US915 lists sub-band 2, the one TTN and Helium use.
+BANDS = {
+    'EU868': {
+        'uplink': [868100000, 868300000, 868500000, 867100000, 867300000, 867500000, 867700000, 867900000],
+        'dr': {0: (12, 125), 1: (11, 125), 2: (10, 125), 3: (9, 125), 4: (8, 125), 5: (7, 125)},
+        'rx1': lambda ch, dr: (ch, dr),
+        'rx2': (869525000, 0),
+        # CFList of the join accept: the five channels after the three default ones
+        'cflist': b''.join((f // 100).to_bytes(3, 'little') for f in
+                           [867100000, 867300000, 867500000, 867700000, 867900000]) + b'\x00',
+    },
+    'US915': {
+        'uplink': [902300000 + 200000 * ch for ch in range(8, 16)],
+        'dr': {0: (10, 125), 1: (9, 125), 2: (8, 125), 3: (7, 125), 8: (12, 500), 9: (11, 500), 10: (10, 500),
+               11: (9, 500), 12: (8, 500), 13: (7, 500)},
+        'rx1': lambda ch, dr: (923300000 + 600000 * ((ch - 902300000) // 200000 % 8), dr + 10),
+        'rx2': (923300000, 8),
+        'cflist': b'',
+    },
+}
+
+
+def dr_for_sf(band, sf, bw_khz=125):
+    for dr, rate in BANDS[band]['dr'].items():
+        if rate == (sf, bw_khz):
+            return dr
+    raise ValueError('No data rate SF%d BW%d in %s' % (sf, bw_khz, band))
+
+
+def parse_credentials(path):
+    # Reads the EUIs, keys and region out of main/credentials.h
+    with open(path) as f:
+        text = f.read()
+
+    def define(name):
+        m = re.search(r'^\s*#define\s+%s\s+((?:.*\\\n)*.*)$' % name, text, re.M)
+        if not m:
+            raise ValueError('%s not found in %s' % (name, path))
+        return m.group(1).replace('\\\n', ' ')
+
+    def key(name):
+        value = bytes(int(b, 16) for b in re.findall(r'0x([0-9A-Fa-f]{2})\b', define(name)))
+        if len(value) != 16:
+            raise ValueError('%s must be 16 bytes' % name)
+        return value
+
+    if re.search(r'^\s*#define\s+USE_NWK_KEY\b', text, re.M):
+        raise ValueError('USE_NWK_KEY (LoRaWAN 1.1) is not supported by the emulator')
+    region = re.search(r'LoRaWANBand_t\s+Region\s*=\s*(\w+)', text)
+    return {
+        'join_eui': int(define('RADIOLIB_LORAWAN_JOIN_EUI').split()[0], 16),
+        'dev_eui': int(define('RADIOLIB_LORAWAN_DEV_EUI').split()[0], 16),
+        'app_key': key('RADIOLIB_LORAWAN_APP_KEY'),
+        'region': region.group(1) if region else 'EU868',
+    }
+
+
+def mtype(phy):
+    if not phy:
+        raise FrameError('empty frame')
+    return phy[0] >> 5
+
+
+def join_request(app_key, join_eui, dev_eui, dev_nonce):
+    msg = bytes([MTYPE_JOIN_REQUEST << 5]) + struct.pack('<QQH', join_eui, dev_eui, dev_nonce)
+    return msg + aes_cmac(app_key, msg)[:4]
+
+
+def parse_join_request(phy):
+    if len(phy) != 23 or mtype(phy) != MTYPE_JOIN_REQUEST:
+        raise FrameError('not a join request')
+    join_eui, dev_eui, dev_nonce = struct.unpack('<QQH', phy[1:19])
+    return {'join_eui': join_eui, 'dev_eui': dev_eui, 'dev_nonce': dev_nonce, 'mic': phy[19:]}
+
+
+def check_join_request(app_key, phy):
+    return aes_cmac(app_key, phy[:19])[:4] == phy[19:]
+
+
+def session_keys(app_key, join_nonce, net_id, dev_nonce):
+    tail = join_nonce.to_bytes(3, 'little') + net_id.to_bytes(3, 'little') + dev_nonce.to_bytes(2, 'little')
+    return {'nwk_s_key': aes_encrypt(app_key, b'\x01' + tail + bytes(7)),
+            'app_s_key': aes_encrypt(app_key, b'\x02' + tail + bytes(7))}
+
+
+def join_accept(app_key, join_nonce, net_id, dev_addr, rx_delay=1, cflist=b''):
+    # The network "decrypts" the accept, so the device only ever needs AES encrypt
+    body = (join_nonce.to_bytes(3, 'little') + net_id.to_bytes(3, 'little') + struct.pack('<IBB', dev_addr, 0, rx_delay)
+            + cflist)
+    mhdr = bytes([MTYPE_JOIN_ACCEPT << 5])
+    plain = body + aes_cmac(app_key, mhdr + body)[:4]
+    return mhdr + b''.join(aes_decrypt(app_key, plain[i:i + 16]) for i in range(0, len(plain), 16))
+
+
+def parse_join_accept(app_key, phy):
+    if mtype(phy) != MTYPE_JOIN_ACCEPT or len(phy) not in (17, 33):
+        raise FrameError('not a join accept')
+    plain = b''.join(aes_encrypt(app_key, phy[i:i + 16]) for i in range(1, len(phy), 16))
+    if aes_cmac(app_key, phy[:1] + plain[:-4])[:4] != plain[-4:]:
+        raise FrameError('join accept MIC mismatch')
+    dev_addr, dl_settings, rx_delay = struct.unpack('<IBB', plain[6:12])
+    return {'join_nonce': int.from_bytes(plain[0:3], 'little'), 'net_id': int.from_bytes(plain[3:6], 'little'),
+            'dev_addr': dev_addr, 'rx_delay': rx_delay or 1, 'cflist': plain[12:-4]}
+
+
+def _block(first, i, downlink, dev_addr, fcnt, length=0):
+    return struct.pack('<BIBIIBB', first, 0, 1 if downlink else 0, dev_addr, fcnt, 0, length or i)
+
+
+def cipher(key, downlink, dev_addr, fcnt, data):
+    # FRMPayload encryption is a counter mode, the same both ways
+    out = bytearray()
+    for i in range(0, len(data), 16):
+        s = aes_encrypt(key, _block(0x01, i // 16 + 1, downlink, dev_addr, fcnt))
+        out += bytes(a ^ b for a, b in zip(data[i:i + 16], s))
+    return bytes(out)
+
+
+def data_mic(nwk_s_key, downlink, dev_addr, fcnt, msg):
+    return aes_cmac(nwk_s_key, _block(0x49, 0, downlink, dev_addr, fcnt, len(msg)) + msg)[:4]
+
+
+def data_frame(keys, mtype_, dev_addr, fcnt, fctrl=0, fopts=b'', fport=None, payload=b''):
+    downlink = mtype_ in (MTYPE_UNCONFIRMED_DOWN, MTYPE_CONFIRMED_DOWN)
+    if len(fopts) > 15:
+        raise FrameError('FOpts longer than 15 bytes')
+    msg = bytes([mtype_ << 5]) + struct.pack('<IBH', dev_addr, fctrl | len(fopts), fcnt & 0xFFFF) + fopts
+    if fport is not None:
+        key = keys['nwk_s_key'] if fport == 0 else keys['app_s_key']
+        msg += bytes([fport]) + cipher(key, downlink, dev_addr, fcnt, payload)
+    return msg + data_mic(keys['nwk_s_key'], downlink, dev_addr, fcnt, msg)
+
+
+def parse_data_header(phy):
+    if len(phy) < 12 or mtype(phy) not in (MTYPE_UNCONFIRMED_UP, MTYPE_UNCONFIRMED_DOWN, MTYPE_CONFIRMED_UP,
+                                           MTYPE_CONFIRMED_DOWN):
+        raise FrameError('not a data frame')
+    dev_addr, fctrl, fcnt16 = struct.unpack('<IBH', phy[1:8])
+    fopts_end = 8 + (fctrl & 0x0F)
+    if fopts_end > len(phy) - 4:
+        raise FrameError('FOpts past end of frame')
+    return {'mtype': mtype(phy), 'dev_addr': dev_addr, 'fctrl': fctrl & 0xF0, 'fcnt16': fcnt16,
+            'fopts': phy[8:fopts_end], 'body': phy[fopts_end:-4], 'mic': phy[-4:]}
+
+
+def full_fcnt(last, fcnt16):
+    # The 16 bits on the air, extended by the highest count seen so far
+    fcnt = (last & ~0xFFFF) | fcnt16
+    return fcnt + 0x10000 if fcnt < last else fcnt
+
+
+def open_data_frame(keys, phy, fcnt):
+    # Checks the MIC at this full frame count and decrypts; None if the MIC does not match
+    hdr = parse_data_header(phy)
+    downlink = hdr['mtype'] in (MTYPE_UNCONFIRMED_DOWN, MTYPE_CONFIRMED_DOWN)
+    if data_mic(keys['nwk_s_key'], downlink, hdr['dev_addr'], fcnt, phy[:-4]) != hdr['mic']:
+        return None
+    hdr['fcnt'] = fcnt
+    hdr['fport'] = None
+    hdr['payload'] = b''
+    if hdr['body']:
+        hdr['fport'] = hdr['body'][0]
+        key = keys['nwk_s_key'] if hdr['fport'] == 0 else keys['app_s_key']
+        hdr['payload'] = cipher(key, downlink, hdr['dev_addr'], fcnt, hdr['body'][1:])
+    return hdr
+
+
+def mac_commands(data):
+    # Splits uplink MAC commands into (cid, payload); stops at the first unknown one, as there is no length to skip
+    commands = []
+    i = 0
+    while i < len(data):
+        cid = data[i]
+        if cid not in MAC_UPLINK_LEN:
+            break
+        commands.append((cid, data[i + 1:i + 1 + MAC_UPLINK_LEN[cid]]))
+        i += 1 + MAC_UPLINK_LEN[cid]
+    return commands
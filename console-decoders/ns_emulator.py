@@ -0,0 +1,485 @@
+import argparse
+import base64
+import heapq
+import json
+import os
+import random
+import socket
+import struct
+import sys
+import time
+
+import lorawan
+import payload_codec
+
+# A stand-in LoRaWAN network server, to see what the Mapper really puts on the
+# air and to exercise the downlink path without TTN or Helium.
+#
+# It knows the device in main/credentials.h, takes its OTAA join, checks and
+# decrypts every frame, decodes it with payload_codec (the same schema and
+# results as unified_decoder.js), answers confirmed uplinks and the LinkCheck
+# and DeviceTime requests in RX1 (or RX2 when the gateway is busy), sends any
+# queued downlink, and counts airtime per device.
+#
+# Two ways to feed it:
+#
+#   python ns_emulator.py udp [--listen 1700]
+#       Semtech UDP packet forwarder protocol, so a real gateway (or a gateway
+#       simulator) pointed at this machine carries the actual firmware's frames.
+#
+#   python ns_emulator.py fleet --devices 200 --interval 60 --sf 7 --hours 1
+#       Simulated Mappers, with real frames, against one emulated 8 channel
+#       gateway: collisions, half-duplex downlinks and gateway duty cycle
+#       included.  For trying a cadence policy on a fleet before shipping it.
+#
+# Either way, --downlink PORT:HEX queues a downlink for the next uplink, e.g.
+# the output of downlink_encoder.py.
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+CREDENTIALS = os.path.join(HERE, '..', 'main', 'credentials.h')
+
+GPS_EPOCH = 315964800  # 1980-01-06 in Unix time
+GPS_LEAP_SECONDS = 18
+
+NET_ID = 0x000013  # TTN, so DevAddrs look familiar
+DEV_ADDR_PREFIX = 0x26000000
+
+# Demodulation floor per SF, for the LinkCheckAns margin
+SNR_FLOOR = {7: -7.5, 8: -10.0, 9: -12.5, 10: -15.0, 11: -17.5, 12: -20.0}
+
+MAPPER_PORT = next(m['port'] for m in payload_codec.MESSAGES if m['name'] == 'mapper')
+
+
+def duty_band(region, freq):
+    # ETSI sub-band of a downlink frequency and its duty cycle, none outside Europe
+    if region != 'EU868':
+        return 'all', 1.0
+    if 869400000 <= freq <= 869650000:
+        return 'g3', 0.1
+    if 868700000 <= freq <= 869200000:
+        return 'g2', 0.001
+    if 868000000 <= freq <= 868600000:
+        return 'g1', 0.01
+    return 'g', 0.01
+
+
+class NetworkServer:
+    def __init__(self, region, log=print):
+        self.region = region
+        self.band = lorawan.BANDS[region]
+        self.log = log
+        self.devices = {}   # DevEUI -> device
+        self.sessions = {}  # DevAddr -> device
+        self.next_addr = 1
+
+    def add_device(self, dev_eui, join_eui, app_key):
+        self.devices[dev_eui] = {'dev_eui': dev_eui, 'join_eui': join_eui, 'app_key': app_key,
+                                 'dev_nonce': None, 'join_nonce': 0, 'session': None, 'queue': [],
+                                 'joins': 0, 'uplinks': 0, 'downlinks': 0, 'up_ms': 0.0, 'down_ms': 0.0,
+                                 'lost_fcnt': 0}
+
+    def queue_downlink(self, dev_eui, fport, payload, confirmed=False):
+        self.devices[dev_eui]['queue'].append((fport, payload, confirmed))
+
+    def airtime_down(self, dev, ms):
+        dev['down_ms'] += ms
+
+    def uplink(self, phy, rx):
+        # rx: time (Unix seconds at the end of the frame), freq, dr, snr.  Returns the answer to send, if any:
+        # phy, delay (seconds after the uplink), rx1 and rx2 as (freq, dr), and the device it is for.
+        try:
+            kind = lorawan.mtype(phy)
+            if kind == lorawan.MTYPE_JOIN_REQUEST:
+                return self._join(phy, rx)
+            if kind in (lorawan.MTYPE_UNCONFIRMED_UP, lorawan.MTYPE_CONFIRMED_UP):
+                return self._data(phy, rx)
+            self.log('Ignored frame type %d' % kind)
+        except lorawan.FrameError as e:
+            self.log('Bad frame %s: %s' % (phy.hex().upper(), e))
+        return None
+
+    def _airtime_up(self, dev, phy, rx):
+        sf, bw = self.band['dr'][rx['dr']]
+        dev['up_ms'] += lorawan.airtime_ms(sf, bw, len(phy))
+
+    def _join(self, phy, rx):
+        req = lorawan.parse_join_request(phy)
+        dev = self.devices.get(req['dev_eui'])
+        if not dev or dev['join_eui'] != req['join_eui']:
+            self.log('Join from unknown device %016X' % req['dev_eui'])
+            return None
+        if not lorawan.check_join_request(dev['app_key'], phy):
+            self.log('%016X join request MIC mismatch, wrong AppKey?' % dev['dev_eui'])
+            return None
+        self._airtime_up(dev, phy, rx)
+        # LoRaWAN 1.0.4: DevNonce counts up and is never used twice, so a device that lost it is refused
+        if dev['dev_nonce'] is not None and req['dev_nonce'] <= dev['dev_nonce']:
+            self.log('%016X DevNonce %d not above %d, ignored' % (dev['dev_eui'], req['dev_nonce'], dev['dev_nonce']))
+            return None
+        dev['dev_nonce'] = req['dev_nonce']
+        dev['join_nonce'] += 1
+        dev['joins'] += 1
+
+        if dev['session']:
+            self.sessions.pop(dev['session']['dev_addr'], None)
+        dev_addr = DEV_ADDR_PREFIX | self.next_addr
+        self.next_addr += 1
+        dev['session'] = dict(lorawan.session_keys(dev['app_key'], dev['join_nonce'], NET_ID, req['dev_nonce']),
+                              dev_addr=dev_addr, fcnt_up=None, fcnt_down=0)
+        self.sessions[dev_addr] = dev
+        self.log('%016X joined, DevNonce %d, DevAddr %08X' % (dev['dev_eui'], req['dev_nonce'], dev_addr))
+        accept = lorawan.join_accept(dev['app_key'], dev['join_nonce'], NET_ID, dev_addr, 1, self.band['cflist'])
+        return self._answer(dev, accept, rx, 5)
+
+    def _data(self, phy, rx):
+        hdr = lorawan.parse_data_header(phy)
+        dev = self.sessions.get(hdr['dev_addr'])
+        if not dev:
+            self.log('Uplink from unknown DevAddr %08X' % hdr['dev_addr'])
+            return None
+        s = dev['session']
+        last = s['fcnt_up'] if s['fcnt_up'] is not None else 0
+        up = lorawan.open_data_frame(s, phy, lorawan.full_fcnt(last, hdr['fcnt16']))
+        if not up:
+            self.log('%016X uplink MIC mismatch' % dev['dev_eui'])
+            return None
+        if s['fcnt_up'] is not None and up['fcnt'] <= s['fcnt_up']:
+            self.log('%016X FCnt %d replayed, ignored' % (dev['dev_eui'], up['fcnt']))
+            return None
+        if s['fcnt_up'] is not None:
+            dev['lost_fcnt'] += up['fcnt'] - s['fcnt_up'] - 1
+        s['fcnt_up'] = up['fcnt']
+        dev['uplinks'] += 1
+        self._airtime_up(dev, phy, rx)
+
+        mac = up['fopts'] if up['fport'] != 0 else up['payload']
+        answers = b''
+        for cid, _ in lorawan.mac_commands(mac):
+            if cid == lorawan.MAC_LINK_CHECK:
+                sf = self.band['dr'][rx['dr']][0]
+                margin = max(0, min(254, round(rx['snr'] - SNR_FLOOR[sf])))
+                answers += bytes([lorawan.MAC_LINK_CHECK, margin, 1])
+            elif cid == lorawan.MAC_DEVICE_TIME:
+                gps = rx['time'] - GPS_EPOCH + GPS_LEAP_SECONDS
+                answers += bytes([lorawan.MAC_DEVICE_TIME]) + struct.pack('<IB', int(gps), int(gps % 1 * 256))
+
+        confirmed = up['mtype'] == lorawan.MTYPE_CONFIRMED_UP
+        decoded = None
+        if up['fport']:
+            decoded = payload_codec.decode(up['fport'], up['payload'])
+        self.log('%016X up FCnt %d%s port %s %s%s' % (
+            dev['dev_eui'], up['fcnt'], ' confirmed' if confirmed else '', up['fport'], up['payload'].hex().upper(),
+            ' ' + json.dumps(decoded) if decoded else ''))
+
+        if not (confirmed or answers or dev['queue']):
+            return None
+        fport, payload, down_confirmed = dev['queue'].pop(0) if dev['queue'] else (None, b'', False)
+        kind = lorawan.MTYPE_CONFIRMED_DOWN if down_confirmed else lorawan.MTYPE_UNCONFIRMED_DOWN
+        down = lorawan.data_frame(s, kind, s['dev_addr'], s['fcnt_down'], lorawan.FCTRL_ACK if confirmed else 0,
+                                  answers, fport, payload)
+        s['fcnt_down'] += 1
+        return self._answer(dev, down, rx, 1)
+
+    def _answer(self, dev, phy, rx, delay):
+        rx1 = self.band['rx1'](rx['freq'], rx['dr'])
+        return {'dev': dev, 'phy': phy, 'delay': delay, 'rx1': rx1, 'rx2': self.band['rx2']}
+
+    def report(self):
+        for dev in self.devices.values():
+            self.log('%016X joins %d, uplinks %d (%d missing FCnts), downlinks %d, airtime up %.1fs down %.1fs' % (
+                dev['dev_eui'], dev['joins'], dev['uplinks'], dev['lost_fcnt'], dev['downlinks'],
+                dev['up_ms'] / 1000, dev['down_ms'] / 1000))
+
+
+def parse_datr(datr):
+    sf, bw = datr.upper().replace('SF', '').split('BW')
+    return int(sf), int(bw)
+
+
+def serve_udp(ns, listen):
+    # Semtech UDP packet forwarder, protocol version 2
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(('0.0.0.0', listen))
+    ns.log('Listening for a packet forwarder on UDP port %d' % listen)
+    pull_addr = None
+    token = 0
+    while True:
+        data, addr = sock.recvfrom(65535)
+        if len(data) < 4 or data[0] != 2:
+            continue
+        ident = data[3]
+        if ident == 0x02:  # PULL_DATA: where downlinks go
+            pull_addr = addr
+            sock.sendto(data[:3] + b'\x04', addr)
+        elif ident == 0x05 and len(data) > 12:  # TX_ACK
+            error = json.loads(data[12:]).get('txpk_ack', {}).get('error', 'NONE')
+            if error != 'NONE':
+                ns.log('Gateway refused the downlink: %s' % error)
+        elif ident == 0x00:  # PUSH_DATA
+            sock.sendto(data[:3] + b'\x01', addr)
+            for rxpk in json.loads(data[12:]).get('rxpk', []):
+                if rxpk.get('modu', 'LORA') != 'LORA' or rxpk.get('stat', 1) != 1:
+                    continue
+                sf, bw = parse_datr(rxpk['datr'])
+                rx = {'time': time.time(), 'freq': round(rxpk['freq'] * 1e6),
+                      'dr': lorawan.dr_for_sf(ns.region, sf, bw), 'snr': rxpk.get('lsnr', 0)}
+                answer = ns.uplink(base64.b64decode(rxpk['data']), rx)
+                if not answer or not pull_addr:
+                    continue
+                freq, dr = answer['rx1']
+                sf, bw = ns.band['dr'][dr]
+                ns.airtime_down(answer['dev'], lorawan.airtime_ms(sf, bw, len(answer['phy']), crc=False))
+                answer['dev']['downlinks'] += 1
+                txpk = {'imme': False, 'tmst': (rxpk['tmst'] + answer['delay'] * 1000000) & 0xFFFFFFFF,
+                        'freq': freq / 1e6, 'rfch': 0, 'powe': 14, 'modu': 'LORA', 'datr': 'SF%dBW%d' % (sf, bw),
+                        'codr': '4/5', 'ipol': True, 'size': len(answer['phy']),
+                        'data': base64.b64encode(answer['phy']).decode()}
+                token = (token + 1) & 0xFFFF
+                sock.sendto(struct.pack('>BHB', 2, token, 0x03) + json.dumps({'txpk': txpk}).encode(), pull_addr)
+
+
+class SimDevice:
+    # The end device side of a simulated Mapper
+    def __init__(self, rng, region, dev_eui, join_eui, app_key, dr, snr):
+        self.rng = rng
+        self.dev_eui = dev_eui
+        self.join_eui = join_eui
+        self.app_key = app_key
+        self.dr = dr
+        self.snr = snr
+        self.dev_nonce = 0
+        self.session = None
+        self.fcnt_up = 0
+        self.fcnt_down = None
+        self.channels = 3 if region == 'EU868' else 8  # Until the join accept's CFList adds the rest
+        self.joined_at = None
+        self.up_ms = 0.0
+        self.sent = self.confirmed = self.acked = 0
+
+    def frame(self, confirm):
+        if not self.session:
+            self.dev_nonce += 1
+            return lorawan.join_request(self.app_key, self.join_eui, self.dev_eui, self.dev_nonce), False
+        payload = payload_codec.encode('mapper', {'latitude': 47 + self.rng.random(),
+                                                  'longitude': 8 + self.rng.random(),
+                                                  'altitude': self.rng.randint(300, 600),
+                                                  'sats': self.rng.randint(4, 12)})
+        # As the firmware does, confirmed uplinks also ask for LinkCheck and DeviceTime
+        fopts = bytes([lorawan.MAC_LINK_CHECK, lorawan.MAC_DEVICE_TIME]) if confirm else b''
+        kind = lorawan.MTYPE_CONFIRMED_UP if confirm else lorawan.MTYPE_UNCONFIRMED_UP
+        phy = lorawan.data_frame(self.session, kind, self.session['dev_addr'], self.fcnt_up, 0, fopts,
+                                 MAPPER_PORT, payload)
+        self.fcnt_up += 1
+        return phy, confirm
+
+    def receive(self, phy, now):
+        if lorawan.mtype(phy) == lorawan.MTYPE_JOIN_ACCEPT:
+            accept = lorawan.parse_join_accept(self.app_key, phy)
+            self.session = dict(lorawan.session_keys(self.app_key, accept['join_nonce'], accept['net_id'],
+                                                     self.dev_nonce), dev_addr=accept['dev_addr'])
+            self.fcnt_up = 0
+            if accept['cflist']:
+                self.channels = 8
+            self.joined_at = now
+            return
+        hdr = lorawan.parse_data_header(phy)
+        down = lorawan.open_data_frame(self.session, phy, lorawan.full_fcnt(self.fcnt_down or 0, hdr['fcnt16']))
+        if not down:
+            raise lorawan.FrameError('downlink MIC mismatch at device')
+        self.fcnt_down = down['fcnt']
+        if down['fctrl'] & lorawan.FCTRL_ACK:
+            self.acked += 1
+
+
+def simulate_fleet(ns, args, rng):
+    band = ns.band
+    start = time.time()
+    end_time = start + args.hours * 3600
+    sf_list = [int(sf) for sf in args.sf.split(',')]
+
+    devices = []
+    for i in range(args.devices):
+        dev_eui = 0x70B3D57ED0000000 + i
+        app_key = bytes(rng.getrandbits(8) for _ in range(16))
+        ns.add_device(dev_eui, 0, app_key)
+        for fport, payload in args.downlink:
+            ns.queue_downlink(dev_eui, fport, payload)
+        dr = lorawan.dr_for_sf(ns.region, sf_list[i % len(sf_list)])
+        devices.append(SimDevice(rng, ns.region, dev_eui, 0, app_key, dr, rng.uniform(-10, 10)))
+
+    events = []
+    seq = 0
+
+    def schedule(t, kind, data):
+        nonlocal seq
+        seq += 1
+        heapq.heappush(events, (t, seq, kind, data))
+
+    # Everyone powers up within the first interval
+    for dev in devices:
+        schedule(start + rng.uniform(0, args.interval), 'tx', dev)
+
+    air = []      # uplinks on the air or recently so
+    gw_tx = []    # (start, end) of gateway transmissions
+    band_free = {}
+    stats = {'sent': 0, 'received': 0, 'collision': 0, 'gateway tx': 0, 'demodulators': 0, 'rx1': 0, 'rx2': 0,
+             'dropped': 0, 'joins': 0}
+    channel_ms = {}
+    band_ms = {}
+
+    def gateway_busy(t0, t1):
+        return any(s < t1 and t0 < e for s, e in gw_tx)
+
+    def next_tx(dev, t):
+        interval = args.interval if dev.session else args.join_retry
+        schedule(t + interval * rng.uniform(1 - args.jitter, 1 + args.jitter), 'tx', dev)
+
+    while events:
+        t, _, kind, data = heapq.heappop(events)
+        if t > end_time:
+            break
+
+        if kind == 'tx':
+            dev = data
+            confirm = bool(dev.session) and args.confirm_every > 0 and dev.fcnt_up % args.confirm_every == 0
+            phy, confirm = dev.frame(confirm)
+            sf, bw = band['dr'][dev.dr]
+            toa = lorawan.airtime_ms(sf, bw, len(phy)) / 1000
+            freq = band['uplink'][rng.randrange(dev.channels)]
+            dev.up_ms += toa * 1000
+            dev.sent += 1
+            dev.confirmed += confirm
+            stats['sent'] += 1
+            channel_ms[freq] = channel_ms.get(freq, 0) + toa * 1000
+            rec = {'dev': dev, 'phy': phy, 'start': t, 'end': t + toa, 'freq': freq, 'sf': sf, 'lost': None}
+            concurrent = [a for a in air if a['start'] <= t < a['end']]
+            if len(concurrent) >= 8:
+                rec['lost'] = 'demodulators'
+            air.append(rec)
+            schedule(t + toa, 'end', rec)
+            if dev.session:
+                next_tx(dev, t)
+
+        elif kind == 'end':
+            rec = data
+            dev = rec['dev']
+            air = [a for a in air if a['end'] > t - 30]
+            for a in air:
+                if a is not rec and a['freq'] == rec['freq'] and a['sf'] == rec['sf'] and \
+                        a['start'] < rec['end'] and rec['start'] < a['end']:
+                    rec['lost'] = rec['lost'] or 'collision'
+            if not rec['lost'] and gateway_busy(rec['start'], rec['end']):
+                rec['lost'] = 'gateway tx'
+            if rec['lost']:
+                stats[rec['lost']] += 1
+            else:
+                stats['received'] += 1
+                answer = ns.uplink(rec['phy'], {'time': t, 'freq': rec['freq'], 'dr': dev.dr, 'snr': dev.snr})
+                if answer:
+                    sent = False
+                    for window, (freq, dr), delay in (('rx1', answer['rx1'], answer['delay']),
+                                                      ('rx2', answer['rx2'], answer['delay'] + 1)):
+                        sf, bw = band['dr'][dr]
+                        toa = lorawan.airtime_ms(sf, bw, len(answer['phy']), crc=False) / 1000
+                        name, duty = duty_band(ns.region, freq)
+                        t0 = t + delay
+                        if gateway_busy(t0, t0 + toa) or band_free.get(name, 0) > t0:
+                            continue
+                        gw_tx.append((t0, t0 + toa))
+                        band_free[name] = t0 + toa / duty
+                        band_ms[name] = band_ms.get(name, 0) + toa * 1000
+                        ns.airtime_down(answer['dev'], toa * 1000)
+                        answer['dev']['downlinks'] += 1
+                        stats[window] += 1
+                        schedule(t0 + toa, 'rx', (dev, answer['phy']))
+                        sent = True
+                        break
+                    if not sent:
+                        stats['dropped'] += 1
+                gw_tx = [(s, e) for s, e in gw_tx if e > t - 30]
+            if not dev.session:
+                # Once both receive windows are over, either start mapping or retry the join
+                schedule(t + 8, 'join check', dev)
+
+        elif kind == 'rx':
+            dev, phy = data
+            if lorawan.mtype(phy) == lorawan.MTYPE_JOIN_ACCEPT:
+                stats['joins'] += 1
+            dev.receive(phy, t)
+
+        elif kind == 'join check':
+            next_tx(data, t)
+
+    hours = args.hours
+    print('Fleet: %d devices on %s, SF %s, every %ds +-%d%%, confirmed every %s, %.1f h' % (
+        args.devices, ns.region, args.sf, args.interval, args.jitter * 100, args.confirm_every or 'never', hours))
+    sent = stats['sent'] or 1
+    print('Uplinks: %d sent, %d received (%.1f%%)' % (stats['sent'], stats['received'], 100 * stats['received'] / sent))
+    print('Lost: %d collisions, %d during gateway transmit, %d with all 8 demodulators busy' % (
+        stats['collision'], stats['gateway tx'], stats['demodulators']))
+    joined = [d for d in devices if d.joined_at]
+    if joined:
+        print('Joined: %d of %d, mean %.0fs after start' % (
+            len(joined), len(devices), sum(d.joined_at - start for d in joined) / len(joined)))
+    else:
+        print('Joined: none of %d' % len(devices))
+    confirmed = sum(d.confirmed for d in devices)
+    if confirmed:
+        print('Confirmed: %d, acknowledged %d (%.1f%%)' % (
+            confirmed, sum(d.acked for d in devices), 100 * sum(d.acked for d in devices) / confirmed))
+    print('Downlinks: %d in RX1, %d in RX2, %d dropped (gateway busy or out of duty cycle)' % (
+        stats['rx1'], stats['rx2'], stats['dropped']))
+    for freq in sorted(channel_ms):
+        print('  Uplink channel %.1f MHz busy %.1f%%' % (freq / 1e6, channel_ms[freq] / (hours * 36000)))
+    for name in sorted(band_ms):
+        print('  Gateway band %s downlink duty cycle %.2f%%' % (name, band_ms[name] / (hours * 36000)))
+    per_hour = sorted(d.up_ms / hours for d in devices)
+    print('Device airtime: mean %.1fs/h, max %.1fs/h; %d over 1%% duty cycle, %d over the TTN 30s/day fair use' % (
+        sum(per_hour) / len(per_hour) / 1000, per_hour[-1] / 1000, sum(ms > 36000 for ms in per_hour),
+        sum(ms * 24 > 30000 for ms in per_hour)))
+
+
+def parse_downlink(text):
+    fport, _, payload = text.partition(':')
+    return int(fport), bytes.fromhex(payload.replace(' ', ''))
+
+
+if __name__ == '__main__':
+    common = argparse.ArgumentParser(add_help=False)
+    common.add_argument('--credentials', default=CREDENTIALS, help='credentials.h with the device keys')
+    common.add_argument('--downlink', action='append', type=parse_downlink, default=[], metavar='PORT:HEX',
+                        help='Queue a downlink, sent after the next uplink (repeatable)')
+    parser = argparse.ArgumentParser(description='Emulate a LoRaWAN network server for the Mapper.')
+    sub = parser.add_subparsers(dest='mode', required=True)
+    udp = sub.add_parser('udp', parents=[common], help='Serve a gateway over the Semtech UDP packet forwarder protocol')
+    udp.add_argument('--listen', type=int, default=1700, help='UDP port')
+    fleet = sub.add_parser('fleet', parents=[common], help='Simulate a fleet of Mappers against one gateway')
+    fleet.add_argument('--devices', type=int, default=200)
+    fleet.add_argument('--interval', type=float, default=60, help='Seconds between uplinks')
+    fleet.add_argument('--jitter', type=float, default=0.1, help='Random spread of the interval, as a fraction')
+    fleet.add_argument('--sf', default='7', help='Spreading factor, or a list shared out over the fleet: 7,8,9')
+    fleet.add_argument('--confirm-every', type=int, default=0, help='Every Nth uplink is confirmed, 0 for never')
+    fleet.add_argument('--join-retry', type=float, default=30, help='Seconds before a Join is retried')
+    fleet.add_argument('--hours', type=float, default=1)
+    fleet.add_argument('--seed', type=int, default=1)
+    fleet.add_argument('--verbose', '-v', action='store_true', help='Print every frame')
+    args = parser.parse_args()
+
+    try:
+        creds = lorawan.parse_credentials(args.credentials)
+    except (OSError, ValueError) as e:
+        parser.error(e)
+
+    if args.mode == 'udp':
+        ns = NetworkServer(creds['region'], log=lambda msg: print(time.strftime('%H:%M:%S'), msg, flush=True))
+        ns.add_device(creds['dev_eui'], creds['join_eui'], creds['app_key'])
+        for fport, payload in args.downlink:
+            ns.queue_downlink(creds['dev_eui'], fport, payload)
+        try:
+            serve_udp(ns, args.listen)
+        except KeyboardInterrupt:
+            ns.report()
+    else:
+        ns = NetworkServer(creds['region'], log=print if args.verbose else lambda msg: None)
+        simulate_fleet(ns, args, random.Random(args.seed))
+    sys.exit(0)
@@ -0,0 +1,300 @@
+# Generated by console-decoders/codec_gen.py from payload_schema.json -- do not edit
+#
+# Payload codec for the Mapper, table-driven from the schema below.
+from decimal import Decimal, ROUND_HALF_UP
+
+
+def _to_fixed(value, digits):
+    # Same rounding as JavaScript toFixed(), so both decoders agree to the bit
+    return float(Decimal(value).quantize(Decimal(1).scaleb(-digits), rounding=ROUND_HALF_UP))
+
+
+def _present(field, raw):
+    when = field.get('when')
+    return when is None or (raw[when['field']] & when['mask']) != 0
+
+
+def _by_port(port, direction):
+    for message in MESSAGES:
+        if message['port'] == port and message['direction'] == direction:
+            return message
+    return None
+
+
+def _by_name(name):
+    for message in MESSAGES:
+        if message['name'] == name:
+            return message
+    raise KeyError(name)
+
+
+def encode_raw(name, raw):
+    """Pack a dict of wire-level integers into bytes"""
+    bits = []
+    for field in _by_name(name)['fields']:
+        if 'bits' not in field or not _present(field, raw):
+            continue
+        value = field['match'] if 'match' in field else raw.get(field['name'], 0)
+        value &= (1 << field['bits']) - 1
+        bits.extend((value >> (field['bits'] - 1 - i)) & 1 for i in range(field['bits']))
+    bits.extend([0] * (-len(bits) % 8))
+    return bytes(int(''.join(map(str, bits[i:i + 8])), 2) for i in range(0, len(bits), 8))
+
+
+def decode_raw(name, payload):
+    """Unpack bytes into a dict of wire-level integers, None if truncated or mismatched"""
+    raw = {}
+    pos = 0
+    for field in _by_name(name)['fields']:
+        if 'bits' not in field:
+            continue
+        if not _present(field, raw):
+            raw[field['name']] = 0
+            continue
+        if pos + field['bits'] > len(payload) * 8:
+            return None
+        value = 0
+        for _ in range(field['bits']):
+            value = (value << 1) | ((payload[pos >> 3] >> (7 - (pos & 7))) & 1)
+            pos += 1
+        if field.get('signed') and value & (1 << (field['bits'] - 1)):
+            value -= 1 << field['bits']
+        if 'match' in field:
+            if value != field['match']:
+                return None
+            continue
+        raw[field['name']] = value
+    return raw
+
+
+def _to_value(field, value):
+    if 'div' in field:
+        value = value / field['div']
+    if 'mul' in field:
+        value = value * field['mul']
+    if 'add' in field:
+        value = value + field['add']
+    if 'round' in field:
+        value = _to_fixed(value, field['round'])
+    return field.get('enum', {}).get(str(value), value)
+
+
+def _from_value(field, value):
+    if 'add' in field:
+        value = value - field['add']
+    if 'mul' in field:
+        value = value / field['mul']
+    if 'div' in field:
+        value = value * field['div']
+    return int(value)
+
+
+def _frame_len(message, raw):
+    """Bytes the frame itself takes, anything after it is the tail"""
+    bits = sum(field['bits'] for field in message['fields'] if 'bits' in field and _present(field, raw))
+    return (bits + 7) // 8
+
+
+def _decode_message(message, payload):
+    decoded = {}
+    raw = decode_raw(message['name'], payload)
+    if raw is None:
+        return decoded
+    for field in message['fields']:
+        if 'const' in field:
+            decoded[field['name']] = field['const']
+        elif field.get('hidden') or 'match' in field:
+            continue
+        elif _present(field, raw):
+            decoded[field['name']] = _to_value(field, raw[field['name']])
+        elif 'default' in field:
+            decoded[field['name']] = field['default']
+    # Another message may ride along after the frame, its fields join the result
+    if decoded and 'tail' in message:
+        decoded.update(_decode_message(_by_name(message['tail']), payload[_frame_len(message, raw):]))
+    return decoded
+
+
+def decode(port, payload, direction='uplink'):
+    """Decode a frame into the same dict the Console decoder produces"""
+    message = _by_port(port, direction)
+    if message is None:
+        return {}
+    return _decode_message(message, payload)
+
+
+def encode(name, values):
+    """Encode a dict of engineering values (as decode() returns them) into bytes"""
+    raw = {}
+    for field in _by_name(name)['fields']:
+        if 'bits' in field and field['name'] in values:
+            raw[field['name']] = _from_value(field, values[field['name']])
+    return encode_raw(name, raw)
+
+
+def _command(key):
+    for command in COMMANDS['list']:
+        if key in (command['id'], command['name']):
+            return command
+    raise KeyError(key)
+
+
+def encode_commands(values):
+    """Encode a list of (name, engineering value) into one command Downlink, raises ValueError when out of bounds"""
+    payload = b''
+    for name, value in values:
+        command = _command(name)
+        raw = round((value - command.get('add', 0)) * command.get('div', 1))
+        if not command['min'] <= raw <= command['max']:
+            raise ValueError('%s out of range' % name)
+        payload += bytes([command['id']]) + raw.to_bytes(command['bits'] // 8, 'big', signed=command.get('signed', False))
+    return payload
+
+
+def decode_commands(payload):
+    """Decode a command Downlink into a list of (name, wire value), None if anything in it is invalid"""
+    commands = []
+    pos = 0
+    while pos < len(payload):
+        try:
+            command = _command(payload[pos])
+        except KeyError:
+            return None
+        size = command['bits'] // 8
+        if pos + 1 + size > len(payload):
+            return None
+        raw = int.from_bytes(payload[pos + 1:pos + 1 + size], 'big', signed=command.get('signed', False))
+        if not command['min'] <= raw <= command['max']:
+            return None
+        commands.append((command['name'], raw))
+        pos += 1 + size
+    return commands
+
+
+MESSAGES = [{'name': 'mapper',
+  'direction': 'uplink',
+  'port': 2,
+  'tail': 'telemetry',
+  'comment': 'Mapper! (Cargo and Heatmap too): 3 Lat, 3 Long, 2 Altitude (m), 1 Sats',
+  'fields': [{'name': 'latitude', 'bits': 24, 'div': 16777215.0, 'mul': 180, 'add': -90},
+             {'name': 'longitude', 'bits': 24, 'div': 16777215.0, 'mul': 360, 'add': -180},
+             {'name': 'altitude', 'bits': 16, 'signed': True},
+             {'name': 'sats', 'bits': 8},
+             {'name': 'accuracy',
+              'const': 2.5,
+              'comment': 'Bogus Accuracy required by Cargo/Mapper integration'}]},
+ {'name': 'mapper_v2',
+  'direction': 'uplink',
+  'port': 3,
+  'tail': 'telemetry',
+  'comment': 'Mapper payload v2: 1e-6 degree position, optional accuracy, speed and heading',
+  'fields': [{'name': 'version', 'bits': 3, 'match': 2},
+             {'name': 'flags', 'bits': 2, 'hidden': True},
+             {'name': 'latitude', 'bits': 28, 'div': 1000000, 'add': -90, 'round': 6},
+             {'name': 'longitude', 'bits': 29, 'div': 1000000, 'add': -180, 'round': 6},
+             {'name': 'altitude', 'bits': 16, 'signed': True},
+             {'name': 'sats', 'bits': 5},
+             {'name': 'accuracy',
+              'bits': 7,
+              'div': 2,
+              'when': {'field': 'flags', 'mask': 1},
+              'default': 2.5,
+              'comment': 'Meters, in 0.5m steps'},
+             {'name': 'speed',
+              'bits': 10,
+              'mul': 0.36,
+              'round': 1,
+              'when': {'field': 'flags', 'mask': 2},
+              'comment': 'km/h, sent as 0.1 m/s'},
+             {'name': 'heading', 'bits': 9, 'when': {'field': 'flags', 'mask': 2}}]},
+ {'name': 'status',
+  'direction': 'uplink',
+  'port': 5,
+  'tail': 'telemetry',
+  'comment': 'System status',
+  'fields': [{'name': 'last_latitude', 'bits': 24, 'div': 16777215.0, 'mul': 180, 'add': -90},
+             {'name': 'last_longitude', 'bits': 24, 'div': 16777215.0, 'mul': 360, 'add': -180},
+             {'name': 'battery', 'bits': 8, 'div': 100, 'add': 2, 'round': 2},
+             {'name': 'status', 'bits': 8, 'enum': {'1': 'BOOT', '2': 'USB ON', '3': 'USB OFF'}},
+             {'name': 'value', 'bits': 8}]},
+ {'name': 'gps_lost',
+  'direction': 'uplink',
+  'port': 6,
+  'tail': 'telemetry',
+  'comment': 'Lost GPS',
+  'fields': [{'name': 'last_latitude', 'bits': 24, 'div': 16777215.0, 'mul': 180, 'add': -90},
+             {'name': 'last_longitude', 'bits': 24, 'div': 16777215.0, 'mul': 360, 'add': -180},
+             {'name': 'battery', 'bits': 8, 'div': 100, 'add': 2, 'round': 2},
+             {'name': 'sats', 'bits': 8},
+             {'name': 'minutes', 'bits': 16}]},
+ {'name': 'telemetry',
+  'direction': 'uplink',
+  'port': 7,
+  'comment': 'Device telemetry, alone or appended to a mapper, status or GPS lost frame',
+  'fields': [{'name': 'battery', 'bits': 8, 'div': 100, 'add': 2, 'round': 2},
+             {'name': 'uptime', 'bits': 16, 'comment': 'Minutes since reset, stops at 65535'},
+             {'name': 'airtime',
+              'bits': 14,
+              'comment': 'Seconds of transmit time since reset, stops at 16383'},
+             {'name': 'frames', 'bits': 15, 'comment': 'Uplinks since reset, stops at 32767'},
+             {'name': 'ack_ratio',
+              'bits': 7,
+              'enum': {'127': 'none'},
+              'comment': 'Percent of confirmed uplinks acknowledged, 127 when none were asked for'},
+             {'name': 'reset_reason',
+              'bits': 4,
+              'enum': {'0': 'UNKNOWN',
+                       '1': 'POWERON',
+                       '2': 'EXT',
+                       '3': 'SW',
+                       '4': 'PANIC',
+                       '5': 'INT_WDT',
+                       '6': 'TASK_WDT',
+                       '7': 'WDT',
+                       '8': 'DEEPSLEEP',
+                       '9': 'BROWNOUT',
+                       '10': 'SDIO'}}]},
+ {'name': 'config',
+  'direction': 'downlink',
+  'port': 1,
+  'comment': 'Remote configuration. Zero leaves a setting unchanged, time 0xFFFF reverts to the build '
+             'default.',
+  'fields': [{'name': 'distance', 'bits': 16, 'comment': 'Meters'},
+             {'name': 'time_interval', 'bits': 16, 'comment': 'Seconds'},
+             {'name': 'cutoff_volts', 'bits': 8, 'div': 100, 'add': 2, 'round': 2}]}]
+
+COMMANDS = {'port': 10,
+ 'comment': 'Downlink commands: any number of [id:8][value, big-endian], applied all or nothing and saved to '
+            'flash',
+ 'list': [{'id': 1, 'name': 'distance', 'bits': 16, 'min': 10, 'max': 65534, 'comment': 'Meters'},
+          {'id': 2, 'name': 'time_interval', 'bits': 16, 'min': 10, 'max': 65534, 'comment': 'Seconds'},
+          {'id': 3,
+           'name': 'cutoff_volts',
+           'bits': 8,
+           'div': 100,
+           'add': 2,
+           'min': 70,
+           'max': 190,
+           'comment': '2.7 to 3.9V'},
+          {'id': 4, 'name': 'sf', 'bits': 8, 'min': 7, 'max': 10},
+          {'id': 5, 'name': 'tx_power', 'bits': 8, 'min': 2, 'max': 20, 'comment': 'dBm'},
+          {'id': 6,
+           'name': 'deadzone_lat',
+           'bits': 32,
+           'signed': True,
+           'div': 1000000,
+           'min': -90000000,
+           'max': 90000000},
+          {'id': 7,
+           'name': 'deadzone_lon',
+           'bits': 32,
+           'signed': True,
+           'div': 1000000,
+           'min': -180000000,
+           'max': 180000000},
+          {'id': 8,
+           'name': 'deadzone_radius',
+           'bits': 16,
+           'min': 0,
+           'max': 65535,
+           'comment': 'Meters, 0 disables'}]}
@@ -0,0 +1,495 @@
+// Coverage cells from stored uplinks, kept up to date incrementally.
+//
+//   c++ -O2 -std=c++17 -o tiles tiles.cpp
+//   ./tiles update --data uplinks --tiles tiles
+//   ./tiles at --tiles tiles 47.3769 8.5417
+//   ./tiles geojson --tiles tiles --precision 7 --bbox 47.3,8.4,47.5,8.7 > coverage.geojson
+//
+// The uplinks come from the ingest.cpp store.  Each update only reads the rows
+// added since the last one (tiles/state.json keeps how far each day got), and
+// folds them into geohash cells at several sizes: count, RSSI min, max and
+// mean, best SNR, most gateways, and when the cell was last heard.
+//
+// Each size is one file, an open addressing hash table of fixed records that
+// is memory mapped, so looking up a cell or walking a map area reads the
+// pages it needs and nothing else.  It doubles when 70% full, into a new file
+// that replaces the old one once complete.  An update saves the cells and
+// state.json after every batch of rows, so one that is cut short counts at
+// most its last batch twice.  Like the uplink store, the files are in native
+// byte order, which is little endian everywhere this runs.
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "batch_codec.h"
+#include "uplink_store.h"
+
+static const int PRECISIONS[] = {5, 6, 7, 8};  // About 4.9km, 1.2km, 150m and 38m across
+#define PRECISION_COUNT 4
+#define PRECISION_MAX 8
+#define CELLS_MAGIC "MCOV"
+#define CELLS_VERSION 1
+#define HEADER_SIZE 16  // magic, version, precision, capacity, used
+#define RECORD_SIZE 44  // key, count, rssi min, max, sum, best snr, most gateways, 2 spare, last time
+#define INITIAL_CAPACITY (1 << 12)
+#define UPDATE_BATCH 65536  // Rows folded in between saves of the cells and state.json
+static const char BASE32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+struct cell {
+  uint64_t key;  // The geohash bits plus one, so zero marks a free slot
+  uint32_t count;
+  float rssi_min, rssi_max;
+  double rssi_sum;
+  float snr_best;
+  uint16_t gateways_max;
+  int64_t last_ms;
+};
+
+static void cell_load(const uint8_t *p, struct cell &c) {
+  memcpy(&c.key, p, 8);
+  memcpy(&c.count, p + 8, 4);
+  memcpy(&c.rssi_min, p + 12, 4);
+  memcpy(&c.rssi_max, p + 16, 4);
+  memcpy(&c.rssi_sum, p + 20, 8);
+  memcpy(&c.snr_best, p + 28, 4);
+  memcpy(&c.gateways_max, p + 32, 2);
+  memcpy(&c.last_ms, p + 36, 8);
+}
+
+static void cell_store(uint8_t *p, const struct cell &c) {
+  memcpy(p, &c.key, 8);
+  memcpy(p + 8, &c.count, 4);
+  memcpy(p + 12, &c.rssi_min, 4);
+  memcpy(p + 16, &c.rssi_max, 4);
+  memcpy(p + 20, &c.rssi_sum, 8);
+  memcpy(p + 28, &c.snr_best, 4);
+  memcpy(p + 32, &c.gateways_max, 2);
+  memset(p + 34, 0, 2);
+  memcpy(p + 36, &c.last_ms, 8);
+}
+
+// Interleaved bits, longitude first, 5 per character
+static uint64_t geohash_bits(double lat, double lon, int precision) {
+  double lat_lo = -90, lat_hi = 90, lon_lo = -180, lon_hi = 180;
+  uint64_t bits = 0;
+  for (int i = 0; i < 5 * precision; i++) {
+    double &lo = i % 2 ? lat_lo : lon_lo, &hi = i % 2 ? lat_hi : lon_hi;
+    double mid = (lo + hi) / 2;
+    bool upper = (i % 2 ? lat : lon) >= mid;
+    bits = bits << 1 | upper;
+    (upper ? lo : hi) = mid;
+  }
+  return bits;
+}
+
+// South, west, north and east of a cell
+static void geohash_box(uint64_t bits, int precision, double box[4]) {
+  double lat_lo = -90, lat_hi = 90, lon_lo = -180, lon_hi = 180;
+  int n = 5 * precision;
+  for (int i = 0; i < n; i++) {
+    double &lo = i % 2 ? lat_lo : lon_lo, &hi = i % 2 ? lat_hi : lon_hi;
+    double mid = (lo + hi) / 2;
+    (bits >> (n - 1 - i) & 1 ? lo : hi) = mid;
+  }
+  box[0] = lat_lo;
+  box[1] = lon_lo;
+  box[2] = lat_hi;
+  box[3] = lon_hi;
+}
+
+static std::string geohash_text(uint64_t bits, int precision) {
+  std::string text;
+  for (int i = 0; i < precision; i++)
+    text += BASE32[bits >> (5 * (precision - 1 - i)) & 31];
+  return text;
+}
+
+// One precision's hash table
+struct cell_file {
+  std::string path;
+  int precision;
+  int fd = -1;
+  uint8_t *map = NULL;
+  uint32_t capacity, used;
+};
+
+static void die(const std::string &what) {
+  perror(what.c_str());
+  exit(1);
+}
+
+static void cells_create(const struct cell_file &f, const std::string &path, uint32_t capacity) {
+  uint8_t header[HEADER_SIZE];
+  uint16_t version = CELLS_VERSION, precision = f.precision;
+  uint32_t used = 0;
+  memcpy(header, CELLS_MAGIC, 4);
+  memcpy(header + 4, &version, 2);
+  memcpy(header + 6, &precision, 2);
+  memcpy(header + 8, &capacity, 4);
+  memcpy(header + 12, &used, 4);
+  FILE *out = fopen(path.c_str(), "wb");
+  if (!out || fwrite(header, HEADER_SIZE, 1, out) != 1 || fclose(out) ||
+      truncate(path.c_str(), HEADER_SIZE + (off_t)capacity * RECORD_SIZE))
+    die(path);
+}
+
+static void cells_map(struct cell_file &f) {
+  f.fd = open(f.path.c_str(), O_RDWR);
+  size_t size = f.fd < 0 ? 0 : store_file_size(f.path);
+  if (size < HEADER_SIZE)
+    die(f.path);
+  f.map = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, f.fd, 0);
+  if (f.map == MAP_FAILED)
+    die(f.path);
+  uint16_t precision;
+  memcpy(&precision, f.map + 6, 2);
+  memcpy(&f.capacity, f.map + 8, 4);
+  memcpy(&f.used, f.map + 12, 4);
+  if (memcmp(f.map, CELLS_MAGIC, 4) || precision != f.precision ||
+      size < HEADER_SIZE + (size_t)f.capacity * RECORD_SIZE) {
+    fprintf(stderr, "%s is not a precision %d cell file\n", f.path.c_str(), f.precision);
+    exit(1);
+  }
+}
+
+static void cells_unmap(struct cell_file &f) {
+  munmap(f.map, HEADER_SIZE + (size_t)f.capacity * RECORD_SIZE);
+  close(f.fd);
+}
+
+static void cells_open(struct cell_file &f, const std::string &path, int precision) {
+  f.path = path;
+  f.precision = precision;
+  if (!std::filesystem::exists(path))
+    cells_create(f, path, INITIAL_CAPACITY);
+  cells_map(f);
+}
+
+// The cells in use, counted, for an update: the header only holds what the last save wrote
+static void cells_recount(struct cell_file &f) {
+  f.used = 0;
+  for (uint32_t i = 0; i < f.capacity; i++) {
+    uint64_t key;
+    memcpy(&key, f.map + HEADER_SIZE + (size_t)i * RECORD_SIZE, 8);
+    f.used += key != 0;
+  }
+}
+
+static void cells_sync(struct cell_file &f) {
+  memcpy(f.map + 12, &f.used, 4);
+  if (msync(f.map, HEADER_SIZE + (size_t)f.capacity * RECORD_SIZE, MS_SYNC))
+    die(f.path);
+}
+
+static void cells_close(struct cell_file &f) {
+  cells_sync(f);
+  cells_unmap(f);
+}
+
+// Linear probing from a multiplicative hash; the slot of key, or the free one it would go in
+static uint8_t *cells_slot(const struct cell_file &f, uint64_t key, bool *found) {
+  uint32_t mask = f.capacity - 1;
+  uint32_t i = (uint32_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & mask;
+  for (uint32_t n = 0; n < f.capacity; n++) {
+    uint8_t *slot = f.map + HEADER_SIZE + (size_t)i * RECORD_SIZE;
+    uint64_t have;
+    memcpy(&have, slot, 8);
+    if (have == key || !have) {
+      *found = have == key;
+      return slot;
+    }
+    i = (i + 1) & mask;
+  }
+  fprintf(stderr, "%s is full\n", f.path.c_str());  // Only a damaged file, updates grow it long before
+  exit(1);
+}
+
+static bool cells_get(const struct cell_file &f, uint64_t bits, struct cell &c) {
+  bool found;
+  uint8_t *slot = cells_slot(f, bits + 1, &found);
+  if (found)
+    cell_load(slot, c);
+  return found;
+}
+
+static void cells_grow(struct cell_file &f) {
+  std::vector<struct cell> old;
+  for (uint32_t i = 0; i < f.capacity; i++) {
+    struct cell c;
+    cell_load(f.map + HEADER_SIZE + (size_t)i * RECORD_SIZE, c);
+    if (c.key)
+      old.push_back(c);
+  }
+  // Filled in full before it replaces the old file, so a crash leaves one or the other
+  struct cell_file grown = f;
+  grown.path = f.path + ".tmp";
+  cells_create(grown, grown.path, f.capacity * 2);
+  cells_map(grown);
+  for (const struct cell &c : old) {
+    bool found;
+    cell_store(cells_slot(grown, c.key, &found), c);
+  }
+  grown.used = old.size();
+  cells_sync(grown);
+  if (rename(grown.path.c_str(), f.path.c_str()))
+    die(f.path);
+  cells_unmap(f);
+  grown.path = f.path;
+  f = grown;
+}
+
+static void cells_add(struct cell_file &f, uint64_t bits, float rssi, float snr, uint16_t gateways, int64_t time_ms) {
+  bool found;
+  uint8_t *slot = cells_slot(f, bits + 1, &found);
+  struct cell c;
+  if (found) {
+    cell_load(slot, c);
+    c.count++;
+    c.rssi_min = std::min(c.rssi_min, rssi);
+    c.rssi_max = std::max(c.rssi_max, rssi);
+    c.rssi_sum += rssi;
+    c.snr_best = std::max(c.snr_best, snr);
+    c.gateways_max = std::max(c.gateways_max, gateways);
+    c.last_ms = std::max(c.last_ms, time_ms);
+    cell_store(slot, c);
+    return;
+  }
+  c = {bits + 1, 1, rssi, rssi, rssi, snr, gateways, time_ms};
+  cell_store(slot, c);
+  f.used++;
+  if ((uint64_t)f.used * 10 > (uint64_t)f.capacity * 7)
+    cells_grow(f);
+}
+
+static void cells_open_all(const std::string &tiles, struct cell_file cells[PRECISION_COUNT]) {
+  std::filesystem::create_directories(tiles);
+  for (int p = 0; p < PRECISION_COUNT; p++)
+    cells_open(cells[p], tiles + "/geohash" + std::to_string(PRECISIONS[p]) + ".cells", PRECISIONS[p]);
+}
+
+// Only Mapper frames say where the device is now; status and GPS lost carry the last known position
+static bool mapper_port(uint8_t port) {
+  for (const struct batch_message &m : batch_messages)
+    if (m.port == port && !strncmp(m.name, "mapper", 6))
+      return true;
+  return false;
+}
+
+// How far each day got, from state.json
+static std::map<std::string, size_t> state_load(const std::string &path) {
+  std::map<std::string, size_t> state;
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f)
+    return state;
+  char day[16];
+  unsigned long long rows;
+  // {"2025-06-01": 123, ...}
+  fscanf(f, " {");
+  while (fscanf(f, " \"%15[^\"]\" : %llu ,", day, &rows) == 2)
+    state[day] = rows;
+  fclose(f);
+  return state;
+}
+
+static void state_save(const std::string &path, const std::map<std::string, size_t> &state) {
+  std::string tmp = path + ".tmp";
+  FILE *f = fopen(tmp.c_str(), "w");
+  if (!f)
+    die(tmp);
+  fputc('{', f);
+  for (auto it = state.begin(); it != state.end(); ++it)
+    fprintf(f, "%s\"%s\": %zu", it == state.begin() ? "" : ", ", it->first.c_str(), it->second);
+  fputc('}', f);
+  if (fclose(f) || rename(tmp.c_str(), path.c_str()))
+    die(path);
+}
+
+// Folds in the rows stored since the last update; returns how many made it into cells
+static size_t update(const std::string &data, const std::string &tiles) {
+  std::string state_path = tiles + "/state.json";
+  std::map<std::string, size_t> state = state_load(state_path);
+  struct cell_file cells[PRECISION_COUNT];
+  cells_open_all(tiles, cells);
+  for (int p = 0; p < PRECISION_COUNT; p++)
+    cells_recount(cells[p]);  // An update cut short may have added cells after the last save
+
+  std::vector<std::string> days;
+  std::error_code err;
+  for (const auto &entry : std::filesystem::directory_iterator(data, err))
+    if (entry.path().filename().string().size() == 10)
+      days.push_back(entry.path().filename().string());
+  std::sort(days.begin(), days.end());
+
+  size_t added = 0;
+  static const int needed[] = {COL_TIME_MS, COL_PORT, COL_LATITUDE, COL_LONGITUDE, COL_RSSI, COL_SNR,
+                               COL_HOTSPOT_COUNT};
+  for (const std::string &day : days) {
+    // Only as many rows as every column holds in full, so this can run while ingest.cpp is appending
+    std::string path = data + "/" + day;
+    size_t start = state.count(day) ? state[day] : 0;
+    size_t rows = store_rows(path, needed, sizeof(needed) / sizeof(needed[0]));
+    for (size_t from = start; from < rows; from += UPDATE_BATCH) {
+      size_t to = std::min(rows, from + UPDATE_BATCH), n = to - from;
+      std::vector<int64_t> time_ms(n);
+      std::vector<uint8_t> port(n);
+      std::vector<double> lat(n), lon(n);
+      std::vector<float> rssi(n), snr(n);
+      std::vector<uint16_t> gateways(n);
+      if (!store_read(path, COL_TIME_MS, from, to, time_ms.data()) ||
+          !store_read(path, COL_PORT, from, to, port.data()) || !store_read(path, COL_LATITUDE, from, to, lat.data()) ||
+          !store_read(path, COL_LONGITUDE, from, to, lon.data()) ||
+          !store_read(path, COL_RSSI, from, to, rssi.data()) || !store_read(path, COL_SNR, from, to, snr.data()) ||
+          !store_read(path, COL_HOTSPOT_COUNT, from, to, gateways.data()))
+        die(path);
+      for (size_t i = 0; i < n; i++) {
+        // NaN never compares true, so positions and RSSI that were not sent drop out here too
+        if (!mapper_port(port[i]) || !(lat[i] >= -90 && lat[i] <= 90 && lon[i] >= -180 && lon[i] <= 180) ||
+            isnan(rssi[i]) || (lat[i] == 0 && lon[i] == 0))
+          continue;
+        uint64_t bits = geohash_bits(lat[i], lon[i], PRECISION_MAX);
+        for (int p = 0; p < PRECISION_COUNT; p++)
+          cells_add(cells[p], bits >> 5 * (PRECISION_MAX - PRECISIONS[p]), rssi[i], isnan(snr[i]) ? -99.0f : snr[i],
+                    gateways[i], time_ms[i]);
+        added++;
+      }
+      // The cells first: a crash in between counts this batch again, rather than leave it out
+      for (int p = 0; p < PRECISION_COUNT; p++)
+        cells_sync(cells[p]);
+      state[day] = to;
+      state_save(state_path, state);
+    }
+    state[day] = std::max(rows, start);
+  }
+  for (int p = 0; p < PRECISION_COUNT; p++)
+    cells_close(cells[p]);
+  state_save(state_path, state);
+  return added;
+}
+
+// A double as Python's json prints it, rounded to one decimal first if asked
+static void json_number(std::string &out, double v, bool one_decimal) {
+  char text[64];
+  if (one_decimal) {
+    snprintf(text, sizeof(text), "%.1f", v);
+  } else {
+    *std::to_chars(text, text + sizeof(text) - 1, v).ptr = 0;
+    if (!strpbrk(text, ".en"))
+      strcat(text, ".0");
+  }
+  out += text;
+}
+
+static std::string describe(const struct cell &c, int precision) {
+  std::string out = "{\"geohash\": \"" + geohash_text(c.key - 1, precision) + "\", \"count\": " + std::to_string(c.count);
+  out += ", \"rssi_min\": ";
+  json_number(out, c.rssi_min, true);
+  out += ", \"rssi_max\": ";
+  json_number(out, c.rssi_max, true);
+  out += ", \"rssi_mean\": ";
+  json_number(out, c.rssi_sum / c.count, true);
+  out += ", \"snr_best\": ";
+  json_number(out, c.snr_best, true);
+  out += ", \"gateways_max\": " + std::to_string(c.gateways_max) + ", \"last_ms\": " + std::to_string(c.last_ms) + "}";
+  return out;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s update [--data DIR] [--tiles DIR]\n"
+          "       %s at [--tiles DIR] LAT LON\n"
+          "       %s geojson [--tiles DIR] [--precision 5|6|7|8] [--bbox SOUTH,WEST,NORTH,EAST]\n",
+          name, name, name);
+}
+
+int main(int argc, char **argv) {
+  const char *mode = argc > 1 ? argv[1] : "", *data = "uplinks", *tiles = "tiles", *bbox = NULL;
+  int precision = 7;
+  std::vector<const char *> positional;
+  for (int i = 2; i < argc; i++) {
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (!strcmp(argv[i], "--data") && value)
+      data = argv[++i];
+    else if (!strcmp(argv[i], "--tiles") && value)
+      tiles = argv[++i];
+    else if (!strcmp(argv[i], "--precision") && value)
+      precision = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--bbox") && value)
+      bbox = argv[++i];
+    else if (strncmp(argv[i], "--", 2))
+      positional.push_back(argv[i]);
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (!strcmp(mode, "update") && positional.empty()) {
+    printf("%zu uplinks added\n", update(data, tiles));
+  } else if (!strcmp(mode, "at") && positional.size() == 2) {
+    struct cell_file cells[PRECISION_COUNT];
+    cells_open_all(tiles, cells);
+    uint64_t bits = geohash_bits(atof(positional[0]), atof(positional[1]), PRECISION_MAX);
+    for (int p = 0; p < PRECISION_COUNT; p++) {
+      uint64_t cell_bits = bits >> 5 * (PRECISION_MAX - PRECISIONS[p]);
+      struct cell c;
+      if (cells_get(cells[p], cell_bits, c))
+        puts(describe(c, PRECISIONS[p]).c_str());
+      else
+        printf("{\"geohash\": \"%s\", \"count\": 0}\n", geohash_text(cell_bits, PRECISIONS[p]).c_str());
+    }
+  } else if (!strcmp(mode, "geojson") && positional.empty() &&
+             std::count(PRECISIONS, PRECISIONS + PRECISION_COUNT, precision)) {
+    double south = -90, west = -180, north = 90, east = 180;
+    if (bbox && sscanf(bbox, "%lf,%lf,%lf,%lf", &south, &west, &north, &east) != 4) {
+      usage(argv[0]);
+      return 2;
+    }
+    struct cell_file cells[PRECISION_COUNT];
+    cells_open_all(tiles, cells);
+    const struct cell_file &f = cells[std::find(PRECISIONS, PRECISIONS + PRECISION_COUNT, precision) - PRECISIONS];
+    std::string out = "{\"type\": \"FeatureCollection\", \"features\": [";
+    bool first = true;
+    for (uint32_t i = 0; i < f.capacity; i++) {
+      struct cell c;
+      cell_load(f.map + HEADER_SIZE + (size_t)i * RECORD_SIZE, c);
+      double box[4];
+      if (!c.key)
+        continue;
+      geohash_box(c.key - 1, precision, box);
+      if (box[2] < south || box[0] > north || box[3] < west || box[1] > east)
+        continue;
+      out += first ? "" : ", ";
+      out += "{\"type\": \"Feature\", \"properties\": " + describe(c, precision) +
+             ", \"geometry\": {\"type\": \"Polygon\", \"coordinates\": [[";
+      // West-south, east-south, east-north, west-north, and closed
+      static const int corners[5][2] = {{1, 0}, {3, 0}, {3, 2}, {1, 2}, {1, 0}};
+      for (int k = 0; k < 5; k++) {
+        out += k ? ", [" : "[";
+        json_number(out, box[corners[k][0]], false);
+        out += ", ";
+        json_number(out, box[corners[k][1]], false);
+        out += "]";
+      }
+      out += "]]}}";
+      first = false;
+    }
+    out += "]}";
+    fputs(out.c_str(), stdout);
+  } else {
+    usage(argv[0]);
+    return 2;
+  }
+  return 0;
+}
@@ -1,67 +1,412 @@
-// Decoder for MaxPlastix mappers
+// Generated by console-decoders/codec_gen.py from payload_schema.json -- do not edit
 //
-// 11 Byte payload: 
-// 3 Lat, 3 Long, 2 Altitude (m), 1 Sats.
-// Accuracy is a dummy value required by some Integrations.
+// Decoder for MaxPlastix mappers, paste into the Console custom function.
+//
+// Port 2: 3 Lat, 3 Long, 2 Altitude (m), 1 Sats.
+// Port 3: bit-packed v2 Mapper payload with optional accuracy, speed and heading.
+// Port 5: System status.  Port 6: Lost GPS.
+// Port 7: Telemetry, which may also follow any of the frames above in the same uplink.
+// Accuracy is a dummy value required by some Integrations when the device does not send one.
 //
-function Decoder(bytes, port) {
-  var decoded = {};
 
-  // All formats carry a lat & lon reading:
-  var latitude = ((bytes[0] << 16) >>> 0) + ((bytes[1] << 8) >>> 0) + bytes[2];
-  latitude = (latitude / 16777215.0 * 180) - 90;
+var MESSAGES = [
+  {
+    "name": "mapper",
+    "direction": "uplink",
+    "port": 2,
+    "tail": "telemetry",
+    "comment": "Mapper! (Cargo and Heatmap too): 3 Lat, 3 Long, 2 Altitude (m), 1 Sats",
+    "fields": [
+      {
+        "name": "latitude",
+        "bits": 24,
+        "div": 16777215.0,
+        "mul": 180,
+        "add": -90
+      },
+      {
+        "name": "longitude",
+        "bits": 24,
+        "div": 16777215.0,
+        "mul": 360,
+        "add": -180
+      },
+      {
+        "name": "altitude",
+        "bits": 16,
+        "signed": true
+      },
+      {
+        "name": "sats",
+        "bits": 8
+      },
+      {
+        "name": "accuracy",
+        "const": 2.5,
+        "comment": "Bogus Accuracy required by Cargo/Mapper integration"
+      }
+    ]
+  },
+  {
+    "name": "mapper_v2",
+    "direction": "uplink",
+    "port": 3,
+    "tail": "telemetry",
+    "comment": "Mapper payload v2: 1e-6 degree position, optional accuracy, speed and heading",
+    "fields": [
+      {
+        "name": "version",
+        "bits": 3,
+        "match": 2
+      },
+      {
+        "name": "flags",
+        "bits": 2,
+        "hidden": true
+      },
+      {
+        "name": "latitude",
+        "bits": 28,
+        "div": 1000000,
+        "add": -90,
+        "round": 6
+      },
+      {
+        "name": "longitude",
+        "bits": 29,
+        "div": 1000000,
+        "add": -180,
+        "round": 6
+      },
+      {
+        "name": "altitude",
+        "bits": 16,
+        "signed": true
+      },
+      {
+        "name": "sats",
+        "bits": 5
+      },
+      {
+        "name": "accuracy",
+        "bits": 7,
+        "div": 2,
+        "when": {
+          "field": "flags",
+          "mask": 1
+        },
+        "default": 2.5,
+        "comment": "Meters, in 0.5m steps"
+      },
+      {
+        "name": "speed",
+        "bits": 10,
+        "mul": 0.36,
+        "round": 1,
+        "when": {
+          "field": "flags",
+          "mask": 2
+        },
+        "comment": "km/h, sent as 0.1 m/s"
+      },
+      {
+        "name": "heading",
+        "bits": 9,
+        "when": {
+          "field": "flags",
+          "mask": 2
+        }
+      }
+    ]
+  },
+  {
+    "name": "status",
+    "direction": "uplink",
+    "port": 5,
+    "tail": "telemetry",
+    "comment": "System status",
+    "fields": [
+      {
+        "name": "last_latitude",
+        "bits": 24,
+        "div": 16777215.0,
+        "mul": 180,
+        "add": -90
+      },
+      {
+        "name": "last_longitude",
+        "bits": 24,
+        "div": 16777215.0,
+        "mul": 360,
+        "add": -180
+      },
+      {
+        "name": "battery",
+        "bits": 8,
+        "div": 100,
+        "add": 2,
+        "round": 2
+      },
+      {
+        "name": "status",
+        "bits": 8,
+        "enum": {
+          "1": "BOOT",
+          "2": "USB ON",
+          "3": "USB OFF"
+        }
+      },
+      {
+        "name": "value",
+        "bits": 8
+      }
+    ]
+  },
+  {
+    "name": "gps_lost",
+    "direction": "uplink",
+    "port": 6,
+    "tail": "telemetry",
+    "comment": "Lost GPS",
+    "fields": [
+      {
+        "name": "last_latitude",
+        "bits": 24,
+        "div": 16777215.0,
+        "mul": 180,
+        "add": -90
+      },
+      {
+        "name": "last_longitude",
+        "bits": 24,
+        "div": 16777215.0,
+        "mul": 360,
+        "add": -180
+      },
+      {
+        "name": "battery",
+        "bits": 8,
+        "div": 100,
+        "add": 2,
+        "round": 2
+      },
+      {
+        "name": "sats",
+        "bits": 8
+      },
+      {
+        "name": "minutes",
+        "bits": 16
+      }
+    ]
+  },
+  {
+    "name": "telemetry",
+    "direction": "uplink",
+    "port": 7,
+    "comment": "Device telemetry, alone or appended to a mapper, status or GPS lost frame",
+    "fields": [
+      {
+        "name": "battery",
+        "bits": 8,
+        "div": 100,
+        "add": 2,
+        "round": 2
+      },
+      {
+        "name": "uptime",
+        "bits": 16,
+        "comment": "Minutes since reset, stops at 65535"
+      },
+      {
+        "name": "airtime",
+        "bits": 14,
+        "comment": "Seconds of transmit time since reset, stops at 16383"
+      },
+      {
+        "name": "frames",
+        "bits": 15,
+        "comment": "Uplinks since reset, stops at 32767"
+      },
+      {
+        "name": "ack_ratio",
+        "bits": 7,
+        "enum": {
+          "127": "none"
+        },
+        "comment": "Percent of confirmed uplinks acknowledged, 127 when none were asked for"
+      },
+      {
+        "name": "reset_reason",
+        "bits": 4,
+        "enum": {
+          "0": "UNKNOWN",
+          "1": "POWERON",
+          "2": "EXT",
+          "3": "SW",
+          "4": "PANIC",
+          "5": "INT_WDT",
+          "6": "TASK_WDT",
+          "7": "WDT",
+          "8": "DEEPSLEEP",
+          "9": "BROWNOUT",
+          "10": "SDIO"
+        }
+      }
+    ]
+  },
+  {
+    "name": "config",
+    "direction": "downlink",
+    "port": 1,
+    "comment": "Remote configuration. Zero leaves a setting unchanged, time 0xFFFF reverts to the build default.",
+    "fields": [
+      {
+        "name": "distance",
+        "bits": 16,
+        "comment": "Meters"
+      },
+      {
+        "name": "time_interval",
+        "bits": 16,
+        "comment": "Seconds"
+      },
+      {
+        "name": "cutoff_volts",
+        "bits": 8,
+        "div": 100,
+        "add": 2,
+        "round": 2
+      }
+    ]
+  }
+];
 
-  var longitude = ((bytes[3] << 16) >>> 0) + ((bytes[4] << 8) >>> 0) + bytes[5];
-  longitude = (longitude / 16777215.0 * 360) - 180;
+function readBits(bytes, state, count) {
+  var value = 0;
+  for (var i = 0; i < count; i++, state.pos++)
+    value = value * 2 + ((bytes[state.pos >> 3] >> (7 - (state.pos & 7))) & 1);
+  return value;
+}
 
-  switch (port) {
-    case 2: // Mapper! (Cargo and Heatmap too)
-      decoded.latitude = latitude;
-      decoded.longitude = longitude;
+function present(field, raw) {
+  return !field.when || (raw[field.when.field] & field.when.mask) != 0;
+}
 
-      var altValue = ((bytes[6] << 8) >>> 0) + bytes[7];
-      var sign = bytes[6] & (1 << 7);
-      if (sign)
-        decoded.altitude = 0xFFFF0000 | altValue;
-      else
-        decoded.altitude = altValue;
+function findMessage(port, direction) {
+  for (var i = 0; i < MESSAGES.length; i++)
+    if (MESSAGES[i].port == port && MESSAGES[i].direction == direction)
+      return MESSAGES[i];
+  return null;
+}
 
-      decoded.sats = bytes[8];
-      decoded.accuracy = 2.5; // Bogus Accuracy required by Cargo/Mapper integration
-      break;
-    case 5: // System status
-      decoded.last_latitude = latitude;
-      decoded.last_longitude = longitude;
-      decoded.battery = parseFloat((bytes[6] / 100 + 2).toFixed(2));
-      decoded.value = bytes[8];
-      decoded.status = bytes[7];
-      switch (bytes[7]) {
-        case 1:
-          decoded.status = "BOOT";
-          break;
-        case 2:
-          decoded.status = "USB ON";
-          break
-        case 3:
-          decoded.status = "USB OFF";
-          break;
-      }
-      break;
-    case 6: // Lost GPS
-      decoded.last_latitude = latitude;
-      decoded.last_longitude = longitude;
-      decoded.battery = parseFloat((bytes[6] / 100 + 2).toFixed(2));
-      decoded.sats = bytes[7];
-      decoded.minutes = ((bytes[8] << 8) >>> 0) + bytes[9];
-      break;
+function findMessageByName(name) {
+  for (var i = 0; i < MESSAGES.length; i++)
+    if (MESSAGES[i].name == name)
+      return MESSAGES[i];
+  return null;
+}
+
+function Decoder(bytes, port) {
+  var message = findMessage(port, "uplink");
+  if (!message)
+    return {};
+  return decodeMessage(message, bytes);
+}
+
+function decodeMessage(message, bytes) {
+  var decoded = {};
+
+  // Wire-level integers first, with length and version checks
+  var raw = {};
+  var state = { pos: 0 };
+  for (var i = 0; i < message.fields.length; i++) {
+    var field = message.fields[i];
+    if (field.bits === undefined)
+      continue;
+    if (!present(field, raw)) {
+      raw[field.name] = 0;
+      continue;
+    }
+    if (state.pos + field.bits > bytes.length * 8)
+      return decoded;
+    var value = readBits(bytes, state, field.bits);
+    if (field.signed && value >= Math.pow(2, field.bits - 1))
+      value -= Math.pow(2, field.bits);
+    if (field.match !== undefined) {
+      if (value != field.match)
+        return decoded;
+      continue;
+    }
+    raw[field.name] = value;
+  }
+
+  // Then engineering units
+  for (var j = 0; j < message.fields.length; j++) {
+    var f = message.fields[j];
+    if (f.const !== undefined) {
+      decoded[f.name] = f.const;
+    } else if (f.hidden || f.match !== undefined) {
+      continue;
+    } else if (present(f, raw)) {
+      var v = raw[f.name];
+      if (f.div !== undefined) v = v / f.div;
+      if (f.mul !== undefined) v = v * f.mul;
+      if (f.add !== undefined) v = v + f.add;
+      if (f.round !== undefined) v = parseFloat(v.toFixed(f.round));
+      if (f.enum && f.enum[v] !== undefined) v = f.enum[v];
+      decoded[f.name] = v;
+    } else if (f.default !== undefined) {
+      decoded[f.name] = f.default;
+    }
   }
 
+  // Another message may ride along after the frame, its fields join the result
+  if (message.tail) {
+    var tail = decodeMessage(findMessageByName(message.tail), bytes.slice((state.pos + 7) >> 3));
+    for (var key in tail)
+      decoded[key] = tail[key];
+  }
   return decoded;
 }
 
-// Wrapper for ChirpStack V4:
+// Downlink encoder, engineering values in, bytes out
+function Encoder(values, port) {
+  var message = findMessage(port, "downlink");
+  var bytes = [];
+  var bitCount = 0;
+  if (!message)
+    return bytes;
+  for (var i = 0; i < message.fields.length; i++) {
+    var field = message.fields[i];
+    if (field.bits === undefined)
+      continue;
+    var v = values[field.name] || 0;
+    if (field.add !== undefined) v = v - field.add;
+    if (field.mul !== undefined) v = v / field.mul;
+    if (field.div !== undefined) v = v * field.div;
+    v = v < 0 ? Math.ceil(v) : Math.floor(v);
+    for (var b = field.bits - 1; b >= 0; b--, bitCount++) {
+      if ((bitCount & 7) == 0)
+        bytes.push(0);
+      if (Math.floor(v / Math.pow(2, b)) % 2)
+        bytes[bytes.length - 1] |= 0x80 >> (bitCount & 7);
+    }
+  }
+  return bytes;
+}
+
+// Wrappers for ChirpStack V4:
 function decodeUplink(input) {
-  return { 
-      data: Decoder(input.bytes, input.fPort)
-  };   
-}
\ No newline at end of file
+  return {
+    data: Decoder(input.bytes, input.fPort)
+  };
+}
+
+function encodeDownlink(input) {
+  var port = input.fPort || 1;
+  return {
+    fPort: port,
+    bytes: Encoder(input.data, port)
+  };
+}
@@ -0,0 +1,19 @@
+import base64
+import argparse
+import json
+
+import payload_codec
+
+# Decode uplink payloads from a log or the Console, with the same codec as unified_decoder.js.
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Decode an uplink payload from a Helium/TTN mapper.')
+    parser.add_argument('--port', '-p', type=int, default=2, help='FPort of the uplink')
+    parser.add_argument('payload', help='Payload as hex (spaces allowed) or Base64')
+    args = parser.parse_args()
+
+    try:
+        payload = bytes.fromhex(args.payload)
+    except ValueError:
+        payload = base64.b64decode(args.payload)
+    print(json.dumps(payload_codec.decode(args.port, payload)))
@@ -0,0 +1,93 @@
+// Layout of the uplink store, which ingest.cpp writes and tiles.cpp reads.
+//
+// One folder per UTC day (YYYY-MM-DD), and in it one append-only file per
+// column of fixed size values in native byte order.  Text columns hold
+// uint32 indexes into <column>.dict, one entry a line in order of first use.
+// Missing numbers are NaN.  A reader takes as many rows as every column it
+// needs holds in full, so it can run while ingest.cpp is appending.  Only
+// the writer cuts what a crash left torn, when it opens the day again.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <string>
+
+enum store_type { STORE_I64, STORE_U32, STORE_U16, STORE_U8, STORE_F64, STORE_F32 };
+
+struct store_column {
+  const char *name;
+  enum store_type type;
+  bool text;  // STORE_U32 indexes into the dictionary
+};
+
+enum store_column_id {
+  COL_TIME_MS,
+  COL_DEV,
+  COL_NAME,
+  COL_PORT,
+  COL_LATITUDE,
+  COL_LONGITUDE,
+  COL_ALTITUDE,
+  COL_SATS,
+  COL_SPEED,
+  COL_ACCURACY,
+  COL_BATTERY,
+  COL_STATUS,
+  COL_HOTSPOT,
+  COL_RSSI,
+  COL_SNR,
+  COL_HOTSPOT_DIST,
+  COL_HOTSPOT_COUNT,
+  STORE_COLUMNS
+};
+
+static const struct store_column store_columns[STORE_COLUMNS] = {
+    {"time_ms", STORE_I64, false},  {"dev", STORE_U32, true},        {"name", STORE_U32, true},
+    {"port", STORE_U8, false},      {"latitude", STORE_F64, false},  {"longitude", STORE_F64, false},
+    {"altitude", STORE_F32, false}, {"sats", STORE_F32, false},      {"speed", STORE_F32, false},
+    {"accuracy", STORE_F32, false}, {"battery", STORE_F32, false},   {"status", STORE_U32, true},
+    {"hotspot", STORE_U32, true},   {"rssi", STORE_F32, false},      {"snr", STORE_F32, false},
+    {"hotspot_dist", STORE_F32, false}, {"hotspot_count", STORE_U16, false},
+};
+
+static inline size_t store_size(enum store_type type) {
+  static const uint8_t sizes[] = {8, 4, 2, 1, 8, 4};
+  return sizes[type];
+}
+
+static inline std::string store_path(const std::string &day, int column) {
+  return day + "/" + store_columns[column].name;
+}
+
+// Bytes in a file, 0 if there is none
+static inline size_t store_file_size(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) ? 0 : st.st_size;
+}
+
+// Rows that all of these columns hold in full
+static inline size_t store_rows(const std::string &day, const int *columns, size_t n) {
+  size_t rows = SIZE_MAX;
+  for (size_t i = 0; i < n; i++) {
+    size_t have = store_file_size(store_path(day, columns[i])) / store_size(store_columns[columns[i]].type);
+    if (have < rows)
+      rows = have;
+  }
+  return n ? rows : 0;
+}
+
+// Rows [start, end) of a column into out, false if the file is short
+static inline bool store_read(const std::string &day, int column, size_t start, size_t end, void *out) {
+  size_t size = store_size(store_columns[column].type);
+  if (end <= start)
+    return true;
+  FILE *f = fopen(store_path(day, column).c_str(), "rb");
+  if (!f)
+    return false;
+  bool ok = !fseek(f, start * size, SEEK_SET) && fread(out, size, end - start, f) == end - start;
+  fclose(f);
+  return ok;
+}
@@ -0,0 +1,161 @@
+/**
+ * Battery module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "battery.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "configuration.h"
+
+#define BATTERY_RESISTANCE_MOHM 150  // Cell and holder, for the voltage drop under load
+#define BATTERY_VOLTAGE_TAU_S 600     // How fast the voltage pulls the state of charge without a counter
+#define BATTERY_COUNTED_TAU_S 3600    // and with one, where it corrects drift and a wrong capacity
+#define BATTERY_DRAIN_SPAN_S 600      // Shortest stretch of time a drain is measured over
+#define BATTERY_DRAIN_TAU_S 3600      // Averaging of the drain
+#define BATTERY_STRETCH_TAU_S 1800    // How fast the stretch follows what the forecast asks for
+#define BATTERY_MARGIN 1.05f          // Aim to outlast the shift by this much, for forecast error
+
+// Rest voltage to state of charge of an 18650 cell, in percent
+static const struct {
+  uint16_t mv;
+  uint8_t percent;
+} battery_curve[] = {
+    {3000, 0},  {3300, 3},  {3450, 8},  {3550, 15}, {3600, 22}, {3650, 30}, {3700, 40}, {3750, 50},
+    {3800, 58}, {3850, 65}, {3900, 72}, {3950, 78}, {4000, 84}, {4050, 89}, {4100, 94}, {4200, 100},
+};
+#define BATTERY_CURVE_POINTS (sizeof(battery_curve) / sizeof(battery_curve[0]))
+
+struct battery_state {
+  float soc;         // 0..1, negative until the first reading
+  float mah;         // Coulomb counter at the last reading
+  float reserve;     // State of charge at the shutdown voltage
+  float drain;       // State of charge per hour while discharging, 0 until measured
+  float stretch;     // Of the uplink interval and distance, 1 or more
+  float anchor_soc;  // Where the drain is measured from
+  uint32_t anchor_s;
+  uint32_t last_s;
+  uint32_t shift_start_s;  // The reset that started the shift
+};
+
+RTC_DATA_ATTR static struct battery_state battery;
+
+static float battery_soc_at(int32_t mv) {
+  if (mv <= battery_curve[0].mv)
+    return 0.0f;
+  for (unsigned i = 1; i < BATTERY_CURVE_POINTS; i++)
+    if (mv < battery_curve[i].mv) {
+      float f = (float)(mv - battery_curve[i - 1].mv) / (battery_curve[i].mv - battery_curve[i - 1].mv);
+      return (battery_curve[i - 1].percent + f * (battery_curve[i].percent - battery_curve[i - 1].percent)) / 100.0f;
+    }
+  return 1.0f;
+}
+
+void battery_begin(bool reset, uint32_t now_s) {
+  if (reset) {
+    battery.soc = -1.0f;
+    battery.drain = 0.0f;
+    battery.stretch = 1.0f;
+    battery.shift_start_s = now_s;
+  }
+}
+
+void battery_update(const struct battery_reading *r, uint32_t shift_s) {
+  bool counter = !isnan(r->mah);
+  bool charging = r->ma != BATTERY_MA_UNKNOWN && r->ma > 0;
+
+  // What the voltage says: at rest the cell would read higher by the drop across it, or lower while charging
+  int32_t drop_mv = r->ma != BATTERY_MA_UNKNOWN ? (int32_t)r->ma * BATTERY_RESISTANCE_MOHM / 1000 : 0;
+  float measured = r->gauge >= 0 ? r->gauge / 100.0f : battery_soc_at(r->mv - drop_mv);
+  // Shutdown goes by the voltage under load, so that much more is left behind
+  battery.reserve = battery_soc_at(r->cutoff_mv - (charging ? 0 : drop_mv));
+
+  if (battery.soc < 0.0f) {
+    battery.soc = measured;
+    battery.mah = r->mah;
+    battery.anchor_soc = measured;
+    battery.anchor_s = r->now_s;
+    battery.last_s = r->now_s;
+    return;
+  }
+
+  uint32_t dt = r->now_s - battery.last_s;
+  battery.last_s = r->now_s;
+  float weight;
+  if (counter) {
+    if (!isnan(battery.mah))
+      battery.soc += (r->mah - battery.mah) / BATTERY_CAPACITY_MAH;
+    battery.mah = r->mah;
+    // Towards the end of charging the voltage is held and says little, the counter carries on alone
+    weight = charging ? 0.0f : (float)dt / BATTERY_COUNTED_TAU_S;
+  } else {
+    weight = (float)dt / BATTERY_VOLTAGE_TAU_S;
+  }
+  battery.soc += (measured - battery.soc) * (weight < 1.0f ? weight : 1.0f);
+  if (battery.soc < 0.0f)
+    battery.soc = 0.0f;
+  if (battery.soc > 1.0f)
+    battery.soc = 1.0f;
+
+  // The drain, over at least BATTERY_DRAIN_SPAN_S of discharging.  A span across deep sleep counts in full.
+  uint32_t span = r->now_s - battery.anchor_s;
+  if (charging || battery.soc > battery.anchor_soc) {
+    battery.anchor_soc = battery.soc;
+    battery.anchor_s = r->now_s;
+  } else if (span >= BATTERY_DRAIN_SPAN_S) {
+    float rate = (battery.anchor_soc - battery.soc) * 3600.0f / span;
+    float w = (float)span / BATTERY_DRAIN_TAU_S;
+    battery.drain = battery.drain > 0.0f ? battery.drain + (rate - battery.drain) * (w < 1.0f ? w : 1.0f) : rate;
+    battery.anchor_soc = battery.soc;
+    battery.anchor_s = r->now_s;
+  }
+
+  // Ask for as much more time between uplinks as the forecast is short of the shift
+  float target = 1.0f;
+  if (shift_s && !charging) {
+    int32_t left = battery.shift_start_s + shift_s - r->now_s;
+    uint32_t runtime = battery_runtime_s();
+    if (runtime == BATTERY_RUNTIME_UNKNOWN)
+      target = battery.stretch;  // Nothing to go on yet
+    else if (left > 0)
+      target = battery.stretch * left * BATTERY_MARGIN / (runtime ? runtime : 1);
+  }
+  if (target < 1.0f)
+    target = 1.0f;
+  if (target > BATTERY_STRETCH_MAX)
+    target = BATTERY_STRETCH_MAX;
+  weight = (float)dt / BATTERY_STRETCH_TAU_S;
+  battery.stretch += (target - battery.stretch) * (weight < 1.0f ? weight : 1.0f);
+}
+
+uint8_t battery_soc_percent(void) {
+  return battery.soc < 0.0f ? 0 : battery.soc * 100.0f + 0.5f;
+}
+
+uint32_t battery_runtime_s(void) {
+  if (battery.soc < 0.0f || battery.drain < 0.001f)  // Under 0.1% an hour is not measured, or charging
+    return BATTERY_RUNTIME_UNKNOWN;
+  if (battery.soc <= battery.reserve)
+    return 0;
+  return (battery.soc - battery.reserve) * 3600.0f / battery.drain;
+}
+
+float battery_stretch(void) {
+  return battery.stretch;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+/**
+ * Battery state of charge, runtime forecast, and cadence stretch.
+ *
+ * Each reading moves the state of charge by what the coulomb counter saw go
+ * in or out, where the PMU has one (AXP192), and pulls it towards what the
+ * voltage says: the cell voltage, corrected for the drop across its internal
+ * resistance at the measured current, looked up on a Li-ion rest curve, or
+ * the fuel gauge where the PMU has that instead (AXP2101).  With a counter
+ * the voltage only corrects drift slowly; without one it leads.
+ *
+ * The drain is how fast that falls, averaged over the last hour or so, and
+ * the runtime forecast is how long what is left above the shutdown voltage
+ * lasts at that drain.
+ *
+ * When the forecast ends before the end of the shift, battery_stretch()
+ * grows to the factor the uplink interval and distance are multiplied by, a
+ * little on each reading so the cadence changes smoothly, and shrinks back
+ * to 1 once there is charge to spare.  Charging counts as charge to spare.
+ *
+ * The shift is shift_s long from the reset, battery_begin(true, ...), and 0
+ * has none.  The state is in RTC memory, so it carries on through deep
+ * sleep.  Times are seconds of the RTC clock.
+ */
+
+#include <stdint.h>
+
+#define BATTERY_MA_UNKNOWN INT16_MIN
+#define BATTERY_RUNTIME_UNKNOWN UINT32_MAX
+
+struct battery_reading {
+  uint32_t now_s;
+  uint16_t mv;
+  int16_t ma;          // Into the cell, negative when discharging, or BATTERY_MA_UNKNOWN
+  float mah;           // Coulomb counter, net charge in since it started, NAN without one
+  int8_t gauge;        // Fuel gauge percent, -1 without one
+  uint16_t cutoff_mv;  // Where the Mapper shuts down
+};
+
+void battery_begin(bool reset, uint32_t now_s);
+void battery_update(const struct battery_reading *reading, uint32_t shift_s);
+uint8_t battery_soc_percent(void);
+uint32_t battery_runtime_s(void);
+float battery_stretch(void);
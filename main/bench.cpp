@@ -0,0 +1,208 @@
+/**
+ * Benchmark module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#if ENABLE_PROFILER
+
+#include "font.h"
+#include "geo.h"
+#include "payload.h"
+#include "payload_codec.h"
+#include "screen_log.h"
+#include "text.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+#include "screen.h"
+#define BENCH_PRINTF(...) Serial.printf(__VA_ARGS__)
+#define BENCH_HEAP_USED() (ESP.getHeapSize() - ESP.getFreeHeap())
+#define BENCH_CYCLES_PER_US() ESP.getCpuFreqMHz()
+#define BENCH_BUDGET(device_ns, host_ns) (device_ns)
+#else
+#include <malloc.h>
+#include <stdio.h>
+#define BENCH_PRINTF(...) printf(__VA_ARGS__)
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+#define BENCH_HEAP_USED() mallinfo2().uordblks
+#else
+#define BENCH_HEAP_USED() 0
+#endif
+#define BENCH_CYCLES_PER_US() 1000
+#define BENCH_BUDGET(device_ns, host_ns) (host_ns)
+#endif
+
+#define BENCH_INPUTS 64  // Distinct inputs, cycled through
+#define BENCH_WIDTH 128  // The OLED, for the screen kernels
+#define BENCH_HEIGHT 64
+
+struct bench_input {
+  double lat;
+  double lon;
+  uint16_t batt_mv;
+  char line[SCREEN_LOG_LINE_LEN];
+};
+
+static struct bench_input inputs[BENCH_INPUTS];
+static uint8_t frame[BENCH_WIDTH * BENCH_HEIGHT / 8];
+static volatile uint32_t bench_sink;  // Keeps the optimizer from dropping the work
+
+/** Fixed-seed LCG so every run sees the same inputs */
+static uint32_t bench_rand(uint32_t *state) {
+  *state = *state * 1664525 + 1013904223;
+  return *state >> 8;
+}
+
+static void bench_fill_inputs(void) {
+  uint32_t seed = 0x4D415050;  // "MAPP"
+  for (int i = 0; i < BENCH_INPUTS; i++) {
+    inputs[i].lat = (bench_rand(&seed) % 1800000) / 10000.0 - 90.0;
+    inputs[i].lon = (bench_rand(&seed) % 3600000) / 10000.0 - 180.0;
+    inputs[i].batt_mv = 3000 + bench_rand(&seed) % 1200;
+    // What mapper_uplink() logs for a send
+    snprintf(inputs[i].line, sizeof(inputs[i].line), "\n%lu %c %4lus %4lum ", (unsigned long)bench_rand(&seed) % 5000,
+             "DT>"[i % 3], (unsigned long)bench_rand(&seed) % 300, (unsigned long)bench_rand(&seed) % 1000);
+  }
+}
+
+/** build_mapper_packet() for payload v1 */
+static void kernel_pack_mapper(const struct bench_input *in) {
+  uint8_t buf[CODEC_MAPPER_MAX_LEN];
+  bench_sink += pack_mapper(buf, in->lat, in->lon, 400, 9);
+}
+
+/** build_mapper_packet() for payload v2 */
+static void kernel_pack_mapper_v2(const struct bench_input *in) {
+  uint8_t buf[PAYLOAD_V2_MAX_LEN];
+  struct mapper_fix fix = {(int32_t)(in->lat * 1e7), (int32_t)(in->lon * 1e7), 400, 9, 0x03, 25, 139, 271};
+  bench_sink += pack_mapper_v2(buf, &fix);
+}
+
+static void kernel_pack_battery(const struct bench_input *in) {
+  bench_sink += pack_battery(in->batt_mv);
+}
+
+/** The two distance checks mapper_uplink() does per pass: last send, and deadzone */
+static void kernel_distance(const struct bench_input *in) {
+  double moved = geo_distance_m(in->lat, in->lon, in->lat + 0.001, in->lon + 0.001);
+  double deadzone = geo_distance_m(in->lat, in->lon, DEADZONE_LAT, DEADZONE_LON);
+  bench_sink += (moved > MIN_DIST) + (deadzone <= DEADZONE_RADIUS_M);
+}
+
+/** downlink_process() splitting a Downlink of every command and checking the values */
+static void kernel_decode_downlink(const struct bench_input *in) {
+  uint8_t buf[32];
+  size_t len = 0;
+  for (size_t c = 0; c < CODEC_COMMANDS; c++) {
+    const struct codec_command *command = &codec_commands[c];
+    uint32_t value = command->min + in->batt_mv % ((uint32_t)(command->max - command->min) + 1);
+    buf[len++] = command->id;
+    for (int b = command->size - 1; b >= 0; b--)
+      buf[len++] = value >> (8 * b);
+  }
+  for (size_t pos = 0; pos < len;) {
+    uint8_t id;
+    int32_t value;
+    size_t used = codec_decode_command(buf + pos, len - pos, &id, &value);
+    if (!used)
+      break;
+    bench_sink += codec_command_valid(id, value);
+    pos += used;
+  }
+}
+
+/** screen_print() of a line to the log */
+static void kernel_log_write(const struct bench_input *in) {
+  bench_sink += screen_buffer_write(in->line);
+}
+
+static void bench_log_line(uint8_t row, const char *text, void *) {
+  text_draw(frame, 0, 23 + row * 10, TEXT_LEFT, text);
+}
+
+/** screen_buffer_print(), the log lines drawn from the text cache, after a line was added */
+static void kernel_log_lines(const struct bench_input *in) {
+  screen_buffer_write(in->line);
+  screen_log_lines(bench_log_line, NULL);
+  bench_sink += frame[BENCH_WIDTH * 4];
+}
+
+static void bench_rle_run(bool white, uint32_t length, void *) {
+  bench_sink += white + length;
+}
+
+/** screen_serial_dump_compressed() without the Serial output */
+static void kernel_rle(const struct bench_input *in) {
+  frame[in->batt_mv % sizeof(frame)] ^= 0x55;
+  screen_rle(frame, BENCH_WIDTH, BENCH_HEIGHT, bench_rle_run, NULL);
+}
+
+struct bench_kernel {
+  const char *name;
+  void (*func)(const struct bench_input *in);
+  uint16_t rounds;     // Passes over the inputs
+  uint32_t budget_ns;  // Per call, on the 240MHz ESP32, or a shared CI runner in the host build
+};
+
+static const struct bench_kernel kernels[] = {
+    {"pack_mapper", kernel_pack_mapper, 500, BENCH_BUDGET(4000, 500)},
+    {"pack_mapper_v2", kernel_pack_mapper_v2, 500, BENCH_BUDGET(8000, 1000)},
+    {"pack_battery", kernel_pack_battery, 500, BENCH_BUDGET(200, 50)},
+    {"distance", kernel_distance, 500, BENCH_BUDGET(60000, 2000)},
+    {"decode_downlink", kernel_decode_downlink, 500, BENCH_BUDGET(20000, 3000)},
+    {"log_write", kernel_log_write, 500, BENCH_BUDGET(8000, 1500)},
+    {"log_lines", kernel_log_lines, 100, BENCH_BUDGET(400000, 60000)},
+    {"rle", kernel_rle, 10, BENCH_BUDGET(1000000, 100000)},
+};
+#define BENCH_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+bool bench_run(void) {
+  bool pass = true;
+
+  bench_fill_inputs();
+  text_begin(Custom_Font, BENCH_WIDTH, BENCH_HEIGHT);
+  BENCH_PRINTF("\n--- BENCH BEGIN ---\n");
+  for (unsigned k = 0; k < BENCH_KERNELS; k++) {
+    const struct bench_kernel *kernel = &kernels[k];
+    size_t heap_before = BENCH_HEAP_USED();
+    uint32_t start = profile_cycles();
+    for (int r = 0; r < kernel->rounds; r++) {
+      for (int i = 0; i < BENCH_INPUTS; i++) {
+        kernel->func(&inputs[i]);
+      }
+    }
+    uint32_t cycles = profile_cycles() - start;
+    int32_t heap_delta = (int32_t)(BENCH_HEAP_USED() - heap_before);
+
+    uint32_t ns_per_op = (uint64_t)cycles * 1000 / BENCH_CYCLES_PER_US() / (kernel->rounds * BENCH_INPUTS);
+    bool ok = ns_per_op <= kernel->budget_ns && heap_delta == 0;
+    pass = pass && ok;
+    BENCH_PRINTF("%-15s %6lu ns/op  budget %6lu  heap %+ld  %s\n", kernel->name, (unsigned long)ns_per_op,
+                 (unsigned long)kernel->budget_ns, (long)heap_delta, ok ? "OK" : "SLOW");
+  }
+#ifdef ARDUINO
+  // The text cache against the OLED library; the host build has test/screen_draw.cpp run it on a stand-in
+  pass = screen_bench() && pass;
+#endif
+  BENCH_PRINTF("--- BENCH %s ---\n", pass ? "PASS" : "FAIL");
+  return pass;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+/**
+ * Micro-benchmarks for the pure-compute kernels of the uplink path and the
+ * screen: payload packing, distance, Downlink decoding, the log and its dump.
+ *
+ * Type 'b' on the debug Serial port to run them on the device, where the log
+ * is full of made-up lines afterwards.  test/Makefile runs the same kernels in
+ * the host build, against budgets for a CI runner, and fails the build on a
+ * "BENCH FAIL".  Inputs come from a fixed-seed generator so runs are
+ * comparable, and each kernel is checked against a ns/op budget and for heap
+ * it did not give back.
+ *
+ * Built together with the profiler (ENABLE_PROFILER).
+ */
+
+#include "profiler.h"
+
+#if ENABLE_PROFILER
+bool bench_run(void);
+#else
+static inline bool bench_run(void) {
+  return true;
+}
+#endif
@@ -0,0 +1,38 @@
+/**
+ * Boot timeline module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "boot.h"
+
+#include <Arduino.h>
+
+static portMUX_TYPE boot_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t boot_last_ms;
+
+void boot_mark(const char *step) {
+  uint32_t now = millis();
+  uint32_t last;
+
+  // The GPS task marks its steps too
+  portENTER_CRITICAL(&boot_lock);
+  last = boot_last_ms;
+  boot_last_ms = now;
+  portEXIT_CRITICAL(&boot_lock);
+
+  Serial.printf("BOOT %5lu ms  +%-4lu %s\n", (unsigned long)now, (unsigned long)(now - last), step);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+/**
+ * Boot timeline.
+ *
+ * boot_mark() logs each startup step with the time since reset and since the
+ * previous step, from any task, so the critical path and the steps that run
+ * alongside it show up in the serial log:
+ *
+ *     BOOT   412 ms  +130  radio
+ */
+
+void boot_mark(const char *step);
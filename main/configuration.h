@@ -85,14 +85,34 @@
  */
 #define REST_WAIT (20 * 60)
 
+/**
+ * Parked or moving from the GPS fixes, see motion.h.  Parked after
+ * MOTION_PARK_S seconds below MOTION_STILL_MPS with the position holding
+ * still, and then it rests right away instead of after REST_WAIT.  Moving
+ * again above MOTION_MOVE_MPS, or MOTION_MOVE_M meters from where it parked.
+ */
+#ifndef MOTION_PARK_S
+#define MOTION_PARK_S 120
+#endif
+#ifndef MOTION_STILL_MPS
+#define MOTION_STILL_MPS 0.5f
+#endif
+#ifndef MOTION_MOVE_MPS
+#define MOTION_MOVE_MPS 1.5f
+#endif
+#ifndef MOTION_MOVE_M
+#define MOTION_MOVE_M 30.0f
+#endif
+
 /**
  * Slow resting ping frequency in seconds
  */
 #define REST_TX_INTERVAL (30 * 60)
 
 /**
- * This last stage is a low-power sleep to conserve battery when the Mapper has
- * not moved for a long time.
+ * This last stage is a deep sleep to conserve battery when the Mapper has
+ * not moved for a long time.  Each wake is a fresh boot, with the mapper
+ * state and LoRaWAN session carried over in RTC memory.
  *
  * This one is a difficult compromise:
  *
@@ -101,7 +121,7 @@
  *     we make it too long, we miss the first minutes of each motion while
  *     sleeping.
  *
- * Note that USB Power will prevent this low-power sleep, and also wake us up
+ * Note that USB Power will prevent this deep sleep, and also wake us up
  * from it.
  * A button press will also wake from sleep, but takes some time to initialise
  * and re-acquire.
@@ -163,6 +183,23 @@
  */
 #define BATTERY_LOW_VOLTAGE 3.1
 
+/**
+ * Battery runtime, see battery.h.  When the forecast says the battery runs
+ * down to BATTERY_LOW_VOLTAGE before BATTERY_SHIFT_HOURS after power on, the
+ * uplink interval and distance are stretched, up to BATTERY_STRETCH_MAX
+ * times, so it lasts the shift.  BATTERY_SHIFT_HOURS 0 turns this off.
+ * BATTERY_CAPACITY_MAH is of the cell fitted, for the coulomb counter.
+ */
+#ifndef BATTERY_SHIFT_HOURS
+#define BATTERY_SHIFT_HOURS 8
+#endif
+#ifndef BATTERY_STRETCH_MAX
+#define BATTERY_STRETCH_MAX 4.0f
+#endif
+#ifndef BATTERY_CAPACITY_MAH
+#define BATTERY_CAPACITY_MAH 2500.0f
+#endif
+
 /**
  * Confirmed packets (ACK request) conflict with the function of a Mapper and
  * should not normally be enabled.
@@ -175,6 +212,68 @@
  */
 #define LORAWAN_CONFIRMED_EVERY 0
 
+/**
+ * Link probes, see link.h: a confirmed Mapper uplink at most every
+ * LINK_PROBE_MAX_S seconds while the link is good, more often as it gets
+ * worse, and on the next uplink after a miss.  LINK_LOST_MISSES misses in a
+ * row step to a slower SF, or Join again when already at SF10.  A LinkCheck
+ * margin below LINK_MARGIN_LOW_DB also steps slower, and one of at least
+ * LINK_MARGIN_HIGH_DB steps back.
+ *
+ * Probes are confirmed packets too, with the same drawbacks as above, so they
+ * are off (0) unless set here, e.g. to (15 * 60).
+ */
+#ifndef LINK_PROBE_MAX_S
+#define LINK_PROBE_MAX_S 0
+#endif
+#ifndef LINK_PROBE_MIN_S
+#define LINK_PROBE_MIN_S 60
+#endif
+#ifndef LINK_LOST_MISSES
+#define LINK_LOST_MISSES 3
+#endif
+#ifndef LINK_MARGIN_LOW_DB
+#define LINK_MARGIN_LOW_DB 3
+#endif
+#ifndef LINK_MARGIN_HIGH_DB
+#define LINK_MARGIN_HIGH_DB 12
+#endif
+
+/**
+ * The LoRaWAN session lives in RTC memory across sleep and resets, and is
+ * written to flash every this many uplinks.  After a power loss the Mapper
+ * resumes from flash, and the network drops uplinks until the frame counter
+ * passes where it was, so up to this many.
+ */
+#ifndef LORAWAN_FCNT_CHECKPOINT
+#define LORAWAN_FCNT_CHECKPOINT 16
+#endif
+
+/**
+ * The frame counter must not run past 50,000 (Helium wants a rollover well
+ * before 0xFFFF), so the session is renewed by a fresh Join in place.  From
+ * this many uplinks on, that happens at the first quiet moment: parked (REST)
+ * or without GPS.  At 50,000 it happens regardless.
+ */
+#ifndef LORAWAN_FCNT_RENEW
+#define LORAWAN_FCNT_RENEW 48000
+#endif
+
+/**
+ * A failed Join is retried from the main loop while the GPS and screen keep
+ * running.  The wait doubles after each failure, from the first to the last
+ * value here (seconds), with random jitter so a fleet does not retry in step.
+ * It never drops below the Join duty cycle LoRaWAN asks for (1% for the first
+ * hour, 0.1% for the next ten, then 0.01%).  Every two failures the Join also
+ * steps down to a slower, longer range SF, down to SF10.
+ */
+#ifndef LORAWAN_JOIN_BACKOFF_MIN
+#define LORAWAN_JOIN_BACKOFF_MIN 15
+#endif
+#ifndef LORAWAN_JOIN_BACKOFF_MAX
+#define LORAWAN_JOIN_BACKOFF_MAX (60 * 60)
+#endif
+
 /**
  * Spreading Factor (Data Rate) determines how long each 11-byte Mapper Uplink
  * is on-air, and how observable it is.
@@ -221,6 +320,37 @@
 #define SEND_STATUS_UPLINKS 0  // USB Connect/disconnect messages
 #endif
 
+/** Status messages come at most this often (seconds), the latest one wins */
+#ifndef STATUS_MIN_INTERVAL
+#define STATUS_MIN_INTERVAL 60
+#endif
+
+/**
+ * Telemetry: battery, uptime, airtime and frames since reset, ACK ratio and
+ * reset reason, in 8 bytes.  Once every TELEMETRY_INTERVAL seconds it is
+ * appended to whichever uplink goes out next, which keeps a Mapper frame
+ * under the 24 bytes of one Helium DC.  Only when nothing has carried it for
+ * twice that long does it go out on its own, on FPort 7.  Set to 0 to never
+ * send it; decoders from before it existed ignore the extra bytes.
+ */
+#ifndef SEND_TELEMETRY
+#define SEND_TELEMETRY 1
+#endif
+#ifndef TELEMETRY_INTERVAL
+#define TELEMETRY_INTERVAL (60 * 60)
+#endif
+
+/**
+ * Mapper Uplink payload format.
+ *
+ * 1: The classic 9-byte CubeCell-compatible frame on FPort 2.
+ * 2: Higher resolution position (~0.1m) plus horizontal accuracy, speed and
+ *    heading on FPort 3, 11 to 14 bytes.  Update the Console Decoder first!
+ */
+#ifndef MAPPER_PAYLOAD_VERSION
+#define MAPPER_PAYLOAD_VERSION 1
+#endif
+
 /** Less common Configuration items */
 
 /**
@@ -270,6 +400,18 @@
 /** Verbose LoRa message callback reporting */
 // #define DEBUG_LORA_MESSAGES
 
+/**
+ * Section timers for the main loop, see profiler.h.
+ * On in debug builds; set to 1 to also profile a release build.
+ */
+#ifndef ENABLE_PROFILER
+#ifdef DEBUG
+#define ENABLE_PROFILER 1
+#else
+#define ENABLE_PROFILER 0
+#endif
+#endif
+
 /** Custom messages */
 #define EV_QUEUED 100
 #define EV_PENDING 101
@@ -306,6 +448,16 @@
 #define GPS_BAUDRATE 115200  // Make haste!  NMEA is big.. go fast
 #define USE_GPS 1
 
+/** Longest wait at each baud rate for a valid NMEA sentence or UBX frame from the GPS */
+#ifndef GPS_DETECT_LISTEN_MS
+#define GPS_DETECT_LISTEN_MS 1100
+#endif
+
+/** Give up looking for the GPS after this long, and report it failed */
+#ifndef GPS_DETECT_TIMEOUT_MS
+#define GPS_DETECT_TIMEOUT_MS 10000
+#endif
+
 #if defined(T_BEAM_V07)
 #define GPS_RX_PIN 12
 #define GPS_TX_PIN 15
@@ -1,3 +1,4 @@
 #pragma once
+#include <Arduino.h>
 
 extern const uint8_t Custom_Font[] PROGMEM;
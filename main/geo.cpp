@@ -0,0 +1,42 @@
+/**
+ * Geo module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "geo.h"
+
+#include <math.h>
+
+#define GEO_EARTH_RADIUS_M 6371009.0  // Mean radius, as TinyGPSPlus uses
+#define GEO_RADIANS (M_PI / 180.0)
+
+double geo_distance_m(double lat1, double lon1, double lat2, double lon2) {
+  // Vincenty's formula on a sphere, which stays accurate for the short hops between fixes
+  double delta = (lon1 - lon2) * GEO_RADIANS;
+  double sdlong = sin(delta);
+  double cdlong = cos(delta);
+  lat1 *= GEO_RADIANS;
+  lat2 *= GEO_RADIANS;
+  double slat1 = sin(lat1);
+  double clat1 = cos(lat1);
+  double slat2 = sin(lat2);
+  double clat2 = cos(lat2);
+  double y = clat1 * slat2 - slat1 * clat2 * cdlong;
+  double x = clat2 * sdlong;
+  double denom = slat1 * slat2 + clat1 * clat2 * cdlong;
+  return atan2(sqrt(y * y + x * x), denom) * GEO_EARTH_RADIUS_M;
+}
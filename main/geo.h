@@ -0,0 +1,9 @@
+#pragma once
+
+/**
+ * Great-circle distance, the same as TinyGPSPlus::distanceBetween() gives,
+ * without the GPS library, so it can be timed in the host build.
+ */
+
+/** Meters between two points given in degrees */
+double geo_distance_m(double lat1, double lon1, double lat2, double lon2);
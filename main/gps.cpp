@@ -6,7 +6,9 @@
 #include <TinyGPS++.h>
 #include <SparkFun_u-blox_GNSS_Arduino_Library.h>
 
+#include "boot.h"
 #include "configuration.h"
+#include "tasks.h"
 
 HardwareSerial gpsSerial(GPS_SERIAL_NUM);
 
@@ -14,75 +16,198 @@ SFE_UBLOX_GNSS myGNSS;
 
 TinyGPSPlus tGPS;
 
+static volatile bool gps_is_ready = false;   // gps_setup() done, gps_loop() may read
+static volatile bool gps_is_failed = false;  // gps_setup() gave up, no receiver found
+
+// GST pseudorange error statistics: standard deviation of latitude and longitude error (m)
+// Multi-GNSS receivers use the GN talker, GPS-only ones GP.
+TinyGPSCustom gstLatGN(tGPS, "GNGST", 6);
+TinyGPSCustom gstLonGN(tGPS, "GNGST", 7);
+TinyGPSCustom gstLatGP(tGPS, "GPGST", 6);
+TinyGPSCustom gstLonGP(tGPS, "GPGST", 7);
+
 void gps_time(char* buffer, uint8_t size) {
   snprintf(buffer, size, "%02d:%02d:%02d", tGPS.time.hour(), tGPS.time.minute(), tGPS.time.second());
 }
 
-void gps_end(void) {
-  gpsSerial.end();
+/** Degrees from NMEA, as an integer in 1e-7 degree units (no float round trip) */
+int32_t gps_raw_e7(const RawDegrees &raw) {
+  int32_t e7 = (int32_t)raw.deg * 10000000 + (int32_t)((raw.billionths + 50) / 100);
+  return raw.negative ? -e7 : e7;
 }
 
-void gps_setup(boolean first_init) {
-  static boolean serial_ready = false;
-  if (serial_ready) {
-    gpsSerial.updateBaudRate(GPS_BAUDRATE);
-  } else {
-    gpsSerial.begin(GPS_BAUDRATE, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
-    gpsSerial.setRxBufferSize(2048);  // Default is 256
-    serial_ready = true;
+/** Horizontal accuracy from the latest GST sentence, false if there is none recent */
+bool gps_hacc_dm(uint16_t *hacc_dm) {
+  TinyGPSCustom *lat = &gstLatGN, *lon = &gstLonGN;
+  if (!lat->isValid() || (gstLatGP.isValid() && gstLatGP.age() < lat->age())) {
+    lat = &gstLatGP;
+    lon = &gstLonGP;
   }
-  // Drain any waiting garbage
-  while (gpsSerial.read() != -1);
+  if (!lat->isValid() || !lon->isValid() || lat->age() > 5000)
+    return false;
 
-  // myGNSS.enableDebugging();
+  float lat_m = atof(lat->value());
+  float lon_m = atof(lon->value());
+  float hacc = sqrtf(lat_m * lat_m + lon_m * lon_m) * 10 + 0.5f;
+  *hacc_dm = hacc > 65535 ? 65535 : (uint16_t)hacc;
+  return true;
+}
 
-  bool changed_speed = false;  // Assume we're already at the right speed
+void gps_end(void) {
+  gpsSerial.end();
+}
 
-  // Check all the possible GPS bitrates to get in sync
-  do {
-    gpsSerial.updateBaudRate(GPS_BAUDRATE);  // Try the desired speed first
-    if (myGNSS.begin(gpsSerial)) {
-      Serial.println("GPS connected.");
-      break;
-    }
+static const uint32_t gps_bauds[] = {GPS_BAUDRATE, 115200, 9600, 38400, 57600};
 
-    // Well, wasn't where we expected it
-    changed_speed = true;
+static int hex_digit(int c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
 
-    // Serial.println("Trying 115200...");
-    gpsSerial.updateBaudRate(115200);
-    if (myGNSS.begin(gpsSerial)) {
-      Serial.println("GPS found at 115200 baud");
-      myGNSS.setSerialRate(GPS_BAUDRATE);
+/** UBX message classes a receiver sends unasked: NAV, RXM, INF, ACK, CFG, MON, TIM */
+static bool ubx_class(int c) {
+  switch (c) {
+    case 0x01:
+    case 0x02:
+    case 0x04:
+    case 0x05:
+    case 0x06:
+    case 0x0A:
+    case 0x0D:
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Listens at one baud rate for output from the receiver, without sending anything.
+ * True on a complete NMEA sentence with a good checksum, or a UBX sync and class.
+ * At the wrong rate the bytes are framing garbage and neither turns up.
+ */
+static bool gps_sniff(uint32_t baud, uint32_t window_ms) {
+  gpsSerial.updateBaudRate(baud);
+  while (gpsSerial.read() != -1);  // Bytes received at the previous rate
+
+  enum { IDLE, BODY, CK_HI, CK_LO } state = IDLE;
+  uint8_t sum = 0, ck = 0, len = 0;
+  int prev = -1, prev2 = -1;
+  uint32_t start = millis();
+  while (millis() - start < window_ms) {
+    int c = gpsSerial.read();
+    if (c < 0) {
+      delay(2);
       continue;
     }
+    if (prev2 == 0xB5 && prev == 0x62 && ubx_class(c))
+      return true;
+    prev2 = prev;
+    prev = c;
 
-    // Serial.println("Trying 9600...");
-    gpsSerial.updateBaudRate(9600);
-    if (myGNSS.begin(gpsSerial)) {
-      Serial.println("GPS found at 9600 baud");
-      myGNSS.setSerialRate(GPS_BAUDRATE);
+    if (c == '$') {
+      state = BODY;
+      sum = 0;
+      len = 0;
       continue;
     }
+    switch (state) {
+      case IDLE:
+        break;
+      case BODY:
+        if (c == '*')
+          state = len >= 6 ? CK_HI : IDLE;  // At least the talker and sentence id
+        else if (c < 0x20 || c > 0x7E || ++len > 80)
+          state = IDLE;
+        else
+          sum ^= c;
+        break;
+      case CK_HI:
+        state = hex_digit(c) < 0 ? IDLE : CK_LO;
+        ck = hex_digit(c) << 4;
+        break;
+      case CK_LO:
+        if (hex_digit(c) >= 0 && (ck | hex_digit(c)) == sum)
+          return true;
+        state = IDLE;
+        break;
+    }
+  }
+  return false;
+}
 
-    // Serial.println("Trying 38400...");
-    gpsSerial.updateBaudRate(38400);
-    if (myGNSS.begin(gpsSerial)) {
-      Serial.println("GPS found at 38400 baud");
-      myGNSS.setSerialRate(GPS_BAUDRATE);
+/** Finds the rate the receiver talks at, 0 if it is silent or absent until the deadline */
+static uint32_t gps_detect_baud(uint32_t deadline) {
+  // Passive first: one window per rate, over as soon as a valid sentence shows up
+  for (size_t i = 0; i < sizeof(gps_bauds) / sizeof(gps_bauds[0]); i++) {
+    if (i > 0 && gps_bauds[i] == GPS_BAUDRATE)
       continue;
-    }
+    int32_t left = deadline - millis();
+    if (left <= 0)
+      return 0;
+    if (gps_sniff(gps_bauds[i], left < GPS_DETECT_LISTEN_MS ? left : GPS_DETECT_LISTEN_MS))
+      return gps_bauds[i];
+  }
 
-    // Serial.println("Trying 57600...");
-    gpsSerial.updateBaudRate(57600);
-    if (myGNSS.begin(gpsSerial)) {
-      Serial.println("GPS found at 57600 baud");
-      myGNSS.setSerialRate(GPS_BAUDRATE);
+  // A receiver with its outputs turned off only answers when polled
+  for (size_t i = 0; i < sizeof(gps_bauds) / sizeof(gps_bauds[0]); i++) {
+    if (i > 0 && gps_bauds[i] == GPS_BAUDRATE)
       continue;
-    }
+    if ((int32_t)(deadline - millis()) <= 0)
+      return 0;
+    gpsSerial.updateBaudRate(gps_bauds[i]);
+    if (myGNSS.begin(gpsSerial, 250))
+      return gps_bauds[i];
+  }
+  return 0;
+}
+
+/**
+ * Detects the receiver's baud rate, moves it to GPS_BAUDRATE and configures the NMEA output.
+ * Gives up after GPS_DETECT_TIMEOUT_MS and returns false, with gps_failed() set.
+ */
+bool gps_setup(boolean first_init) {
+  static boolean serial_ready = false;
+  gps_is_ready = false;
+  gps_is_failed = false;
+  if (serial_ready) {
+    gpsSerial.updateBaudRate(GPS_BAUDRATE);
+  } else {
+    gpsSerial.begin(GPS_BAUDRATE, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+    gpsSerial.setRxBufferSize(2048);  // Default is 256
+    serial_ready = true;
+  }
+
+  // myGNSS.enableDebugging();
+
+  uint32_t baud = gps_detect_baud(millis() + GPS_DETECT_TIMEOUT_MS);
+  if (!baud) {
+    Serial.println("GPS not found, giving up.");
+    gpsSerial.updateBaudRate(GPS_BAUDRATE);
+    gps_is_failed = true;
+    return false;
+  }
 
-    Serial.println("Could not connect to GPS. Retrying all speeds...");
-  } while (1);
+  bool changed_speed = false;  // Assume we're already at the right speed
+  if (baud != GPS_BAUDRATE) {
+    Serial.printf("GPS found at %lu baud\n", (unsigned long)baud);
+    gpsSerial.updateBaudRate(baud);
+    if (myGNSS.begin(gpsSerial))
+      myGNSS.setSerialRate(GPS_BAUDRATE);
+    gpsSerial.updateBaudRate(GPS_BAUDRATE);
+    delay(50);  // Let the receiver switch over
+    changed_speed = true;
+    first_init = true;  // It lost our settings too, so send them all again
+  }
+
+  if ((first_init || changed_speed) && !myGNSS.begin(gpsSerial)) {
+    // NMEA is all the mapper needs, so carry on with whatever the receiver sends
+    Serial.println("GPS does not answer UBX, not configured.");
+    gps_is_ready = true;
+    return true;
+  }
+  Serial.println("GPS connected.");
 
   // Configure NMEA messages only once, save to flash
   if (first_init) {
@@ -116,15 +241,43 @@ void gps_setup(boolean first_init) {
 
     myGNSS.enableNMEAMessage(UBX_NMEA_RMC, COM_PORT_UART1);  // For Speed
     myGNSS.enableNMEAMessage(UBX_NMEA_GGA, COM_PORT_UART1);  // For Time & Location & SV count
+    myGNSS.enableNMEAMessage(UBX_NMEA_GST, COM_PORT_UART1);  // For position accuracy
   }
 
   if (first_init || changed_speed) {
     myGNSS.saveConfiguration();  // Save the current settings to flash and BBR
   }
+  // Drain anything sent while configuring
+  while (gpsSerial.read() != -1);
+  gps_is_ready = true;
+  return true;
+}
+
+static void gps_setup_task(void *first_init) {
+  delay(100);  // GPS doesn't respond right away after power-up.. not ready for baud-rate test.
+  boot_mark(gps_setup(first_init != NULL) ? "gps ready" : "gps failed");
+  vTaskDelete(NULL);
+}
+
+/** gps_setup() in a task of its own (see tasks.h), so boot can carry on.  gps_loop() idles until it is done. */
+void gps_setup_async(boolean first_init) {
+  gps_is_ready = false;
+  gps_is_failed = false;
+  xTaskCreatePinnedToCore(gps_setup_task, "gps_setup", TASK_GPS_STACK, first_init ? (void *)1 : NULL, TASK_GPS_PRIORITY,
+                          NULL, TASK_GPS_CORE);
+}
+
+bool gps_ready(void) {
+  return gps_is_ready;
+}
+
+bool gps_failed(void) {
+  return gps_is_failed;
 }
 
 void gps_full_reset(void) {
   Serial.println("Resetting GPS...");
+  myGNSS.begin(gpsSerial);  // A wake skips it when the receiver is already set up
   myGNSS.factoryReset();
   delay(5000);
   Serial.println("Reconfiguring GPS...");
@@ -147,6 +300,8 @@ void gps_passthrough(void) {
 }
 
 void gps_loop(boolean print_it) {
+  if (!gps_is_ready)
+    return;
   while (gpsSerial.available()) {
     char c = gpsSerial.read();
     if (print_it)
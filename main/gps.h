@@ -7,8 +7,13 @@
 extern TinyGPSPlus tGPS;
 
 void gps_loop(boolean print_it);
-void gps_setup(boolean first_init);
+bool gps_setup(boolean first_init);
+void gps_setup_async(boolean first_init);
+bool gps_ready(void);
+bool gps_failed(void);
 void gps_time(char *buffer, uint8_t size);
 void gps_passthrough(void);
 void gps_end(void);
-void gps_full_reset(void);
\ No newline at end of file
+void gps_full_reset(void);
+int32_t gps_raw_e7(const RawDegrees &raw);
+bool gps_hacc_dm(uint16_t *hacc_dm);
\ No newline at end of file
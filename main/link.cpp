@@ -0,0 +1,122 @@
+/**
+ * Link health module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "link.h"
+
+#include <Arduino.h>
+
+#include "configuration.h"
+
+// Weight of the newest probe in the loss estimate
+#define LINK_LOSS_WEIGHT 0.25f
+
+struct link_state {
+  float loss;            // Estimated probability an uplink is lost, 0..1
+  uint32_t last_probe_s;
+  uint16_t probes;       // Since reset or rejoin
+  uint8_t misses;        // In a row
+  uint8_t step;          // SF steps slower than configured
+  int16_t margin_db;     // Of the last ACK, LINK_MARGIN_UNKNOWN if none
+};
+
+RTC_DATA_ATTR static struct link_state link;
+
+static void link_reset(void) {
+  link.loss = 0.5f;  // Nothing known yet, so probe often until it is
+  link.last_probe_s = 0;
+  link.probes = 0;
+  link.misses = 0;
+  link.step = 0;
+  link.margin_db = LINK_MARGIN_UNKNOWN;
+}
+
+void link_begin(bool reset) {
+  if (reset)
+    link_reset();
+}
+
+bool link_probe_due(uint32_t now_s) {
+  if (LINK_PROBE_MAX_S == 0)
+    return false;
+  // The first uplink of a session, and the one after a miss, find out right away
+  if (!link.probes || link.misses)
+    return true;
+  float good = 1.0f - link.loss;
+  uint32_t interval = LINK_PROBE_MAX_S * good * good;
+  if (link.margin_db != LINK_MARGIN_UNKNOWN && link.margin_db < LINK_MARGIN_LOW_DB)
+    interval /= 2;
+  if (interval < LINK_PROBE_MIN_S)
+    interval = LINK_PROBE_MIN_S;
+  return now_s - link.last_probe_s >= interval;
+}
+
+void link_probe_sent(uint32_t now_s) {
+  link.last_probe_s = now_s;
+  if (link.probes < UINT16_MAX)
+    link.probes++;
+}
+
+/**
+ * margin_db is the LinkCheck margin, or LINK_MARGIN_UNKNOWN; snr_margin_db is
+ * the downlink SNR above the demodulation floor of the SF it came on, and
+ * stands in when the LinkCheck was not answered.  max_step is how many SF
+ * steps slower than the configured one there are.
+ */
+enum link_action link_result(bool acked, int16_t margin_db, float snr_margin_db, uint8_t max_step) {
+  if (!acked) {
+    link.loss += LINK_LOSS_WEIGHT * (1.0f - link.loss);
+    if (++link.misses < LINK_LOST_MISSES)
+      return LINK_KEEP;
+    link.misses = 0;
+    if (link.step < max_step) {
+      link.step++;
+      link.margin_db = LINK_MARGIN_UNKNOWN;
+      return LINK_SF_SLOWER;
+    }
+    link_reset();
+    return LINK_REJOIN;
+  }
+
+  link.misses = 0;
+  if (margin_db == LINK_MARGIN_UNKNOWN)
+    margin_db = snr_margin_db;
+  link.margin_db = margin_db;
+
+  // An ACK from right at the edge is only half good news
+  float lost = margin_db < LINK_MARGIN_LOW_DB ? 0.5f : 0.0f;
+  link.loss += LINK_LOSS_WEIGHT * (lost - link.loss);
+
+  if (margin_db < LINK_MARGIN_LOW_DB && link.step < max_step) {
+    link.step++;
+    return LINK_SF_SLOWER;
+  }
+  if (margin_db >= LINK_MARGIN_HIGH_DB && link.step > 0) {
+    link.step--;
+    return LINK_SF_FASTER;
+  }
+  return LINK_KEEP;
+}
+
+uint8_t link_sf_step(void) {
+  return link.step;
+}
+
+uint8_t link_loss_percent(void) {
+  return link.loss * 100.0f + 0.5f;
+}
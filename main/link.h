@@ -0,0 +1,35 @@
+#pragma once
+
+/**
+ * Link health: when to ask for an ACK, and what to do when none comes back.
+ *
+ * Each confirmed uplink is a probe.  Its outcome feeds a running estimate of
+ * the loss probability, and an ACK also brings the LinkCheck margin (how far
+ * above the demodulation floor the gateway heard us) and the downlink SNR.
+ * The next probe is due LINK_PROBE_MAX_S after the last one, sooner the worse
+ * the link looks, and straight away after a miss.  So coverage loss is known
+ * within LINK_PROBE_MAX_S plus LINK_LOST_MISSES uplinks, while a good link
+ * costs one downlink every LINK_PROBE_MAX_S.  LINK_PROBE_MAX_S is 0 by
+ * default, which turns the probes off.
+ *
+ * link_result() returns what to do about it: step to a slower SF after
+ * LINK_LOST_MISSES misses in a row or a thin margin, back when the margin is
+ * ample, and join again once the slowest SF misses too.  The SF step is on
+ * top of the configured SF, which stays the fastest one used.
+ *
+ * The state is in RTC memory, so it carries on through deep sleep.  Times
+ * are seconds of the RTC clock.
+ */
+
+#include <stdint.h>
+
+enum link_action { LINK_KEEP, LINK_SF_SLOWER, LINK_SF_FASTER, LINK_REJOIN };
+
+#define LINK_MARGIN_UNKNOWN -1
+
+void link_begin(bool reset);
+bool link_probe_due(uint32_t now_s);
+void link_probe_sent(uint32_t now_s);
+enum link_action link_result(bool acked, int16_t margin_db, float snr_db, uint8_t max_step);
+uint8_t link_sf_step(void);
+uint8_t link_loss_percent(void);
@@ -40,22 +40,37 @@
 #include <BluetoothSerial.h>
 #include <ESPmDNS.h>
 #include <HardwareSerial.h>
-#include <Preferences.h>
 #include <RadioLib.h>
 #include <SPI.h>
 #include <WiFi.h>
 #include <WiFiClient.h>
 #include <Wire.h>
 #include <XPowersLib.h>
+#include <esp32/rom/crc.h>
 #include <esp_bt.h>
+#include <sys/time.h>
 
 #include "configuration.h"
 #include "credentials.h"
+#include "battery.h"
+#include "bench.h"
+#include "boot.h"
+#include "geo.h"
 #include "gps.h"
+#include "link.h"
+#include "motion.h"
+#include "payload.h"
+#include "payload_codec.h"
+#include "pmu_irq.h"
+#include "profiler.h"
 #include "screen.h"
+#include "settings.h"
 #include "sleep.h"
+#include "spsc.h"
+#include "tasks.h"
 
-#define FPORT_MAPPER 2  // FPort for Uplink messages -- must match Helium Console Decoder script!
+#define FPORT_MAPPER CODEC_MAPPER_PORT        // FPort for Uplink messages -- must match Helium Console Decoder script!
+#define FPORT_MAPPER_V2 CODEC_MAPPER_V2_PORT  // FPort for payload v2 Mapper Uplinks (see payload.h)
 
 #define STATUS_BOOT 1
 #define STATUS_USB_ON 2
@@ -69,6 +84,7 @@ unsigned long int last_send_ms = 0;     // Time of last uplink
 unsigned long int last_moved_ms = 0;    // Time of last movement
 unsigned long int last_gpslost_ms = 0;  // Time of last gps-lost packet
 unsigned long int last_display_ms = 0;  // Time of last display update
+unsigned long int logo_until_ms = 0;    // Leave the boot logo up until then
 double last_send_lat = 0;               // Last known location
 double last_send_lon = 0;               //
 double dist_moved = 0;                  // Distance in m from last uplink
@@ -76,7 +92,7 @@ double dist_moved = 0;                  // Distance in m from last uplink
 // Deadzone (no uplink) location and radius
 double deadzone_lat = DEADZONE_LAT;
 double deadzone_lon = DEADZONE_LON;
-double deadzone_radius_m = DEADZONE_RADIUS_M;
+unsigned int deadzone_radius_m = DEADZONE_RADIUS_M;
 boolean in_deadzone = false;
 
 /* Defaults that can be overwritten by downlink messages */
@@ -108,12 +124,14 @@ unsigned int sleep_tx_interval_s = SLEEP_TX_INTERVAL;
 unsigned int gps_lost_wait_s = GPS_LOST_WAIT;
 unsigned int gps_lost_ping_s = GPS_LOST_PING;
 uint32_t last_fix_time = 0;
+uint32_t woke_time_ms = 0;    // Time of wake from sleep
+uint32_t woke_fix_count = 0;  // GPS fixes seen by then
 
 float battery_low_voltage = BATTERY_LOW_VOLTAGE;
+uint8_t battery_shift_h = BATTERY_SHIFT_HOURS;
 float min_dist_moved = MIN_DIST;
 
 XPowersLibInterface *PMU = NULL;
-bool pmu_irq = false;  // true when PMU IRQ pending
 
 bool oled_found = false;
 bool pmu_found = false;
@@ -133,7 +151,9 @@ boolean have_usb_power = true;
 uint8_t usb_power_count = 0;
 
 // Buffer for Payload frame
-static uint8_t txBuffer[11];
+// Any Mapper, status or GPS lost frame, with room for telemetry on the end
+#define UPLINK_MAX_LEN (PAYLOAD_V2_MAX_LEN + CODEC_TELEMETRY_MAX_LEN)
+static uint8_t txBuffer[UPLINK_MAX_LEN];
 
 // deep sleep support
 RTC_DATA_ATTR int bootCount = 0;
@@ -171,40 +191,47 @@ char sf_name[40];
 #define SF_ENTRIES (sizeof(sf_list) / sizeof(sf_list[0]))
 uint8_t sf_index = 0; // Default to SF7
 
-unsigned long int ack_req = 0;
-unsigned long int ack_rx = 0;
+bool uplink_busy(void);
+uint8_t lorawan_datarate(void);
 
-// Store Lat & Long in six bytes of payload
-void pack_lat_lon(double lat, double lon) {
-  uint32_t LatitudeBinary;
-  uint32_t LongitudeBinary;
-  LatitudeBinary = ((lat + 90) / 180.0) * 16777215;
-  LongitudeBinary = ((lon + 180) / 360.0) * 16777215;
+// Select an entry of sf_list and apply it to the node
+void lorawan_set_sf(uint8_t index) {
+  sf_index = index % SF_ENTRIES;
+  lorawan_sf = sf_list[sf_index];  // Get the data rate number
 
-  txBuffer[0] = (LatitudeBinary >> 16) & 0xFF;
-  txBuffer[1] = (LatitudeBinary >> 8) & 0xFF;
-  txBuffer[2] = LatitudeBinary & 0xFF;
-  txBuffer[3] = (LongitudeBinary >> 16) & 0xFF;
-  txBuffer[4] = (LongitudeBinary >> 8) & 0xFF;
-  txBuffer[5] = LongitudeBinary & 0xFF;
+  // Apply the new data rate to the LoRaWAN node, or after the uplink in flight
+  if (!radio_busy())
+    node.setDatarate(lorawan_datarate());
+
+  // Update the name for display purposes
+  strncpy(sf_name, sf_names[sf_index], sizeof(sf_name));
+}
+
+// The sf_list entry in use: the configured one, or slower if the link probes asked for it
+uint8_t lorawan_sf_index(void) {
+  uint8_t index = sf_index + link_sf_step();
+  return index < SF_ENTRIES ? index : SF_ENTRIES - 1;
 }
 
+uint8_t lorawan_datarate(void) {
+  return sf_list[lorawan_sf_index()];
+}
+
+RTC_DATA_ATTR unsigned long int ack_req = 0;  // Since reset, deep sleep carries them over
+RTC_DATA_ATTR unsigned long int ack_rx = 0;
+
 uint8_t battery_byte(void) {
-  uint16_t batteryVoltage = ((float_t)((float_t)(PMU->getBattVoltage()) / 10.0) + .5);
-  return (uint8_t)((batteryVoltage - 200) & 0xFF);
+  return pack_battery(PMU->getBattVoltage());
 }
 
-// Prepare a packet for the Mapper
-void build_mapper_packet() {
+// Prepare a packet for the Mapper, returns the payload length
+uint8_t build_mapper_packet() {
   double lat;
   double lon;
-  uint16_t altitudeGps;
   uint8_t sats;
 
   lat = tGPS.location.lat();
   lon = tGPS.location.lng();
-  pack_lat_lon(lat, lon);
-  altitudeGps = (uint16_t)tGPS.altitude.meters();
   sats = tGPS.satellites.value();
 
   sprintf(buffer, "Lat: %f, ", lat);
@@ -216,32 +243,143 @@ void build_mapper_packet() {
   sprintf(buffer, "Sats: %d", sats);
   Serial.println(buffer);
 
-  txBuffer[6] = (altitudeGps >> 8) & 0xFF;
-  txBuffer[7] = altitudeGps & 0xFF;
-
-  txBuffer[8] = sats & 0xFF;
-}
-
-/// Blow away our prefs (i.e. to rejoin from scratch)
-void ttn_erase_prefs() {
-  node.clearSession();
-  Preferences p;
-  if (p.begin("lora", false)) {
-    p.clear();
-    p.end();
-  }
+#if MAPPER_PAYLOAD_VERSION >= 2
+  // Straight from the NMEA digits in integer form, no double rounding on the way
+  struct mapper_fix fix;
+  fix.lat_e7 = gps_raw_e7(tGPS.location.rawLat());
+  fix.lon_e7 = gps_raw_e7(tGPS.location.rawLng());
+  fix.alt_m = (int16_t)(tGPS.altitude.value() / 100);
+  fix.sats = sats;
+  fix.flags = 0;
+  if (gps_hacc_dm(&fix.hacc_dm))
+    fix.flags |= PAYLOAD_V2_FLAG_HACC;
+  if (tGPS.speed.isValid() && tGPS.course.isValid()) {
+    fix.flags |= PAYLOAD_V2_FLAG_MOTION;
+    fix.speed_dms = ((uint64_t)tGPS.speed.value() * 514444 + 5000000) / 10000000;  // 1/100 knot to 0.1 m/s
+    fix.heading_deg = ((tGPS.course.value() + 50) / 100) % 360;                       // 1/100 degree
+  }
+  return pack_mapper_v2(txBuffer, &fix);
+#else
+  return pack_mapper(txBuffer, lat, lon, (int16_t)tGPS.altitude.meters(), sats);
+#endif
 }
 
 // Helium requires a FCount reset sometime before hitting 0xFFFF
 // 50,000 makes it obvious it was intentional
 #define MAX_FCOUNT 50000
 
+void downlink_process(uint8_t fport, const uint8_t *buf, size_t len);
+void lorawan_save_prefs(void);
+void lorawan_rtc_save(void);
+extern uint32_t lorawan_fcnt_saved;
+void lora_msg_callback(const _ev_t message);
+extern uint32_t telemetry_frames;
+extern uint32_t telemetry_airtime_ms;
+uint8_t telemetry_append(uint8_t *buf, uint8_t length);
+void telemetry_sent(bool sent);
+uint32_t rtc_seconds(void);
+void link_update(bool acked, int16_t margin);
+void pmu_handlers_begin(void);
+
+/*
+ * Radio task, on its own core (see tasks.h).  sendReceive() and
+ * activateOTAA() block through TX and both receive windows, several seconds
+ * at SF10, so they run there while the loop keeps reading the GPS, buttons
+ * and screen:
+ *
+ *   send_uplink() prepares the frame -> request queue -> the task transmits
+ *   and waits out RX1 and RX2 -> result queue -> radio_loop() handles it and
+ *   reports to lora_msg_callback()
+ *
+ * Only the task touches the node between a request and its result; everything
+ * else that does checks radio_busy() first, or waits with radio_wait().
+ */
+enum radio_op { RADIO_UPLINK, RADIO_JOIN };
+struct radio_request {
+  enum radio_op op;
+  uint8_t fport;  // RADIO_UPLINK
+  bool confirmed;
+  uint8_t length;
+  uint8_t data[UPLINK_MAX_LEN];
+  uint8_t dr;  // RADIO_JOIN
+};
+struct radio_result {
+  enum radio_op op;
+  bool confirmed;
+  int16_t state;
+  uint32_t toa_ms;
+  size_t downlink_size;
+  uint8_t downlink[RADIOLIB_LORAWAN_MAX_DOWNLINK_SIZE];  // Whatever the network sends has to fit
+  LoRaWANEvent_t down;
+};
+struct radio_request radio_requests[2];
+struct radio_result radio_results[2];
+struct spsc radio_request_queue = SPSC(radio_requests);  // loop -> radio task
+struct spsc radio_result_queue = SPSC(radio_results);    // radio task -> loop
+uint32_t radio_posted = 0;  // Written by the loop only
+uint32_t radio_done = 0;    // Written by the radio task only
+TaskHandle_t radio_task_handle = NULL;
+
+void radio_task(void *param) {
+  struct radio_request req;
+  static struct radio_result res;  // Too big for comfort on the stack
+  LoRaWANEvent_t up;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (spsc_pop(&radio_request_queue, &req)) {
+      res.op = req.op;
+      res.confirmed = req.confirmed;
+      res.downlink_size = 0;
+      if (req.op == RADIO_UPLINK)
+        res.state = node.sendReceive(req.data, req.length, req.fport, res.downlink, &res.downlink_size, req.confirmed,
+                                     &up, &res.down);
+      else
+        res.state = node.activateOTAA(req.dr);
+      res.toa_ms = node.getLastToA();
+      spsc_push(&radio_result_queue, &res);  // Never full: the loop has one request out at most
+      __atomic_store_n(&radio_done, radio_done + 1, __ATOMIC_RELEASE);
+    }
+  }
+}
+
+void radio_task_begin(void) {
+  xTaskCreatePinnedToCore(radio_task, "radio", TASK_RADIO_STACK, NULL, TASK_RADIO_PRIORITY, &radio_task_handle,
+                          TASK_RADIO_CORE);
+}
+
+/** The radio task has the node */
+bool radio_busy(void) {
+  return __atomic_load_n(&radio_done, __ATOMIC_ACQUIRE) != radio_posted;
+}
+
+/** Block until the radio is free again, for the few places that cannot carry on without it */
+void radio_wait(void) {
+  while (radio_busy())
+    delay(10);
+}
+
+bool radio_post(const struct radio_request *req) {
+  if (radio_busy() || !radio_task_handle || !spsc_push(&radio_request_queue, req))
+    return false;
+  radio_posted++;
+  xTaskNotifyGive(radio_task_handle);
+  return true;
+}
+
+/** Prepare a frame and hand it to the radio task.  False if the radio is still busy. */
 boolean send_uplink(uint8_t *txBuffer, uint8_t length, uint8_t fport, boolean confirmed) {
+  struct radio_request req;
+  if (radio_busy() || length > sizeof(req.data)) {
+    telemetry_sent(false);
+    return false;
+  }
+
   if (confirmed) {
     Serial.println("ACK requested");
     screen_print("? ");
     digitalWrite(RED_LED, LOW);  // Light LED
     ack_req++;
+    link_probe_sent(rtc_seconds());
   }
 
   // send it!
@@ -259,35 +397,69 @@ boolean send_uplink(uint8_t *txBuffer, uint8_t length, uint8_t fport, boolean co
   }
   node.setDeviceStatus(battLevel);
   packetQueued = true;
-  int16_t state = RADIOLIB_ERR_NONE;
-  uint8_t downlinkPayload[10];  // Make sure this fits your plans!
-  size_t downlinkSize;          // To hold the actual payload size received
-  LoRaWANEvent_t uplinkDetails;
-  LoRaWANEvent_t downlinkDetails;
   if (confirmed) {
     node.sendMacCommandReq(RADIOLIB_LORAWAN_MAC_LINK_CHECK);
     node.sendMacCommandReq(RADIOLIB_LORAWAN_MAC_DEVICE_TIME);
-    state = node.sendReceive(txBuffer, length, fport, downlinkPayload, &downlinkSize, confirmed, &uplinkDetails,
-                             &downlinkDetails);
-  } else {
-    state = node.sendReceive(txBuffer, length, fport, downlinkPayload, &downlinkSize, confirmed, &uplinkDetails,
-                             &downlinkDetails);
   }
+
+  req.op = RADIO_UPLINK;
+  memcpy(req.data, txBuffer, length);
+  req.length = length;
+  req.fport = fport;
+  req.confirmed = confirmed;
+  bool posted = radio_post(&req);
+  telemetry_sent(posted);
+  return posted;
+}
+
+/** A finished uplink: session bookkeeping, downlinks, and the events for lora_msg_callback() */
+void uplink_done(const struct radio_result *res) {
+  int16_t state = res->state;
+  const LoRaWANEvent_t &downlinkDetails = res->down;
   Serial.print("Send result: ");
   Serial.println(state);
 
+  // Menu changes made while the radio task had the node
+  node.setDatarate(lorawan_datarate());
+  node.setTxPower(lorawan_tx_power);
+
+  // The frame counter moved on: keep RTC memory current, and flash every so often
+  if (state >= RADIOLIB_ERR_NONE) {
+    telemetry_frames++;
+    telemetry_airtime_ms += res->toa_ms;
+    if (node.getFCntUp() - lorawan_fcnt_saved >= LORAWAN_FCNT_CHECKPOINT)
+      lorawan_save_prefs();
+    else
+      lorawan_rtc_save();
+  }
+
+  static bool first_uplink = true;
+  if (first_uplink) {
+    boot_mark("first uplink");
+    first_uplink = false;
+  }
+
   // Check for error:
   if( state == RADIOLIB_ERR_NETWORK_NOT_JOINED){
     screen_print("\nNot Joined!\n"); 
   }
 
+  // The LinkCheck answer, asked for with every confirmed uplink
+  uint8_t margin = 0;
+  uint8_t gwCnt = 0;
+  bool link_checked = state > 0 && node.getMacLinkCheckAns(&margin, &gwCnt) == RADIOLIB_ERR_NONE;
+
   // If things got returned:
   // Check if downlink was received
   // (state 0 = no downlink, state 1/2 = downlink in window Rx1/Rx2)
   if (state > 0) {
+    if (res->confirmed && downlinkDetails.confirming)
+      lora_msg_callback(EV_ACK);
+
     // Did we get a downlink with data for us
-    if (downlinkSize > 0) {
+    if (res->downlink_size > 0) {
       Serial.println(F("Downlink data"));
+      downlink_process(downlinkDetails.fPort, res->downlink, res->downlink_size);
     } else {
       Serial.println(F("<MAC commands only>"));
     }
@@ -326,12 +498,10 @@ boolean send_uplink(uint8_t *txBuffer, uint8_t length, uint8_t fport, boolean co
     Serial.print(F("[LoRaWAN] Port:\t\t"));
     Serial.println(downlinkDetails.fPort);
     Serial.print(F("[LoRaWAN] Time-on-air: \t"));
-    Serial.print(node.getLastToA());
+    Serial.print(res->toa_ms);
     Serial.println(F(" ms"));
 
-    uint8_t margin = 0;
-    uint8_t gwCnt = 0;
-    if (node.getMacLinkCheckAns(&margin, &gwCnt) == RADIOLIB_ERR_NONE) {
+    if (link_checked) {
       Serial.print(F("[LoRaWAN] LinkCheck margin:\t"));
       Serial.println(margin);
       Serial.print(F("[LoRaWAN] LinkCheck count:\t"));
@@ -348,27 +518,22 @@ boolean send_uplink(uint8_t *txBuffer, uint8_t length, uint8_t fport, boolean co
     }
   }
 
-  // Helium requires a re-join / reset of count to avoid 16bit count rollover
-  // Hopefully a device reboot every 50k uplinks is no problem.
-  if (node.getFCntUp() > MAX_FCOUNT) {
-    Serial.println("FCount Rollover!");
-
-    // I don't understand why this doesn't show at all
-    screen_print("\n\nRollover Reset!\n");
-    screen_update();
-    delay(1000);  // Give some time to read the screen
-
-    ttn_erase_prefs();
-    ESP.restart();
-  }
+  if (res->confirmed && state >= RADIOLIB_ERR_NONE)
+    link_update(state > 0 && downlinkDetails.confirming, link_checked ? margin : LINK_MARGIN_UNKNOWN);
 
-  return true;
+  lora_msg_callback(EV_TXCOMPLETE);
 }
 
 // LoRa message event callback
 void lora_msg_callback(const _ev_t message) {
   static boolean seen_joined = false, seen_joining = false;
 
+  // Session renewal: start over, as if just booted
+  if (EV_RESET == message) {
+    seen_joined = seen_joining = false;
+    isJoined = false;
+  }
+
   // This is confusing because JOINED is sometimes spoofed and comes early
   if (EV_JOINED == message)
     seen_joined = true;
@@ -413,6 +578,10 @@ enum mapper_uplink_result mapper_uplink() {
   double now_lon = tGPS.location.lng();
   unsigned long int now = millis();
 
+  // The last one is still in its receive windows, the node is not ours to use
+  if (radio_busy())
+    return MAPPER_UPLINK_NOLORA;
+
   if (!justSendNow) {
     // Here we try to filter out bogus GPS readings.
     if (!(tGPS.location.isValid() && tGPS.time.isValid() && tGPS.satellites.isValid() && tGPS.hdop.isValid() &&
@@ -445,8 +614,8 @@ enum mapper_uplink_result mapper_uplink() {
       return MAPPER_UPLINK_NOLORA;
   }
   // distance from last transmitted location
-  double dist_moved = tGPS.distanceBetween(last_send_lat, last_send_lon, now_lat, now_lon);
-  double deadzone_dist = tGPS.distanceBetween(deadzone_lat, deadzone_lon, now_lat, now_lon);
+  double dist_moved = geo_distance_m(last_send_lat, last_send_lon, now_lat, now_lon);
+  double deadzone_dist = geo_distance_m(deadzone_lat, deadzone_lon, now_lat, now_lon);
   in_deadzone = (deadzone_dist <= deadzone_radius_m);
 
   /*
@@ -462,8 +631,10 @@ enum mapper_uplink_result mapper_uplink() {
   bool confirmed;
   if (justSendNow) {
     confirmed = true;
+  } else if (lorawanAck > 0) {
+    confirmed = (node.getFCntUp() % lorawanAck == 0);
   } else {
-    confirmed = (lorawanAck > 0) && (node.getFCntUp() % lorawanAck == 0);
+    confirmed = link_probe_due(rtc_seconds());
   }
 
   char because = '?';
@@ -471,7 +642,8 @@ enum mapper_uplink_result mapper_uplink() {
     justSendNow = false;
     Serial.println("** JUST_SEND_NOW");
     because = '>';
-  } else if (dist_moved > min_dist_moved) {
+  } else if (dist_moved > min_dist_moved * battery_stretch() && motion_now() != MOTION_PARKED) {
+    // Parked, that far is GPS jitter: real movement would have shown in the speed and position first
     Serial.println("** DIST");
     last_moved_ms = now;
     because = 'D';
@@ -492,11 +664,11 @@ enum mapper_uplink_result mapper_uplink() {
   screen_print(buffer);
 
   // prepare the LoRa frame
-  build_mapper_packet();
+  uint8_t length = telemetry_append(txBuffer, build_mapper_packet());
 
   // Send it!
   lora_msg_callback(EV_TXSTART);
-  if (!send_uplink(txBuffer, 9, FPORT_MAPPER, confirmed))
+  if (!send_uplink(txBuffer, length, MAPPER_PAYLOAD_VERSION >= 2 ? FPORT_MAPPER_V2 : FPORT_MAPPER, confirmed))
     return MAPPER_UPLINK_NOLORA;
 
   last_send_ms = now;
@@ -504,226 +676,460 @@ enum mapper_uplink_result mapper_uplink() {
   last_send_lon = now_lon;
 
   screen_last_active_ms = now;
-  lora_msg_callback(EV_TXCOMPLETE);
-  return MAPPER_UPLINK_SUCCESS;  // We did it!
+  return MAPPER_UPLINK_SUCCESS;  // We did it!  radio_loop() reports EV_TXCOMPLETE
 }
 
-void mapper_restore_prefs(void) {
-  Preferences p;
-  if (p.begin("mapper", true)) {  // Read-only
-    min_dist_moved = p.getFloat("min_dist", MIN_DIST);
-    stationary_tx_interval_s = p.getUInt("tx_interval", STATIONARY_TX_INTERVAL);
-    never_rest = p.getBool("never_rest", NEVER_REST);
-    rest_wait_s = p.getUInt("rest_wait", REST_WAIT);
-    rest_tx_interval_s = p.getUInt("rest_tx", REST_TX_INTERVAL);
-    sleep_wait_s = p.getUInt("sleep_wait", SLEEP_WAIT);
-    sleep_tx_interval_s = p.getUInt("sleep_tx", SLEEP_TX_INTERVAL);
-    gps_lost_wait_s = p.getUInt("gps_lost_wait", GPS_LOST_WAIT);
-    gps_lost_ping_s = p.getUInt("gps_lost_ping", GPS_LOST_PING);
-    // Close the Preferences
-    p.end();
-  } else {
-    Serial.println("No Mapper prefs -- using defaults.");
-    min_dist_moved = MIN_DIST;
-    stationary_tx_interval_s = STATIONARY_TX_INTERVAL;
-    never_rest = NEVER_REST;
-    rest_wait_s = REST_WAIT;
-    rest_tx_interval_s = REST_TX_INTERVAL;
-    sleep_wait_s = SLEEP_WAIT;
-    sleep_tx_interval_s = SLEEP_TX_INTERVAL;
-    gps_lost_wait_s = GPS_LOST_WAIT;
-    gps_lost_ping_s = GPS_LOST_PING;
-  }
+/*
+ * Telemetry, status and GPS lost uplinks, all optional.  Telemetry rides
+ * along on the next uplink once TELEMETRY_INTERVAL has passed, and is only
+ * sent alone when nothing carried it for twice as long.  Its counters and
+ * timestamps use the RTC clock and memory, so they run on through deep sleep
+ * and only start over on a reset.
+ */
+RTC_DATA_ATTR uint32_t telemetry_epoch_s = 0;  // RTC clock at reset
+RTC_DATA_ATTR uint32_t telemetry_last_s = 0;   // RTC clock when last sent
+RTC_DATA_ATTR uint32_t telemetry_frames = 0;
+RTC_DATA_ATTR uint32_t telemetry_airtime_ms = 0;
+bool telemetry_in_frame = false;  // telemetry_build() put it in the frame send_uplink() gets next
+uint8_t status_pending = 0;  // STATUS_* waiting for the radio, 0 for none
+uint8_t status_pending_value = 0;
+uint32_t last_status_ms = 0;
+
+uint32_t rtc_seconds(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec;
+}
 
-  tx_interval_s = stationary_tx_interval_s;
+void telemetry_begin(void) {
+  if (bootCount > 1)
+    return;  // Woke from sleep, carry on counting
+  telemetry_epoch_s = rtc_seconds();
+  telemetry_last_s = telemetry_epoch_s - TELEMETRY_INTERVAL;  // First uplink carries it, with the reset reason
+  telemetry_frames = 0;
+  telemetry_airtime_ms = 0;
+}
+
+uint32_t telemetry_cap(uint32_t value, uint32_t max) {
+  return value < max ? value : max;
+}
+
+uint8_t telemetry_build(uint8_t *buf) {
+  struct codec_telemetry t;
+  t.battery = battery_byte();
+  t.uptime = telemetry_cap((rtc_seconds() - telemetry_epoch_s) / 60, 65535);
+  t.airtime = telemetry_cap(telemetry_airtime_ms / 1000, 16383);
+  t.frames = telemetry_cap(telemetry_frames, 32767);
+  t.ack_ratio = ack_req ? telemetry_cap(ack_rx * 100 / ack_req, 100) : 127;
+  t.reset_reason = esp_reset_reason() & 0x0F;
+  telemetry_in_frame = true;
+  return codec_encode_telemetry(buf, &t);
+}
+
+/** From send_uplink(): the interval starts over only once a frame with telemetry in it is on its way */
+void telemetry_sent(bool sent) {
+  if (telemetry_in_frame && sent)
+    telemetry_last_s = rtc_seconds();
+  telemetry_in_frame = false;
+}
+
+/** Appends telemetry to a frame of this length if it is due, returns the new length */
+uint8_t telemetry_append(uint8_t *buf, uint8_t length) {
+  if (!SEND_TELEMETRY || rtc_seconds() - telemetry_last_s < TELEMETRY_INTERVAL)
+    return length;
+  return length + telemetry_build(buf + length);
+}
+
+/** Queue a status message, sent by status_loop() when the radio is free */
+void status_uplink(uint8_t status, uint8_t value) {
+  if (!SEND_STATUS_UPLINKS)
+    return;
+  status_pending = status;
+  status_pending_value = value;
 }
 
-void mapper_save_prefs(void) {
-  Preferences p;
+void status_loop(uint32_t now) {
+  if (!status_pending || !isJoined || radio_busy() ||
+      (last_status_ms && now - last_status_ms < STATUS_MIN_INTERVAL * 1000))
+    return;
 
-  Serial.println("Saving mapper prefs.");
-  if (p.begin("mapper", false)) {
-    p.putFloat("min_dist", min_dist_moved);
-    p.putUInt("tx_interval", stationary_tx_interval_s);
-    p.putBool("never_rest", never_rest);
-    p.putUInt("rest_wait", rest_wait_s);
-    p.putUInt("rest_tx", rest_tx_interval_s);
-    p.putUInt("sleep_wait", sleep_wait_s);
-    p.putUInt("sleep_tx", sleep_tx_interval_s);
-    p.putUInt("gps_lost_wait", gps_lost_wait_s);
-    p.putUInt("gps_lost_ping", gps_lost_ping_s);
-    p.end();
+  struct codec_status m;
+  m.last_latitude = codec_status_last_latitude_from(tGPS.location.lat());
+  m.last_longitude = codec_status_last_longitude_from(tGPS.location.lng());
+  m.battery = battery_byte();
+  m.status = status_pending;
+  m.value = status_pending_value;
+  uint8_t length = telemetry_append(txBuffer, codec_encode_status(txBuffer, &m));
+  if (send_uplink(txBuffer, length, CODEC_STATUS_PORT, false)) {
+    status_pending = 0;
+    last_status_ms = now;
   }
 }
 
-void mapper_erase_prefs(void) {
-#if 0
-    nvs_flash_erase(); // erase the NVS partition and...
-    nvs_flash_init(); // initialize the NVS partition.
-#endif
-  Preferences p;
-  if (p.begin("mapper", false)) {
-    p.clear();
-    p.end();
+/** While the GPS is lost, say so every gps_lost_ping_s instead of going quiet */
+void gpslost_loop(uint32_t now) {
+  if (!SEND_GPSLOST_UPLINKS || active_state != ACTIVITY_GPS_LOST || !isJoined || radio_busy() ||
+      (last_gpslost_ms && now - last_gpslost_ms < gps_lost_ping_s * 1000))
+    return;
+
+  struct codec_gps_lost m;
+  m.last_latitude = codec_gps_lost_last_latitude_from(tGPS.location.lat());
+  m.last_longitude = codec_gps_lost_last_longitude_from(tGPS.location.lng());
+  m.battery = battery_byte();
+  m.sats = tGPS.satellites.value();
+  m.minutes = last_fix_time ? telemetry_cap((now - last_fix_time) / 60000, 65535) : 65535;
+  uint8_t length = telemetry_append(txBuffer, codec_encode_gps_lost(txBuffer, &m));
+  if (send_uplink(txBuffer, length, CODEC_GPS_LOST_PORT, false)) {
+    Serial.println("** GPS LOST");
+    last_gpslost_ms = now;
   }
 }
 
+/** Telemetry on its own, when no other uplink has carried it for too long */
+void telemetry_loop(void) {
+  if (!SEND_TELEMETRY || !isJoined || radio_busy() || rtc_seconds() - telemetry_last_s < 2 * TELEMETRY_INTERVAL)
+    return;
+  uint8_t length = telemetry_build(txBuffer);
+  send_uplink(txBuffer, length, CODEC_TELEMETRY_PORT, false);
+}
+
+// Buffers the LoRaWAN session is copied through, on its way to and from flash
+uint8_t lorawan_nonces[RADIOLIB_LORAWAN_NONCES_BUF_SIZE];
+uint8_t lorawan_session[RADIOLIB_LORAWAN_SESSION_BUF_SIZE];
+
+// Everything kept in flash, see settings.h
+struct setting settings[] = {
+    SETTING("mapper", "min_dist", SETTING_BLOB, min_dist_moved),
+    SETTING("mapper", "tx_interval", SETTING_U32, stationary_tx_interval_s),
+    SETTING("mapper", "never_rest", SETTING_U8, never_rest),
+    SETTING("mapper", "rest_wait", SETTING_U32, rest_wait_s),
+    SETTING("mapper", "rest_tx", SETTING_U32, rest_tx_interval_s),
+    SETTING("mapper", "sleep_wait", SETTING_U32, sleep_wait_s),
+    SETTING("mapper", "sleep_tx", SETTING_U32, sleep_tx_interval_s),
+    SETTING("mapper", "gps_lost_wait", SETTING_U32, gps_lost_wait_s),
+    SETTING("mapper", "gps_lost_ping", SETTING_U32, gps_lost_ping_s),
+    SETTING("mapper", "batt_low", SETTING_BLOB, battery_low_voltage),
+    SETTING("mapper", "shift_h", SETTING_U8, battery_shift_h),
+    SETTING("lora", "ack", SETTING_U8, lorawanAck),
+    SETTING("lora", "sf", SETTING_U8, lorawan_sf),
+    SETTING("lora", "tx_power", SETTING_U8, lorawan_tx_power),
+    SETTING("lora", "nonces", SETTING_BLOB, lorawan_nonces),
+    SETTING("lora", "session", SETTING_BLOB, lorawan_session),
+    SETTING("deadzone", "lat", SETTING_BLOB, deadzone_lat),
+    SETTING("deadzone", "lon", SETTING_BLOB, deadzone_lon),
+    SETTING("deadzone", "radius", SETTING_U32, deadzone_radius_m),
+    SETTING("screen", "off_time", SETTING_I32, screen_idle_off_s),
+    SETTING("screen", "menu_timeout", SETTING_I32, screen_menu_timeout_s),
+};
+
+/*
+ * Copy of the LoRaWAN settings and session in RTC memory, which survives deep
+ * sleep and software resets (but not power loss).  When its checksum holds,
+ * boot resumes from it without reading flash; flash only gets the session
+ * again every LORAWAN_FCNT_CHECKPOINT uplinks, or when something else changed.
+ */
+#define LORAWAN_RTC_MAGIC (0x4C525443 ^ sizeof(struct lorawan_rtc))
+struct lorawan_rtc {
+  uint32_t magic;
+  uint8_t ack;
+  uint8_t sf;
+  uint8_t tx_power;
+  uint8_t nonces[RADIOLIB_LORAWAN_NONCES_BUF_SIZE];
+  uint8_t session[RADIOLIB_LORAWAN_SESSION_BUF_SIZE];
+  uint32_t fcnt_saved;  // Uplink counter in the session flash holds
+  bool shadow_found[5];  // The settings store's idea of flash, in lorawan_rtc_values order
+  uint32_t shadow_crc[5];
+  uint32_t crc;  // Of everything above
+};
+RTC_NOINIT_ATTR struct lorawan_rtc lorawan_rtc;
+const void *lorawan_rtc_values[] = {&lorawanAck, &lorawan_sf, &lorawan_tx_power, lorawan_nonces, lorawan_session};
+uint32_t lorawan_fcnt_saved = 0;
+
+uint32_t lorawan_rtc_crc(void) {
+  return crc32_le(0, (const uint8_t *)&lorawan_rtc, offsetof(struct lorawan_rtc, crc));
+}
+
+// Snapshot after anything that moves the session on, cheap enough for every uplink
+void lorawan_rtc_save(void) {
+  lorawan_rtc.magic = LORAWAN_RTC_MAGIC;
+  lorawan_rtc.ack = lorawanAck;
+  lorawan_rtc.sf = lorawan_sf;
+  lorawan_rtc.tx_power = lorawan_tx_power;
+  memcpy(lorawan_rtc.nonces, node.getBufferNonces(), RADIOLIB_LORAWAN_NONCES_BUF_SIZE);
+  memcpy(lorawan_rtc.session, node.getBufferSession(), RADIOLIB_LORAWAN_SESSION_BUF_SIZE);
+  lorawan_rtc.fcnt_saved = lorawan_fcnt_saved;
+  for (int i = 0; i < 5; i++)
+    lorawan_rtc.shadow_found[i] = settings_shadow(lorawan_rtc_values[i], &lorawan_rtc.shadow_crc[i]);
+  lorawan_rtc.crc = lorawan_rtc_crc();
+}
+
+void lorawan_rtc_invalidate(void) {
+  lorawan_rtc.magic = 0;
+}
+
+// True if the session was resumed from RTC memory, otherwise use lorawan_restore_prefs()
+bool lorawan_rtc_restore(void) {
+  if (lorawan_rtc.magic != LORAWAN_RTC_MAGIC || lorawan_rtc.crc != lorawan_rtc_crc()) {
+    Serial.println(F("No RTC session copy."));
+    return false;
+  }
+  if (node.setBufferNonces(lorawan_rtc.nonces) != RADIOLIB_ERR_NONE ||
+      node.setBufferSession(lorawan_rtc.session) != RADIOLIB_ERR_NONE) {
+    Serial.println(F("RTC session copy rejected."));
+    lorawan_rtc_invalidate();
+    return false;
+  }
+  lorawanAck = lorawan_rtc.ack;
+  lorawan_sf = lorawan_rtc.sf;
+  lorawan_tx_power = lorawan_rtc.tx_power;
+  memcpy(lorawan_nonces, lorawan_rtc.nonces, RADIOLIB_LORAWAN_NONCES_BUF_SIZE);
+  memcpy(lorawan_session, lorawan_rtc.session, RADIOLIB_LORAWAN_SESSION_BUF_SIZE);
+  lorawan_fcnt_saved = lorawan_rtc.fcnt_saved;
+  for (int i = 0; i < 5; i++)
+    settings_set_shadow(lorawan_rtc_values[i], lorawan_rtc.shadow_found[i], lorawan_rtc.shadow_crc[i]);
+  settings_load_writes("lora");  // Or the next commit counts the session writes from 0 again
+  Serial.println(F("Session resumed from RTC memory."));
+  return true;
+}
+
+// The restore functions set the build defaults, then load whatever flash has on top
+
+void mapper_restore_prefs(void) {
+  min_dist_moved = MIN_DIST;
+  stationary_tx_interval_s = STATIONARY_TX_INTERVAL;
+  never_rest = NEVER_REST;
+  rest_wait_s = REST_WAIT;
+  rest_tx_interval_s = REST_TX_INTERVAL;
+  sleep_wait_s = SLEEP_WAIT;
+  sleep_tx_interval_s = SLEEP_TX_INTERVAL;
+  gps_lost_wait_s = GPS_LOST_WAIT;
+  gps_lost_ping_s = GPS_LOST_PING;
+  battery_low_voltage = BATTERY_LOW_VOLTAGE;
+  battery_shift_h = BATTERY_SHIFT_HOURS;
+  if (!settings_load("mapper"))
+    Serial.println("No Mapper prefs -- using defaults.");
+
+  tx_interval_s = stationary_tx_interval_s;
+}
+
+void mapper_erase_prefs(void) {
+  settings_erase("mapper");
+}
+
 void lorawan_restore_prefs(void) {
-  Preferences p;
-  if (p.begin("lora", true)) {  // Read-only
-    lorawanAck = p.getUChar("ack", LORAWAN_CONFIRMED_EVERY);
-    lorawan_sf = p.getUChar("sf", LORAWAN_SF);
-    lorawan_tx_power = p.getUChar("tx_power", 16);
-    // a buffer that holds all LW base parameters that should persist at all times!
-    uint8_t BbufferNonces[RADIOLIB_LORAWAN_NONCES_BUF_SIZE];
-    p.getBytes("nonces", BbufferNonces, RADIOLIB_LORAWAN_NONCES_BUF_SIZE);
-    // a buffer that holds all LW session parameters that preferably persist, but can be afforded to get lost
-    uint8_t BbufferSession[RADIOLIB_LORAWAN_SESSION_BUF_SIZE];
-    p.getBytes("session", BbufferSession, RADIOLIB_LORAWAN_SESSION_BUF_SIZE);
-
-    uint32_t state;
-    state = node.setBufferNonces(BbufferNonces);
+  lorawanAck = LORAWAN_CONFIRMED_EVERY;
+  lorawan_sf = LORAWAN_SF;
+  lorawan_tx_power = 16;
+  if (!settings_load("lora")) {
+    Serial.println("No lorawan prefs -- using defaults.");
+    return;
+  }
+
+  uint32_t state;
+  if (settings_found(lorawan_nonces)) {
+    state = node.setBufferNonces(lorawan_nonces);
     if (state == RADIOLIB_ERR_NONE) {
       Serial.println(F("set nonces success!"));
     } else {
       Serial.print(F("set nonces failed, code "));
       Serial.println(state);
     }
+  }
 
-    state = node.setBufferSession(BbufferSession);
+  if (settings_found(lorawan_session)) {
+    state = node.setBufferSession(lorawan_session);
     if (state == RADIOLIB_ERR_NONE) {
       Serial.println(F("set session success!"));
     } else {
       Serial.print(F("set session failed, code "));
       Serial.println(state);
     }
-
-    /** Close the Preferences */
-    p.end();
-  } else {
-    Serial.println("No lorawan prefs -- using defaults.");
-    lorawanAck = LORAWAN_CONFIRMED_EVERY;
-    lorawan_sf = LORAWAN_SF;
   }
 }
 
+// Take a copy of the join counters (nonces) and session, then save whatever changed
 void lorawan_save_prefs(void) {
-  Preferences p;
-  Serial.println("Saving lorawan prefs.");
-  if (p.begin("lora", false)) {
-    p.putUChar("sf", lorawan_sf);
-    p.putUChar("ack", lorawanAck);
-    p.putUChar("tx_power", lorawan_tx_power);
-    // ##### save the join counters (nonces) to permanent store
-    Serial.println(F("Saving nonces to flash"));
-    uint8_t* noncesPtr = node.getBufferNonces();
-    p.putBytes("nonces", noncesPtr, RADIOLIB_LORAWAN_NONCES_BUF_SIZE);
-    uint8_t* sessionPtr  = node.getBufferSession();
-    p.putBytes("session", sessionPtr, RADIOLIB_LORAWAN_SESSION_BUF_SIZE);
-    p.end();
-  }
+  radio_wait();
+  memcpy(lorawan_nonces, node.getBufferNonces(), RADIOLIB_LORAWAN_NONCES_BUF_SIZE);
+  memcpy(lorawan_session, node.getBufferSession(), RADIOLIB_LORAWAN_SESSION_BUF_SIZE);
+  settings_commit();
+  lorawan_fcnt_saved = node.getFCntUp();
+  lorawan_rtc_save();
 }
 
 // Clear all saves surrounding the Lora setting
 void lorawan_erase_prefs(void) {
-  Preferences p;
+  radio_wait();
   node.clearSession();
-  if (p.begin("lora", false)) {
-    p.clear();
-    p.end();
-  }
+  settings_erase("lora");
+  lorawan_rtc_invalidate();
 }
 
 void deadzone_restore_prefs(void) {
-  Preferences p;
-  if (p.begin("deadzone", true)) {  // Read-only
-    deadzone_lat = p.getDouble("lat", DEADZONE_LAT);
-    deadzone_lon = p.getDouble("lon", DEADZONE_LON);
-    deadzone_radius_m = p.getUInt("radius", DEADZONE_RADIUS_M);
-    /** Close the Preferences */
-    p.end();
-  } else {
+  deadzone_lat = DEADZONE_LAT;
+  deadzone_lon = DEADZONE_LON;
+  deadzone_radius_m = DEADZONE_RADIUS_M;
+  if (!settings_load("deadzone"))
     Serial.println("No deadzone prefs -- using defaults.");
-    deadzone_lat = DEADZONE_LAT;
-    deadzone_lon = DEADZONE_LON;
-    deadzone_radius_m = DEADZONE_RADIUS_M;
-  }
 }
 
-void deadzone_save_prefs(void) {
-  Preferences p;
-  Serial.println("Saving deadzone prefs.");
-  if (p.begin("deadzone", false)) {
-    p.putDouble("lat", deadzone_lat);
-    p.putDouble("lon", deadzone_lon);
-    p.putUInt("radius", deadzone_radius_m);
-    p.end();
-  }
+void deadzone_erase_prefs(void) {
+  settings_erase("deadzone");
 }
 
-void deadzone_erase_prefs(void) {
-  Preferences p;
-  if (p.begin("deadzone", false)) {
-    p.clear();
-    p.end();
+/*
+ * Remote configuration by Downlink.  Every setting is a command from the
+ * schema (console-decoders/payload_schema.json), which holds its bounds.
+ * A frame is checked completely before any of it is applied, then the
+ * changed settings are saved in one go.
+ */
+void downlink_distance(int32_t v) {
+  min_dist_moved = v;
+}
+
+void downlink_time_interval(int32_t v) {
+  stationary_tx_interval_s = v;
+}
+
+void downlink_cutoff_volts(int32_t v) {
+  battery_low_voltage = 2.0 + v / 100.0;
+}
+
+void downlink_sf(int32_t v) {
+  lorawan_set_sf(v - 7);  // sf_list starts at SF7
+}
+
+void downlink_tx_power(int32_t v) {
+  lorawan_tx_power = v;
+  node.setTxPower(lorawan_tx_power);
+}
+
+void downlink_deadzone_lat(int32_t v) {
+  deadzone_lat = v / 1000000.0;
+}
+
+void downlink_deadzone_lon(int32_t v) {
+  deadzone_lon = v / 1000000.0;
+}
+
+void downlink_deadzone_radius(int32_t v) {
+  deadzone_radius_m = v;
+}
+
+struct downlink_handler {
+  uint8_t id;
+  void (*apply)(int32_t value);
+};
+
+struct downlink_handler downlink_handlers[] = {
+    {CODEC_CMD_DISTANCE, downlink_distance},
+    {CODEC_CMD_TIME_INTERVAL, downlink_time_interval},
+    {CODEC_CMD_CUTOFF_VOLTS, downlink_cutoff_volts},
+    {CODEC_CMD_SF, downlink_sf},
+    {CODEC_CMD_TX_POWER, downlink_tx_power},
+    {CODEC_CMD_DEADZONE_LAT, downlink_deadzone_lat},
+    {CODEC_CMD_DEADZONE_LON, downlink_deadzone_lon},
+    {CODEC_CMD_DEADZONE_RADIUS, downlink_deadzone_radius},
+};
+#define DOWNLINK_HANDLERS (sizeof(downlink_handlers) / sizeof(downlink_handlers[0]))
+
+// Value must already be bounds-checked
+void downlink_apply(uint8_t id, int32_t value) {
+  for (size_t i = 0; i < DOWNLINK_HANDLERS; i++) {
+    if (downlink_handlers[i].id == id) {
+      Serial.printf("Downlink %s = %ld\n", codec_command_find(id)->name, (long)value);
+      downlink_handlers[i].apply(value);
+    }
   }
 }
 
-void screen_restore_prefs(void) {
-  Preferences p;
-  if (p.begin("screen", true)) {  // Read-only
-    screen_idle_off_s = p.getInt("off_time", SCREEN_IDLE_OFF_S);
-    screen_menu_timeout_s = p.getInt("menu_timeout", MENU_TIMEOUT_S);
-    /** Close the Preferences */
-    p.end();
+void downlink_process(uint8_t fport, const uint8_t *buf, size_t len) {
+  uint8_t ids[RADIOLIB_LORAWAN_MAX_DOWNLINK_SIZE / 2];
+  int32_t values[RADIOLIB_LORAWAN_MAX_DOWNLINK_SIZE / 2];
+  size_t count = 0;
+
+  if (fport == CODEC_CONFIG_PORT) {
+    // The classic fixed frame: zero leaves a setting alone, time 0xFFFF goes back to the build default
+    struct codec_config c;
+    if (!codec_decode_config(buf, len, &c)) {
+      Serial.println("Config Downlink too short, ignored.");
+      return;
+    }
+    if (c.distance) {
+      ids[count] = CODEC_CMD_DISTANCE;
+      values[count++] = c.distance;
+    }
+    if (c.time_interval) {
+      // Checked and applied with the rest, so a frame rejected for another value changes nothing
+      static_assert(codec_command_valid(CODEC_CMD_TIME_INTERVAL, STATIONARY_TX_INTERVAL), "Default out of range");
+      ids[count] = CODEC_CMD_TIME_INTERVAL;
+      values[count++] = c.time_interval == 0xFFFF ? STATIONARY_TX_INTERVAL : c.time_interval;
+    }
+    if (c.cutoff_volts) {
+      ids[count] = CODEC_CMD_CUTOFF_VOLTS;
+      values[count++] = c.cutoff_volts;
+    }
+  } else if (fport == CODEC_COMMAND_PORT) {
+    size_t pos = 0;
+    while (pos < len) {
+      size_t used = codec_decode_command(buf + pos, len - pos, &ids[count], &values[count]);
+      if (!used) {
+        Serial.printf("Bad command at byte %u, Downlink ignored.\n", (unsigned)pos);
+        return;
+      }
+      pos += used;
+      count++;
+    }
   } else {
-    Serial.println("No screen prefs -- using defaults.");
-    screen_idle_off_s = SCREEN_IDLE_OFF_S;
-    screen_menu_timeout_s = MENU_TIMEOUT_S;
+    Serial.printf("No Downlink handler for FPort %d\n", fport);
+    return;
   }
-}
 
-void screen_save_prefs(void) {
-  Preferences p;
-  Serial.println("Saving screen prefs.");
-  if (p.begin("screen", false)) {
-    p.putInt("off_time", screen_idle_off_s);
-    p.putInt("menu_timeout", screen_menu_timeout_s);
-    p.end();
+  for (size_t i = 0; i < count; i++) {
+    if (!codec_command_valid(ids[i], values[i])) {
+      Serial.printf("Downlink %s = %ld out of range, ignored.\n", codec_command_find(ids[i])->name, (long)values[i]);
+      return;
+    }
   }
+
+  for (size_t i = 0; i < count; i++)
+    downlink_apply(ids[i], values[i]);
+  settings_commit();
+
+  snprintf(buffer, sizeof(buffer), "\nDownlink: %u set\n", (unsigned)count);
+  screen_print(buffer);
+}
+
+void screen_restore_prefs(void) {
+  screen_idle_off_s = SCREEN_IDLE_OFF_S;
+  screen_menu_timeout_s = MENU_TIMEOUT_S;
+  if (!settings_load("screen"))
+    Serial.println("No screen prefs -- using defaults.");
 }
 
 void screen_erase_prefs(void) {
-  Preferences p;
-  if (p.begin("screen", false)) {
-    p.clear();
-    p.end();
-  }
+  settings_erase("screen");
 }
 
+// Only the addresses this board can have, a full 127-address scan costs boot time
 void scanI2CDevice(void) {
-  byte err, addr;
-  int nDevices = 0;
-  for (addr = 1; addr < 0x7F; addr++) {
-    Wire.beginTransmission(addr);
-    err = Wire.endTransmission();
-    if (err == 0) {
-      // Serial.printf("I2C device found at address 0x%X !\r\n", addr);
-      nDevices++;
-      if (addr == 0x3C || addr == 0x78 || addr == 0x7E) {
-        oled_addr = addr;
-        oled_found = true;
-        Serial.printf("OLED at 0x%02X\r\n", oled_addr);
-      }
-      if (addr == AXP2101_SLAVE_ADDRESS) {
-        pmu_found = true;
-        Serial.printf("AXP192/AXP2101 PMU at 0x%02X\r\n", addr);
-      }
-    } else if (err == 4) {
-      Serial.printf("Unknown i2c device at 0x%02X\r\n", addr);
+  const uint8_t oled_addrs[] = {0x3C, 0x78, 0x7E};
+
+  Wire.beginTransmission(AXP2101_SLAVE_ADDRESS);  // Same address for the AXP192
+  if (Wire.endTransmission() == 0) {
+    pmu_found = true;
+    Serial.printf("AXP192/AXP2101 PMU at 0x%02X\r\n", AXP2101_SLAVE_ADDRESS);
+  }
+  for (size_t i = 0; i < sizeof(oled_addrs); i++) {
+    Wire.beginTransmission(oled_addrs[i]);
+    if (Wire.endTransmission() == 0) {
+      oled_addr = oled_addrs[i];
+      oled_found = true;
+      Serial.printf("OLED at 0x%02X\r\n", oled_addr);
+      break;
     }
   }
-  if (nDevices == 0) {
+  if (!pmu_found && !oled_found) {
     Serial.println("No I2C devices found!\r\n");
   }
 }
@@ -815,6 +1221,11 @@ void axpInit() {
     // disable not use channel
     PMU->disablePowerOutput(XPOWERS_DCDC2);
 
+    // Battery current and the coulomb counter, for the state of charge
+    XPowersAXP192 *axp = static_cast<XPowersAXP192 *>(PMU);
+    axp->enableBattCurrentMeasure();
+    axp->enableCoulomb();
+
   } else if (PMU->getChipModel() == XPOWERS_AXP2101) {
     // Unuse power channel
     PMU->disablePowerOutput(XPOWERS_DCDC2);
@@ -854,19 +1265,17 @@ void axpInit() {
   PMU->setChargingLedMode(XPOWERS_CHG_LED_BLINK_4HZ);
   // PMU->setChargingLedMode(XPOWERS_CHG_LED_OFF);
 
-  // Fire an interrupt on falling edge.  Note that some IRQs repeat/persist.
-  pinMode(PMU_IRQ, INPUT);
-  gpio_pullup_en((gpio_num_t)PMU_IRQ);
-  attachInterrupt(PMU_IRQ, [] { pmu_irq = true; }, FALLING);
-
   // Configure REG 36H: PEK press key parameter set.  Index values for
   // argument!
   PMU->setPowerKeyPressOnTime(XPOWERS_POWERON_2S);
   PMU->setPowerKeyPressOffTime(XPOWERS_POWEROFF_4S);
 
-  have_usb_power = PMU->isVbusIn();
+  pmu_irq_begin(PMU, PMU_IRQ);
+  have_usb_power = pmu_irq_usb_power();
   Serial.printf("Battery Charge Level: %d%%\n", PMU->getBatteryPercent());
 
+#ifdef DEBUG
+  // Every rail, at the cost of some boot time
   Serial.printf("=========================================\n");
   if (PMU->isChannelAvailable(XPOWERS_DCDC1)) {
     Serial.printf("DC1  : %s   Voltage: %04u mV \n", PMU->isPowerChannelEnable(XPOWERS_DCDC1) ? "+" : "-",
@@ -921,6 +1330,7 @@ void axpInit() {
                   PMU->getPowerChannelVoltage(XPOWERS_BLDO2));
   }
   Serial.printf("=========================================\n");
+#endif
 
   // It is necessary to disable the detection function of the TS pin on the board
   // without the battery temperature detection function, otherwise it will cause abnormal charging
@@ -939,13 +1349,240 @@ void axpInit() {
                        XPOWERS_BATTERY_REMOVE_INT | XPOWERS_PWR_BTN_CLICK_INT | XPOWERS_CHARGE_START_INT |
                        XPOWERS_CHARGE_DONE_INT | XPOWERS_PWR_BTN_LONGPRESSED_INT);
 
-  // Clear all interrupt flags
-  PMU->clearIrqStatus();
+  // What woke us from deep sleep goes to its handler on the first loop(); anything older is cleared
+  if (wakeCause == ESP_SLEEP_WAKEUP_EXT1)
+    pmu_irq_wake();
+  else
+    PMU->clearIrqStatus();
 }
 
 /**
  * Perform power on init that we do on each wake from deep sleep
  */
+void mapper_state_restore(void);
+
+/*
+ * Join state machine, run from the loop so the GPS and screen carry on while
+ * out of coverage.  The first attempt resumes the stored session without any
+ * radio traffic; after that each attempt is a Join Request, with a jittered,
+ * doubling wait in between and a slower SF every two failures.  The attempt
+ * count and time spent joining survive deep sleep, so the duty cycle and SF
+ * stepping carry on across wakes.
+ */
+enum join_state { JOIN_RESUME, JOIN_WAIT, JOIN_BUSY, JOIN_DONE };
+enum join_state join_state = JOIN_RESUME;
+uint32_t join_next_ms = 0;
+bool lorawan_fast_resume = false;  // Session came from RTC memory
+RTC_DATA_ATTR uint16_t join_attempts = 0;
+RTC_DATA_ATTR uint32_t join_elapsed_s = 0;  // Awake time from the first Join Request to the latest
+
+void lorawan_join_begin(void) {
+  Serial.print(F("[LoRaWAN] Resuming previous session ... "));
+  node.beginOTAA(joinEUI, devEUI, nwkKey, appKey);
+
+  lorawan_fast_resume = lorawan_rtc_restore();
+  if (!lorawan_fast_resume)
+    lorawan_restore_prefs();
+  lora_msg_callback(EV_JOINING);
+
+  // Find the correct index and name for the loaded SF to display on screen
+  bool sf_found = false;
+  for (int i = 0; i < SF_ENTRIES; i++) {
+    if (sf_list[i] == lorawan_sf) {
+        sf_index = i;
+        strncpy(sf_name, sf_names[i], sizeof(sf_name));
+        sf_found = true;
+        break;
+    }
+  }
+  // Fallback to default if saved SF is not in our list
+  if (!sf_found) {
+    sf_index = 0; // Default to SF7
+    strncpy(sf_name, sf_names[sf_index], sizeof(sf_name));
+  }
+
+  join_state = JOIN_RESUME;
+  join_next_ms = millis();
+}
+
+/** Try now, i.e. on a button press, rather than wait out the backoff */
+void lorawan_join_now(void) {
+  if (join_state == JOIN_WAIT)
+    join_next_ms = millis();
+}
+
+/** Seconds to the next Join Request: jittered exponential, but no less than the duty cycle allows */
+uint32_t lorawan_join_backoff(uint32_t toa_ms) {
+  uint32_t backoff = LORAWAN_JOIN_BACKOFF_MIN;
+  for (uint16_t i = 1; i < join_attempts && backoff < LORAWAN_JOIN_BACKOFF_MAX; i++)
+    backoff *= 2;
+  if (backoff > LORAWAN_JOIN_BACKOFF_MAX)
+    backoff = LORAWAN_JOIN_BACKOFF_MAX;
+  backoff = backoff / 2 + random(backoff / 2 + 1);
+
+  uint32_t duty = join_elapsed_s < 60 * 60 ? 100 : join_elapsed_s < 11 * 60 * 60 ? 1000 : 10000;
+  uint32_t min_s = (toa_ms * duty + 999) / 1000;
+  return backoff < min_s ? min_s : backoff;
+}
+
+/** Join SF for this attempt: the configured one first, one slower every two failures */
+uint8_t lorawan_join_dr(void) {
+  size_t index = sf_index + join_attempts / 2;
+  return sf_list[index < SF_ENTRIES ? index : SF_ENTRIES - 1];
+}
+
+void lorawan_joined(int16_t state) {
+  join_state = JOIN_DONE;
+  join_attempts = 0;
+  join_elapsed_s = 0;
+  node.setADR(false);
+
+  // Print the DevAddr
+  Serial.print("[LoRaWAN] DevAddr: ");
+  Serial.println((unsigned long)node.getDevAddr(), HEX);
+  char devAddrBuffer[30];
+  lora_msg_callback(EV_JOINED);
+  snprintf(devAddrBuffer, sizeof(devAddrBuffer), "DevAddr: %08lX\n", (unsigned long)node.getDevAddr());
+  screen_print(devAddrBuffer);
+
+  // Back to the configured SF, the Join may have stepped it down
+  Serial.printf("Setting initial SF from preferences: DR%d\n", lorawan_datarate());
+  node.setDatarate(lorawan_datarate());
+
+  // Set TX Power from preferences
+  node.setTxPower(lorawan_tx_power);
+
+  // Flash only needs the session when it did not come from RTC memory, or is new
+  if (!lorawan_fast_resume || state == RADIOLIB_LORAWAN_NEW_SESSION)
+    lorawan_save_prefs();
+  else
+    lorawan_rtc_save();
+  boot_mark(lorawan_fast_resume ? "lorawan (RTC)" : "lorawan (flash)");
+}
+
+void lorawan_join_loop(uint32_t now) {
+  if (join_state == JOIN_DONE || join_state == JOIN_BUSY || (int32_t)(now - join_next_ms) < 0 || radio_busy())
+    return;
+
+  int16_t state;
+  if (join_state == JOIN_RESUME) {
+    join_state = JOIN_WAIT;
+    if (node.isActivated()) {  // A session was restored, no radio traffic needed
+      state = node.activateOTAA();
+      if (state == RADIOLIB_ERR_NONE || state == RADIOLIB_LORAWAN_SESSION_RESTORED) {
+        Serial.println(F("success!"));
+        lorawan_joined(state);
+        return;
+      }
+      Serial.print(F("Restore failed, code "));
+      Serial.println(state);
+      node.beginOTAA(joinEUI, devEUI, nwkKey, appKey);
+    } else {
+      Serial.println(F("no session."));
+    }
+  }
+
+  struct radio_request req;
+  req.op = RADIO_JOIN;
+  req.dr = lorawan_join_dr();
+  Serial.printf("[LoRaWAN] Attempting over-the-air activation #%u at DR%u ... ", join_attempts + 1, req.dr);
+  static uint32_t last_join_ms = now;
+  join_elapsed_s += (now - last_join_ms) / 1000;
+  last_join_ms = now;
+  if (radio_post(&req))
+    join_state = JOIN_BUSY;
+}
+
+/** The radio task is back from a Join Request */
+void lorawan_join_done(const struct radio_result *res) {
+  int16_t state = res->state;
+  if (state == RADIOLIB_LORAWAN_NEW_SESSION) {
+    Serial.println(F("success in OTAA activation!"));
+    lorawan_joined(state);
+    return;
+  }
+
+  Serial.print(F("Activation failed, code "));
+  Serial.println(state);
+  lora_msg_callback(EV_JOIN_FAILED);
+  lorawan_save_prefs();  // Every Join Request uses up a DevNonce, which must never repeat
+  join_attempts++;
+  uint32_t wait_s = lorawan_join_backoff(res->toa_ms);
+  join_next_ms = millis() + wait_s * 1000;
+  join_state = JOIN_WAIT;
+
+  // Check for the specific -1116 error (No JoinAccept received): out of range, or wrong keys
+  const char *why = state == RADIOLIB_ERR_NO_JOIN_ACCEPT ? "No JoinAccept" : "Join failed";
+  snprintf(buffer, sizeof(buffer), "\n%s, retry %lus", why, (unsigned long)wait_s);
+  screen_print(buffer);
+}
+
+/** Hands whatever the radio task finished to its owner */
+void radio_loop(void) {
+  static struct radio_result res;
+  while (spsc_pop(&radio_result_queue, &res)) {
+    if (res.op == RADIO_UPLINK)
+      uplink_done(&res);
+    else
+      lorawan_join_done(&res);
+  }
+}
+
+/**
+ * Replace the session before the frame counter reaches MAX_FCOUNT, by
+ * joining again in place.  Nothing else is reset: mapper state, settings and
+ * the DevNonce carry on.  From LORAWAN_FCNT_RENEW on it waits for a quiet
+ * moment, parked or without GPS, so a drive is not cut short; at MAX_FCOUNT
+ * it goes ahead regardless.
+ */
+bool link_lost = false;  // The link probes gave up on this session
+
+/** Act on what link.h makes of a confirmed uplink */
+void link_update(bool acked, int16_t margin) {
+  // The demodulation floor is -7.5dB at SF7, and 2.5dB lower for each slower SF
+  float snr_margin = acked ? radio.getSNR() + 7.5f + 2.5f * lorawan_sf_index() : 0;
+  switch (link_result(acked, margin, snr_margin, SF_ENTRIES - 1 - sf_index)) {
+    case LINK_SF_SLOWER:
+    case LINK_SF_FASTER:
+      node.setDatarate(lorawan_datarate());
+      Serial.printf("Link: %u%% loss, now %s\n", link_loss_percent(), sf_names[lorawan_sf_index()]);
+      snprintf(buffer, sizeof(buffer), "\nLink: %s", sf_names[lorawan_sf_index()]);
+      screen_print(buffer);
+      break;
+    case LINK_REJOIN:
+      Serial.println("Link: lost at the slowest SF");
+      link_lost = true;  // lorawan_renew_check() joins again
+      break;
+    case LINK_KEEP:
+      break;
+  }
+}
+
+void lorawan_renew_check(void) {
+  if (join_state != JOIN_DONE || in_menu || radio_busy())
+    return;
+  uint32_t fcnt = node.getFCntUp();
+  bool quiet = active_state == ACTIVITY_REST || active_state == ACTIVITY_GPS_LOST;
+  if (!link_lost && fcnt <= MAX_FCOUNT && (fcnt < LORAWAN_FCNT_RENEW || !quiet))
+    return;
+
+  if (link_lost) {
+    screen_print("\nLink lost, joining");
+    link_lost = false;
+  } else {
+    Serial.printf("FCount %lu, renewing the session.\n", (unsigned long)fcnt);
+    screen_print("\nRenewing session");
+  }
+  node.clearSession();
+  lorawan_save_prefs();  // A power loss from here on joins too, rather than resume the old session
+  lora_msg_callback(EV_RESET);
+  lora_msg_callback(EV_JOINING);
+  join_attempts = 0;
+  join_elapsed_s = 0;
+  join_state = JOIN_WAIT;
+  join_next_ms = millis();
+}
+
 void wakeup() {
   bootCount++;
   wakeCause = esp_sleep_get_wakeup_cause();
@@ -959,6 +1596,7 @@ void setup() {
   DEBUG_PORT.begin(SERIAL_BAUD);
 #endif
   wakeup();
+  boot_mark("serial");
 
   // Buttons & LED
   pinMode(MIDDLE_BUTTON_PIN, INPUT);
@@ -966,10 +1604,17 @@ void setup() {
   pinMode(RED_LED, OUTPUT);
   digitalWrite(RED_LED, LOW);  // Off
 
+  settings_begin(settings, sizeof(settings) / sizeof(settings[0]));
   mapper_restore_prefs();
   // lorawan_restore_prefs();
   deadzone_restore_prefs();
   screen_restore_prefs();
+  mapper_state_restore();
+  telemetry_begin();
+  link_begin(bootCount <= 1);
+  battery_begin(bootCount <= 1, rtc_seconds());
+  motion_begin(bootCount <= 1);
+  boot_mark("prefs");
 
   /** Make sure WiFi and BT are off */
   // WiFi.disconnect(true);
@@ -980,8 +1625,11 @@ void setup() {
   SPI.begin(SCK_GPIO, MISO_GPIO, MOSI_GPIO, NSS_GPIO);
 
   scanI2CDevice();
+  boot_mark("i2c");
 
   axpInit();
+  pmu_handlers_begin();
+  boot_mark("pmu");
 
   // GPS sometimes gets wedged with no satellites in view and only a power-cycle
   // saves it. Here we turn off power and the delay in screen setup is enough
@@ -1008,7 +1656,7 @@ void setup() {
   }
   is_screen_on = true;
 
-  /** GPS power on, so it has time to settle. */
+  /** GPS power on, then bring it up on the other core while we get the radio going. */
   if (PMU) {
     if (PMU->getChipModel() == XPOWERS_AXP192) {
       PMU->enablePowerOutput(XPOWERS_LDO3);
@@ -1016,136 +1664,121 @@ void setup() {
       PMU->enablePowerOutput(XPOWERS_ALDO3);
     }
   }
+  gps_setup_async(bootCount <= 1);  // Init GPS baudrate, and the messages on first boot (kept in its BBR)
+  boot_mark("screen, gps power");
 
-  /** Show logo on first boot (as opposed to wake) */
+  /** Show logo on first boot (as opposed to wake), the loop leaves it up for LOGO_DELAY */
   if (bootCount <= 1) {
     screen_print(APP_NAME " " APP_VERSION, 0, 0);  // Above the Logo
     // screen_print(APP_NAME " " APP_VERSION "\n");   // Add it to the log too
 
     screen_update();
-    delay(LOGO_DELAY);
+    logo_until_ms = millis() + LOGO_DELAY;
   }
 
   // LoRaWan setup
   int16_t state = 0;  // return value for calls to RadioLib
   state = radio.begin();
   debug(state != RADIOLIB_ERR_NONE, F("Initialise radio failed"), state, true);
+  boot_mark("radio");
 
-  Serial.print(F("[LoRaWAN] Resuming previous session ... "));
-
-  node.beginOTAA(joinEUI, devEUI, nwkKey, appKey);
-
-  lorawan_restore_prefs();
-  lora_msg_callback(EV_JOINING);
-
-  state = node.activateOTAA();
-
-  if ((state == RADIOLIB_ERR_NONE)||(state == RADIOLIB_LORAWAN_NEW_SESSION)||(state == RADIOLIB_LORAWAN_SESSION_RESTORED)) {
-    Serial.println(F("success!"));
-  } else {
-    Serial.print(F("Restore failed, code "));
-    Serial.println(state);
-    // while(true);
-    // node.wipe();
+  radio_task_begin();
+  lorawan_join_begin();  // The Join itself runs from the loop, see lorawan_join_loop()
 
-    Serial.print(F("[LoRaWAN] Attempting over-the-air activation ... "));
-    node.beginOTAA(joinEUI, devEUI, nwkKey, appKey);
-    state = node.activateOTAA();
-
-    node.setADR(false);
-
-    if (state == RADIOLIB_LORAWAN_NEW_SESSION) {
-      Serial.println(F("success in OTAA activation!"));
-    } else {
-      Serial.print(F("Activation failed, code "));
-      lora_msg_callback(EV_JOIN_FAILED);
-      Serial.println(state);
+  /** This is bad.. we can't find the AXP192 PMIC, so no menu key detect: */
+  if (!pmu_found) {
+    screen_print("** Missing AXP192! **\n");
+  }
 
-      // Check for the specific -1116 error (No JoinAccept received)
-      if (state == RADIOLIB_ERR_NO_JOIN_ACCEPT) { // This constant equals -1116
-          // Show a more descriptive error for this specific case
-          screen_print("No JoinAccept\nCheck Keys/Range\n\nPress middle button\nto retry.", 0, 20);
-      } else {
-          // Show the generic failure message for all other errors
-          screen_print("Join failed!\nPress middle button\nto retry.", 0, 20);
-      }
-      screen_update();
-
-      // Loop forever until the middle button is pressed to retry
-      while (true) {
-          if (!digitalRead(MIDDLE_BUTTON_PIN)) {
-              Serial.println("Middle button pressed. Retrying activation by restarting...");
-              screen_clear();
-              screen_update();
-              ESP.restart();
-          }
-          delay(50);
-      }
+  Serial.printf("Deadzone: %um @ %f, %f\n", deadzone_radius_m, deadzone_lat, deadzone_lon);
+  boot_mark("setup done");
+}
 
-        //while (true);
-    }
-  }
+/*
+ * The activity state machine across deep sleep.  RAM is lost and millis()
+ * starts over, so timestamps are kept as ages, and the time asleep comes from
+ * the RTC clock, which keeps running.
+ */
+struct mapper_state {
+  bool valid;
+  enum activity_state active_state;
+  double last_send_lat;
+  double last_send_lon;
+  uint32_t last_send_age_ms;  // Ages at sleep time, 0 for never
+  uint32_t last_moved_age_ms;
+  uint32_t last_fix_age_ms;
+  unsigned int tx_interval_s;
+  struct timeval slept_at;
+};
+RTC_DATA_ATTR struct mapper_state mapper_state;
 
-  // Print the DevAddr
-  Serial.print("[LoRaWAN] DevAddr: ");
-  Serial.println((unsigned long)node.getDevAddr(), HEX);
-  char devAddrBuffer[30];
-  lora_msg_callback(EV_JOINED);
-  snprintf(devAddrBuffer, sizeof(devAddrBuffer), "DevAddr: %08lX\n", (unsigned long)node.getDevAddr());
-  screen_print(devAddrBuffer);
-  screen_update();
+uint32_t mapper_state_age(uint32_t now, uint32_t then) {
+  return then ? now - then : 0;
+}
 
-  // Initialize SF based on preferences
-  Serial.printf("Setting initial SF from preferences: DR%d\n", lorawan_sf);
-  node.setDatarate(lorawan_sf);
+uint32_t mapper_state_since(uint32_t now, uint32_t age_ms, uint32_t slept_ms) {
+  return age_ms ? now - age_ms - slept_ms : 0;  // Wraps like millis() does
+}
 
-  // Find the correct index and name for the loaded SF to display on screen
-  bool sf_found = false;
-  for (int i = 0; i < SF_ENTRIES; i++) {
-    if (sf_list[i] == lorawan_sf) {
-        sf_index = i;
-        strncpy(sf_name, sf_names[i], sizeof(sf_name));
-        sf_found = true;
-        break;
-    }
-  }
-  // Fallback to default if saved SF is not in our list
-  if (!sf_found) {
-    sf_index = 0; // Default to SF7
-    strncpy(sf_name, sf_names[sf_index], sizeof(sf_name));
-  }
+void mapper_state_save(void) {
+  uint32_t now = millis();
 
-  // Set TX Power from preferences
-  node.setTxPower(lorawan_tx_power);
+  mapper_state.active_state = active_state;
+  mapper_state.last_send_lat = last_send_lat;
+  mapper_state.last_send_lon = last_send_lon;
+  mapper_state.last_send_age_ms = mapper_state_age(now, last_send_ms);
+  mapper_state.last_moved_age_ms = mapper_state_age(now, last_moved_ms);
+  mapper_state.last_fix_age_ms = mapper_state_age(now, last_fix_time);
+  mapper_state.tx_interval_s = tx_interval_s;
+  gettimeofday(&mapper_state.slept_at, NULL);
+  mapper_state.valid = true;
+}
 
-  // on EEPROM enabled boards, you can save the current session
-  // by calling "saveSession" which allows retrieving the session after reboot or deepsleep
-  // node.saveSession();
-  lorawan_save_prefs();
+// After the prefs are loaded: pick up where we went to sleep, if we did
+void mapper_state_restore(void) {
+  if (!mapper_state.valid)
+    return;
+  mapper_state.valid = false;  // Only once
+  if (wakeCause != ESP_SLEEP_WAKEUP_TIMER && wakeCause != ESP_SLEEP_WAKEUP_EXT0 && wakeCause != ESP_SLEEP_WAKEUP_EXT1)
+    return;
 
-  /**
-   * Might have to add a longer delay here for GPS boot-up.
-   * Takes longer to sync if we talk to it too early.
-   */
-  delay(100);
-  gps_setup(true);  // Init GPS baudrate and messages
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  uint32_t slept_ms =
+      (tv.tv_sec - mapper_state.slept_at.tv_sec) * 1000 + (tv.tv_usec - mapper_state.slept_at.tv_usec) / 1000;
+  uint32_t now = millis();
 
-  /** This is bad.. we can't find the AXP192 PMIC, so no menu key detect: */
-  if (!pmu_found) {
-    screen_print("** Missing AXP192! **\n");
+  last_send_lat = mapper_state.last_send_lat;
+  last_send_lon = mapper_state.last_send_lon;
+  last_send_ms = mapper_state_since(now, mapper_state.last_send_age_ms, slept_ms);
+  last_moved_ms = mapper_state_since(now, mapper_state.last_moved_age_ms, slept_ms);
+  last_fix_time = mapper_state_since(now, mapper_state.last_fix_age_ms, slept_ms);
+  tx_interval_s = mapper_state.tx_interval_s;
+  Serial.printf("Deep sleep of %lu s, was %d\n", (unsigned long)(slept_ms / 1000), mapper_state.active_state);
+
+  // Same as coming out of light sleep: look for a fix, then decide
+  active_state = ACTIVITY_WOKE;
+  woke_time_ms = now;
+  woke_fix_count = tGPS.sentencesWithFix();
+
+  // Try not to puke, but we pretend we moved if they hit a key, to exit SLEEP and restart timers
+  if (wakeCause != ESP_SLEEP_WAKEUP_TIMER) {
+    last_moved_ms = screen_last_active_ms = now;
+    Serial.println("(GPIO)");
   }
-
-  Serial.printf("Deadzone: %f.0m @ %f, %f\n", deadzone_radius_m, deadzone_lat, deadzone_lon);
 }
 
-// Should be around 0.5mA ESP32 consumption, plus OLED controller and PMIC overhead.
-void low_power_sleep(uint32_t seconds) {
-  boolean was_screen_on = is_screen_on;
+// Around 10uA for the ESP32, plus OLED controller and PMIC overhead.  Does not return.
+void deep_sleep(uint32_t seconds) {
+  Serial.printf("Deep sleep %d..\n", seconds);
 
-  Serial.printf("Sleep %d..\n", seconds);
-  Serial.flush();
+  radio_wait();  // Finish the uplink in flight, so RTC memory has its frame counter
+  radio_loop();
 
+  mapper_state_save();
+  lorawan_rtc_save();
   screen_off();
+  radio.sleep();
 
   digitalWrite(RED_LED, HIGH);  // LED Off
 
@@ -1159,52 +1792,14 @@ void low_power_sleep(uint32_t seconds) {
     }
     // axp.setPowerOutPut(AXP192_LDO3, AXP202_OFF);  // GPS power
     PMU->setChargingLedMode(XPOWERS_CHG_LED_OFF);  // Blue LED off
-
-    // Turning off DCDC1 consumes MORE power, for reasons unknown
-    // axp.setPowerOutPut(AXP192_DCDC1, AXP202_OFF);  // OLED power off
-    // pinMode(I2C_SCL, OUTPUT);
-    // digitalWrite(I2C_SCL, HIGH);                    // Must enable pull-up on SCL to keep AXP accessible
-  }
-
-  // Wake on either button press
-  gpio_wakeup_enable((gpio_num_t)MIDDLE_BUTTON_PIN, GPIO_INTR_LOW_LEVEL);
-  gpio_wakeup_enable((gpio_num_t)PMU_IRQ, GPIO_INTR_LOW_LEVEL);
-  esp_sleep_enable_gpio_wakeup();
-
-  esp_sleep_enable_timer_wakeup(seconds * 1000ULL * 1000ULL);  // call expects usecs
-  // Some GPIOs need this to stay on?
-  // esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
-
-  esp_light_sleep_start();
-  // If we woke by keypress (7) then turn on the screen
-  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO) {
-    // Try not to puke, but we pretend we moved if they hit a key, to exit SLEEP and restart timers
-    last_moved_ms = screen_last_active_ms = millis();
-    was_screen_on = true;  // Lies
-    Serial.println("(GPIO)");
-  }
-  Serial.println("..woke");
-
-  if (was_screen_on) {
-    screen_on();
-  }
-
-  if (pmu_found) {
-    if (PMU) {
-      if (PMU->getChipModel() == XPOWERS_AXP192) {
-        PMU->enablePowerOutput(XPOWERS_LDO3);
-      } else if (PMU->getChipModel() == XPOWERS_AXP2101) {
-        PMU->enablePowerOutput(XPOWERS_ALDO3);
-      }
-    }
-    // axp.setPowerOutPut(AXP192_LDO3, AXP202_ON);  // GPS power
-    // axp.setPowerOutPut(AXP192_DCDC1, AXP202_ON);  // OLED power
-    // if (oled_found)
-    //  screen_setup();
+    PMU->clearIrqStatus();                         // Or a pending IRQ wakes us right away
   }
+  Serial.flush();
 
-  delay(100);        // GPS doesn't respond right away.. not ready for baud-rate test.
-  gps_setup(false);  // Resync with GPS
+  // Wake on the middle button or a PMU interrupt (USB, power key), both active low
+  sleep_interrupt(MIDDLE_BUTTON_PIN, 0);
+  sleep_interrupt_mask(1ULL << PMU_IRQ, ESP_EXT1_WAKEUP_ALL_LOW);
+  sleep_seconds(seconds);
 }
 
 /** Power OFF -- does not return */
@@ -1212,10 +1807,7 @@ void clean_shutdown(void) {
   /** cleanly shutdown the radio */
   Serial.println("Shutdown.");
   // LMIC_shutdown();
-  mapper_save_prefs();
-  lorawan_save_prefs();
-  deadzone_save_prefs();
-  screen_save_prefs();
+  lorawan_save_prefs();  // Saves all the other settings too
   // ttn_write_prefs();
   if (pmu_found) {
     /** Surprisingly sticky if you don't set it */
@@ -1228,8 +1820,54 @@ void clean_shutdown(void) {
   }
 }
 
-uint32_t woke_time_ms = 0;
-uint32_t woke_fix_count = 0;
+
+/** Feeds the state of charge from the PMU, see battery.h */
+void battery_sample(void) {
+  struct battery_reading r = {rtc_seconds(), (uint16_t)PMU->getBattVoltage(), BATTERY_MA_UNKNOWN, NAN, -1,
+                              (uint16_t)(battery_low_voltage * 1000)};
+  if (PMU->getChipModel() == XPOWERS_AXP192) {
+    XPowersAXP192 *axp = static_cast<XPowersAXP192 *>(PMU);
+    r.ma = PMU->isCharging() ? axp->getBattChargeCurrent() : -axp->getBattDischargeCurrent();
+    r.mah = axp->getCoulombData();
+  } else if (PMU->getChipModel() == XPOWERS_AXP2101) {
+    r.gauge = PMU->getBatteryPercent();
+  }
+  // The shift runs from power on.  On USB power it does not matter.
+  battery_update(&r, have_usb_power ? 0 : battery_shift_h * 3600);
+
+  static float shown = 1.0f;
+  float stretch = battery_stretch();
+  if (fabsf(stretch - shown) >= 0.1f) {
+    shown = stretch;
+    uint32_t runtime = battery_runtime_s();
+    Serial.printf("Battery %u%%, %ld min left, cadence x%.1f\n", battery_soc_percent(),
+                  runtime == BATTERY_RUNTIME_UNKNOWN ? -1L : (long)(runtime / 60), stretch);
+  }
+}
+
+/** Feeds each new fix to the motion classifier, see motion.h.  A moving fix counts as moved. */
+void motion_sample(uint32_t now) {
+  static uint32_t last_time = 0;
+  if (!tGPS.location.isValid() || tGPS.time.value() == last_time)
+    return;  // GGA and RMC of the same fix count once
+  last_time = tGPS.time.value();
+
+  struct motion_fix fix = {now,
+                           gps_raw_e7(tGPS.location.rawLat()),
+                           gps_raw_e7(tGPS.location.rawLng()),
+                           tGPS.speed.isValid() && tGPS.speed.age() < 2000 ? (float)tGPS.speed.mps() : NAN,
+                           tGPS.hdop.isValid() ? (float)tGPS.hdop.hdop() : 99.9f,
+                           (uint8_t)tGPS.satellites.value(),
+                           0};
+  gps_hacc_dm(&fix.hacc_dm);
+
+  enum motion_state before = motion_now();
+  motion_update(&fix);
+  if (motion_moved())
+    last_moved_ms = now;
+  if (motion_now() != before)
+    Serial.println(motion_now() == MOTION_PARKED ? "Motion: parked" : "Motion: moving");
+}
 
 /** Determine the current activity state */
 void update_activity() {
@@ -1276,6 +1914,12 @@ void update_activity() {
     clean_shutdown();
   }
 
+  static uint32_t battery_sample_ms = 0;
+  if (pmu_found && PMU->isBatteryConnect() && (!battery_sample_ms || now - battery_sample_ms > 60 * 1000)) {
+    battery_sample_ms = now;
+    battery_sample();
+  }
+
   // Here we just woke from a GPS-off long sleep.
   // When we have a fresh GPS fix, and the fix qualifies for mapper report, we can resume
   // either mapping or going back to sleep.  Until then, we loop in Wake looking for a good GPS signal.
@@ -1291,11 +1935,7 @@ void update_activity() {
   }
 
   if (active_state == ACTIVITY_SLEEP && !in_menu) {
-    low_power_sleep(tx_interval_s);
-    active_state = ACTIVITY_WOKE;
-    woke_time_ms = millis();
-    woke_fix_count = tGPS.sentencesWithFix();
-    return;
+    deep_sleep(tx_interval_s);  // Comes back through setup() and mapper_state_restore()
   }
 
   // In order of precedence:
@@ -1305,7 +1945,7 @@ void update_activity() {
     active_state = ACTIVITY_SLEEP;
   } else if (last_fix_time == 0 || now - last_fix_time > gps_lost_wait_s * 1000) {
     active_state = ACTIVITY_GPS_LOST;
-  } else if (now - last_moved_ms > rest_wait_s * 1000) {
+  } else if (now - last_moved_ms > rest_wait_s * 1000 || motion_now() == MOTION_PARKED) {
     active_state = ACTIVITY_REST;
   } else {
     active_state = ACTIVITY_MOVING;
@@ -1336,6 +1976,8 @@ void update_activity() {
       tx_interval_s = stationary_tx_interval_s;
       break;
   }
+  // Longer when the battery would not last the shift
+  tx_interval_s = tx_interval_s * battery_stretch();
 
   // Has the screen been on for longer than idle time?
   if (now - screen_last_active_ms > screen_idle_off_s * 1000) {
@@ -1351,12 +1993,6 @@ void update_activity() {
   }
 }
 
-/** I must know what that interrupt was for! */
-const char *find_irq_name(void) {
-  const char *irq_name = "MysteryIRQ";
-  return irq_name;
-}
-
 struct menu_entry {
   const char *name;
   void (*func)(void);
@@ -1423,7 +2059,7 @@ void menu_deadzone_here(void) {
 }
 
 void menu_no_deadzone(void) {
-  deadzone_radius_m = 0.0;
+  deadzone_radius_m = 0;
 }
 
 void menu_stay_on(void) {
@@ -1437,14 +2073,7 @@ void menu_gps_reset(void) {
 
 void menu_change_sf(void)
 {
-    sf_index = (sf_index + 1) % SF_ENTRIES; // Cycle through the list
-    lorawan_sf = sf_list[sf_index]; // Get the data rate number
-
-    // Apply the new data rate to the LoRaWAN node
-    node.setDatarate(lorawan_sf);
-
-    // Update the name for display purposes
-    strncpy(sf_name, sf_names[sf_index], sizeof(sf_name));
+    lorawan_set_sf(sf_index + 1); // Cycle through the list
 
     Serial.printf("New SF set to: %s (DR%d)\n", sf_name, lorawan_sf);
     screen_print("\nSF set to ");
@@ -1454,7 +2083,8 @@ void menu_change_sf(void)
 void menu_power_plus(void) {
     if (lorawan_tx_power < MAX_TX_POWER) {
         lorawan_tx_power++;
-        node.setTxPower(lorawan_tx_power);
+        if (!radio_busy())
+            node.setTxPower(lorawan_tx_power);
         Serial.printf("Tx Power set to %d dBm\n", lorawan_tx_power);
     }
 }
@@ -1462,7 +2092,8 @@ void menu_power_plus(void) {
 void menu_power_minus(void) {
     if (lorawan_tx_power > MIN_TX_POWER) {
         lorawan_tx_power--;
-        node.setTxPower(lorawan_tx_power);
+        if (!radio_busy())
+            node.setTxPower(lorawan_tx_power);
         Serial.printf("Tx Power set to %d dBm\n", lorawan_tx_power);
     }
 }
@@ -1513,22 +2144,82 @@ void menu_selected(void) {
   menu[menu_entry].func();
 }
 
+void pmu_usb_on(const struct pmu_event *event) {
+  (void)event;
+  have_usb_power = true;
+  status_uplink(STATUS_USB_ON, 0);
+  screen_print("\nUSB ON");
+}
+
+void pmu_usb_off(const struct pmu_event *event) {
+  (void)event;
+  have_usb_power = false;
+  status_uplink(STATUS_USB_OFF, 0);
+  screen_print("\nUSB OFF");
+}
+
+/** Events that only need a line in the log */
+void pmu_show(const struct pmu_event *event) {
+  char buffer[24];
+  if (event->type == PMU_OTHER)
+    snprintf(buffer, sizeof(buffer), "\n* IRQ %llx", (unsigned long long)event->status);
+  else
+    snprintf(buffer, sizeof(buffer), "\n%s", pmu_event_name(event->type));
+  screen_print(buffer);
+}
+
+void pmu_key_short(const struct pmu_event *event) {
+  (void)event;
+  menu_press();
+}
+
+void pmu_key_long(const struct pmu_event *event) {  // want to turn OFF
+  (void)event;
+  menu_power_off();
+}
+
+void pmu_handlers_begin(void) {
+  pmu_irq_on(PMU_USB_ON, pmu_usb_on);
+  pmu_irq_on(PMU_USB_OFF, pmu_usb_off);
+  pmu_irq_on(PMU_BATTERY_IN, pmu_show);
+  pmu_irq_on(PMU_BATTERY_OUT, pmu_show);
+  pmu_irq_on(PMU_CHARGE_START, pmu_show);
+  pmu_irq_on(PMU_CHARGE_DONE, pmu_show);
+  pmu_irq_on(PMU_KEY_SHORT, pmu_key_short);
+  pmu_irq_on(PMU_KEY_LONG, pmu_key_long);
+  pmu_irq_on(PMU_OTHER, pmu_show);
+}
+
 void update_screen(void) {
-  screen_header(tx_interval_s, min_dist_moved, sf_name, lorawan_tx_power, in_deadzone, screen_stay_on, never_rest);
+  // The SF in use, slower than the configured sf_name when the link probes stepped it, and the distance as
+  // stretched where it is compared (tx_interval_s is stretched already)
+  screen_header(tx_interval_s, min_dist_moved * battery_stretch(), sf_names[lorawan_sf_index()], lorawan_tx_power,
+                in_deadzone, screen_stay_on, never_rest);
   screen_body(in_menu, menu_prev, menu_cur, menu_next, is_highlighted);
 }
 
 void loop() {
   static uint32_t last_fix_count = 0;
   static boolean booted = true;
+  static boolean gps_fail_shown = false;
   uint32_t now_fix_count;
   uint32_t now = millis();
+  PROFILE_SCOPE(PROF_LOOP);
 
-  gps_loop(0 /* active_state == ACTIVITY_WOKE */);  // Update GPS
+  {
+    PROFILE_SCOPE(PROF_GPS);
+    gps_loop(0 /* active_state == ACTIVITY_WOKE */);  // Update GPS
+  }
+  if (gps_failed() != gps_fail_shown) {
+    gps_fail_shown = gps_failed();
+    if (gps_fail_shown)
+      screen_print("\nGPS failed");
+  }
   now_fix_count = tGPS.sentencesWithFix();          // Did we get a new fix?
   if (now_fix_count != last_fix_count) {
     last_fix_count = now_fix_count;
     last_fix_time = now;  // Note the time of most recent fix
+    motion_sample(now);
   }
 
   // ttn_loop();
@@ -1538,47 +2229,18 @@ void loop() {
     in_menu = false;
 
   // update only every 250ms, or all the time when the in_menu is set
-  if (in_menu || (now - last_display_ms) > 250) {
+  if (now >= logo_until_ms && (in_menu || (now - last_display_ms) > 250)) {
+    PROFILE_SCOPE(PROF_SCREEN);
     update_screen();
     last_display_ms = now;
   }
 
-  // If any interrupts on PMIC, report the name
-  // PEK button handler
-  if (pmu_found && pmu_irq) {
-    const char *irq_name;
-    pmu_irq = false;
-    // uint32_t status = PMU->getIrqStatus();
-    PMU->getIrqStatus();
-
-    // Check for USB power events first
-    if (PMU->isVbusInsertIrq()) {
-        have_usb_power = true;
-        Serial.println("USB power connected.");
-        screen_print("\nUSB ON");
-    } else if (PMU->isVbusRemoveIrq()) {
-        have_usb_power = false;
-        Serial.println("USB power disconnected.");
-        screen_print("\nUSB OFF");
-    } else if (PMU->isBatChargeStartIrq()) {
-        Serial.println("Battery charge start.");
-        screen_print("\nCharge ON");
-    } else if (PMU->isBatChargeDoneIrq()) {
-        Serial.println("Battery charge done.");
-        screen_print("\nCharge DONE");
-    } else if (PMU->isPekeyShortPressIrq()) {
-      menu_press();
-    } else if (PMU->isPekeyLongPressIrq()) {  // want to turn OFF
-      menu_power_off();
-    } else {
-      irq_name = find_irq_name();
-      snprintf(buffer, sizeof(buffer), "\n* %s  ", irq_name);
-      screen_print(buffer);
-    }
-
-    // Clear PMU Interrupt Status Register
-    PMU->clearIrqStatus();
-    screen_last_active_ms = now;
+  // PMU events: USB power, charging, the power key.  Every pending one, not just the first.
+  if (pmu_found && pmu_irq_pending()) {
+    PROFILE_SCOPE(PROF_PMU_IRQ);
+    pmu_irq_poll();
+    if (pmu_irq_dispatch())
+      screen_last_active_ms = now;
   }
 
   // Middle Button handler
@@ -1594,7 +2256,10 @@ void loop() {
     // we just did a release
     if (in_menu)
       menu_selected();
-    else {
+    else if (!isJoined) {
+      screen_print("\nJoining now!");
+      lorawan_join_now();
+    } else {
       screen_print("\nSend now!");
       justSendNow = true;
     }
@@ -1609,14 +2274,42 @@ void loop() {
     screen_last_active_ms = now;
   }
 
-  update_activity();
+  {
+    PROFILE_SCOPE(PROF_ACTIVITY);
+    update_activity();
+  }
+
+  // Debug console: settings and tasks in every build, benchmarks and the profiler with ENABLE_PROFILER
+  while (Serial.available()) {
+    int c = Serial.read();
+    if (c == 's')
+      settings_dump();
+    else if (c == 't')
+      tasks_dump();
+#if ENABLE_PROFILER
+    else if (c == 'b')
+      bench_run();
+    else
+      profile_serial_command(c);
+#endif
+  }
 
   if (booted) {
-    // status_uplink(STATUS_BOOT, 0);
+    if (bootCount <= 1)
+      status_uplink(STATUS_BOOT, esp_reset_reason());  // Not for every wake from sleep
     booted = 0;
   }
 
-  if (mapper_uplink() == MAPPER_UPLINK_SUCCESS) {
+  radio_loop();
+  lorawan_renew_check();
+  lorawan_join_loop(now);
+
+  enum mapper_uplink_result uplink_result;
+  {
+    PROFILE_SCOPE(PROF_UPLINK);
+    uplink_result = mapper_uplink();
+  }
+  if (uplink_result == MAPPER_UPLINK_SUCCESS) {
     // Good send, light Blue LED
     if (pmu_found)
       PMU->setChargingLedMode(XPOWERS_CHG_LED_ON);
@@ -1624,4 +2317,8 @@ void loop() {
     // Nothing sent.
     // Do NOT delay() here.. the LoRa receiver and join housekeeping also needs to run!
   }
+  // Whatever the Mapper left the radio free for
+  status_loop(now);
+  gpslost_loop(now);
+  telemetry_loop();
 }
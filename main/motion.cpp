@@ -0,0 +1,151 @@
+/**
+ * Motion module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "motion.h"
+
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+
+#include "configuration.h"
+
+#define MOTION_WINDOW 10           // Fixes the position statistics average over
+#define MOTION_MIN_SATS 4          // Same gate as a Mapper uplink
+#define MOTION_MAX_HDOP 5.0f
+#define MOTION_GAP_MS 10000        // Longer without a good fix and the statistics start over
+#define MOTION_SCATTER_M 5.0f      // Scatter of a still receiver that gives no accuracy
+#define MOTION_MOVE_FIXES 3        // Moving fixes in a row
+#define MOTION_REBASE_M 1000.0f    // Keeps the local coordinates small enough for floats
+#define METERS_PER_E7 0.0111319f   // 1e-7 degree of latitude
+
+RTC_DATA_ATTR static struct {
+  enum motion_state state;
+  uint32_t last_ms;       // Of the last good fix
+  uint32_t still_ms;      // First of the still fixes in a row, 0 if the last one was not
+  uint8_t moving;         // Moving fixes in a row
+  bool moved;             // The last fix ended MOTION_MOVE_FIXES moving ones in a row
+  uint8_t fixes;          // In the statistics, up to MOTION_WINDOW
+  int32_t ref_lat_e7;     // Origin of the local coordinates
+  int32_t ref_lon_e7;
+  float lon_scale;        // Meters per 1e-7 degree of longitude there
+  float mean_x;           // Meters east and north of the origin
+  float mean_y;
+  float var;              // Of both axes together, square meters
+  int32_t park_lat_e7;    // Where it parked
+  int32_t park_lon_e7;
+} motion;
+
+void motion_begin(bool reset) {
+  if (reset) {
+    memset(&motion, 0, sizeof(motion));
+    motion.state = MOTION_UNKNOWN;
+  }
+  // millis() starts over after deep sleep, so the first fix counts as after a gap either way
+  motion.last_ms = 0;
+}
+
+static void motion_origin(int32_t lat_e7, int32_t lon_e7) {
+  motion.ref_lat_e7 = lat_e7;
+  motion.ref_lon_e7 = lon_e7;
+  motion.lon_scale = METERS_PER_E7 * cosf(lat_e7 * (float)(M_PI / 1e9 / 1.8));
+}
+
+enum motion_state motion_update(const struct motion_fix *fix) {
+  motion.moved = false;
+  if (fix->sats < MOTION_MIN_SATS || fix->hdop > MOTION_MAX_HDOP)
+    return motion.state;  // Not good enough to tell jitter from movement
+
+  if (!motion.last_ms || fix->ms - motion.last_ms > MOTION_GAP_MS) {
+    motion_origin(fix->lat_e7, fix->lon_e7);
+    motion.fixes = 0;
+    motion.still_ms = 0;
+    motion.moving = 0;
+  }
+  motion.last_ms = fix->ms;
+
+  float x = (fix->lon_e7 - motion.ref_lon_e7) * motion.lon_scale;
+  float y = (fix->lat_e7 - motion.ref_lat_e7) * METERS_PER_E7;
+  if (fabsf(x) > MOTION_REBASE_M || fabsf(y) > MOTION_REBASE_M) {
+    motion.mean_x -= x;
+    motion.mean_y -= y;
+    motion_origin(fix->lat_e7, fix->lon_e7);
+    x = y = 0.0f;
+  }
+
+  // Running mean and variance of the positions since the speed last said moving: exact until the window
+  // fills, exponentially weighted after
+  bool speed = !isnan(fix->speed_mps);
+  bool slow = !speed || fix->speed_mps < MOTION_STILL_MPS;
+  bool moving = speed && fix->speed_mps > MOTION_MOVE_MPS;
+  if (moving)
+    motion.fixes = 0;
+  if (!motion.fixes) {
+    motion.mean_x = x;
+    motion.mean_y = y;
+    motion.var = 0.0f;
+  } else {
+    float a = 1.0f / (motion.fixes < MOTION_WINDOW ? motion.fixes + 1 : MOTION_WINDOW);
+    float dx = x - motion.mean_x, dy = y - motion.mean_y;
+    motion.var = (1.0f - a) * (motion.var + a * (dx * dx + dy * dy));
+    motion.mean_x += a * dx;
+    motion.mean_y += a * dy;
+  }
+  if (motion.fixes < MOTION_WINDOW)
+    motion.fixes++;
+
+  float hacc_m = fix->hacc_dm / 10.0f;
+  float scatter_m = 2.0f * hacc_m > MOTION_SCATTER_M ? 2.0f * hacc_m : MOTION_SCATTER_M;
+  float away_m = 4.0f * hacc_m > MOTION_MOVE_M ? 4.0f * hacc_m : MOTION_MOVE_M;
+  bool still = slow && motion.fixes >= 3 && motion.var <= scatter_m * scatter_m;
+  if (motion.state == MOTION_PARKED && motion.fixes >= 3) {
+    // Creeping away slower than the speed shows.  By the mean, so scatter of single fixes does not count.
+    float px = motion.mean_x + (motion.ref_lon_e7 - motion.park_lon_e7) * motion.lon_scale;
+    float py = motion.mean_y + (motion.ref_lat_e7 - motion.park_lat_e7) * METERS_PER_E7;
+    moving |= px * px + py * py > away_m * away_m;
+  }
+
+  if (moving) {
+    motion.still_ms = 0;
+    if (motion.moving < UINT8_MAX)
+      motion.moving++;
+    if (motion.moving >= MOTION_MOVE_FIXES && motion.state != MOTION_MOVING)
+      motion.state = MOTION_MOVING;
+    motion.moved = motion.moving >= MOTION_MOVE_FIXES;
+  } else {
+    motion.moving = 0;
+    if (!still) {
+      motion.still_ms = 0;
+    } else if (!motion.still_ms) {
+      motion.still_ms = fix->ms | 1;
+    } else if (motion.state != MOTION_PARKED && fix->ms - motion.still_ms >= MOTION_PARK_S * 1000) {
+      motion.state = MOTION_PARKED;
+      motion.park_lat_e7 = motion.ref_lat_e7 + (int32_t)lroundf(motion.mean_y / METERS_PER_E7);
+      motion.park_lon_e7 = motion.ref_lon_e7 + (int32_t)lroundf(motion.mean_x / motion.lon_scale);
+    }
+  }
+  return motion.state;
+}
+
+enum motion_state motion_now(void) {
+  return motion.state;
+}
+
+bool motion_moved(void) {
+  return motion.moved;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+/**
+ * Parked or moving, from the stream of GPS fixes.
+ *
+ * Each fix good enough to judge by (satellites, HDOP) feeds a running mean
+ * and variance of the position over the last few fixes.  A fix looks still
+ * when the Doppler speed from RMC is below MOTION_STILL_MPS and the positions
+ * scatter no more than the receiver's own accuracy explains.  It looks moving
+ * when the speed is above MOTION_MOVE_MPS, or the mean position is more than
+ * MOTION_MOVE_M (or several times the accuracy) from where the Mapper parked,
+ * which catches a creep too slow for the speed.  Anything in between is
+ * neither.
+ *
+ * The state changes with hysteresis: to MOTION_PARKED after MOTION_PARK_S of
+ * nothing but still fixes, to MOTION_MOVING on a few moving fixes in a row,
+ * so jitter of a parked receiver does not count as movement and a single
+ * odd fix does not wake it.
+ *
+ * The state stays MOTION_MOVING through fixes that are too poor to judge or
+ * neither still nor moving, so what counts as movement for resting is
+ * motion_moved(): the last fix was itself a moving one, and as many before
+ * it in a row as it takes to become MOTION_MOVING.
+ *
+ * The state is in RTC memory, so a Mapper that parked before deep sleep
+ * wakes up parked and still knows where; motion_begin(true) starts over.
+ *
+ * Times are millis().
+ */
+
+#include <stdint.h>
+
+enum motion_state { MOTION_UNKNOWN, MOTION_MOVING, MOTION_PARKED };
+
+struct motion_fix {
+  uint32_t ms;
+  int32_t lat_e7;
+  int32_t lon_e7;
+  float speed_mps;   // RMC speed over ground, NAN if there is none
+  float hdop;
+  uint8_t sats;
+  uint16_t hacc_dm;  // GST horizontal accuracy, 0 if there is none
+};
+
+void motion_begin(bool reset);
+enum motion_state motion_update(const struct motion_fix *fix);
+enum motion_state motion_now(void);
+bool motion_moved(void);
@@ -0,0 +1,65 @@
+/**
+ * Payload module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ * Copyright (C) 2021-2022 by Max-Plastix
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "payload.h"
+
+#include "payload_codec.h"
+
+uint8_t pack_mapper(uint8_t *buf, double lat, double lon, int16_t alt_m, uint8_t sats) {
+  struct codec_mapper m = {codec_mapper_latitude_from(lat), codec_mapper_longitude_from(lon), alt_m, sats};
+  return codec_encode_mapper(buf, &m);
+}
+
+uint8_t pack_battery(uint16_t batt_mv) {
+  uint16_t batteryVoltage = (batt_mv + 5) / 10;
+  return (uint8_t)((batteryVoltage - 200) & 0xFF);
+}
+
+uint8_t pack_mapper_v2(uint8_t *buf, const struct mapper_fix *fix) {
+  struct codec_mapper_v2 m = {};
+
+  m.flags = fix->flags;
+  // Offset into unsigned range first, so the rounding divide is the same for both hemispheres
+  m.latitude = ((uint32_t)fix->lat_e7 + 900000000u + 5) / 10;
+  m.longitude = ((uint32_t)fix->lon_e7 + 1800000000u + 5) / 10;
+  m.altitude = fix->alt_m;
+  m.sats = fix->sats > 31 ? 31 : fix->sats;
+  uint16_t hacc = (fix->hacc_dm + 2) / 5;  // 0.5m steps
+  m.accuracy = hacc > 127 ? 127 : hacc;
+  m.speed = fix->speed_dms > 1023 ? 1023 : fix->speed_dms;
+  m.heading = fix->heading_deg % 360;
+  return codec_encode_mapper_v2(buf, &m);
+}
+
+bool unpack_mapper_v2(const uint8_t *buf, uint8_t len, struct mapper_fix *fix) {
+  struct codec_mapper_v2 m = {};
+
+  if (!codec_decode_mapper_v2(buf, len, &m))
+    return false;
+  fix->flags = m.flags;
+  fix->lat_e7 = (int32_t)(m.latitude * 10 - 900000000u);
+  fix->lon_e7 = (int32_t)(m.longitude * 10 - 1800000000u);
+  fix->alt_m = m.altitude;
+  fix->sats = m.sats;
+  fix->hacc_dm = m.accuracy * 5;
+  fix->speed_dms = m.speed;
+  fix->heading_deg = m.heading;
+  return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+/**
+ * Uplink payload packing.
+ *
+ * Pure functions with no Arduino or global state, so they can be timed by the
+ * on-device benchmark and compiled as-is in a native build.
+ */
+
+#include <stdint.h>
+
+/** Mapper payload v1 (FPORT_MAPPER): 24 bit Lat & Long, 16 bit altitude, 8 bit sats.  Returns the length. */
+uint8_t pack_mapper(uint8_t *buf, double lat, double lon, int16_t alt_m, uint8_t sats);
+
+/** Battery byte as sent on the status ports: 10mV steps above 2.00V */
+uint8_t pack_battery(uint16_t batt_mv);
+
+/**
+ * Mapper payload v2 (FPORT_MAPPER_V2), bit-packed as laid out in
+ * console-decoders/payload_schema.json:
+ *
+ *   version:3 flags:2 lat:28 lon:29 alt:16 sats:5 [hacc:7] [speed:10 heading:9]
+ *
+ * lat/lon are 1e-6 degree steps offset by +90/+180, alt is signed meters.
+ * hacc is in 0.5m steps (flag bit 0), speed in 0.1 m/s and heading in whole
+ * degrees (flag bit 1).  Absent optional fields take no space, so a frame is
+ * 11 to 14 bytes.
+ */
+#define PAYLOAD_V2_FLAG_HACC 0x01
+#define PAYLOAD_V2_FLAG_MOTION 0x02
+#define PAYLOAD_V2_MAX_LEN 14
+
+struct mapper_fix {
+  int32_t lat_e7;        // 1e-7 degrees, as the receiver reports it
+  int32_t lon_e7;        // 1e-7 degrees
+  int16_t alt_m;         // Meters above MSL
+  uint8_t sats;          // Satellites in use
+  uint8_t flags;         // PAYLOAD_V2_FLAG_* for the optional fields below
+  uint16_t hacc_dm;      // Horizontal accuracy, decimeters
+  uint16_t speed_dms;    // Ground speed, 0.1 m/s
+  uint16_t heading_deg;  // Course over ground, 0-359
+};
+
+/** Pack a fix as payload v2, returns the frame length */
+uint8_t pack_mapper_v2(uint8_t *buf, const struct mapper_fix *fix);
+
+/** Unpack a payload v2 frame, false if it is too short or not version 2 */
+bool unpack_mapper_v2(const uint8_t *buf, uint8_t len, struct mapper_fix *fix);
@@ -0,0 +1,657 @@
+// Generated by console-decoders/codec_gen.py from payload_schema.json -- do not edit
+#pragma once
+
+/**
+ * Payload codecs, header-only and allocation-free.
+ *
+ * Structs hold wire-level integers; codec_<field>_from() helpers convert
+ * engineering units with the same arithmetic the decoders use in reverse.
+ * Golden vectors from the schema are checked at compile time.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+constexpr void codec_put_bits(uint8_t *buf, size_t *pos, uint32_t value, uint8_t bits) {
+  while (bits) {
+    uint8_t room = 8 - (*pos & 7);  // Up to a byte at a time
+    uint8_t n = bits < room ? bits : room;
+    uint8_t mask = ((1u << n) - 1) << (room - n);
+    buf[*pos >> 3] = (buf[*pos >> 3] & ~mask) | (((value >> (bits - n)) << (room - n)) & mask);
+    bits -= n;
+    *pos += n;
+  }
+}
+
+constexpr uint32_t codec_get_bits(const uint8_t *buf, size_t *pos, uint8_t bits) {
+  uint32_t value = 0;
+  while (bits) {
+    uint8_t room = 8 - (*pos & 7);
+    uint8_t n = bits < room ? bits : room;
+    value = (value << n) | ((buf[*pos >> 3] >> (room - n)) & ((1u << n) - 1));
+    bits -= n;
+    *pos += n;
+  }
+  return value;
+}
+
+constexpr int32_t codec_sign_extend(uint32_t value, uint8_t bits) {
+  if (bits >= 32)
+    return (int32_t)value;
+  return (int32_t)(value ^ (1u << (bits - 1))) - (int32_t)(1u << (bits - 1));
+}
+
+/** Mapper! (Cargo and Heatmap too): 3 Lat, 3 Long, 2 Altitude (m), 1 Sats (uplink, FPort 2) */
+constexpr uint8_t CODEC_MAPPER_PORT = 2;
+constexpr size_t CODEC_MAPPER_MIN_LEN = 9;
+constexpr size_t CODEC_MAPPER_MAX_LEN = 9;
+
+struct codec_mapper {
+  uint32_t latitude;
+  uint32_t longitude;
+  int16_t altitude;
+  uint8_t sats;
+};
+
+constexpr uint32_t codec_mapper_latitude_from(double v) {
+  return (uint32_t)((v + 90.0) / 180.0 * 16777215.0);
+}
+
+constexpr uint32_t codec_mapper_longitude_from(double v) {
+  return (uint32_t)((v + 180.0) / 360.0 * 16777215.0);
+}
+
+/** Returns the frame length */
+constexpr size_t codec_encode_mapper(uint8_t *buf, const struct codec_mapper *m) {
+  size_t pos = 0;
+  codec_put_bits(buf, &pos, (uint32_t)m->latitude, 24);
+  codec_put_bits(buf, &pos, (uint32_t)m->longitude, 24);
+  codec_put_bits(buf, &pos, (uint32_t)m->altitude, 16);
+  codec_put_bits(buf, &pos, (uint32_t)m->sats, 8);
+  codec_put_bits(buf, &pos, 0, (8 - (pos & 7)) & 7);
+  return pos >> 3;
+}
+
+/** False if the frame is truncated or of another version */
+constexpr bool codec_decode_mapper(const uint8_t *buf, size_t len, struct codec_mapper *m) {
+  size_t pos = 0;
+  if (pos + 24 > len * 8)
+    return false;
+  m->latitude = codec_get_bits(buf, &pos, 24);
+  if (pos + 24 > len * 8)
+    return false;
+  m->longitude = codec_get_bits(buf, &pos, 24);
+  if (pos + 16 > len * 8)
+    return false;
+  m->altitude = codec_sign_extend(codec_get_bits(buf, &pos, 16), 16);
+  if (pos + 8 > len * 8)
+    return false;
+  m->sats = codec_get_bits(buf, &pos, 8);
+  return true;
+}
+
+/** Mapper payload v2: 1e-6 degree position, optional accuracy, speed and heading (uplink, FPort 3) */
+constexpr uint8_t CODEC_MAPPER_V2_PORT = 3;
+constexpr size_t CODEC_MAPPER_V2_MIN_LEN = 11;
+constexpr size_t CODEC_MAPPER_V2_MAX_LEN = 14;
+
+struct codec_mapper_v2 {
+  uint8_t flags;
+  uint32_t latitude;
+  uint32_t longitude;
+  int16_t altitude;
+  uint8_t sats;
+  uint8_t accuracy;     // Meters, in 0.5m steps
+  uint16_t speed;       // km/h, sent as 0.1 m/s
+  uint16_t heading;
+};
+
+constexpr uint32_t codec_mapper_v2_latitude_from(double v) {
+  return (uint32_t)((v + 90.0) * 1000000.0);
+}
+
+constexpr uint32_t codec_mapper_v2_longitude_from(double v) {
+  return (uint32_t)((v + 180.0) * 1000000.0);
+}
+
+constexpr uint8_t codec_mapper_v2_accuracy_from(double v) {
+  return (uint8_t)(v * 2.0);
+}
+
+constexpr uint16_t codec_mapper_v2_speed_from(double v) {
+  return (uint16_t)(v / 0.36);
+}
+
+/** Returns the frame length */
+constexpr size_t codec_encode_mapper_v2(uint8_t *buf, const struct codec_mapper_v2 *m) {
+  size_t pos = 0;
+  codec_put_bits(buf, &pos, 2, 3);
+  codec_put_bits(buf, &pos, (uint32_t)m->flags, 2);
+  codec_put_bits(buf, &pos, (uint32_t)m->latitude, 28);
+  codec_put_bits(buf, &pos, (uint32_t)m->longitude, 29);
+  codec_put_bits(buf, &pos, (uint32_t)m->altitude, 16);
+  codec_put_bits(buf, &pos, (uint32_t)m->sats, 5);
+  if (m->flags & 1)
+    codec_put_bits(buf, &pos, (uint32_t)m->accuracy, 7);
+  if (m->flags & 2)
+    codec_put_bits(buf, &pos, (uint32_t)m->speed, 10);
+  if (m->flags & 2)
+    codec_put_bits(buf, &pos, (uint32_t)m->heading, 9);
+  codec_put_bits(buf, &pos, 0, (8 - (pos & 7)) & 7);
+  return pos >> 3;
+}
+
+/** False if the frame is truncated or of another version */
+constexpr bool codec_decode_mapper_v2(const uint8_t *buf, size_t len, struct codec_mapper_v2 *m) {
+  size_t pos = 0;
+  if (pos + 3 > len * 8)
+    return false;
+  if (codec_get_bits(buf, &pos, 3) != 2)
+    return false;
+  if (pos + 2 > len * 8)
+    return false;
+  m->flags = codec_get_bits(buf, &pos, 2);
+  if (pos + 28 > len * 8)
+    return false;
+  m->latitude = codec_get_bits(buf, &pos, 28);
+  if (pos + 29 > len * 8)
+    return false;
+  m->longitude = codec_get_bits(buf, &pos, 29);
+  if (pos + 16 > len * 8)
+    return false;
+  m->altitude = codec_sign_extend(codec_get_bits(buf, &pos, 16), 16);
+  if (pos + 5 > len * 8)
+    return false;
+  m->sats = codec_get_bits(buf, &pos, 5);
+  m->accuracy = 0;
+  if (m->flags & 1) {
+    if (pos + 7 > len * 8)
+      return false;
+    m->accuracy = codec_get_bits(buf, &pos, 7);
+  }
+  m->speed = 0;
+  if (m->flags & 2) {
+    if (pos + 10 > len * 8)
+      return false;
+    m->speed = codec_get_bits(buf, &pos, 10);
+  }
+  m->heading = 0;
+  if (m->flags & 2) {
+    if (pos + 9 > len * 8)
+      return false;
+    m->heading = codec_get_bits(buf, &pos, 9);
+  }
+  return true;
+}
+
+/** System status (uplink, FPort 5) */
+constexpr uint8_t CODEC_STATUS_PORT = 5;
+constexpr size_t CODEC_STATUS_MIN_LEN = 9;
+constexpr size_t CODEC_STATUS_MAX_LEN = 9;
+
+struct codec_status {
+  uint32_t last_latitude;
+  uint32_t last_longitude;
+  uint8_t battery;
+  uint8_t status;
+  uint8_t value;
+};
+
+constexpr uint32_t codec_status_last_latitude_from(double v) {
+  return (uint32_t)((v + 90.0) / 180.0 * 16777215.0);
+}
+
+constexpr uint32_t codec_status_last_longitude_from(double v) {
+  return (uint32_t)((v + 180.0) / 360.0 * 16777215.0);
+}
+
+constexpr uint8_t codec_status_battery_from(double v) {
+  return (uint8_t)((v - 2.0) * 100.0);
+}
+
+/** Returns the frame length */
+constexpr size_t codec_encode_status(uint8_t *buf, const struct codec_status *m) {
+  size_t pos = 0;
+  codec_put_bits(buf, &pos, (uint32_t)m->last_latitude, 24);
+  codec_put_bits(buf, &pos, (uint32_t)m->last_longitude, 24);
+  codec_put_bits(buf, &pos, (uint32_t)m->battery, 8);
+  codec_put_bits(buf, &pos, (uint32_t)m->status, 8);
+  codec_put_bits(buf, &pos, (uint32_t)m->value, 8);
+  codec_put_bits(buf, &pos, 0, (8 - (pos & 7)) & 7);
+  return pos >> 3;
+}
+
+/** False if the frame is truncated or of another version */
+constexpr bool codec_decode_status(const uint8_t *buf, size_t len, struct codec_status *m) {
+  size_t pos = 0;
+  if (pos + 24 > len * 8)
+    return false;
+  m->last_latitude = codec_get_bits(buf, &pos, 24);
+  if (pos + 24 > len * 8)
+    return false;
+  m->last_longitude = codec_get_bits(buf, &pos, 24);
+  if (pos + 8 > len * 8)
+    return false;
+  m->battery = codec_get_bits(buf, &pos, 8);
+  if (pos + 8 > len * 8)
+    return false;
+  m->status = codec_get_bits(buf, &pos, 8);
+  if (pos + 8 > len * 8)
+    return false;
+  m->value = codec_get_bits(buf, &pos, 8);
+  return true;
+}
+
+/** Lost GPS (uplink, FPort 6) */
+constexpr uint8_t CODEC_GPS_LOST_PORT = 6;
+constexpr size_t CODEC_GPS_LOST_MIN_LEN = 10;
+constexpr size_t CODEC_GPS_LOST_MAX_LEN = 10;
+
+struct codec_gps_lost {
+  uint32_t last_latitude;
+  uint32_t last_longitude;
+  uint8_t battery;
+  uint8_t sats;
+  uint16_t minutes;
+};
+
+constexpr uint32_t codec_gps_lost_last_latitude_from(double v) {
+  return (uint32_t)((v + 90.0) / 180.0 * 16777215.0);
+}
+
+constexpr uint32_t codec_gps_lost_last_longitude_from(double v) {
+  return (uint32_t)((v + 180.0) / 360.0 * 16777215.0);
+}
+
+constexpr uint8_t codec_gps_lost_battery_from(double v) {
+  return (uint8_t)((v - 2.0) * 100.0);
+}
+
+/** Returns the frame length */
+constexpr size_t codec_encode_gps_lost(uint8_t *buf, const struct codec_gps_lost *m) {
+  size_t pos = 0;
+  codec_put_bits(buf, &pos, (uint32_t)m->last_latitude, 24);
+  codec_put_bits(buf, &pos, (uint32_t)m->last_longitude, 24);
+  codec_put_bits(buf, &pos, (uint32_t)m->battery, 8);
+  codec_put_bits(buf, &pos, (uint32_t)m->sats, 8);
+  codec_put_bits(buf, &pos, (uint32_t)m->minutes, 16);
+  codec_put_bits(buf, &pos, 0, (8 - (pos & 7)) & 7);
+  return pos >> 3;
+}
+
+/** False if the frame is truncated or of another version */
+constexpr bool codec_decode_gps_lost(const uint8_t *buf, size_t len, struct codec_gps_lost *m) {
+  size_t pos = 0;
+  if (pos + 24 > len * 8)
+    return false;
+  m->last_latitude = codec_get_bits(buf, &pos, 24);
+  if (pos + 24 > len * 8)
+    return false;
+  m->last_longitude = codec_get_bits(buf, &pos, 24);
+  if (pos + 8 > len * 8)
+    return false;
+  m->battery = codec_get_bits(buf, &pos, 8);
+  if (pos + 8 > len * 8)
+    return false;
+  m->sats = codec_get_bits(buf, &pos, 8);
+  if (pos + 16 > len * 8)
+    return false;
+  m->minutes = codec_get_bits(buf, &pos, 16);
+  return true;
+}
+
+/** Device telemetry, alone or appended to a mapper, status or GPS lost frame (uplink, FPort 7) */
+constexpr uint8_t CODEC_TELEMETRY_PORT = 7;
+constexpr size_t CODEC_TELEMETRY_MIN_LEN = 8;
+constexpr size_t CODEC_TELEMETRY_MAX_LEN = 8;
+
+struct codec_telemetry {
+  uint8_t battery;
+  uint16_t uptime;        // Minutes since reset, stops at 65535
+  uint16_t airtime;       // Seconds of transmit time since reset, stops at 16383
+  uint16_t frames;        // Uplinks since reset, stops at 32767
+  uint8_t ack_ratio;      // Percent of confirmed uplinks acknowledged, 127 when none were asked for
+  uint8_t reset_reason;
+};
+
+constexpr uint8_t codec_telemetry_battery_from(double v) {
+  return (uint8_t)((v - 2.0) * 100.0);
+}
+
+/** Returns the frame length */
+constexpr size_t codec_encode_telemetry(uint8_t *buf, const struct codec_telemetry *m) {
+  size_t pos = 0;
+  codec_put_bits(buf, &pos, (uint32_t)m->battery, 8);
+  codec_put_bits(buf, &pos, (uint32_t)m->uptime, 16);
+  codec_put_bits(buf, &pos, (uint32_t)m->airtime, 14);
+  codec_put_bits(buf, &pos, (uint32_t)m->frames, 15);
+  codec_put_bits(buf, &pos, (uint32_t)m->ack_ratio, 7);
+  codec_put_bits(buf, &pos, (uint32_t)m->reset_reason, 4);
+  codec_put_bits(buf, &pos, 0, (8 - (pos & 7)) & 7);
+  return pos >> 3;
+}
+
+/** False if the frame is truncated or of another version */
+constexpr bool codec_decode_telemetry(const uint8_t *buf, size_t len, struct codec_telemetry *m) {
+  size_t pos = 0;
+  if (pos + 8 > len * 8)
+    return false;
+  m->battery = codec_get_bits(buf, &pos, 8);
+  if (pos + 16 > len * 8)
+    return false;
+  m->uptime = codec_get_bits(buf, &pos, 16);
+  if (pos + 14 > len * 8)
+    return false;
+  m->airtime = codec_get_bits(buf, &pos, 14);
+  if (pos + 15 > len * 8)
+    return false;
+  m->frames = codec_get_bits(buf, &pos, 15);
+  if (pos + 7 > len * 8)
+    return false;
+  m->ack_ratio = codec_get_bits(buf, &pos, 7);
+  if (pos + 4 > len * 8)
+    return false;
+  m->reset_reason = codec_get_bits(buf, &pos, 4);
+  return true;
+}
+
+/** Remote configuration. Zero leaves a setting unchanged, time 0xFFFF reverts to the build default. (downlink, FPort 1) */
+constexpr uint8_t CODEC_CONFIG_PORT = 1;
+constexpr size_t CODEC_CONFIG_MIN_LEN = 5;
+constexpr size_t CODEC_CONFIG_MAX_LEN = 5;
+
+struct codec_config {
+  uint16_t distance;        // Meters
+  uint16_t time_interval;   // Seconds
+  uint8_t cutoff_volts;
+};
+
+constexpr uint8_t codec_config_cutoff_volts_from(double v) {
+  return (uint8_t)((v - 2.0) * 100.0);
+}
+
+/** Returns the frame length */
+constexpr size_t codec_encode_config(uint8_t *buf, const struct codec_config *m) {
+  size_t pos = 0;
+  codec_put_bits(buf, &pos, (uint32_t)m->distance, 16);
+  codec_put_bits(buf, &pos, (uint32_t)m->time_interval, 16);
+  codec_put_bits(buf, &pos, (uint32_t)m->cutoff_volts, 8);
+  codec_put_bits(buf, &pos, 0, (8 - (pos & 7)) & 7);
+  return pos >> 3;
+}
+
+/** False if the frame is truncated or of another version */
+constexpr bool codec_decode_config(const uint8_t *buf, size_t len, struct codec_config *m) {
+  size_t pos = 0;
+  if (pos + 16 > len * 8)
+    return false;
+  m->distance = codec_get_bits(buf, &pos, 16);
+  if (pos + 16 > len * 8)
+    return false;
+  m->time_interval = codec_get_bits(buf, &pos, 16);
+  if (pos + 8 > len * 8)
+    return false;
+  m->cutoff_volts = codec_get_bits(buf, &pos, 8);
+  return true;
+}
+
+/** Downlink commands: any number of [id:8][value, big-endian], applied all or nothing and saved to flash (downlink, FPort 10) */
+constexpr uint8_t CODEC_COMMAND_PORT = 10;
+
+enum codec_command_id {
+  CODEC_CMD_DISTANCE = 1,
+  CODEC_CMD_TIME_INTERVAL = 2,
+  CODEC_CMD_CUTOFF_VOLTS = 3,
+  CODEC_CMD_SF = 4,
+  CODEC_CMD_TX_POWER = 5,
+  CODEC_CMD_DEADZONE_LAT = 6,
+  CODEC_CMD_DEADZONE_LON = 7,
+  CODEC_CMD_DEADZONE_RADIUS = 8,
+};
+
+/** Wire-level bounds, inclusive */
+struct codec_command {
+  uint8_t id;
+  uint8_t size;  // Bytes after the id
+  bool is_signed;
+  int32_t min;
+  int32_t max;
+  const char *name;
+};
+
+constexpr struct codec_command codec_commands[] = {
+    {CODEC_CMD_DISTANCE, 2, false, 10, 65534, "distance"},
+    {CODEC_CMD_TIME_INTERVAL, 2, false, 10, 65534, "time_interval"},
+    {CODEC_CMD_CUTOFF_VOLTS, 1, false, 70, 190, "cutoff_volts"},
+    {CODEC_CMD_SF, 1, false, 7, 10, "sf"},
+    {CODEC_CMD_TX_POWER, 1, false, 2, 20, "tx_power"},
+    {CODEC_CMD_DEADZONE_LAT, 4, true, -90000000, 90000000, "deadzone_lat"},
+    {CODEC_CMD_DEADZONE_LON, 4, true, -180000000, 180000000, "deadzone_lon"},
+    {CODEC_CMD_DEADZONE_RADIUS, 2, false, 0, 65535, "deadzone_radius"},
+};
+constexpr size_t CODEC_COMMANDS = sizeof(codec_commands) / sizeof(codec_commands[0]);
+
+/** NULL for an unknown id */
+constexpr const struct codec_command *codec_command_find(uint8_t id) {
+  for (size_t i = 0; i < CODEC_COMMANDS; i++)
+    if (codec_commands[i].id == id)
+      return &codec_commands[i];
+  return nullptr;
+}
+
+constexpr bool codec_command_valid(uint8_t id, int32_t value) {
+  return codec_command_find(id) && value >= codec_command_find(id)->min && value <= codec_command_find(id)->max;
+}
+
+/** Decodes the command at buf, returns the bytes used or 0 if unknown, truncated or out of bounds */
+constexpr size_t codec_decode_command(const uint8_t *buf, size_t len, uint8_t *id, int32_t *value) {
+  if (len < 1 || !codec_command_find(buf[0]))
+    return 0;
+  const struct codec_command *c = codec_command_find(buf[0]);
+  if (len < 1u + c->size)
+    return 0;
+  size_t pos = 8;
+  uint32_t raw = codec_get_bits(buf, &pos, c->size * 8);
+  int32_t v = c->is_signed ? codec_sign_extend(raw, c->size * 8) : (int32_t)raw;
+  if (!codec_command_valid(c->id, v))
+    return 0;
+  *id = c->id;
+  *value = v;
+  return 1 + c->size;
+}
+
+// Golden vectors, shared with the JS and Python codecs
+
+constexpr bool codec_golden_mapper_0() {
+  const uint8_t want[] = {0xC3, 0x61, 0x66, 0x86, 0x12, 0xF7, 0x01, 0x98, 0x09};
+  struct codec_mapper m = {(uint32_t)12804454, (uint32_t)8786679, (int16_t)408, (uint8_t)9};
+  struct codec_mapper back = {};
+  uint8_t buf[CODEC_MAPPER_MAX_LEN] = {};
+  if (codec_encode_mapper(buf, &m) != sizeof(want))
+    return false;
+  for (size_t i = 0; i < sizeof(want); i++)
+    if (buf[i] != want[i])
+      return false;
+  if (!codec_decode_mapper(want, sizeof(want), &back))
+    return false;
+  return back.latitude == m.latitude && back.longitude == m.longitude && back.altitude == m.altitude && back.sats == m.sats;
+}
+static_assert(codec_golden_mapper_0(), "mapper golden vector 0");
+
+constexpr bool codec_golden_mapper_1() {
+  const uint8_t want[] = {0x7F, 0xFF, 0xFF, 0x7F, 0xFF, 0xFF, 0xFF, 0xF0, 0x04};
+  struct codec_mapper m = {(uint32_t)8388607, (uint32_t)8388607, (int16_t)-16, (uint8_t)4};
+  struct codec_mapper back = {};
+  uint8_t buf[CODEC_MAPPER_MAX_LEN] = {};
+  if (codec_encode_mapper(buf, &m) != sizeof(want))
+    return false;
+  for (size_t i = 0; i < sizeof(want); i++)
+    if (buf[i] != want[i])
+      return false;
+  if (!codec_decode_mapper(want, sizeof(want), &back))
+    return false;
+  return back.latitude == m.latitude && back.longitude == m.longitude && back.altitude == m.altitude && back.sats == m.sats;
+}
+static_assert(codec_golden_mapper_1(), "mapper golden vector 1");
+
+constexpr bool codec_golden_mapper_v2_0() {
+  const uint8_t want[] = {0x5C, 0x18, 0x1A, 0x42, 0x2C, 0xF3, 0xAC, 0x10, 0x06, 0x61, 0x21, 0x48, 0xB8, 0x78};
+  struct codec_mapper_v2 m = {(uint8_t)3, (uint32_t)137376900, (uint32_t)188541700, (int16_t)408, (uint8_t)9, (uint8_t)5, (uint16_t)139, (uint16_t)271};
+  struct codec_mapper_v2 back = {};
+  uint8_t buf[CODEC_MAPPER_V2_MAX_LEN] = {};
+  if (codec_encode_mapper_v2(buf, &m) != sizeof(want))
+    return false;
+  for (size_t i = 0; i < sizeof(want); i++)
+    if (buf[i] != want[i])
+      return false;
+  if (!codec_decode_mapper_v2(want, sizeof(want), &back))
+    return false;
+  return back.flags == m.flags && back.latitude == m.latitude && back.longitude == m.longitude && back.altitude == m.altitude && back.sats == m.sats && back.accuracy == m.accuracy && back.speed == m.speed && back.heading == m.heading;
+}
+static_assert(codec_golden_mapper_v2_0(), "mapper_v2 golden vector 0");
+
+constexpr bool codec_golden_mapper_v2_1() {
+  const uint8_t want[] = {0x40, 0x00, 0x00, 0x00, 0x55, 0xD4, 0xA8, 0x03, 0xFF, 0xEF, 0xE0};
+  struct codec_mapper_v2 m = {(uint8_t)0, (uint32_t)0, (uint32_t)360000000, (int16_t)-5, (uint8_t)31, (uint8_t)0, (uint16_t)0, (uint16_t)0};
+  struct codec_mapper_v2 back = {};
+  uint8_t buf[CODEC_MAPPER_V2_MAX_LEN] = {};
+  if (codec_encode_mapper_v2(buf, &m) != sizeof(want))
+    return false;
+  for (size_t i = 0; i < sizeof(want); i++)
+    if (buf[i] != want[i])
+      return false;
+  if (!codec_decode_mapper_v2(want, sizeof(want), &back))
+    return false;
+  return back.flags == m.flags && back.latitude == m.latitude && back.longitude == m.longitude && back.altitude == m.altitude && back.sats == m.sats && back.accuracy == m.accuracy && back.speed == m.speed && back.heading == m.heading;
+}
+static_assert(codec_golden_mapper_v2_1(), "mapper_v2 golden vector 1");
+
+constexpr bool codec_golden_status_0() {
+  const uint8_t want[] = {0xC3, 0x61, 0x66, 0x86, 0x12, 0xF7, 0xBB, 0x01, 0x00};
+  struct codec_status m = {(uint32_t)12804454, (uint32_t)8786679, (uint8_t)187, (uint8_t)1, (uint8_t)0};
+  struct codec_status back = {};
+  uint8_t buf[CODEC_STATUS_MAX_LEN] = {};
+  if (codec_encode_status(buf, &m) != sizeof(want))
+    return false;
+  for (size_t i = 0; i < sizeof(want); i++)
+    if (buf[i] != want[i])
+      return false;
+  if (!codec_decode_status(want, sizeof(want), &back))
+    return false;
+  return back.last_latitude == m.last_latitude && back.last_longitude == m.last_longitude && back.battery == m.battery && back.status == m.status && back.value == m.value;
+}
+static_assert(codec_golden_status_0(), "status golden vector 0");
+
+constexpr bool codec_golden_gps_lost_0() {
+  const uint8_t want[] = {0xC3, 0x61, 0x66, 0x86, 0x12, 0xF7, 0xA0, 0x02, 0x01, 0x2C};
+  struct codec_gps_lost m = {(uint32_t)12804454, (uint32_t)8786679, (uint8_t)160, (uint8_t)2, (uint16_t)300};
+  struct codec_gps_lost back = {};
+  uint8_t buf[CODEC_GPS_LOST_MAX_LEN] = {};
+  if (codec_encode_gps_lost(buf, &m) != sizeof(want))
+    return false;
+  for (size_t i = 0; i < sizeof(want); i++)
+    if (buf[i] != want[i])
+      return false;
+  if (!codec_decode_gps_lost(want, sizeof(want), &back))
+    return false;
+  return back.last_latitude == m.last_latitude && back.last_longitude == m.last_longitude && back.battery == m.battery && back.sats == m.sats && back.minutes == m.minutes;
+}
+static_assert(codec_golden_gps_lost_0(), "gps_lost golden vector 0");
+
+constexpr bool codec_golden_telemetry_0() {
+  const uint8_t want[] = {0xBB, 0x05, 0xA0, 0x01, 0x7C, 0x19, 0x64, 0xB1};
+  struct codec_telemetry m = {(uint8_t)187, (uint16_t)1440, (uint16_t)95, (uint16_t)812, (uint8_t)75, (uint8_t)1};
+  struct codec_telemetry back = {};
+  uint8_t buf[CODEC_TELEMETRY_MAX_LEN] = {};
+  if (codec_encode_telemetry(buf, &m) != sizeof(want))
+    return false;
+  for (size_t i = 0; i < sizeof(want); i++)
+    if (buf[i] != want[i])
+      return false;
+  if (!codec_decode_telemetry(want, sizeof(want), &back))
+    return false;
+  return back.battery == m.battery && back.uptime == m.uptime && back.airtime == m.airtime && back.frames == m.frames && back.ack_ratio == m.ack_ratio && back.reset_reason == m.reset_reason;
+}
+static_assert(codec_golden_telemetry_0(), "telemetry golden vector 0");
+
+constexpr bool codec_golden_telemetry_1() {
+  const uint8_t want[] = {0xA0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF8};
+  struct codec_telemetry m = {(uint8_t)160, (uint16_t)65535, (uint16_t)16383, (uint16_t)32767, (uint8_t)127, (uint8_t)8};
+  struct codec_telemetry back = {};
+  uint8_t buf[CODEC_TELEMETRY_MAX_LEN] = {};
+  if (codec_encode_telemetry(buf, &m) != sizeof(want))
+    return false;
+  for (size_t i = 0; i < sizeof(want); i++)
+    if (buf[i] != want[i])
+      return false;
+  if (!codec_decode_telemetry(want, sizeof(want), &back))
+    return false;
+  return back.battery == m.battery && back.uptime == m.uptime && back.airtime == m.airtime && back.frames == m.frames && back.ack_ratio == m.ack_ratio && back.reset_reason == m.reset_reason;
+}
+static_assert(codec_golden_telemetry_1(), "telemetry golden vector 1");
+
+constexpr bool codec_golden_config_0() {
+  const uint8_t want[] = {0x00, 0x4B, 0x02, 0x58, 0x00};
+  struct codec_config m = {(uint16_t)75, (uint16_t)600, (uint8_t)0};
+  struct codec_config back = {};
+  uint8_t buf[CODEC_CONFIG_MAX_LEN] = {};
+  if (codec_encode_config(buf, &m) != sizeof(want))
+    return false;
+  for (size_t i = 0; i < sizeof(want); i++)
+    if (buf[i] != want[i])
+      return false;
+  if (!codec_decode_config(want, sizeof(want), &back))
+    return false;
+  return back.distance == m.distance && back.time_interval == m.time_interval && back.cutoff_volts == m.cutoff_volts;
+}
+static_assert(codec_golden_config_0(), "config golden vector 0");
+
+constexpr bool codec_golden_config_1() {
+  const uint8_t want[] = {0x00, 0x00, 0xFF, 0xFF, 0x6E};
+  struct codec_config m = {(uint16_t)0, (uint16_t)65535, (uint8_t)110};
+  struct codec_config back = {};
+  uint8_t buf[CODEC_CONFIG_MAX_LEN] = {};
+  if (codec_encode_config(buf, &m) != sizeof(want))
+    return false;
+  for (size_t i = 0; i < sizeof(want); i++)
+    if (buf[i] != want[i])
+      return false;
+  if (!codec_decode_config(want, sizeof(want), &back))
+    return false;
+  return back.distance == m.distance && back.time_interval == m.time_interval && back.cutoff_volts == m.cutoff_volts;
+}
+static_assert(codec_golden_config_1(), "config golden vector 1");
+
+constexpr bool codec_golden_command_0() {
+  const uint8_t want[] = {0x01, 0x00, 0x4B, 0x04, 0x09, 0x05, 0x0E};
+  const uint8_t id[] = {CODEC_CMD_DISTANCE, CODEC_CMD_SF, CODEC_CMD_TX_POWER};
+  const int32_t value[] = {75, 9, 14};
+  size_t pos = 0;
+  for (size_t i = 0; i < sizeof(id); i++) {
+    uint8_t got_id = 0;
+    int32_t got_value = 0;
+    size_t used = codec_decode_command(want + pos, sizeof(want) - pos, &got_id, &got_value);
+    if (!used || got_id != id[i] || got_value != value[i])
+      return false;
+    pos += used;
+  }
+  return pos == sizeof(want);
+}
+static_assert(codec_golden_command_0(), "command golden vector 0");
+
+constexpr bool codec_golden_command_1() {
+  const uint8_t want[] = {0x06, 0x02, 0x0F, 0x76, 0x78, 0x07, 0xF8, 0xA4, 0x33, 0x44, 0x08, 0x01, 0xF4};
+  const uint8_t id[] = {CODEC_CMD_DEADZONE_LAT, CODEC_CMD_DEADZONE_LON, CODEC_CMD_DEADZONE_RADIUS};
+  const int32_t value[] = {34567800, -123456700, 500};
+  size_t pos = 0;
+  for (size_t i = 0; i < sizeof(id); i++) {
+    uint8_t got_id = 0;
+    int32_t got_value = 0;
+    size_t used = codec_decode_command(want + pos, sizeof(want) - pos, &got_id, &got_value);
+    if (!used || got_id != id[i] || got_value != value[i])
+      return false;
+    pos += used;
+  }
+  return pos == sizeof(want);
+}
+static_assert(codec_golden_command_1(), "command golden vector 1");
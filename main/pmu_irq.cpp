@@ -0,0 +1,148 @@
+/**
+ * PMU interrupt module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pmu_irq.h"
+
+#include <Arduino.h>
+#include <XPowersLib.h>
+
+#include "spsc.h"
+
+// Status bits by event, asked through the library as the AXP192 and AXP2101 keep them in different places
+static const struct {
+  uint8_t type;
+  bool (XPowersLibInterface::*pending)(void);
+} pmu_bits[] = {
+    {PMU_BATTERY_IN, &XPowersLibInterface::isBatInsertIrq},
+    {PMU_BATTERY_OUT, &XPowersLibInterface::isBatRemoveIrq},
+    {PMU_CHARGE_START, &XPowersLibInterface::isBatChargeStartIrq},
+    {PMU_CHARGE_DONE, &XPowersLibInterface::isBatChargeDoneIrq},
+    {PMU_KEY_SHORT, &XPowersLibInterface::isPekeyShortPressIrq},
+    {PMU_KEY_LONG, &XPowersLibInterface::isPekeyLongPressIrq},
+};
+#define PMU_BITS (sizeof(pmu_bits) / sizeof(pmu_bits[0]))
+
+static const char *const pmu_event_names[PMU_EVENT_TYPES] = {
+    "USB ON", "USB OFF", "Battery IN", "Battery OUT", "Charge ON", "Charge DONE", "Key short", "Key long", "PMU IRQ"};
+
+static XPowersLibInterface *pmu;
+static pmu_handler handlers[PMU_EVENT_TYPES];
+static bool usb_power;
+
+static struct pmu_event events[16];  // More than one poll can find
+static struct spsc event_queue = SPSC(events);
+
+static volatile bool irq_pending;
+static volatile uint32_t irq_us;
+
+static void IRAM_ATTR pmu_isr(void) {
+  if (!irq_pending)
+    irq_us = micros();  // The first edge since the last poll
+  irq_pending = true;
+}
+
+void pmu_irq_begin(XPowersLibInterface *p, uint8_t pin) {
+  pmu = p;
+  usb_power = pmu->isVbusIn();
+
+  // Fire an interrupt on falling edge.  Note that some IRQs repeat/persist.
+  pinMode(pin, INPUT);
+  gpio_pullup_en((gpio_num_t)pin);
+  attachInterrupt(pin, pmu_isr, FALLING);
+}
+
+/** For a PMU interrupt that woke the ESP32 from deep sleep, before pmu_isr() was attached */
+void pmu_irq_wake(void) {
+  if (!pmu)
+    return;
+  // VBUS was read after the change, so a plug in or out that woke us would not show as one.
+  // With both bits set it may have gone either way and back, so that is left alone.
+  pmu->getIrqStatus();
+  if (pmu->isVbusInsertIrq() != pmu->isVbusRemoveIrq() && pmu->isVbusInsertIrq() == usb_power)
+    usb_power = !usb_power;
+  irq_us = micros();
+  irq_pending = true;
+}
+
+void pmu_irq_on(enum pmu_event_type type, pmu_handler handler) {
+  handlers[type] = handler;
+}
+
+bool pmu_irq_pending(void) {
+  return irq_pending;
+}
+
+static void pmu_queue(uint8_t type, uint32_t read_us, uint64_t status) {
+  struct pmu_event event = {type, irq_us, read_us, status};
+  if (!spsc_push(&event_queue, &event))
+    Serial.printf("PMU event queue full, %s dropped\n", pmu_event_names[type]);
+}
+
+/** Returns how many events were queued */
+uint8_t pmu_irq_poll(void) {
+  if (!pmu || !irq_pending)
+    return 0;
+  irq_pending = false;
+
+  uint64_t status = pmu->getIrqStatus();
+  pmu->clearIrqStatus();
+  uint32_t read_us = micros();
+  uint8_t queued = 0;
+
+  bool usb = pmu->isVbusIn();
+  if (usb != usb_power) {
+    usb_power = usb;
+    pmu_queue(usb ? PMU_USB_ON : PMU_USB_OFF, read_us, status);
+    queued++;
+  }
+  bool known = pmu->isVbusInsertIrq() || pmu->isVbusRemoveIrq();
+  for (unsigned i = 0; i < PMU_BITS; i++)
+    if ((pmu->*pmu_bits[i].pending)()) {
+      pmu_queue(pmu_bits[i].type, read_us, status);
+      queued++;
+      known = true;
+    }
+  if (status && !known) {
+    pmu_queue(PMU_OTHER, read_us, status);
+    queued++;
+  }
+  return queued;
+}
+
+/** Runs the handler of every queued event, returns how many there were */
+uint8_t pmu_irq_dispatch(void) {
+  struct pmu_event event;
+  uint8_t n = 0;
+  while (spsc_pop(&event_queue, &event)) {
+    Serial.printf("PMU %s, %lu us after the IRQ\n", pmu_event_names[event.type],
+                  (unsigned long)(micros() - event.irq_us));
+    if (handlers[event.type])
+      handlers[event.type](&event);
+    n++;
+  }
+  return n;
+}
+
+bool pmu_irq_usb_power(void) {
+  return usb_power;
+}
+
+const char *pmu_event_name(uint8_t type) {
+  return type < PMU_EVENT_TYPES ? pmu_event_names[type] : "?";
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+/**
+ * PMU interrupt dispatcher.
+ *
+ * The IRQ line only says that something happened.  pmu_irq_poll() reads the
+ * status once, turns every pending bit into an event with the time of the IRQ
+ * edge and of the read, clears the status and queues the events.
+ * pmu_irq_dispatch() hands each one to the handler registered for its type, so
+ * a key press at the same moment as a charger event is no longer lost.
+ *
+ * USB power is taken from the VBUS state rather than the insert and remove
+ * bits: each poll compares it with the last one seen and queues the change,
+ * which also catches an edge that came in between the read and the clear.
+ *
+ * Both run from loop(); the IRQ handler itself only notes the time.
+ *
+ * When the PMU interrupt woke the ESP32 from deep sleep, the status is left
+ * as it is and pmu_irq_wake() has the first poll read it, so the key press or
+ * USB change that woke us reaches its handler like any other.
+ */
+
+#include <stdint.h>
+
+class XPowersLibInterface;
+
+enum pmu_event_type {
+  PMU_USB_ON,
+  PMU_USB_OFF,
+  PMU_BATTERY_IN,
+  PMU_BATTERY_OUT,
+  PMU_CHARGE_START,
+  PMU_CHARGE_DONE,
+  PMU_KEY_SHORT,
+  PMU_KEY_LONG,
+  PMU_OTHER,  // Set bits none of the above account for
+  PMU_EVENT_TYPES
+};
+
+struct pmu_event {
+  uint8_t type;     // enum pmu_event_type
+  uint32_t irq_us;  // IRQ edge, micros()
+  uint32_t read_us;
+  uint64_t status;  // As read, for PMU_OTHER
+};
+
+typedef void (*pmu_handler)(const struct pmu_event *event);
+
+void pmu_irq_begin(XPowersLibInterface *pmu, uint8_t pin);
+void pmu_irq_wake(void);
+void pmu_irq_on(enum pmu_event_type type, pmu_handler handler);
+bool pmu_irq_pending(void);
+uint8_t pmu_irq_poll(void);
+uint8_t pmu_irq_dispatch(void);
+bool pmu_irq_usb_power(void);
+const char *pmu_event_name(uint8_t type);
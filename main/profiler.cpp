@@ -0,0 +1,111 @@
+/**
+ * Hot-path profiler module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.h"
+
+#if ENABLE_PROFILER
+
+#ifdef ARDUINO
+#define PROFILE_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#include <stdio.h>
+
+#include <chrono>
+#define PROFILE_PRINTF(...) printf(__VA_ARGS__)
+
+uint32_t profile_cycles(void) {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+#endif
+
+struct profile_stats {
+  uint32_t count;
+  uint32_t max_cycles;
+  uint64_t total_cycles;
+  uint32_t buckets[PROFILE_BUCKETS];
+};
+
+static struct profile_stats stats[PROF_SECTIONS];
+
+static const char *section_names[PROF_SECTIONS] = {"loop", "gps", "screen", "pmu_irq", "activity", "uplink"};
+
+static uint32_t cycles_per_us(void) {
+#ifdef ARDUINO
+  return ESP.getCpuFreqMHz();
+#else
+  return 1000;
+#endif
+}
+
+void profile_record(enum profile_section section, uint32_t cycles) {
+  struct profile_stats *s = &stats[section];
+  uint32_t us = cycles / cycles_per_us();
+  uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;
+
+  if (bucket >= PROFILE_BUCKETS)
+    bucket = PROFILE_BUCKETS - 1;
+  s->buckets[bucket]++;
+  s->count++;
+  s->total_cycles += cycles;
+  if (cycles > s->max_cycles)
+    s->max_cycles = cycles;
+}
+
+void profile_reset(void) {
+  for (int i = 0; i < PROF_SECTIONS; i++) {
+    stats[i] = {};
+  }
+}
+
+void profile_dump(void) {
+  uint32_t per_us = cycles_per_us();
+
+  PROFILE_PRINTF("\n--- PROFILE BEGIN ---\n");
+  for (int i = 0; i < PROF_SECTIONS; i++) {
+    const struct profile_stats *s = &stats[i];
+    if (!s->count)
+      continue;
+    PROFILE_PRINTF("%-9s n=%lu avg=%luus max=%luus\n", section_names[i], (unsigned long)s->count,
+                   (unsigned long)(s->total_cycles / s->count / per_us), (unsigned long)(s->max_cycles / per_us));
+    // Only print the populated buckets, as "<limit_us:count"
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+      if (!s->buckets[b])
+        continue;
+      if (b == PROFILE_BUCKETS - 1)
+        PROFILE_PRINTF("  >=%lu:%lu", 1UL << (b - 1), (unsigned long)s->buckets[b]);
+      else
+        PROFILE_PRINTF("  <%lu:%lu", 1UL << b, (unsigned long)s->buckets[b]);
+    }
+    PROFILE_PRINTF("\n");
+  }
+  PROFILE_PRINTF("--- PROFILE END ---\n");
+}
+
+void profile_serial_command(int c) {
+  if (c == 'p') {
+    profile_dump();
+  } else if (c == 'r') {
+    profile_reset();
+    PROFILE_PRINTF("Profile reset.\n");
+  }
+}
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+ * Hot-path section timers.
+ *
+ * Each PROFILE_SCOPE() measures the enclosing block in CPU cycles and feeds a
+ * fixed-bucket (power of two microseconds) histogram for its section.
+ * Type 'p' on the debug Serial port to dump the histograms, 'r' to reset them.
+ *
+ * Compiled out unless ENABLE_PROFILER is set (on by default in debug builds).
+ * Without ARDUINO, the same code times with std::chrono for native builds.
+ */
+
+#include <stdint.h>
+
+#include "configuration.h"
+
+enum profile_section {
+  PROF_LOOP,      // Whole loop() pass
+  PROF_GPS,       // gps_loop()
+  PROF_SCREEN,    // update_screen()
+  PROF_PMU_IRQ,   // PMU interrupt handling
+  PROF_ACTIVITY,  // update_activity()
+  PROF_UPLINK,    // mapper_uplink()
+  PROF_SECTIONS
+};
+
+/** Histogram buckets: [0] < 1us, [n] < 2^n us, last bucket catches the rest */
+#define PROFILE_BUCKETS 20
+
+#if ENABLE_PROFILER
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static inline uint32_t profile_cycles(void) {
+  return ESP.getCycleCount();
+}
+#else
+uint32_t profile_cycles(void);  // Nanoseconds stand in for cycles on the host
+#endif
+
+void profile_record(enum profile_section section, uint32_t cycles);
+void profile_dump(void);
+void profile_reset(void);
+void profile_serial_command(int c);
+
+class ProfileScope {
+ public:
+  explicit ProfileScope(enum profile_section section) : section_(section), start_(profile_cycles()) {}
+  ~ProfileScope() {
+    profile_record(section_, profile_cycles() - start_);
+  }
+
+ private:
+  enum profile_section section_;
+  uint32_t start_;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(section) ProfileScope PROFILE_CONCAT(_profile_scope_, __LINE__)(section)
+
+#else
+
+#define PROFILE_SCOPE(section)
+static inline void profile_dump(void) {}
+static inline void profile_reset(void) {}
+static inline void profile_serial_command(int) {}
+
+#endif
@@ -34,6 +34,13 @@
 #include "font.h"
 #include "gps.h"
 #include "images.h"
+#include "profiler.h"
+#include "screen_log.h"
+#include "text.h"
+
+static_assert((int)TEXT_LEFT == TEXT_ALIGN_LEFT && (int)TEXT_RIGHT == TEXT_ALIGN_RIGHT &&
+                  (int)TEXT_CENTER == TEXT_ALIGN_CENTER,
+              "text.h alignments follow OLEDDisplay");
 
 // --- Screenshot Helper Classes ---
 // These simple subclasses expose the protected 'buffer' from the base library
@@ -56,15 +63,6 @@ public:
 };
 
 #define SCREEN_HEADER_HEIGHT 23
-const uint16_t logBufferLineLen = 30;
-const uint8_t logBufferMaxLines = 4;
-const uint16_t LOG_BUFFER_SIZE = 200;
-char logBuffer[LOG_BUFFER_SIZE];
-uint16_t logHead = 0;
-uint16_t logTail = 0;
-uint16_t lineStartIndices[logBufferMaxLines];
-uint8_t lineStartIndex = 0; // The 'head' for the indices array
-uint8_t lineCount = 0;      // How many lines are currently in the buffer
 
 OLEDDisplay *display;
 uint8_t _screen_line = SCREEN_HEADER_HEIGHT - 1;
@@ -73,6 +71,32 @@ typedef enum DisplayType_T { E_DISPLAY_UNKNOWN, E_DISPLAY_SSD1306, E_DISPLAY_SH1
 
 DisplayType_T display_type = E_DISPLAY_UNKNOWN;
 
+// Parts of the display that screen_body() redraws on their own
+#define AREA_HEADER_TOP 0x01  // Battery or clock, GPS and the satellite
+#define AREA_HEADER_ROW 0x02  // Interval, distance, flags and radio
+#define AREA_BODY 0x04        // Log or menu
+#define AREA_ALL 0x07
+#define HEADER_ROW_Y 12  // Text of the second row; glyphs start a pixel below where they are drawn
+#define HEADER_SPLIT_Y 13  // First pixel row that belongs to the second row
+
+static uint8_t screen_stale = AREA_ALL;  // Areas on the display that are not what screen_body() would draw
+
+static uint8_t *screen_buffer(void) {
+  if (display_type == E_DISPLAY_SSD1306)
+    return static_cast<ScreenCaptureSSD1306 *>(display)->getBuffer();
+  if (display_type == E_DISPLAY_SH1106)
+    return static_cast<ScreenCaptureSH1106 *>(display)->getBuffer();
+  return NULL;
+}
+
+/** drawString(), from the text cache where it can */
+static void screen_draw(int16_t x, int16_t y, const char *text, OLEDDISPLAY_TEXT_ALIGNMENT alignment) {
+  if (text_draw(screen_buffer(), x, y, alignment, text))
+    return;
+  display->setTextAlignment(alignment);
+  display->drawString(x, y, text);
+}
+
 void screen_off() {
   if (!display)
     return;
@@ -85,6 +109,7 @@ void screen_on() {
     return;
 
   display->displayOn();
+  screen_stale = AREA_ALL;
 }
 
 void screen_clear() {
@@ -92,6 +117,7 @@ void screen_clear() {
     return;
 
   display->clear();
+  screen_stale = AREA_ALL;
 }
 
 void screen_print(const char *text, uint8_t x, uint8_t y, uint8_t alignment) {
@@ -100,59 +126,14 @@ void screen_print(const char *text, uint8_t x, uint8_t y, uint8_t alignment) {
   if (!display)
     return;
 
-  display->setTextAlignment((OLEDDISPLAY_TEXT_ALIGNMENT)alignment);
-  display->drawString(x, y, text);
+  screen_draw(x, y, text, (OLEDDISPLAY_TEXT_ALIGNMENT)alignment);
+  screen_stale = AREA_ALL;
 }
 
 void screen_print(const char *text, uint8_t x, uint8_t y) {
   screen_print(text, x, y, TEXT_ALIGN_LEFT);
 }
 
-size_t screen_buffer_write(uint8_t c) {
-    // Ignore carriage returns
-    if (c < 32 && c != '\n') return 1; // Ignore non-printable characters except newline
-
-    // --- Part 1: Manage the main logBuffer ---
-    logBuffer[logHead] = c;
-    logHead = (logHead + 1) % LOG_BUFFER_SIZE;
-
-    // If the buffer is full, advance the tail
-    if (logHead == logTail) {
-        // Check if the character we are about to overwrite was a newline.
-        // If so, we are losing a line and must decrease our line count.
-        if (logBuffer[logTail] == '\n' && lineCount > 0) {
-            lineCount--;
-        }
-        logTail = (logTail + 1) % LOG_BUFFER_SIZE;
-    }
-
-    // --- Part 2: Manage the lineStartIndices array ---
-    if (c == '\n') {
-        // Store the starting position of the *next* line
-        lineStartIndices[lineStartIndex] = logHead;
-
-        // Advance the index for the line starts, wrapping if needed
-        lineStartIndex = (lineStartIndex + 1) % logBufferMaxLines;
-
-        // Keep track of how many lines we have, but don't exceed the max
-        if (lineCount < logBufferMaxLines) {
-            lineCount++;
-        }
-    }
-    return 1;
-}
-
-size_t screen_buffer_write(const char *str) {
-  // interpretation from OLEDDisplay::write()
-  if (str == NULL)
-    return 0;
-  size_t length = strlen(str);
-  for (size_t i = 0; i < length; i++) {
-    screen_buffer_write(str[i]);
-  }
-  return length;
-}
-
 void screen_print(const char *text) {
   // Serial.printf("Screen: %s\n", text);
   if (!display)
@@ -161,47 +142,15 @@ void screen_print(const char *text) {
   screen_buffer_write(text);
 }
 
-void screen_buffer_print() {
-    if (!display) return;
-
-    display->setTextAlignment(TEXT_ALIGN_LEFT);
-
-    uint16_t startIndex;
-
-    if (lineCount < logBufferMaxLines) {
-        // If we have fewer lines than the max, start from the very beginning.
-        startIndex = logTail;
-    } else {
-        // Start from the oldest line in lineStartIndices
-    startIndex = lineStartIndices[(lineStartIndex - lineCount + logBufferMaxLines) % logBufferMaxLines];
-    }
+static void screen_log_line(uint8_t row, const char *text, void *) {
+  screen_draw(0, SCREEN_HEADER_HEIGHT + row * 10, text, TEXT_ALIGN_LEFT);
+}
 
-    const uint16_t lineHeight = 10;
-    uint8_t linesDrawn = 0;
-    char lineBuffer[logBufferLineLen + 1];
-    uint8_t linePos = 0;
-    uint16_t i = startIndex;
-
-    while (i != logHead) {
-        char character = logBuffer[i];
-
-        if (character == '\n' || linePos >= logBufferLineLen) {
-          lineBuffer[linePos] = '\0';
-          if (linesDrawn < logBufferMaxLines) {
-              display->drawString(0, SCREEN_HEADER_HEIGHT + (linesDrawn * lineHeight), lineBuffer);
-              linesDrawn++;
-          }
-          linePos = 0;
-        } else {
-            lineBuffer[linePos++] = character;
-        }
-        i = (i + 1) % LOG_BUFFER_SIZE;
-    }
+void screen_buffer_print() {
+  if (!display)
+    return;
 
-    if (linePos > 0) {
-        lineBuffer[linePos] = '\0';
-        display->drawString(0, SCREEN_HEADER_HEIGHT + (linesDrawn * lineHeight), lineBuffer);
-    }
+  screen_log_lines(screen_log_line, NULL);
 }
 
 void screen_update() {
@@ -309,6 +258,8 @@ void screen_setup(uint8_t addr) {
   display->init();
   display->flipScreenVertically();
   display->setFont(Custom_Font);
+  text_begin(Custom_Font, display->getWidth(), display->getHeight());
+  screen_stale = AREA_ALL;
 }
 
 void screen_end() {
@@ -322,87 +273,180 @@ void screen_end() {
 #include <XPowersLib.h>
 extern XPowersLibInterface *PMU;
 
-void screen_header(unsigned int tx_interval_s, float min_dist_moved, char *cached_sf_name, uint8_t tx_power, boolean in_deadzone,
-                   boolean stay_on, boolean never_rest) {
+// What the header shows, as integers.  Each text is formatted again only when
+// its own values change, and a frame where nothing changed is not drawn or sent.
+enum header_panel { HEADER_BATTERY, HEADER_CLOCK, HEADER_NO_GPS };
+
+struct header_model {
+  uint8_t panel;  // Top left, alternating every 3 seconds
+  uint8_t battery_percent;
+  uint16_t battery_cv;  // Centivolts
+  uint32_t clock;       // hhmmss
+  uint8_t sats;
+  uint16_t hdop_tenths;
+  unsigned int tx_interval_s;
+  uint32_t distance_m;
+  char flags[4];  // Deadzone, stay on and never rest, or blanks
+  char sf_name[8];
+  uint8_t tx_power;
+};
+
+static struct header_model header;  // As last formatted
+static bool header_valid = false;
+static char header_top[24];    // Battery or clock, or the satellite count next to NO GPS
+static char header_gps[16];    // HDOP and satellites
+static char header_row[24];    // Interval, distance and flags
+static char header_radio[16];  // SF and power
+
+void screen_header(unsigned int tx_interval_s, float min_dist_moved, const char *cached_sf_name, uint8_t tx_power,
+                   boolean in_deadzone, boolean stay_on, boolean never_rest) {
   if (!display)
     return;
 
-  char buffer[40];
-  uint32_t sats = tGPS.satellites.value();
-  boolean no_gps = (sats < 3);
-  // uint16_t devid_hint = ((devEUI[7] << 4) | (devEUI[6] & 0xF0) >> 4);
-
-  display->clear();
+  struct header_model m;
+  memset(&m, 0, sizeof(m));
+  m.sats = tGPS.satellites.value();
+  boolean no_gps = (m.sats < 3);
+  m.panel = millis() % 6000 < 3000 ? HEADER_BATTERY : no_gps ? HEADER_NO_GPS : HEADER_CLOCK;
+  if (m.panel == HEADER_BATTERY && PMU) {
+    m.battery_percent = PMU->getBatteryPercent();
+    m.battery_cv = (PMU->getBattVoltage() + 5) / 10;
+  } else if (m.panel == HEADER_CLOCK) {
+    m.clock = tGPS.time.value() / 100;
+  }
+  if (!no_gps)
+    m.hdop_tenths = (tGPS.hdop.value() + 5) / 10;
+  m.tx_interval_s = tx_interval_s;
+  m.distance_m = min_dist_moved + 0.5f;
+  m.flags[0] = in_deadzone ? 'D' : ' ';
+  m.flags[1] = stay_on ? 'S' : ' ';
+  m.flags[2] = never_rest ? 'N' : ' ';
+  strncpy(m.sf_name, cached_sf_name, sizeof(m.sf_name) - 1);
+  m.tx_power = tx_power;
+
+  if (!header_valid || m.panel != header.panel || m.battery_percent != header.battery_percent ||
+      m.battery_cv != header.battery_cv || m.clock != header.clock ||
+      (m.panel == HEADER_NO_GPS && m.sats != header.sats)) {
+    if (m.panel == HEADER_BATTERY)
+      snprintf(header_top, sizeof(header_top), "%u%%, %u.%02uV  ", m.battery_percent, m.battery_cv / 100,
+               m.battery_cv % 100);
+    else if (m.panel == HEADER_CLOCK)
+      snprintf(header_top, sizeof(header_top), "#%02lu:%02lu:%02lu", (unsigned long)m.clock / 10000,
+               (unsigned long)m.clock / 100 % 100, (unsigned long)m.clock % 100);
+    else
+      snprintf(header_top, sizeof(header_top), "(%u)", m.sats);
+    screen_stale |= AREA_HEADER_TOP;
+  }
+  if (!header_valid || m.hdop_tenths != header.hdop_tenths || m.sats != header.sats) {
+    snprintf(header_gps, sizeof(header_gps), "%u.%u   %u", m.hdop_tenths / 10, m.hdop_tenths % 10, m.sats);
+    screen_stale |= AREA_HEADER_TOP;
+    if (header_valid && (m.sats >= 3) != (header.sats >= 3))
+      screen_stale |= AREA_HEADER_ROW;  // The satellite comes or goes, and it reaches into the second row
+  }
+  if (!header_valid || m.tx_interval_s != header.tx_interval_s || m.distance_m != header.distance_m ||
+      memcmp(m.flags, header.flags, sizeof(m.flags))) {
+    snprintf(header_row, sizeof(header_row), "%us %lum %s", m.tx_interval_s, (unsigned long)m.distance_m, m.flags);
+    screen_stale |= AREA_HEADER_ROW;
+  }
+  if (!header_valid || strcmp(m.sf_name, header.sf_name) || m.tx_power != header.tx_power) {
+    // The SF and Tx Power together (e.g., "SF7/16dB")
+    snprintf(header_radio, sizeof(header_radio), "%s/%udB", m.sf_name, m.tx_power);
+    screen_stale |= AREA_HEADER_ROW;
+  }
+  header = m;
+  header_valid = true;
+}
 
-  // Cycle display every 3 seconds
-  if (millis() % 6000 < 3000) {
-    // Voltage and Battery %
-    snprintf(buffer, sizeof(buffer), "%d%%, %.2fV  ", PMU->getBatteryPercent(),
-             PMU ? PMU->getBattVoltage() / 1000.0 : 0.0);
-    display->setTextAlignment(TEXT_ALIGN_LEFT);
-    display->drawString(0, 2, buffer);
-  } else {
-    // ID & Time
-    if (no_gps) {
-      display->setTextAlignment(TEXT_ALIGN_CENTER);
-      display->drawString(display->getWidth() / 2, 2, "*** NO GPS ***");
+/** Blanks one area, unless the whole display was just cleared */
+static void screen_area_clear(uint8_t areas, uint8_t area, int16_t y, int16_t height) {
+  if (!(areas & area) || areas == AREA_ALL)
+    return;
+  display->setColor(BLACK);
+  display->fillRect(0, y, display->getWidth(), height);
+  display->setColor(WHITE);
+}
 
-      snprintf(buffer, sizeof(buffer), "(%d)", sats);
-      display->setTextAlignment(TEXT_ALIGN_RIGHT);
-      display->drawString(display->getWidth(), 2, buffer);
+static void screen_header_draw(uint8_t areas) {
+  screen_area_clear(areas, AREA_HEADER_TOP, 0, HEADER_SPLIT_Y);
+  screen_area_clear(areas, AREA_HEADER_ROW, HEADER_SPLIT_Y, SCREEN_HEADER_HEIGHT - HEADER_SPLIT_Y);
 
+  if (areas & AREA_HEADER_TOP) {
+    if (header.panel == HEADER_NO_GPS) {
+      screen_draw(display->getWidth() / 2, 2, "*** NO GPS ***", TEXT_ALIGN_CENTER);
+      screen_draw(display->getWidth(), 2, header_top, TEXT_ALIGN_RIGHT);
     } else {
-      snprintf(buffer, sizeof(buffer), "#%02d:%02d:%02d", tGPS.time.hour(), tGPS.time.minute(), tGPS.time.second());
-      display->setTextAlignment(TEXT_ALIGN_LEFT);
-      display->drawString(0, 2, buffer);
+      screen_draw(0, 2, header_top, TEXT_ALIGN_LEFT);
     }
-  }
 
-  // HDOP & Satellite count
-  if (!no_gps) {
-    snprintf(buffer, sizeof(buffer), "%2.1f   %d", tGPS.hdop.hdop(), sats);
-    display->setTextAlignment(TEXT_ALIGN_RIGHT);
-    display->drawString(display->getWidth() - SATELLITE_IMAGE_WIDTH - 4, 2, buffer);
-    display->drawXbm(display->getWidth() - SATELLITE_IMAGE_WIDTH, 0, SATELLITE_IMAGE_WIDTH, SATELLITE_IMAGE_HEIGHT,
-                     SATELLITE_IMAGE);
+    // HDOP & Satellite count
+    if (header.sats >= 3)
+      screen_draw(display->getWidth() - SATELLITE_IMAGE_WIDTH - 4, 2, header_gps, TEXT_ALIGN_RIGHT);
   }
 
-  // Second status row:
-  snprintf(buffer, sizeof(buffer), "%us %.0fm %c%c%c", tx_interval_s, min_dist_moved, in_deadzone ? 'D' : ' ',
-           stay_on ? 'S' : ' ', never_rest ? 'N' : ' ');
-  display->setTextAlignment(TEXT_ALIGN_LEFT);
-  display->drawString(0, 12, buffer);
-
-  // Format the SF and Tx Power together (e.g., "SF7/16dB")
-  snprintf(buffer, sizeof(buffer), "%s/%ddB", cached_sf_name, tx_power);
-  display->setTextAlignment(TEXT_ALIGN_RIGHT);
-  display->drawString(display->getWidth(), 12, buffer);
+  // Second status row
+  if (areas & AREA_HEADER_ROW) {
+    screen_draw(0, HEADER_ROW_Y, header_row, TEXT_ALIGN_LEFT);
+    screen_draw(display->getWidth(), HEADER_ROW_Y, header_radio, TEXT_ALIGN_RIGHT);
+  }
 
+  // The satellite reaches into the second row, so it goes back on whichever row was cleared
+  if (header.sats >= 3)
+    display->drawXbm(display->getWidth() - SATELLITE_IMAGE_WIDTH, 0, SATELLITE_IMAGE_WIDTH, SATELLITE_IMAGE_HEIGHT,
+                     SATELLITE_IMAGE);
   display->drawHorizontalLine(0, SCREEN_HEADER_HEIGHT, display->getWidth());
 }
 
 #define MARGIN 15
 void screen_body(boolean in_menu, const char *menu_prev, const char *menu_cur, const char *menu_next,
                  boolean highlighted) {
+  static boolean shown_in_menu, shown_alone;
+  static const char *shown_prev, *shown_cur, *shown_next;
+  static uint16_t shown_log;
+
   if (!display) {
     return;
   }
 
-  if (in_menu) {
+  // A highlighted menu item is shown alone on a blank display, so it has no areas of its own
+  boolean alone = in_menu && highlighted;
+  uint8_t areas = screen_stale;
+  if (in_menu != shown_in_menu || menu_prev != shown_prev || menu_cur != shown_cur || menu_next != shown_next ||
+      (!in_menu && screen_log_generation() != shown_log))
+    areas |= AREA_BODY;
+  if (alone != shown_alone || (alone && (areas & AREA_BODY)))
+    areas = AREA_ALL;
+  else if (alone)
+    areas = 0;  // The header changed under the item; it is drawn again when the highlight goes
+  screen_stale = 0;
+  if (!areas)
+    return;  // Same frame as on the display already
+  shown_in_menu = in_menu;
+  shown_alone = alone;
+  shown_prev = menu_prev;
+  shown_cur = menu_cur;
+  shown_next = menu_next;
+  shown_log = screen_log_generation();
+
+  if (areas == AREA_ALL)
+    display->clear();
+  if (!alone)
+    screen_header_draw(areas);
+  screen_area_clear(areas, AREA_BODY, SCREEN_HEADER_HEIGHT + 1, display->getHeight() - SCREEN_HEADER_HEIGHT - 1);
+
+  if ((areas & AREA_BODY) && in_menu) {
     char buffer[40];
 
-    display->setTextAlignment(TEXT_ALIGN_CENTER);
-    display->drawString(display->getWidth() / 2, SCREEN_HEADER_HEIGHT + 5, menu_prev);
-    display->drawString(display->getWidth() / 2, SCREEN_HEADER_HEIGHT + 28, menu_next);
-    if (highlighted)
-      display->clear();
+    if (!highlighted) {
+      screen_draw(display->getWidth() / 2, SCREEN_HEADER_HEIGHT + 5, menu_prev, TEXT_ALIGN_CENTER);
+      screen_draw(display->getWidth() / 2, SCREEN_HEADER_HEIGHT + 28, menu_next, TEXT_ALIGN_CENTER);
+    }
     display->drawHorizontalLine(MARGIN, SCREEN_HEADER_HEIGHT + 16, display->getWidth() - MARGIN * 2);
     snprintf(buffer, sizeof(buffer), highlighted ? ">>> %s <<<" : "%s", menu_cur);
-    display->drawString(display->getWidth() / 2, SCREEN_HEADER_HEIGHT + 16, buffer);
+    screen_draw(display->getWidth() / 2, SCREEN_HEADER_HEIGHT + 16, buffer, TEXT_ALIGN_CENTER);
     display->drawHorizontalLine(MARGIN, SCREEN_HEADER_HEIGHT + 28, display->getWidth() - MARGIN * 2);
     display->drawVerticalLine(MARGIN, SCREEN_HEADER_HEIGHT + 16, 28 - 16);
     display->drawVerticalLine(display->getWidth() - MARGIN, SCREEN_HEADER_HEIGHT + 16, 28 - 16);
-  } else {
+  } else if (areas & AREA_BODY) {
     screen_buffer_print();
   }
   display->display();
@@ -419,14 +463,7 @@ void screen_body(boolean in_menu, const char *menu_prev, const char *menu_cur, c
 int getPixelFromBuffer(int16_t x, int16_t y) {
   if (!display) return 0;
   
-  uint8_t* buffer = nullptr;
-
-  // Cast the display pointer to our specific subclass to access getBuffer()
-  if (display_type == E_DISPLAY_SSD1306) {
-    buffer = static_cast<ScreenCaptureSSD1306*>(display)->getBuffer();
-  } else if (display_type == E_DISPLAY_SH1106) {
-    buffer = static_cast<ScreenCaptureSH1106*>(display)->getBuffer();
-  }
+  uint8_t* buffer = screen_buffer();
 
   if (!buffer) return 0; // Safety check
 
@@ -472,41 +509,93 @@ void screen_serial_dump() {
  * This is much faster than the uncompressed dump.
  * Format: B<count> W<count> ... (e.g., B128 W15 B1000)
  */
+static void screen_serial_run(bool white, uint32_t length, void *ctx) {
+  if ((*(uint32_t *)ctx)++)
+    Serial.print(' ');
+  Serial.print(white ? 'W' : 'B');
+  Serial.print((unsigned long)length);
+}
+
 void screen_serial_dump_compressed() {
-  if (!display) {
+  uint8_t *buffer = screen_buffer();
+  if (!buffer) {
     return;
   }
 
   Serial.println(F("\n--- RLE DUMP BEGIN ---"));
+  uint32_t runs = 0;
+  screen_rle(buffer, display->getWidth(), display->getHeight(), screen_serial_run, &runs);
+  Serial.println(); // Final newline
+  Serial.println(F("--- RLE DUMP END ---"));
+}
+#if ENABLE_PROFILER
+#define SCREEN_BENCH_ROUNDS 20
 
-  // Get the state of the very first pixel to start the first run
-  int currentRunState = getPixelFromBuffer(0, 0);
-  int runLength = 0;
-
-  for (int16_t y = 0; y < display->getHeight(); y++) {
-    for (int16_t x = 0; x < display->getWidth(); x++) {
-      // Use the new helper function here as well
-      int pixelState = getPixelFromBuffer(x, y);
-      if (pixelState == currentRunState) {
-        // If the pixel is the same, extend the current run
-        runLength++;
-      } else {
-        // The pixel changed, so the run has ended. Print it.
-        Serial.print(currentRunState ? 'W' : 'B');
-        Serial.print(runLength);
-        Serial.print(' ');
-        
-        // Start a new run
-        currentRunState = pixelState;
-        runLength = 1;
-      }
+/**
+ * Draws what the screen usually shows, plus every character, once with
+ * drawString() and once from the text cache, checks both set the same pixels,
+ * and times them.  The screen is blank until the next update.
+ */
+bool screen_bench(void) {
+  static const char *const samples[] = {
+      "87%, 4.12V  ", "#12:34:56", "*** NO GPS ***", "(2)", "1.2   9", "60s 50m D N", "SF7/16dB",
+      "Joined Network!", "Moving", ">>> Send Now <<<", " !\"#$%&'()*+,-./0123456789:;<=>?",
+      "@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_", "`abcdefghijklmnopqrstuvwxyz{|}~"};
+  static const struct {
+    int16_t x, y;
+    OLEDDISPLAY_TEXT_ALIGNMENT alignment;
+  } places[] = {{0, 2, TEXT_ALIGN_LEFT},     {64, 2, TEXT_ALIGN_CENTER},   {128, 12, TEXT_ALIGN_RIGHT},
+                {0, 33, TEXT_ALIGN_LEFT},    {64, 44, TEXT_ALIGN_CENTER},  {100, 53, TEXT_ALIGN_RIGHT},
+                {120, 60, TEXT_ALIGN_LEFT},  {-20, 7, TEXT_ALIGN_LEFT}};
+  const size_t draws = sizeof(samples) / sizeof(samples[0]) * (sizeof(places) / sizeof(places[0]));
+
+  uint8_t *buffer = screen_buffer();
+  if (!buffer) {
+    Serial.printf("text_draw       no display\n");
+    return true;
+  }
+  size_t size = display->getWidth() * display->getHeight() / 8;
+  uint8_t *expected = (uint8_t *)malloc(size);
+  if (!expected)
+    return false;
+
+  unsigned same = 0;
+  for (const auto &place : places) {
+    for (const char *sample : samples) {
+      display->clear();
+      display->setTextAlignment(place.alignment);
+      display->drawString(place.x, place.y, sample);
+      memcpy(expected, buffer, size);
+      display->clear();
+      text_draw(buffer, place.x, place.y, place.alignment, sample);  // Renders
+      same += !memcmp(expected, buffer, size);
+      display->clear();
+      text_draw(buffer, place.x, place.y, place.alignment, sample);  // From the cache
+      same += !memcmp(expected, buffer, size);
     }
   }
+  free(expected);
+
+  // A screen's worth of strings fits in the cache, so time one
+  uint32_t start = profile_cycles();
+  for (int r = 0; r < SCREEN_BENCH_ROUNDS; r++)
+    for (size_t i = 0; i < 10; i++) {
+      display->setTextAlignment(places[i % 6].alignment);
+      display->drawString(places[i % 6].x, places[i % 6].y, samples[i]);
+    }
+  uint32_t library_ns = (uint64_t)(profile_cycles() - start) * 1000 / ESP.getCpuFreqMHz() / (SCREEN_BENCH_ROUNDS * 10);
+  start = profile_cycles();
+  for (int r = 0; r < SCREEN_BENCH_ROUNDS; r++)
+    for (size_t i = 0; i < 10; i++)
+      text_draw(buffer, places[i % 6].x, places[i % 6].y, places[i % 6].alignment, samples[i]);
+  uint32_t cached_ns = (uint64_t)(profile_cycles() - start) * 1000 / ESP.getCpuFreqMHz() / (SCREEN_BENCH_ROUNDS * 10);
+  display->clear();
+  screen_stale = AREA_ALL;
 
-  // After the loops, print the very last run
-  Serial.print(currentRunState ? 'W' : 'B');
-  Serial.print(runLength);
-  Serial.println(); // Final newline
-  
-  Serial.println(F("--- RLE DUMP END ---"));
-}
\ No newline at end of file
+  bool ok = same == 2 * draws && cached_ns <= library_ns;
+  Serial.printf("%-15s %6lu ns/op\n", "drawString", (unsigned long)library_ns);
+  Serial.printf("%-15s %6lu ns/op  %u/%u pixel-exact  %s\n", "text_draw", (unsigned long)cached_ns, same,
+                (unsigned)(2 * draws), ok ? "OK" : same == 2 * draws ? "SLOW" : "DIFF");
+  return ok;
+}
+#endif
@@ -7,6 +7,10 @@ void screen_print(const char *text, uint8_t x, uint8_t y, uint8_t alignment);
 
 void screen_update(void);
 
+// screen_header() takes the values of the header, screen_body() the rest, and
+// draws and sends the frame only when something on it changed.  Only the parts
+// that changed are cleared and drawn again: either header row, or the log or
+// menu below.  A highlighted menu item stands alone on a blank display.
 void screen_body(
     boolean in_menu,
     const char *menu_prev,
@@ -18,7 +22,7 @@ void screen_body(
 void screen_header(
     unsigned int tx_interval_s,
     float min_dist_moved,
-    char *cached_sf_name,
+    const char *cached_sf_name,
     uint8_t tx_power,
     boolean in_deadzone,
     boolean stay_on,
@@ -34,5 +38,7 @@ void screen_show_logo(void);
 void screen_setup(uint8_t addr);
 void screen_end(void);
 
+bool screen_bench(void);  // Debug builds (ENABLE_PROFILER) only
+
 void screen_serial_dump();
 void screen_serial_dump_compressed();
\ No newline at end of file
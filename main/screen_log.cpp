@@ -0,0 +1,145 @@
+/**
+ * Screen log module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "screen_log.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+const uint16_t LOG_BUFFER_SIZE = 200;
+// The log lives in RTC memory, so it is still there after a deep sleep
+RTC_DATA_ATTR char logBuffer[LOG_BUFFER_SIZE];
+RTC_DATA_ATTR uint16_t logHead = 0;
+RTC_DATA_ATTR uint16_t logTail = 0;
+RTC_DATA_ATTR uint16_t lineStartIndices[SCREEN_LOG_LINES];
+RTC_DATA_ATTR uint8_t lineStartIndex = 0; // The 'head' for the indices array
+RTC_DATA_ATTR uint8_t lineCount = 0;      // How many lines are currently in the buffer
+
+static uint16_t log_generation = 0;  // Counts log writes
+
+size_t screen_buffer_write(uint8_t c) {
+    // Ignore carriage returns
+    if (c < 32 && c != '\n') return 1; // Ignore non-printable characters except newline
+
+    log_generation++;
+
+    // --- Part 1: Manage the main logBuffer ---
+    logBuffer[logHead] = c;
+    logHead = (logHead + 1) % LOG_BUFFER_SIZE;
+
+    // If the buffer is full, advance the tail
+    if (logHead == logTail) {
+        // Check if the character we are about to overwrite was a newline.
+        // If so, we are losing a line and must decrease our line count.
+        if (logBuffer[logTail] == '\n' && lineCount > 0) {
+            lineCount--;
+        }
+        logTail = (logTail + 1) % LOG_BUFFER_SIZE;
+    }
+
+    // --- Part 2: Manage the lineStartIndices array ---
+    if (c == '\n') {
+        // Store the starting position of the *next* line
+        lineStartIndices[lineStartIndex] = logHead;
+
+        // Advance the index for the line starts, wrapping if needed
+        lineStartIndex = (lineStartIndex + 1) % SCREEN_LOG_LINES;
+
+        // Keep track of how many lines we have, but don't exceed the max
+        if (lineCount < SCREEN_LOG_LINES) {
+            lineCount++;
+        }
+    }
+    return 1;
+}
+
+size_t screen_buffer_write(const char *str) {
+  // interpretation from OLEDDisplay::write()
+  if (str == NULL)
+    return 0;
+  size_t length = strlen(str);
+  for (size_t i = 0; i < length; i++) {
+    screen_buffer_write(str[i]);
+  }
+  return length;
+}
+
+uint16_t screen_log_generation(void) {
+  return log_generation;
+}
+
+void screen_log_lines(void (*line)(uint8_t row, const char *text, void *ctx), void *ctx) {
+    uint16_t startIndex;
+
+    if (lineCount < SCREEN_LOG_LINES) {
+        // If we have fewer lines than the max, start from the very beginning.
+        startIndex = logTail;
+    } else {
+        // Start from the oldest line in lineStartIndices
+    startIndex = lineStartIndices[(lineStartIndex - lineCount + SCREEN_LOG_LINES) % SCREEN_LOG_LINES];
+    }
+
+    uint8_t linesDrawn = 0;
+    char lineBuffer[SCREEN_LOG_LINE_LEN + 1];
+    uint8_t linePos = 0;
+    uint16_t i = startIndex;
+
+    while (i != logHead) {
+        char character = logBuffer[i];
+
+        if (character == '\n' || linePos >= SCREEN_LOG_LINE_LEN) {
+          lineBuffer[linePos] = '\0';
+          if (linesDrawn < SCREEN_LOG_LINES) {
+              line(linesDrawn, lineBuffer, ctx);
+              linesDrawn++;
+          }
+          linePos = 0;
+        } else {
+            lineBuffer[linePos++] = character;
+        }
+        i = (i + 1) % LOG_BUFFER_SIZE;
+    }
+
+    if (linePos > 0) {
+        lineBuffer[linePos] = '\0';
+        line(linesDrawn, lineBuffer, ctx);
+    }
+}
+
+void screen_rle(const uint8_t *buffer, uint16_t width, uint16_t height,
+                void (*run)(bool white, uint32_t length, void *ctx), void *ctx) {
+  bool state = buffer[0] & 1;
+  uint32_t length = 0;
+
+  for (uint16_t y = 0; y < height; y++) {
+    const uint8_t *page = buffer + (y / 8) * width;
+    uint8_t bit = y % 8;
+    for (uint16_t x = 0; x < width; x++) {
+      bool white = (page[x] >> bit) & 1;
+      if (white == state) {
+        length++;
+      } else {
+        run(state, length, ctx);
+        state = white;
+        length = 1;
+      }
+    }
+  }
+  run(state, length, ctx);
+}
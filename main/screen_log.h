@@ -0,0 +1,34 @@
+#pragma once
+
+/**
+ * The screen's scrolling log and the framebuffer dump, kept apart from the
+ * display library so the host build can run and time them.
+ *
+ * The log is a ring of characters in RTC memory, so it is still there after
+ * a deep sleep.  screen_log_lines() walks it the way screen_buffer_print()
+ * shows it: the last SCREEN_LOG_LINES lines, each cut at SCREEN_LOG_LINE_LEN
+ * characters, then what there is of the line being written.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCREEN_LOG_LINES 4
+#define SCREEN_LOG_LINE_LEN 30
+
+size_t screen_buffer_write(uint8_t c);
+size_t screen_buffer_write(const char *str);
+
+/** Counts log writes, to tell when the log on the screen is out of date */
+uint16_t screen_log_generation(void);
+
+/** Calls line() with each line to show and its row, from 0 at the top */
+void screen_log_lines(void (*line)(uint8_t row, const char *text, void *ctx), void *ctx);
+
+/**
+ * Run-length encodes a framebuffer (bytes of 8 vertical pixels, as the OLED
+ * library keeps it) row by row from the top left, calling run() for each run
+ * of white or black pixels.
+ */
+void screen_rle(const uint8_t *buffer, uint16_t width, uint16_t height,
+                void (*run)(bool white, uint32_t length, void *ctx), void *ctx);
@@ -0,0 +1,244 @@
+/**
+ * Settings store module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "settings.h"
+
+#include <Arduino.h>
+#include <esp32/rom/crc.h>
+#include <nvs.h>
+#include <string.h>
+
+#define SETTINGS_WRITES_KEY "_writes"  // In each namespace, the write counters of its keys
+#define SETTINGS_NS_KEYS 32            // Most keys of one namespace whose counters are kept
+
+// A write counter as kept in flash, by the CRC of the key name so keys can come and go
+struct setting_writes {
+  uint32_t key_crc;
+  uint32_t writes;
+};
+
+static struct setting *settings;
+static size_t settings_count;
+static uint32_t commits;
+static struct setting_writes writes_buffer[SETTINGS_NS_KEYS];
+
+static uint32_t setting_crc(const struct setting *s) {
+  return crc32_le(0, (const uint8_t *)s->value, s->size);
+}
+
+static uint32_t setting_key_crc(const struct setting *s) {
+  return crc32_le(0, (const uint8_t *)s->key, strlen(s->key));
+}
+
+static bool setting_read(nvs_handle_t h, struct setting *s) {
+  size_t len = s->size;
+  switch (s->type) {
+    case SETTING_U8:
+      return nvs_get_u8(h, s->key, (uint8_t *)s->value) == ESP_OK;
+    case SETTING_I32:
+      return nvs_get_i32(h, s->key, (int32_t *)s->value) == ESP_OK;
+    case SETTING_U32:
+      return nvs_get_u32(h, s->key, (uint32_t *)s->value) == ESP_OK;
+    case SETTING_BLOB:
+      // A blob of another size (i.e. after a library update) reads as missing
+      if (nvs_get_blob(h, s->key, NULL, &len) != ESP_OK || len != s->size)
+        return false;
+      return nvs_get_blob(h, s->key, s->value, &len) == ESP_OK;
+  }
+  return false;
+}
+
+static bool setting_write(nvs_handle_t h, const struct setting *s) {
+  switch (s->type) {
+    case SETTING_U8:
+      return nvs_set_u8(h, s->key, *(const uint8_t *)s->value) == ESP_OK;
+    case SETTING_I32:
+      return nvs_set_i32(h, s->key, *(const int32_t *)s->value) == ESP_OK;
+    case SETTING_U32:
+      return nvs_set_u32(h, s->key, *(const uint32_t *)s->value) == ESP_OK;
+    case SETTING_BLOB:
+      return nvs_set_blob(h, s->key, s->value, s->size) == ESP_OK;
+  }
+  return false;
+}
+
+static bool setting_dirty(const struct setting *s) {
+  return !s->found || s->crc != setting_crc(s);
+}
+
+static void settings_read_writes(nvs_handle_t h, const char *ns) {
+  size_t len = sizeof(writes_buffer);
+  if (nvs_get_blob(h, SETTINGS_WRITES_KEY, writes_buffer, &len) != ESP_OK)
+    return;
+  for (size_t i = 0; i < settings_count; i++) {
+    struct setting *s = &settings[i];
+    if (strcmp(s->ns, ns))
+      continue;
+    for (size_t n = 0; n < len / sizeof(writes_buffer[0]); n++)
+      if (writes_buffer[n].key_crc == setting_key_crc(s))
+        s->writes = writes_buffer[n].writes;
+  }
+}
+
+/** Stages the write counters of the namespace, for the commit that wrote its keys */
+static void settings_write_writes(nvs_handle_t h, const char *ns) {
+  size_t n = 0;
+  for (size_t i = 0; i < settings_count && n < SETTINGS_NS_KEYS; i++) {
+    if (strcmp(settings[i].ns, ns))
+      continue;
+    writes_buffer[n].key_crc = setting_key_crc(&settings[i]);
+    writes_buffer[n].writes = settings[i].writes;
+    n++;
+  }
+  nvs_set_blob(h, SETTINGS_WRITES_KEY, writes_buffer, n * sizeof(writes_buffer[0]));
+}
+
+void settings_begin(struct setting *table, size_t count) {
+  settings = table;
+  settings_count = count;
+}
+
+/** Overwrites the variables of this namespace with what flash holds, false if the namespace is missing */
+bool settings_load(const char *ns) {
+  nvs_handle_t h;
+  if (nvs_open(ns, NVS_READONLY, &h) != ESP_OK)
+    return false;
+  for (size_t i = 0; i < settings_count; i++) {
+    struct setting *s = &settings[i];
+    if (strcmp(s->ns, ns))
+      continue;
+    s->found = setting_read(h, s);
+    if (s->found)
+      s->crc = setting_crc(s);
+  }
+  settings_read_writes(h, ns);
+  nvs_close(h);
+  return true;
+}
+
+/** Reads only the write counters of this namespace, where its variables came from elsewhere (i.e. RTC memory) */
+bool settings_load_writes(const char *ns) {
+  nvs_handle_t h;
+  if (nvs_open(ns, NVS_READONLY, &h) != ESP_OK)
+    return false;
+  settings_read_writes(h, ns);
+  nvs_close(h);
+  return true;
+}
+
+bool settings_found(const void *value) {
+  for (size_t i = 0; i < settings_count; i++)
+    if (settings[i].value == value)
+      return settings[i].found;
+  return false;
+}
+
+/** What flash holds for this key, as a CRC, false if nothing */
+bool settings_shadow(const void *value, uint32_t *crc) {
+  for (size_t i = 0; i < settings_count; i++) {
+    if (settings[i].value == value) {
+      *crc = settings[i].crc;
+      return settings[i].found;
+    }
+  }
+  return false;
+}
+
+/** Restores a shadow kept elsewhere (i.e. RTC memory), in place of loading the key from flash */
+void settings_set_shadow(const void *value, bool found, uint32_t crc) {
+  for (size_t i = 0; i < settings_count; i++) {
+    if (settings[i].value == value) {
+      settings[i].found = found;
+      settings[i].crc = crc;
+    }
+  }
+}
+
+int settings_dirty(void) {
+  int dirty = 0;
+  for (size_t i = 0; i < settings_count; i++)
+    if (setting_dirty(&settings[i]))
+      dirty++;
+  return dirty;
+}
+
+/** Writes every changed key, one commit per namespace.  Returns the number of keys written. */
+int settings_commit(void) {
+  int written = 0;
+  for (size_t i = 0; i < settings_count; i++) {
+    // Each namespace is handled at its first key, and only opened if something in it changed
+    bool seen = false, dirty = false;
+    for (size_t j = 0; j < settings_count; j++) {
+      if (strcmp(settings[j].ns, settings[i].ns))
+        continue;
+      if (j < i)
+        seen = true;
+      else if (setting_dirty(&settings[j]))
+        dirty = true;
+    }
+    if (seen || !dirty)
+      continue;
+
+    nvs_handle_t h;
+    if (nvs_open(settings[i].ns, NVS_READWRITE, &h) != ESP_OK) {
+      Serial.printf("Settings: cannot open %s\n", settings[i].ns);
+      continue;
+    }
+    for (size_t j = i; j < settings_count; j++) {
+      struct setting *s = &settings[j];
+      if (strcmp(s->ns, settings[i].ns) || !setting_dirty(s))
+        continue;
+      if (setting_write(h, s)) {
+        s->found = true;
+        s->crc = setting_crc(s);
+        s->writes++;
+        written++;
+      }
+    }
+    settings_write_writes(h, settings[i].ns);
+    nvs_commit(h);
+    nvs_close(h);
+    commits++;
+  }
+  if (written)
+    Serial.printf("Settings: %d keys written.\n", written);
+  return written;
+}
+
+/** Clears the namespace in flash; its variables keep their values and count as unsaved */
+void settings_erase(const char *ns) {
+  nvs_handle_t h;
+  if (nvs_open(ns, NVS_READWRITE, &h) == ESP_OK) {
+    nvs_erase_all(h);
+    nvs_commit(h);
+    nvs_close(h);
+  }
+  for (size_t i = 0; i < settings_count; i++)
+    if (!strcmp(settings[i].ns, ns))
+      settings[i].found = false;
+}
+
+void settings_dump(void) {
+  Serial.printf("\n--- SETTINGS (%lu commits) ---\n", (unsigned long)commits);
+  for (size_t i = 0; i < settings_count; i++) {
+    const struct setting *s = &settings[i];
+    Serial.printf("%-8s %-14s writes=%lu%s\n", s->ns, s->key, (unsigned long)s->writes,
+                  setting_dirty(s) ? " dirty" : "");
+  }
+}
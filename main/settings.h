@@ -0,0 +1,55 @@
+#pragma once
+
+/**
+ * Settings store: one table of every key kept in flash (NVS).
+ *
+ * Each entry points at the live variable.  Loading fills the variable and
+ * remembers a CRC of what flash holds; committing writes only the keys whose
+ * variable no longer matches, with a single nvs_commit() per namespace.
+ * Nothing else has to mark a key dirty, just change the variable.
+ *
+ * The NVS types match what Preferences used, so existing flash contents load
+ * unchanged: putFloat/putDouble/putBytes are blobs, putBool/putUChar are u8.
+ *
+ * Each namespace also keeps the flash write counters of its keys, in one more
+ * blob that goes out with the same commit, so they count over the life of the
+ * flash.  Type 's' on the debug Serial port to list them.  Where the variables
+ * of a namespace are restored from elsewhere instead of settings_load(), the
+ * counters still have to be read with settings_load_writes(), or the next
+ * commit would write them back from 0.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum setting_type {
+  SETTING_U8,   // uint8_t, bool
+  SETTING_I32,  // int
+  SETTING_U32,  // unsigned int
+  SETTING_BLOB  // float, double, byte arrays
+};
+
+struct setting {
+  const char *ns;  // Namespace, at most 15 characters
+  const char *key;
+  enum setting_type type;
+  void *value;
+  size_t size;
+  bool found;       // Present in flash (loaded or committed)
+  uint32_t crc;     // Of the flash contents, when found
+  uint32_t writes;  // Flash writes, kept in flash with the key
+};
+
+#define SETTING(ns, key, type, var) \
+  { ns, key, type, &(var), sizeof(var), false, 0, 0 }
+
+void settings_begin(struct setting *table, size_t count);
+bool settings_load(const char *ns);
+bool settings_load_writes(const char *ns);
+bool settings_found(const void *value);
+bool settings_shadow(const void *value, uint32_t *crc);
+void settings_set_shadow(const void *value, bool found, uint32_t crc);
+int settings_dirty(void);
+int settings_commit(void);
+void settings_erase(const char *ns);
+void settings_dump(void);
@@ -34,7 +34,7 @@ void sleep_millis(uint64_t ms) {
 }
 
 void sleep_seconds(uint32_t seconds) {
-    esp_sleep_enable_timer_wakeup(seconds * 1000000);
+    esp_sleep_enable_timer_wakeup(seconds * 1000000ULL);
     esp_deep_sleep_start();
 }
 
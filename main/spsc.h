@@ -0,0 +1,52 @@
+#pragma once
+
+/**
+ * Lock-free single-producer, single-consumer queue of fixed-size items.
+ *
+ * One task pushes and one other task pops; neither ever blocks or takes a
+ * lock.  head is only written by the producer and tail only by the consumer,
+ * each published with release ordering and read with acquire ordering, so an
+ * item is fully copied before the other side can see it.  The item count must
+ * be a power of two.
+ *
+ *     struct radio_request requests[2];
+ *     struct spsc request_queue = SPSC(requests);
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+struct spsc {
+  uint8_t *items;
+  uint32_t item_size;
+  uint32_t count;
+  uint32_t head;  // Next slot to push, producer owned
+  uint32_t tail;  // Next slot to pop, consumer owned
+};
+
+#define SPSC(array) \
+  { (uint8_t *)(array), sizeof((array)[0]), sizeof(array) / sizeof((array)[0]), 0, 0 }
+
+/** False if the queue is full */
+static inline bool spsc_push(struct spsc *q, const void *item) {
+  uint32_t head = q->head;
+  if (head - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) == q->count)
+    return false;
+  memcpy(q->items + (head & (q->count - 1)) * q->item_size, item, q->item_size);
+  __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+/** False if the queue is empty */
+static inline bool spsc_pop(struct spsc *q, void *item) {
+  uint32_t tail = q->tail;
+  if (__atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == tail)
+    return false;
+  memcpy(item, q->items + (tail & (q->count - 1)) * q->item_size, q->item_size);
+  __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static inline bool spsc_empty(struct spsc *q) {
+  return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+}
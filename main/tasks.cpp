@@ -0,0 +1,42 @@
+/**
+ * Task statistics module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tasks.h"
+
+#include <Arduino.h>
+
+// About 40 characters per task, and an idle system has a dozen
+static char tasks_buffer[40 * 24];
+
+void tasks_dump(void) {
+#if configUSE_TRACE_FACILITY && configUSE_STATS_FORMATTING_FUNCTIONS
+  Serial.println("\n--- TASKS: state, priority, stack free (words), number, core ---");
+  vTaskList(tasks_buffer);
+  Serial.print(tasks_buffer);
+#endif
+
+#if configGENERATE_RUN_TIME_STATS && configUSE_STATS_FORMATTING_FUNCTIONS
+  Serial.println("--- CPU: run time (us), share ---");
+  vTaskGetRunTimeStats(tasks_buffer);
+  Serial.print(tasks_buffer);
+#else
+  Serial.println("Run-time stats need CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS in the framework's sdkconfig.");
+  Serial.printf("loopTask stack free: %u words\n", (unsigned)uxTaskGetStackHighWaterMark(NULL));
+#endif
+}
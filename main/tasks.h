@@ -0,0 +1,34 @@
+#pragma once
+
+/**
+ * Task layout.
+ *
+ * Core 0, PRO_CPU: the LoRaWAN MAC and radio.
+ *   radio     TASK_RADIO_*   Joins and uplinks: sendReceive() and
+ *                            activateOTAA() with their receive windows.  Above
+ *                            everything else on core 0, so RX1/RX2 open on time.
+ *
+ * Core 1, APP_CPU: everything the user sees.
+ *   loopTask  (Arduino)      loop(): GNSS ingest, mapper decisions, PMU and
+ *                            buttons, screen.  Priority 1, 8 KB stack.
+ *   gps_setup TASK_GPS_*     Baud rate detection and receiver setup at boot,
+ *                            then gone.  Same priority as the loop, which keeps
+ *                            running while it waits on the UART.
+ *
+ * The loop and the radio task only talk through the two lock-free queues in
+ * main.cpp (see spsc.h): requests one way, results the other.  The node
+ * belongs to the radio task from a request until its result.
+ *
+ * Type 't' on the debug Serial port for each task's state, stack headroom and
+ * share of CPU time (FreeRTOS run-time stats).
+ */
+
+#define TASK_RADIO_CORE 0
+#define TASK_RADIO_PRIORITY 3
+#define TASK_RADIO_STACK 8192
+
+#define TASK_GPS_CORE 1
+#define TASK_GPS_PRIORITY 1
+#define TASK_GPS_STACK 4096
+
+void tasks_dump(void);
@@ -0,0 +1,175 @@
+/**
+ * Text cache module
+ *
+ * Copyright (C) 2025 designer2k2 Stephan M.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "text.h"
+
+#include <string.h>
+
+#define TEXT_CACHE_ENTRIES 16  // A full screen: header, four log lines, menu, with room to spare
+#define TEXT_CACHE_LEN 40      // Longest string kept, with its terminator
+#define TEXT_MAX_WIDTH 128     // Columns
+#define TEXT_MAX_PAGES 3       // A glyph two bytes tall, shifted down into a third page
+
+// Font layout, as the OLEDDisplay library reads it
+#define FONT_HEIGHT 1
+#define FONT_FIRST_CHAR 2
+#define FONT_CHAR_COUNT 3
+#define FONT_JUMP_TABLE 4
+
+struct text_entry {
+  uint32_t hash;  // 0 when free
+  uint32_t used;  // For least recently used replacement
+  int16_t x;
+  int16_t y;
+  uint8_t align;
+  uint8_t page;   // First page of the bitmap
+  uint8_t pages;  // 0 when nothing shows
+  uint8_t left;   // First and last column that has pixels set
+  uint8_t right;
+  char text[TEXT_CACHE_LEN];
+  uint8_t bitmap[TEXT_MAX_PAGES][TEXT_MAX_WIDTH];
+};
+
+static struct text_entry cache[TEXT_CACHE_ENTRIES];
+static const uint8_t *font;
+static uint16_t screen_width;
+static uint16_t screen_pages;
+static uint32_t draws;
+static uint32_t hits;
+static uint32_t misses;
+
+void text_begin(const uint8_t *f, uint16_t width, uint16_t height) {
+  // Anything the bitmaps cannot hold is left to drawString()
+  bool fits = width <= TEXT_MAX_WIDTH && 1 + ((f[FONT_HEIGHT] - 1) >> 3) < TEXT_MAX_PAGES;
+  font = fits ? f : NULL;
+  screen_width = width;
+  screen_pages = height / 8;
+  memset(cache, 0, sizeof(cache));
+}
+
+/** Same steps as OLEDDisplay::drawStringInternal() and drawInternal(), into the entry instead of the screen */
+static void text_render(struct text_entry *e, size_t len) {
+  uint8_t height = font[FONT_HEIGHT];
+  uint8_t first = font[FONT_FIRST_CHAR];
+  const uint8_t *jump = font + FONT_JUMP_TABLE;
+  const uint8_t *data = jump + font[FONT_CHAR_COUNT] * 4;
+  uint8_t raster = 1 + ((height - 1) >> 3);
+  uint8_t offset = e->y & 7;
+
+  memset(e->bitmap, 0, sizeof(e->bitmap));
+  e->page = e->y >> 3;
+  e->pages = 0;
+  e->left = TEXT_MAX_WIDTH - 1;
+  e->right = 0;
+
+  int16_t width = 0;
+  for (size_t i = 0; i < len; i++)
+    width += jump[((uint8_t)e->text[i] - first) * 4 + 3];
+  int16_t x = e->x;
+  if (e->align == TEXT_CENTER)
+    x -= width >> 1;
+  else if (e->align == TEXT_RIGHT)
+    x -= width;
+  if (x + width < 0 || x >= (int16_t)screen_width || e->y >= (int16_t)screen_pages * 8)
+    return;
+
+  int16_t cursor = x;
+  for (size_t i = 0; i < len && cursor <= (int16_t)screen_width; i++) {
+    const uint8_t *glyph = jump + ((uint8_t)e->text[i] - first) * 4;
+    uint8_t advance = glyph[3];
+    if ((glyph[0] != 0xFF || glyph[1] != 0xFF) && cursor + advance >= 0) {
+      const uint8_t *bytes = data + (glyph[0] << 8 | glyph[1]);
+      uint16_t size = glyph[2] ? glyph[2] : advance * raster;
+      for (uint16_t b = 0; b < size; b++) {
+        int16_t column = cursor + b / raster;
+        uint8_t row = b % raster;
+        if (column < 0 || column >= (int16_t)screen_width || e->page + row >= screen_pages)
+          continue;
+        e->bitmap[row][column] |= bytes[b] << offset;
+        if (offset && e->page + row + 1 < screen_pages)
+          e->bitmap[row + 1][column] |= bytes[b] >> (8 - offset);
+        if (column < e->left)
+          e->left = column;
+        if (column > e->right)
+          e->right = column;
+        if (row + (offset ? 2 : 1) > e->pages)
+          e->pages = row + (offset ? 2 : 1);
+      }
+    }
+    cursor += advance;
+  }
+  if (e->page + e->pages > screen_pages)
+    e->pages = screen_pages - e->page;
+}
+
+bool text_draw(uint8_t *buffer, int16_t x, int16_t y, uint8_t align, const char *text) {
+  if (!font || !buffer || y < 0 || align > TEXT_CENTER)
+    return false;
+
+  // FNV-1a over what makes the picture, checking the text is drawable on the way
+  uint32_t hash = 2166136261u;
+  size_t len = 0;
+  for (; text[len]; len++) {
+    uint8_t c = text[len];
+    if (c < font[FONT_FIRST_CHAR] || c >= 128 || len + 1 >= TEXT_CACHE_LEN)
+      return false;
+    hash = (hash ^ c) * 16777619u;
+  }
+  hash = (hash ^ (uint16_t)x) * 16777619u;
+  hash = (hash ^ (uint16_t)y) * 16777619u;
+  hash = ((hash ^ align) * 16777619u) | 1;
+
+  draws++;
+  struct text_entry *e = NULL;
+  struct text_entry *oldest = &cache[0];
+  for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+    struct text_entry *c = &cache[i];
+    if (c->hash == hash && c->x == x && c->y == y && c->align == align && !strcmp(c->text, text)) {
+      e = c;
+      break;
+    }
+    if (c->used < oldest->used)
+      oldest = c;
+  }
+  if (e) {
+    hits++;
+  } else {
+    misses++;
+    e = oldest;
+    e->hash = hash;
+    e->x = x;
+    e->y = y;
+    e->align = align;
+    memcpy(e->text, text, len + 1);
+    text_render(e, len);
+  }
+  e->used = draws;
+
+  for (uint8_t p = 0; p < e->pages; p++) {
+    uint8_t *row = buffer + (e->page + p) * screen_width;
+    for (uint16_t column = e->left; column <= e->right; column++)
+      row[column] |= e->bitmap[p][column];
+  }
+  return true;
+}
+
+void text_stats(uint32_t *h, uint32_t *m) {
+  *h = hits;
+  *m = misses;
+}
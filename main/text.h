@@ -0,0 +1,25 @@
+#pragma once
+
+/**
+ * Cached text drawing for the OLED framebuffer.
+ *
+ * The screen is redrawn several times a second, and nearly every string on
+ * it is the same as the frame before.  text_draw() renders a string once into
+ * a bitmap laid out like the framebuffer (bytes of 8 vertical pixels), keyed
+ * by its text, position and alignment, and after that only ORs those bytes in.
+ * Rendering follows OLEDDisplay::drawString() for the same font pixel for
+ * pixel, clipping included, and like it only ever sets pixels (WHITE).
+ *
+ * Strings it does not handle return false, and the caller draws them with
+ * drawString(): newlines, characters outside the font's ASCII range, a
+ * position above the screen, CENTER_BOTH, or longer than the cache keeps.
+ */
+
+#include <stdint.h>
+
+/** Same values as OLEDDISPLAY_TEXT_ALIGNMENT */
+enum text_align { TEXT_LEFT, TEXT_RIGHT, TEXT_CENTER };
+
+void text_begin(const uint8_t *font, uint16_t width, uint16_t height);
+bool text_draw(uint8_t *buffer, int16_t x, int16_t y, uint8_t align, const char *text);
+void text_stats(uint32_t *hits, uint32_t *misses);
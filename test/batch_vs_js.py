@@ -0,0 +1,83 @@
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+# Decodes the same random frames with batch_decode --json and with
+# unified_decoder.js, and fails unless every line is the same text, so every
+# value is the same to the bit.  The frames come from a fixed seed: each
+# uplink message at its vector lengths, with and without a telemetry tail,
+# plus frames of the wrong length and on ports nothing decodes.
+#
+#   python test/batch_vs_js.py --batch-decode ./batch_decode
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+DECODERS = os.path.join(HERE, '..', 'console-decoders')
+SEED = 45
+UNKNOWN_PORTS = [0, 1, 4, 8, 223]
+
+
+def frames(n):
+    with open(os.path.join(DECODERS, 'payload_schema.json')) as f:
+        messages = [m for m in json.load(f)['messages'] if m['direction'] == 'uplink']
+    by_name = dict((m['name'], m) for m in messages)
+    rng = random.Random(SEED)
+    out = []
+    for i in range(n):
+        m = messages[i % len(messages)]
+        lengths = sorted(set(len(v['hex']) // 2 for v in m.get('vectors', [])))
+        kind = rng.randrange(8)
+        port = m['port']
+        length = rng.choice(lengths)
+        if kind < 2 and 'tail' in m:
+            length += len(by_name[m['tail']]['vectors'][0]['hex']) // 2
+        elif kind == 2:
+            length = rng.randrange(max(lengths) + 12)
+        elif kind == 3:
+            port = rng.choice(UNKNOWN_PORTS)
+        payload = bytearray(rng.randrange(256) for _ in range(length))
+        if payload and m['name'] == 'mapper_v2' and kind != 2:
+            payload[0] = (payload[0] & 0x1F) | 2 << 5  # The version it decodes
+        out.append((port, payload.hex().upper()))
+    return out
+
+
+def decode_js(cases):
+    with open(os.path.join(DECODERS, 'unified_decoder.js')) as f:
+        source = f.read()
+    script = source + '\nvar cases = ' + json.dumps(cases) + ''';
+cases.forEach(function (c) {
+  console.log(JSON.stringify(Decoder(Buffer.from(c[1], "hex"), c[0])));
+});
+'''
+    return subprocess.run(['node'], input=script, check=True, capture_output=True, text=True).stdout.splitlines()
+
+
+def decode_batch(path, cases):
+    with tempfile.NamedTemporaryFile('w', suffix='.txt') as f:
+        f.writelines('%d %s\n' % c for c in cases)
+        f.flush()
+        return subprocess.run([path, '--hex', '--json', f.name], check=True, capture_output=True,
+                              text=True).stdout.splitlines()
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Check batch_decode against unified_decoder.js on random frames.')
+    parser.add_argument('--batch-decode', required=True, help='Path of the built batch_decode')
+    parser.add_argument('--frames', type=int, default=5000)
+    args = parser.parse_args()
+
+    cases = frames(args.frames)
+    js = decode_js(cases)
+    batch = decode_batch(args.batch_decode, cases)
+    mismatches = [(c, a, b) for c, a, b in zip(cases, js, batch) if a != b]
+    if len(js) != len(cases) or len(batch) != len(cases):
+        mismatches.append((None, '%d lines' % len(js), '%d lines' % len(batch)))
+    for case, a, b in mismatches[:10]:
+        print('%s\n  unified_decoder.js %s\n  batch_decode       %s' % (case, a, b))
+    decoded = sum(1 for line in js if line != '{}')
+    print('%d frames, %d decoded, %d mismatches' % (len(cases), decoded, len(mismatches)))
+    sys.exit(1 if mismatches else 0)
@@ -0,0 +1,90 @@
+import argparse
+import os
+import random
+
+# Writes the synthetic discharge curves in this folder, which
+# battery_forecast.cpp replays.  They are not logs from a Mapper: each comes
+# from a cell model deliberately unlike the one in main/battery.cpp, with its
+# own rest curve, capacity and resistance, a coulomb counter that reads high,
+# and a load that switches between driving and parked with uplinks on top.
+# One reading a minute, as battery_sample() takes them, down to the cutoff
+# under load.
+#
+#   python test/battery/make_curves.py
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+CUTOFF_MV = 3100
+COUNTER_GAIN = 1.015  # The counter reads 1.5% high
+DRIVING_MA = 150
+PARKED_MA = 95
+UPLINK_MA = 120       # On top, for the seconds an uplink is on air
+UPLINK_SHARE = 0.02   # Of the seconds
+
+# State of charge to rest voltage of the model cell
+OCV = [(0, 3000), (.05, 3350), (.1, 3480), (.2, 3590), (.3, 3650), (.4, 3700), (.5, 3745), (.6, 3810),
+       (.7, 3890), (.8, 3960), (.9, 4060), (1, 4190)]
+
+# name, seed, capacity mAh, resistance ohm, start state of charge, PMU
+CURVES = [
+    ('axp192_full.csv', 1, 2600, 0.14, 0.97, 'AXP192'),
+    ('axp192_aged.csv', 2, 1900, 0.22, 0.62, 'AXP192'),
+    ('axp2101_full.csv', 3, 2600, 0.14, 0.97, 'AXP2101'),
+]
+
+HEADER = '''# Synthetic, written by make_curves.py: not logged from a Mapper.
+# Discharge from %s down to %.1f V under load, one reading a minute as battery_sample() takes them, from
+# a cell model unlike the one in battery.cpp: its own rest curve, %d mAh, %d mOhm, a counter reading
+# 1.5%% high, and a load that changes between driving (%d mA) and parked (%d mA) with uplinks on top.
+# Empty ma and mah are a PMU without a counter, gauge -1 one without a fuel gauge.
+'''
+
+
+def ocv(soc):
+    for (s0, v0), (s1, v1) in zip(OCV, OCV[1:]):
+        if soc <= s1:
+            return v0 + (soc - s0) / (s1 - s0) * (v1 - v0)
+    return OCV[-1][1]
+
+
+def curve(seed, capacity, resistance, soc, pmu):
+    rng = random.Random(seed)
+    t = 0
+    mah = 0.0
+    gauge_soc = soc
+    driving = True
+    phase = 0
+    while True:
+        # Driving with the screen on for a while, then parked for a while
+        phase -= 1
+        if phase <= 0:
+            driving = not driving
+            phase = rng.randint(20, 90) if driving else rng.randint(5, 40)
+        load = (DRIVING_MA if driving else PARKED_MA) + rng.gauss(0, 6)
+        for _ in range(60):
+            ma = load + (UPLINK_MA if rng.random() < UPLINK_SHARE else 0)
+            soc -= ma / 3600 / capacity
+            mah -= ma / 3600 * COUNTER_GAIN
+        t += 60
+        ma = load + (UPLINK_MA if rng.random() < UPLINK_SHARE else 0)
+        mv = ocv(soc) - ma * resistance + rng.gauss(0, 4)
+        if mv < CUTOFF_MV:
+            return
+        gauge_soc += (soc - gauge_soc) * 0.2  # The fuel gauge lags and is noisy
+        if pmu == 'AXP192':
+            yield t, round(mv), str(-round(ma)), '%.2f' % mah, -1
+        else:
+            yield t, round(mv), '', '', max(0, min(100, round(gauge_soc * 100 + rng.gauss(0, 1.5))))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Write the synthetic discharge curves for battery_forecast.cpp.')
+    parser.add_argument('--out', default=HERE, help='Folder to write them to')
+    args = parser.parse_args()
+
+    for name, seed, capacity, resistance, soc, pmu in CURVES:
+        start = 'full' if soc > 0.9 else '%d%%' % round(soc * 100)
+        with open(os.path.join(args.out, name), 'w') as f:
+            f.write(HEADER % (start, CUTOFF_MV / 1000, capacity, resistance * 1000, DRIVING_MA, PARKED_MA))
+            f.write('t_s,mv,ma,mah,gauge\n')
+            for row in curve(seed, capacity, resistance, soc, pmu):
+                f.write('%d,%d,%s,%s,%d\n' % row)
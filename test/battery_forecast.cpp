@@ -0,0 +1,118 @@
+// Replays the discharge curves in battery/ through main/battery.cpp and fails
+// when the runtime forecast strays too far from when the cell actually ran
+// down, or when the cadence stretch does not follow the shift.  Curves whose
+// header says "# Synthetic" (from battery/make_curves.py) are reported as such,
+// so their figures are not taken for a real cell's.
+//
+//   build/battery_forecast battery/*.csv
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "battery.h"
+
+#define CUTOFF_MV 3100           // Where every curve ends
+#define SETTLE 0.2               // Of the run, before the forecast is held to account
+#define MAX_MEAN_ERROR 0.10      // Of the run, averaged over the rest of it
+#define MAX_WORST_ERROR 0.25     // Of the run, at any one reading after SETTLE
+#define MAX_READINGS 4096
+
+static struct battery_reading readings[MAX_READINGS];
+static bool synthetic;  // Of the curve last loaded
+
+// The next comma separated field, empty at the end of the line
+static char *field(char **p) {
+  char *start = *p;
+  *p += strcspn(*p, ",\n");
+  if (**p)
+    *(*p)++ = 0;
+  return start;
+}
+
+static size_t load(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return 0;
+  }
+  char line[128];
+  size_t n = 0;
+  synthetic = false;
+  while (n < MAX_READINGS && fgets(line, sizeof(line), f)) {
+    synthetic |= !strncmp(line, "# Synthetic", 11);
+    if (line[0] == '#' || !strncmp(line, "t_s,", 4))
+      continue;
+    // t_s,mv,ma,mah,gauge with ma and mah empty where the PMU has no counter
+    struct battery_reading *r = &readings[n++];
+    char *p = line, *ma, *mah;
+    r->now_s = strtoul(field(&p), NULL, 10);
+    r->mv = strtoul(field(&p), NULL, 10);
+    ma = field(&p);
+    r->ma = *ma ? (int16_t)atoi(ma) : BATTERY_MA_UNKNOWN;
+    mah = field(&p);
+    r->mah = *mah ? strtof(mah, NULL) : NAN;
+    r->gauge = atoi(field(&p));
+    r->cutoff_mv = CUTOFF_MV;
+  }
+  fclose(f);
+  return n;
+}
+
+// The forecast, against the time that was left, with no shift
+static bool check_forecast(const char *name, size_t n) {
+  uint32_t start = readings[0].now_s, end = readings[n - 1].now_s + 60;
+  double run = end - start, sum = 0, worst = 0;
+  size_t held = 0;
+  battery_begin(true, start);
+  for (size_t i = 0; i < n; i++) {
+    battery_update(&readings[i], 0);
+    uint32_t forecast = battery_runtime_s();
+    if (readings[i].now_s - start < SETTLE * run)
+      continue;
+    double error = forecast == BATTERY_RUNTIME_UNKNOWN ? 1.0 : fabs((double)forecast - (end - readings[i].now_s)) / run;
+    sum += error;
+    worst = error > worst ? error : worst;
+    held++;
+  }
+  double mean = held ? sum / held : 1.0;
+  bool pass = mean <= MAX_MEAN_ERROR && worst <= MAX_WORST_ERROR;
+  printf("%-28s %5.1f h, forecast error %4.1f%% mean, %4.1f%% worst%s\n", name, run / 3600, 100 * mean, 100 * worst,
+         pass ? "" : "  FAIL");
+  return pass;
+}
+
+// A shift the cell falls well short of is stretched for, one it outlasts is not
+static bool check_stretch(const char *name, size_t n) {
+  uint32_t start = readings[0].now_s, run = readings[n - 1].now_s + 60 - start;
+  float stretch[2];
+  for (int longer = 0; longer < 2; longer++) {
+    battery_begin(true, start);
+    for (size_t i = 0; i < n; i++)
+      battery_update(&readings[i], longer ? run * 2 : run / 2);
+    stretch[longer] = battery_stretch();
+  }
+  bool pass = stretch[0] < 1.05f && stretch[1] > 1.5f;
+  printf("%-28s stretch x%.2f for half the run, x%.2f for twice%s\n", name, stretch[0], stretch[1],
+         pass ? "" : "  FAIL");
+  return pass;
+}
+
+int main(int argc, char **argv) {
+  bool pass = argc > 1;
+  for (int i = 1; i < argc; i++) {
+    const char *base = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+    size_t n = load(argv[i]);
+    char name[64];
+    snprintf(name, sizeof(name), "%s%s", base, synthetic ? " (synthetic)" : "");
+    if (n < 2) {
+      printf("%-28s no readings  FAIL\n", name);
+      pass = false;
+      continue;
+    }
+    pass &= check_forecast(name, n);
+    pass &= check_stretch(name, n);
+  }
+  return pass ? 0 : 1;
+}
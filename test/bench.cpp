@@ -0,0 +1,7 @@
+// Host driver for the firmware benchmarks in main/bench.cpp, exits 1 on a "BENCH FAIL"
+
+#include "bench.h"
+
+int main(void) {
+  return bench_run() ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+# Times the three uplink decoders on the golden vector frames of the schema and
+# fails when one decodes fewer frames a second than its floor.  The floors are
+# several times under a laptop, for a shared CI runner.
+#
+#   python test/bench_decoders.py --batch-decode ./batch_decode
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+DECODERS = os.path.join(HERE, '..', 'console-decoders')
+sys.path.insert(0, DECODERS)
+sys.dont_write_bytecode = True
+
+import payload_codec  # noqa: E402
+
+FLOORS = {'payload_codec.py': 4000, 'unified_decoder.js': 40000, 'batch_decode': 500000}
+
+
+def frames():
+    with open(os.path.join(DECODERS, 'payload_schema.json')) as f:
+        messages = json.load(f)['messages']
+    by_name = dict((m['name'], m) for m in messages)
+    out = []
+    for m in messages:
+        if m['direction'] != 'uplink':
+            continue
+        out += [(m['port'], v['hex']) for v in m.get('vectors', [])]
+        if 'tail' in m and m.get('vectors'):
+            out.append((m['port'], m['vectors'][0]['hex'] + by_name[m['tail']]['vectors'][0]['hex']))
+    return out
+
+
+def bench_python(cases, n):
+    payloads = [(port, bytes.fromhex(h)) for port, h in cases]
+    start = time.perf_counter()
+    for i in range(n):
+        port, payload = payloads[i % len(payloads)]
+        payload_codec.decode(port, payload)
+    return n / (time.perf_counter() - start)
+
+
+def bench_js(cases, n):
+    with open(os.path.join(DECODERS, 'unified_decoder.js')) as f:
+        source = f.read()
+    script = source + '\nvar cases = ' + json.dumps(cases) + ''';
+var payloads = cases.map(function (c) { return [c[0], Buffer.from(c[1], "hex")]; });
+var n = %d, sink = 0;
+var start = process.hrtime.bigint();
+for (var i = 0; i < n; i++) {
+  var c = payloads[i %% payloads.length];
+  sink += Object.keys(Decoder(c[1], c[0])).length;
+}
+console.log(JSON.stringify([n / (Number(process.hrtime.bigint() - start) / 1e9), sink]));
+''' % n
+    return json.loads(subprocess.run(['node', '-e', script], check=True, capture_output=True).stdout)[0]
+
+
+def bench_batch(path, n):
+    out = subprocess.run([path, '--bench', str(n)], check=True, capture_output=True, text=True).stdout
+    return float(re.search(r'([0-9.]+) frames/s', out).group(1))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Benchmark the uplink decoders against their floors.')
+    parser.add_argument('--batch-decode', help='Path of the built batch_decode, skipped without it')
+    parser.add_argument('--frames', type=int, default=200000, help='Frames per decoder')
+    args = parser.parse_args()
+
+    cases = frames()
+    rates = {'payload_codec.py': bench_python(cases, args.frames // 10)}
+    if shutil.which('node'):
+        rates['unified_decoder.js'] = bench_js(cases, args.frames)
+    else:
+        print('node not found, unified_decoder.js not timed')
+    if args.batch_decode:
+        rates['batch_decode'] = bench_batch(args.batch_decode, args.frames * 5)
+
+    failed = False
+    for name, rate in rates.items():
+        ok = rate >= FLOORS[name]
+        failed |= not ok
+        print('%-20s %10.0f frames/s  floor %8d  %s' % (name, rate, FLOORS[name], 'OK' if ok else 'SLOW'))
+    print('--- DECODER BENCH %s ---' % ('FAIL' if failed else 'PASS'))
+    sys.exit(1 if failed else 0)
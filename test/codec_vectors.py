@@ -0,0 +1,105 @@
+import json
+import os
+import subprocess
+import sys
+
+# Runs the golden vectors of payload_schema.json through the generated
+# payload_codec.py and unified_decoder.js as they are checked in, and fails on
+# any mismatch between them and the vectors or each other.  codec_gen.py checks
+# its own in-memory output before writing; this checks what ships.
+#
+#   python test/codec_vectors.py
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+DECODERS = os.path.join(HERE, '..', 'console-decoders')
+sys.path.insert(0, DECODERS)
+sys.dont_write_bytecode = True
+
+import payload_codec  # noqa: E402
+
+
+def engineering(field, raw):
+    # A wire value as the codecs take it in, for the fields and commands that scale
+    value = raw
+    if 'div' in field:
+        value = value / field['div']
+    if 'mul' in field:
+        value = value * field['mul']
+    return value + field.get('add', 0)
+
+
+def js_run(calls):
+    # Each call is [function, args...], the results come back in order
+    with open(os.path.join(DECODERS, 'unified_decoder.js')) as f:
+        source = f.read()
+    script = source + '\nvar calls = ' + json.dumps(calls) + ''';
+console.log(JSON.stringify(calls.map(function (c) {
+  if (c[0] == "Decoder")
+    return Decoder(Buffer.from(c[1], "hex"), c[2]);
+  return Buffer.from(Encoder(c[1], c[2])).toString("hex").toUpperCase();
+})));
+'''
+    return json.loads(subprocess.run(['node', '-e', script], check=True, capture_output=True).stdout)
+
+
+def check():
+    with open(os.path.join(DECODERS, 'payload_schema.json')) as f:
+        schema = json.load(f)
+    by_name = dict((m['name'], m) for m in schema['messages'])
+    errors = []
+    js_calls = []  # With what Python made of the same vector, to compare
+    count = 0
+
+    for m in schema['messages']:
+        wire = [f for f in m['fields'] if 'bits' in f and 'match' not in f]
+        for n, vector in enumerate(m.get('vectors', [])):
+            what = '%s vector %d' % (m['name'], n)
+            payload = bytes.fromhex(vector['hex'])
+            count += 1
+            got = payload_codec.encode_raw(m['name'], vector['raw']).hex().upper()
+            if got != vector['hex'].upper():
+                errors.append('%s: payload_codec.py encodes %s' % (what, got))
+            want_raw = dict((f['name'], vector['raw'].get(f['name'], 0)) for f in wire)
+            back = payload_codec.decode_raw(m['name'], payload)
+            if back != want_raw:
+                errors.append('%s: payload_codec.py decodes %s' % (what, back))
+            decoded = payload_codec.decode(m['port'], payload, m['direction'])
+            if m['direction'] == 'uplink':
+                js_calls.append((what, ['Decoder', vector['hex'], m['port']], decoded))
+            else:
+                got = payload_codec.encode(m['name'], decoded).hex().upper()
+                if got != vector['hex'].upper():
+                    errors.append('%s: payload_codec.py encodes %s back to %s' % (what, decoded, got))
+                values = dict((f['name'], engineering(f, vector['raw'].get(f['name'], 0))) for f in wire)
+                js_calls.append((what, ['Encoder', values, m['port']], vector['hex'].upper()))
+        # The frame with its tail appended, merged the same way by both
+        if 'tail' in m and m.get('vectors'):
+            joined = m['vectors'][0]['hex'] + by_name[m['tail']]['vectors'][0]['hex']
+            decoded = payload_codec.decode(m['port'], bytes.fromhex(joined))
+            count += 1
+            js_calls.append(('%s with %s tail' % (m['name'], m['tail']), ['Decoder', joined, m['port']], decoded))
+
+    commands = dict((c['name'], c) for c in schema['commands']['list'])
+    for n, vector in enumerate(schema['commands'].get('vectors', [])):
+        what = 'command vector %d' % n
+        raw = [tuple(c) for c in vector['raw']]
+        count += 1
+        got = payload_codec.encode_commands([(name, engineering(commands[name], value)) for name, value in raw])
+        if got.hex().upper() != vector['hex'].upper():
+            errors.append('%s: payload_codec.py encodes %s' % (what, got.hex().upper()))
+        back = payload_codec.decode_commands(bytes.fromhex(vector['hex']))
+        if back != raw:
+            errors.append('%s: payload_codec.py decodes %s' % (what, back))
+
+    for (what, call, want), got in zip(js_calls, js_run([c[1] for c in js_calls])):
+        if got != want:
+            errors.append('%s: unified_decoder.js gives %s, payload_codec.py %s' % (what, got, want))
+    return count, errors
+
+
+if __name__ == '__main__':
+    count, errors = check()
+    for e in errors:
+        print(e)
+    print('%d vectors, %d mismatches' % (count, len(errors)))
+    sys.exit(1 if errors else 0)
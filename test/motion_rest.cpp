@@ -0,0 +1,222 @@
+// Drives main/motion.cpp through drives and stops of one fix a second, and
+// fails unless:
+//
+// - a clean stop parks within MOTION_PARK_S, and the Mapper rests at once;
+// - parked, GPS jitter with multipath jumps, or fixes that scatter tens of
+//   meters, never count as moving;
+// - the first real drive, or a creep too slow for the speed, does;
+// - parked survives deep sleep, which starts millis() over;
+// - fixes too poor to judge or scattering too far to look still, which keep
+//   the state MOTION_MOVING after a drive, do not keep the Mapper awake: it
+//   still goes to REST and SLEEP by REST_WAIT and SLEEP_WAIT.
+//
+//   build/motion_rest
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "configuration.h"
+#include "motion.h"
+
+#define DRIVE_S 300
+#define START_LAT_E7 482000000
+#define START_LON_E7 163700000
+#define METERS_PER_E7 0.0111319f
+#define LON_METERS_PER_E7 0.0074f  // At START_LAT_E7
+
+enum fixes { DRIVE, CREEP, STILL, JITTER, SCATTER, GATED, MIXED };
+
+enum activity { MOVING, REST, SLEEP };
+static const char *activity_names[] = {"MOVING", "REST", "SLEEP"};
+static const char *state_names[] = {"UNKNOWN", "MOVING", "PARKED"};
+
+static uint32_t ms;            // millis() of the next fix
+static uint32_t last_moved_ms;
+static float north_m;          // Where the Mapper really is
+static uint32_t fix_count;
+
+static float gauss(void) {
+  float u = (rand() + 1.0f) / (RAND_MAX + 2.0f), v = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  return sqrtf(-2.0f * logf(u)) * cosf(6.2831853f * v);
+}
+
+// The next fix of this kind, one second after the last
+static struct motion_fix next_fix(enum fixes kind) {
+  struct motion_fix f = {ms, 0, 0, 0.0f, 1.2f, 8, 25};
+  float dx = 0.0f, dy = 0.0f;
+  fix_count++;
+  if (kind == MIXED)
+    kind = fix_count % 2 ? GATED : SCATTER;
+  switch (kind) {
+    case DRIVE:
+      north_m += 12.0f;
+      f.speed_mps = 12.0f + 0.2f * gauss();
+      break;
+    case CREEP:  // Pushed along at walking pace, slower than MOTION_MOVE_MPS
+      north_m += 0.8f;
+      f.speed_mps = fabsf(0.8f + 0.2f * gauss());
+      dx = 1.5f * gauss();
+      dy = 1.5f * gauss();
+      break;
+    case STILL:
+    case JITTER:  // Doppler speed noise of a parked receiver is about 0.1 m/s
+      f.speed_mps = fabsf(0.1f * gauss());
+      dx = 1.5f * gauss();
+      dy = 1.5f * gauss();
+      if (kind == JITTER && fix_count % 200 == 0) {  // A multipath jump
+        dx += 60.0f;
+        f.speed_mps = 2.0f;
+      }
+      break;
+    case SCATTER:  // A receiver in a street canyon: slow but not still, tens of meters of scatter
+      f.speed_mps = fabsf(0.6f + 0.3f * gauss());
+      dx = 25.0f * gauss();
+      dy = 25.0f * gauss();
+      f.hacc_dm = 40;
+      break;
+    default:  // GATED
+      f.speed_mps = 0.1f;
+      if (fix_count % 3)
+        f.sats = 3;
+      else
+        f.hdop = 8.0f;
+      break;
+  }
+  f.lat_e7 = START_LAT_E7 + (int32_t)((north_m + dy) / METERS_PER_E7);
+  f.lon_e7 = START_LON_E7 + (int32_t)(dx / LON_METERS_PER_E7);
+  ms += 1000;
+  return f;
+}
+
+// As motion_sample() and update_activity() in main.cpp, leaving out the GPS lost and USB cases
+static enum activity activity(void) {
+  if (ms - last_moved_ms > SLEEP_WAIT * 1000UL)
+    return SLEEP;
+  if (ms - last_moved_ms > REST_WAIT * 1000UL || motion_now() == MOTION_PARKED)
+    return REST;
+  return MOVING;
+}
+
+// Feeds `seconds` fixes of a kind, returns how many of them left the state MOTION_MOVING
+static uint32_t run(enum fixes kind, uint32_t seconds) {
+  uint32_t moving = 0;
+  for (uint32_t i = 0; i < seconds; i++) {
+    struct motion_fix f = next_fix(kind);
+    motion_update(&f);
+    if (motion_moved())
+      last_moved_ms = f.ms;
+    moving += motion_now() == MOTION_MOVING;
+  }
+  return moving;
+}
+
+// Seconds of fixes of a kind until the state is `want`, or `limit` if it never got there
+static uint32_t run_until(enum fixes kind, enum motion_state want, uint32_t limit) {
+  uint32_t s = 0;
+  while (s < limit && motion_now() != want) {
+    run(kind, 1);
+    s++;
+  }
+  return s;
+}
+
+static void start(void) {
+  srand(50);
+  motion_begin(true);
+  ms = 5000;
+  last_moved_ms = 0;
+  north_m = 0.0f;
+  fix_count = 0;
+}
+
+static bool report(const char *name, bool pass, const char *format, ...) __attribute__((format(printf, 3, 4)));
+static bool report(const char *name, bool pass, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  printf("%-22s ", name);
+  vprintf(format, args);
+  printf("%s\n", pass ? "" : "  FAIL");
+  va_end(args);
+  return pass;
+}
+
+// Drive, then stop cleanly: parked within MOTION_PARK_S and a few fixes for the statistics
+static uint32_t drive_and_park(void) {
+  run(DRIVE, DRIVE_S);
+  return run_until(STILL, MOTION_PARKED, 3600);
+}
+
+static bool check_park(void) {
+  start();
+  run(DRIVE, DRIVE_S);
+  enum motion_state driving = motion_now();
+  uint32_t s = run_until(STILL, MOTION_PARKED, 3600);
+  return report("clean stop", driving == MOTION_MOVING && s <= MOTION_PARK_S + 5 && activity() == REST,
+                "%s while driving, parked after %u s, then %s", state_names[driving], (unsigned)s,
+                activity_names[activity()]);
+}
+
+static bool check_parked(enum fixes kind, const char *name) {
+  start();
+  drive_and_park();
+  uint32_t moving = run(kind, 3600);
+  return report(name, moving == 0 && motion_now() == MOTION_PARKED, "%u s of an hour MOVING, then %s",
+                (unsigned)moving, state_names[motion_now()]);
+}
+
+static bool check_leave(enum fixes kind, const char *name, uint32_t limit) {
+  start();
+  drive_and_park();
+  uint32_t s = run_until(kind, MOTION_MOVING, 600);
+  return report(name, s <= limit && activity() == MOVING, "MOVING after %u s, then %s", (unsigned)s,
+                activity_names[activity()]);
+}
+
+static bool check_sleep(void) {
+  start();
+  drive_and_park();
+  run(STILL, 60);
+  // Deep sleep: RTC memory stays, millis() starts over
+  motion_begin(false);
+  ms = 1000;
+  last_moved_ms = 0;
+  uint32_t moving = run(JITTER, 5);
+  enum motion_state woke = motion_now();  // Before it could have parked again
+  moving += run(JITTER, 300);
+  uint32_t s = run_until(DRIVE, MOTION_MOVING, 600);
+  motion_begin(true);
+  return report("deep sleep", woke == MOTION_PARKED && moving == 0 && s <= 5 && motion_now() == MOTION_UNKNOWN,
+                "woke %s, MOVING after %u s of driving, %s on a reset", state_names[woke], (unsigned)s,
+                state_names[motion_now()]);
+}
+
+static bool check_rest(enum fixes kind, const char *name) {
+  start();
+  run(DRIVE, DRIVE_S);
+  enum motion_state driving = motion_now();
+  run(kind, REST_WAIT + 2);
+  enum activity at_rest = activity();
+  run(kind, SLEEP_WAIT - REST_WAIT);
+  enum activity at_sleep = activity();
+  bool pass = driving == MOTION_MOVING &&
+              (kind == DRIVE ? at_rest == MOVING && at_sleep == MOVING : at_rest != MOVING && at_sleep == SLEEP);
+  return report(name, pass, "%s after the drive, then %s, then %s", state_names[driving], activity_names[at_rest],
+                activity_names[at_sleep]);
+}
+
+int main(void) {
+  bool pass = true;
+  pass &= check_park();
+  pass &= check_parked(JITTER, "parked, jitter");
+  pass &= check_parked(SCATTER, "parked, high scatter");
+  pass &= check_leave(DRIVE, "parked, drive away", 5);
+  pass &= check_leave(CREEP, "parked, creep away", 120);
+  pass &= check_sleep();
+  pass &= check_rest(GATED, "stop, gated out");
+  pass &= check_rest(SCATTER, "stop, high scatter");
+  pass &= check_rest(MIXED, "stop, mixed");
+  pass &= check_rest(DRIVE, "still driving");
+  return pass ? 0 : 1;
+}
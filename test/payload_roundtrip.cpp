@@ -0,0 +1,83 @@
+// Packs edge-case fixes with pack_mapper_v2() and unpacks them with
+// unpack_mapper_v2(), and fails unless each comes back as the payload rules in
+// main/payload.h say: 1e-7 degrees rounded half up to 1e-6 on both sides of
+// the equator and the meridian, and satellites, accuracy, speed and heading
+// clamped or wrapped.  Each frame is also printed with what it unpacked to,
+// for payload_roundtrip.py to decode the same frame with payload_codec.py.
+//
+//   build/payload_roundtrip
+
+#include <stdio.h>
+
+#include "payload.h"
+
+#define BOTH (PAYLOAD_V2_FLAG_HACC | PAYLOAD_V2_FLAG_MOTION)
+
+static const struct mapper_fix cases[] = {
+    // lat_e7, lon_e7, alt_m, sats, flags, hacc_dm, speed_dms, heading_deg
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {900000000, 1800000000, 32767, 12, BOTH, 10, 100, 359},
+    {-900000000, -1800000000, -32768, 3, BOTH, 0, 0, 0},
+    {4, -4, 10, 8, 0, 0, 0, 0},       // Round down to 0 on either side
+    {5, -5, 10, 8, 0, 0, 0, 0},       // Half up: 1e-6 north and east, 0 south and west
+    {6, -6, 10, 8, 0, 0, 0, 0},
+    {-15, 15, 10, 8, 0, 0, 0, 0},     // Half up, past zero
+    {482081234, 163701235, 171, 9, BOTH, 23, 134, 87},
+    {-337712345, -706543215, 520, 7, PAYLOAD_V2_FLAG_HACC, 7, 0, 0},
+    {515000005, -1234999995, 12, 31, PAYLOAD_V2_FLAG_MOTION, 0, 1023, 180},
+    {100, 100, 0, 40, BOTH, 1000, 2000, 360},  // Every clamp, and the heading wraps
+    {100, 100, 0, 32, BOTH, 8, 1024, 725},
+    {100, 100, 0, 255, PAYLOAD_V2_FLAG_HACC, 635, 0, 0},  // The largest accuracy that fits
+};
+#define CASES (sizeof(cases) / sizeof(cases[0]))
+
+// Nearest 1e-6 degree in 1e-7 steps, half up, worked out apart from the offset trick pack_mapper_v2() uses
+static int32_t round_e6(int32_t e7) {
+  int64_t v = (int64_t)e7 + 5;
+  return (int32_t)((v >= 0 ? v / 10 : (v - 9) / 10) * 10);
+}
+
+static struct mapper_fix expected(const struct mapper_fix *f) {
+  struct mapper_fix e = {round_e6(f->lat_e7), round_e6(f->lon_e7), f->alt_m, f->sats > 31 ? (uint8_t)31 : f->sats,
+                         f->flags, 0, 0, 0};
+  if (f->flags & PAYLOAD_V2_FLAG_HACC) {
+    unsigned steps = (f->hacc_dm + 2) / 5;
+    e.hacc_dm = (steps > 127 ? 127 : steps) * 5;
+  }
+  if (f->flags & PAYLOAD_V2_FLAG_MOTION) {
+    e.speed_dms = f->speed_dms > 1023 ? 1023 : f->speed_dms;
+    e.heading_deg = f->heading_deg % 360;
+  }
+  return e;
+}
+
+int main(void) {
+  bool pass = true;
+  for (size_t i = 0; i < CASES; i++) {
+    uint8_t buf[PAYLOAD_V2_MAX_LEN + 1];
+    struct mapper_fix got = {}, want = expected(&cases[i]);
+    uint8_t len = pack_mapper_v2(buf, &cases[i]);
+    uint8_t want_len = 11 + (want.flags & PAYLOAD_V2_FLAG_HACC ? 1 : 0) + (want.flags & PAYLOAD_V2_FLAG_MOTION ? 2 : 0);
+    bool ok = len == want_len && unpack_mapper_v2(buf, len, &got) && got.lat_e7 == want.lat_e7 &&
+              got.lon_e7 == want.lon_e7 && got.alt_m == want.alt_m && got.sats == want.sats &&
+              got.flags == want.flags && got.hacc_dm == want.hacc_dm && got.speed_dms == want.speed_dms &&
+              got.heading_deg == want.heading_deg;
+    // A frame cut short, or of another version, does not unpack
+    struct mapper_fix ignored;
+    ok &= !unpack_mapper_v2(buf, len - 1, &ignored);
+    buf[0] ^= 0x20;
+    ok &= !unpack_mapper_v2(buf, len, &ignored);
+    buf[0] ^= 0x20;
+
+    for (uint8_t b = 0; b < len; b++)
+      printf("%02X", buf[b]);
+    printf(" %ld %ld %d %u %u %u %u %u%s\n", (long)got.lat_e7, (long)got.lon_e7, got.alt_m, got.sats, got.flags,
+           got.hacc_dm, got.speed_dms, got.heading_deg, ok ? "" : " FAIL");
+    if (!ok)
+      fprintf(stderr, "case %u: want %ld %ld %d %u %u %u %u %u, %u bytes\n", (unsigned)i, (long)want.lat_e7,
+              (long)want.lon_e7, want.alt_m, want.sats, want.flags, want.hacc_dm, want.speed_dms, want.heading_deg,
+              want_len);
+    pass &= ok;
+  }
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+import argparse
+import os
+import subprocess
+import sys
+
+# Decodes the frames build/payload_roundtrip packed with payload_codec.py, and
+# fails unless every field is what unpack_mapper_v2() got back from the same
+# frame, in the units of the Console decoder.
+#
+#   python test/payload_roundtrip.py --roundtrip build/payload_roundtrip
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, '..', 'console-decoders'))
+import payload_codec  # noqa: E402
+
+PORT = 3
+FLAG_HACC = 1
+FLAG_MOTION = 2
+
+
+def expected(lat_e7, lon_e7, alt_m, sats, flags, hacc_dm, speed_dms, heading_deg):
+    out = {'latitude': lat_e7 / 1e7, 'longitude': lon_e7 / 1e7, 'altitude': alt_m, 'sats': sats,
+           'accuracy': hacc_dm / 10 if flags & FLAG_HACC else 2.5}
+    if flags & FLAG_MOTION:
+        out['speed'] = round(speed_dms * 0.36, 1)
+        out['heading'] = heading_deg
+    return out
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Check pack/unpack_mapper_v2 against payload_codec.py.')
+    parser.add_argument('--roundtrip', required=True, help='Path of the built payload_roundtrip')
+    args = parser.parse_args()
+
+    run = subprocess.run([args.roundtrip], capture_output=True, text=True)
+    sys.stderr.write(run.stderr)
+    mismatches = 0
+    lines = run.stdout.splitlines()
+    for line in lines:
+        frame, *fields = line.split()
+        want = expected(*(int(f) for f in fields[:8]))
+        got = payload_codec.decode(PORT, bytes.fromhex(frame))
+        same = set(got) == set(want) and all(abs(got[k] - want[k]) < 1e-9 for k in want)
+        if not same:
+            mismatches += 1
+            print('%s\n  unpack_mapper_v2  %s\n  payload_codec.py  %s' % (frame, want, got))
+    print('%d frames, %d mismatches' % (len(lines), mismatches))
+    sys.exit(1 if mismatches or run.returncode or not lines else 0)
@@ -0,0 +1,112 @@
+// Drives main/pmu_irq.cpp with the fake PMU of stub/XPowersLib.h, booting as
+// axpInit() in main.cpp does, and fails unless:
+//
+// - a wake from deep sleep on a short key press, USB in or USB out hands that
+//   one event to its handler on the first poll;
+// - a cold boot, which clears the status, and a wake on USB in and out again
+//   hand over neither a key press nor a USB change;
+// - awake, an IRQ with several bits set hands each to its handler once, with
+//   the time of the IRQ edge, and a bit without an event of its own shows up
+//   as PMU_OTHER.
+//
+//   build/pmu_wake
+
+#include <Arduino.h>
+#include <XPowersLib.h>
+
+#include "pmu_irq.h"
+
+#define PMU_IRQ_PIN 35
+
+static XPowersLibInterface pmu;
+static unsigned seen[PMU_EVENT_TYPES];
+static uint32_t seen_irq_us;
+
+static void count(const struct pmu_event *event) {
+  seen[event->type]++;
+  seen_irq_us = event->irq_us;
+}
+
+// Boots with this status latched and VBUS as it is now, as after a deep sleep or not
+static void boot(uint64_t status, bool vbus, bool woke) {
+  pmu = XPowersLibInterface();
+  pmu.status = status;
+  pmu.vbus = vbus;
+  memset(seen, 0, sizeof(seen));
+  pmu_irq_begin(&pmu, PMU_IRQ_PIN);
+  for (int type = 0; type < PMU_EVENT_TYPES; type++)
+    pmu_irq_on((enum pmu_event_type)type, count);
+  if (woke)
+    pmu_irq_wake();
+  else
+    pmu.clearIrqStatus();
+}
+
+// As loop() in main.cpp
+static void poll(void) {
+  if (pmu_irq_pending())
+    pmu_irq_poll();
+  pmu_irq_dispatch();
+}
+
+static unsigned seen_total(void) {
+  unsigned n = 0;
+  for (int type = 0; type < PMU_EVENT_TYPES; type++)
+    n += seen[type];
+  return n;
+}
+
+static bool report(const char *name, bool pass) {
+  printf("%-22s USB on %u, USB off %u, key short %u, key long %u, charge %u, other %u%s\n", name, seen[PMU_USB_ON],
+         seen[PMU_USB_OFF], seen[PMU_KEY_SHORT], seen[PMU_KEY_LONG], seen[PMU_CHARGE_START], seen[PMU_OTHER],
+         pass ? "" : "  FAIL");
+  return pass;
+}
+
+// The one event `status` should come out as
+static bool check_wake(const char *name, uint64_t status, bool vbus, enum pmu_event_type want) {
+  boot(status, vbus, true);
+  poll();
+  return report(name, seen[want] == 1 && seen_total() == 1 && pmu_irq_usb_power() == vbus);
+}
+
+static bool check_quiet(const char *name, uint64_t status, bool vbus, bool woke) {
+  boot(status, vbus, woke);
+  poll();
+  return report(name, !seen[PMU_USB_ON] && !seen[PMU_USB_OFF] && !seen[PMU_KEY_SHORT] && !seen[PMU_KEY_LONG] &&
+                          pmu_irq_usb_power() == vbus);
+}
+
+static bool check_awake(void) {
+  boot(0, false, false);
+  poll();
+  host_us = 1000000;
+  pmu.status = XPowersLibInterface::KEY_SHORT | XPowersLibInterface::CHARGE_START |
+               XPowersLibInterface::VBUS_INSERT | XPowersLibInterface::OVER_TEMPERATURE;
+  pmu.vbus = true;
+  host_isr();
+  host_us += 250;
+  host_isr();  // A second edge before the poll keeps the time of the first
+  host_us += 5000;
+  poll();
+  bool pass = seen[PMU_KEY_SHORT] == 1 && seen[PMU_CHARGE_START] == 1 && seen[PMU_USB_ON] == 1 &&
+              seen_total() == 3 && seen_irq_us == 1000000 && !pmu.status;
+  // Left alone, the over temperature bit now does show
+  pmu.status = XPowersLibInterface::OVER_TEMPERATURE;
+  host_isr();
+  poll();
+  pass &= seen[PMU_OTHER] == 1 && seen_total() == 4;
+  return report("awake, several at once", pass);
+}
+
+int main(void) {
+  bool pass = true;
+  pass &= check_wake("woke on key short", XPowersLibInterface::KEY_SHORT, false, PMU_KEY_SHORT);
+  pass &= check_wake("woke on USB in", XPowersLibInterface::VBUS_INSERT, true, PMU_USB_ON);
+  pass &= check_wake("woke on USB out", XPowersLibInterface::VBUS_REMOVE, false, PMU_USB_OFF);
+  pass &= check_quiet("cold boot, key long", XPowersLibInterface::KEY_LONG, false, false);
+  pass &= check_quiet("woke on USB in and out",
+                      XPowersLibInterface::VBUS_INSERT | XPowersLibInterface::VBUS_REMOVE, false, true);
+  pass &= check_awake();
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+// Runs main/screen.cpp on the framebuffer of stub/OLEDDisplay.h, which draws
+// text as the OLED library does, and fails unless:
+//
+// - screen_bench(), the check the 'b' command runs on the device, finds the
+//   text cache pixel-exact and no slower than drawString() (timed twice at most);
+// - random strings, positions and alignments, clipped at every edge, come out
+//   of the text cache the same as from drawString(), rendered and cached;
+// - after each of SCREEN_STEPS random changes to the header, log and menu,
+//   the display clearing and redrawing only the areas that changed shows the
+//   same pixels as a full redraw, and a frame with no change is not sent.
+//
+//   build/screen_draw
+
+#include <random>
+
+#include <OLEDDisplay.h>
+#include <TinyGPS++.h>
+#include <XPowersLib.h>
+
+#include "screen.h"
+#include "screen_log.h"
+#include "text.h"
+
+#define SCREEN_ADDR 0x3C
+#define WIDTH 128
+#define HEIGHT 64
+#define TEXT_CASES 20000
+#define SCREEN_STEPS 20000
+
+TinyGPSPlus tGPS;
+static XPowersLibInterface pmu;
+XPowersLibInterface *PMU = &pmu;
+
+extern OLEDDisplay *display;
+int getPixelFromBuffer(int16_t x, int16_t y);
+
+static std::mt19937 rng(46);
+
+// Random number in [low, high]
+static int uniform(int low, int high) {
+  return low + (int)(rng() % (high - low + 1));
+}
+
+// The display, as text_draw() keeps it: bytes of 8 vertical pixels
+static void frame(uint8_t *out) {
+  memset(out, 0, WIDTH * HEIGHT / 8);
+  for (int16_t y = 0; y < HEIGHT; y++)
+    for (int16_t x = 0; x < WIDTH; x++)
+      out[x + (y / 8) * WIDTH] |= getPixelFromBuffer(x, y) << (y & 7);
+}
+
+static bool check_text(void) {
+  uint8_t expected[WIDTH * HEIGHT / 8], got[WIDTH * HEIGHT / 8];
+  unsigned same = 0;
+  for (int i = 0; i < TEXT_CASES; i++) {
+    char text[32];
+    int length = uniform(0, sizeof(text) - 1);
+    for (int c = 0; c < length; c++)
+      text[c] = uniform(' ', '~');
+    text[length] = 0;
+    int16_t x = uniform(-60, WIDTH + 10), y = uniform(0, HEIGHT + 2);
+    OLEDDISPLAY_TEXT_ALIGNMENT alignment = (OLEDDISPLAY_TEXT_ALIGNMENT)uniform(TEXT_ALIGN_LEFT, TEXT_ALIGN_CENTER);
+
+    display->clear();
+    display->setTextAlignment(alignment);
+    display->drawString(x, y, text);
+    frame(expected);
+    for (int pass = 0; pass < 2; pass++) {  // Rendered, then from the cache
+      memset(got, 0, sizeof(got));
+      same += text_draw(got, x, y, alignment, text) && !memcmp(expected, got, sizeof(got));
+    }
+  }
+  bool pass = same == 2 * TEXT_CASES;
+  printf("%-15s %u/%u random strings pixel-exact%s\n", "text_draw", same, 2 * TEXT_CASES, pass ? "" : "  FAIL");
+  return pass;
+}
+
+static bool check_areas(void) {
+  static const char *const items[] = {"Send Now", "Power Off", "Distance +", "Interval -"};
+  static uint8_t incremental[WIDTH * HEIGHT / 8], full[WIDTH * HEIGHT / 8];
+  unsigned differ = 0, resent = 0, drawn = 0;
+  bool in_menu = false, highlighted = false, deadzone = false;
+  int item = 1;
+  unsigned interval = 60;
+  float distance = 50.0f;
+  const char *sf = "SF7";
+
+  screen_clear();
+  for (int step = 0; step < SCREEN_STEPS; step++) {
+    switch (rng() % 11) {
+      case 0:
+        host_us += uniform(0, 4000) * 1000;  // Battery and clock panels take turns
+        break;
+      case 1:
+        tGPS.satellites.val = uniform(0, 12);
+        break;
+      case 2:
+        tGPS.hdop.val = uniform(50, 400);
+        break;
+      case 3:
+        tGPS.time.val += 100;
+        break;
+      case 4: {
+        char line[SCREEN_LOG_LINE_LEN];
+        snprintf(line, sizeof(line), "Log line %u\n", (unsigned)rng() % 1000);
+        screen_buffer_write(line);
+        break;
+      }
+      case 5:
+        in_menu = rng() % 3 == 0;
+        break;
+      case 6:
+        highlighted = rng() % 2;
+        break;
+      case 7:
+        item = uniform(1, 2);
+        break;
+      case 8:
+        interval = rng() % 2 ? 60 : 120;
+        distance = uniform(0, 150);
+        deadzone = rng() % 10 == 0;
+        break;
+      case 9:
+        sf = rng() % 2 ? "SF7" : "SF10";
+        break;
+      case 10:
+        pmu.battery_percent = uniform(0, 100);
+        pmu.battery_mv = uniform(3300, 4200);
+        break;
+    }
+    screen_header(interval, distance, sf, 16, deadzone, false, false);
+    uint32_t frames = display->frames;
+    screen_body(in_menu, items[item - 1], items[item], items[item + 1], highlighted);
+    drawn += display->frames != frames;
+    frame(incremental);
+
+    // Nothing changed since, so nothing is sent
+    frames = display->frames;
+    screen_header(interval, distance, sf, 16, deadzone, false, false);
+    screen_body(in_menu, items[item - 1], items[item], items[item + 1], highlighted);
+    resent += display->frames != frames;
+
+    screen_clear();
+    screen_body(in_menu, items[item - 1], items[item], items[item + 1], highlighted);
+    frame(full);
+    differ += memcmp(incremental, full, sizeof(full)) != 0;
+  }
+  bool pass = !differ && !resent;
+  printf("%-15s %u of %u steps drawn, %u differ from a full redraw, %u sent again unchanged%s\n", "screen_body",
+         drawn, SCREEN_STEPS, differ, resent, pass ? "" : "  FAIL");
+  return pass;
+}
+
+int main(void) {
+  screen_setup(SCREEN_ADDR);
+  if (!display) {
+    printf("no display  FAIL\n");
+    return 1;
+  }
+  bool pass = screen_bench() || screen_bench();  // Pixels come out the same every time, a busy runner's timing may not
+  pass &= check_text();
+  pass &= check_areas();
+  return pass ? 0 : 1;
+}
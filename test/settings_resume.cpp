@@ -0,0 +1,77 @@
+// Boots main/settings.cpp against an NVS in memory, cold and then resumed the
+// way lorawan_rtc_restore() in main.cpp does it, and fails unless the flash
+// write counters of the keys carry on counting across the resume.
+//
+//   build/settings_resume
+
+#include <stdio.h>
+#include <string.h>
+
+#include "settings.h"
+
+static uint8_t sf;
+static uint8_t session[16];
+static float min_dist;
+
+// A fresh table, as after a reset: nothing loaded, every counter 0
+static struct setting table[3];
+
+static void boot(void) {
+  struct setting fresh[] = {
+      SETTING("lora", "sf", SETTING_U8, sf),
+      SETTING("lora", "session", SETTING_BLOB, session),
+      SETTING("mapper", "min_dist", SETTING_BLOB, min_dist),
+  };
+  memcpy(table, fresh, sizeof(table));
+  settings_begin(table, sizeof(table) / sizeof(table[0]));
+}
+
+static uint32_t writes(const char *key) {
+  for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); i++)
+    if (!strcmp(table[i].key, key))
+      return table[i].writes;
+  return 0;
+}
+
+static bool expect(const char *when, uint32_t sf_writes, uint32_t session_writes) {
+  bool pass = writes("sf") == sf_writes && writes("session") == session_writes;
+  printf("%-30s sf writes=%u session writes=%u%s\n", when, (unsigned)writes("sf"), (unsigned)writes("session"),
+         pass ? "" : "  FAIL");
+  return pass;
+}
+
+int main(void) {
+  bool pass = true;
+
+  // Cold boot into an empty flash, a Join and two uplinks that save the session
+  boot();
+  settings_load("lora");
+  settings_load("mapper");
+  sf = 9;
+  min_dist = 30.0f;
+  for (int i = 0; i < 3; i++) {
+    session[0] = i;
+    settings_commit();
+  }
+  pass &= expect("cold boot, 3 session commits", 1, 3);
+
+  // Deep sleep keeps the shadows in RTC memory, and the wake restores them in place of loading the keys
+  bool found[2];
+  uint32_t crc[2];
+  found[0] = settings_shadow(&sf, &crc[0]);
+  found[1] = settings_shadow(session, &crc[1]);
+  boot();
+  settings_load("mapper");
+  settings_set_shadow(&sf, found[0], crc[0]);
+  settings_set_shadow(session, found[1], crc[1]);
+  settings_load_writes("lora");
+  session[0] = 3;
+  settings_commit();
+  pass &= expect("resumed, 1 more session commit", 1, 4);
+
+  // What flash holds, on the next cold boot
+  boot();
+  settings_load("lora");
+  pass &= expect("cold boot again", 1, 4);
+  return pass ? 0 : 1;
+}
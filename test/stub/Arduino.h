@@ -0,0 +1,64 @@
+#pragma once
+
+// Just enough of the Arduino core for the modules the host build compiles
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROGMEM
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+#define F(text) text
+
+typedef bool boolean;
+
+// Serial prints to stdout
+struct HostSerial {
+  template <typename... Args>
+  int printf(const char *format, Args... args) {
+    return ::printf(format, args...);
+  }
+  void print(const char *text) {
+    fputs(text, stdout);
+  }
+  void print(char c) {
+    putchar(c);
+  }
+  void print(unsigned long n) {
+    ::printf("%lu", n);
+  }
+  void println(const char *text = "") {
+    puts(text);
+  }
+};
+inline HostSerial Serial;
+
+// Nanoseconds stand in for cycles, as profile_cycles() has them on the host
+struct HostEsp {
+  uint32_t getCpuFreqMHz(void) {
+    return 1000;
+  }
+};
+inline HostEsp ESP;
+
+// Time stands still unless the test moves host_us on
+inline uint32_t host_us;
+inline unsigned long micros(void) {
+  return host_us;
+}
+inline unsigned long millis(void) {
+  return host_us / 1000;
+}
+
+// Pins do nothing; the last interrupt handler attached is kept for the test to call
+#define INPUT 0x01
+#define FALLING 0x02
+typedef int gpio_num_t;
+inline void (*host_isr)(void);
+inline void pinMode(uint8_t, uint8_t) {}
+inline void gpio_pullup_en(gpio_num_t) {}
+inline void attachInterrupt(uint8_t, void (*isr)(void), int) {
+  host_isr = isr;
+}
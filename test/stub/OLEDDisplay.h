@@ -0,0 +1,233 @@
+#pragma once
+
+// The framebuffer of the ThingPulse OLED library (4.6.1), 128x64, without a
+// panel behind it.  drawString() takes the same steps as the library's
+// drawString(), drawStringInternal() and drawInternal(), byte for byte, so
+// test/screen.cpp can hold main/text.cpp to it.  The other drawing calls only
+// need the same pixels, and set them one at a time.
+
+#include <Arduino.h>
+
+enum OLEDDISPLAY_COLOR { BLACK = 0, WHITE = 1, INVERSE = 2 };
+
+enum OLEDDISPLAY_TEXT_ALIGNMENT {
+  TEXT_ALIGN_LEFT = 0,
+  TEXT_ALIGN_RIGHT = 1,
+  TEXT_ALIGN_CENTER = 2,
+  TEXT_ALIGN_CENTER_BOTH = 3
+};
+
+class OLEDDisplay {
+public:
+  virtual ~OLEDDisplay() {}
+
+  bool init(void) {
+    clear();
+    return true;
+  }
+  void end(void) {}
+  void displayOn(void) {}
+  void displayOff(void) {}
+  void flipScreenVertically(void) {}  // Only turns the panel, the buffer stays as it is
+  void display(void) {
+    frames++;
+  }
+  void clear(void) {
+    memset(buffer, 0, sizeof(buffer));
+  }
+  uint16_t getWidth(void) {
+    return WIDTH;
+  }
+  uint16_t getHeight(void) {
+    return HEIGHT;
+  }
+
+  void setColor(OLEDDISPLAY_COLOR c) {
+    color = c;
+  }
+  void setFont(const uint8_t *font) {
+    fontData = font;
+  }
+  void setTextAlignment(OLEDDISPLAY_TEXT_ALIGNMENT alignment) {
+    textAlignment = alignment;
+  }
+
+  void setPixel(int16_t x, int16_t y) {
+    if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT)
+      return;
+    uint8_t bit = 1 << (y & 7);
+    uint8_t *b = &buffer[x + (y / 8) * WIDTH];
+    if (color == WHITE)
+      *b |= bit;
+    else if (color == BLACK)
+      *b &= ~bit;
+    else
+      *b ^= bit;
+  }
+  void drawHorizontalLine(int16_t x, int16_t y, int16_t length) {
+    for (int16_t i = 0; i < length; i++)
+      setPixel(x + i, y);
+  }
+  void drawVerticalLine(int16_t x, int16_t y, int16_t length) {
+    for (int16_t i = 0; i < length; i++)
+      setPixel(x, y + i);
+  }
+  void fillRect(int16_t x, int16_t y, int16_t width, int16_t height) {
+    for (int16_t i = 0; i < width; i++)
+      drawVerticalLine(x + i, y, height);
+  }
+  // Rows of bytes, least significant bit leftmost; only set bits are drawn
+  void drawXbm(int16_t x, int16_t y, int16_t width, int16_t height, const uint8_t *xbm) {
+    int16_t row_bytes = (width + 7) / 8;
+    for (int16_t j = 0; j < height; j++)
+      for (int16_t i = 0; i < width; i++)
+        if (xbm[i / 8 + j * row_bytes] >> (i & 7) & 1)
+          setPixel(x + i, y + j);
+  }
+
+  // Lines split at '\n', each as wide as its characters in the font
+  void drawString(int16_t x, int16_t y, const char *text) {
+    uint8_t line_height = fontData[HEIGHT_POS];
+    uint16_t y_offset = 0;
+    if (textAlignment == TEXT_ALIGN_CENTER_BOTH) {
+      uint16_t breaks = 0;
+      for (const char *c = text; *c; c++)
+        breaks += *c == '\n';
+      y_offset = breaks * line_height / 2;
+    }
+    char *copy = strdup(text);
+    uint16_t line = 0;
+    for (char *part = strtok(copy, "\n"); part; part = strtok(NULL, "\n")) {
+      uint16_t length = strlen(part);
+      drawStringInternal(x, y - y_offset + (line++) * line_height, part, length, stringWidth(part, length));
+    }
+    free(copy);
+  }
+
+  uint32_t frames = 0;  // display() calls, as the frames sent to the panel
+
+protected:
+  static const int16_t WIDTH = 128;
+  static const int16_t HEIGHT = 64;
+  static const int BUFFER_SIZE = WIDTH * HEIGHT / 8;
+
+  uint8_t buffer[BUFFER_SIZE] = {};
+
+private:
+  // Font layout
+  static const uint8_t HEIGHT_POS = 1;
+  static const uint8_t FIRST_CHAR_POS = 2;
+  static const uint8_t CHAR_NUM_POS = 3;
+  static const uint8_t JUMPTABLE_START = 4;
+  static const uint8_t JUMPTABLE_BYTES = 4;
+
+  OLEDDISPLAY_COLOR color = WHITE;
+  OLEDDISPLAY_TEXT_ALIGNMENT textAlignment = TEXT_ALIGN_LEFT;
+  const uint8_t *fontData = NULL;
+
+  // The library's default font table lookup leaves ASCII alone and drops the rest of UTF-8
+  static uint8_t lookup(char c) {
+    return (uint8_t)c < 128 ? c : 0;
+  }
+
+  uint16_t stringWidth(const char *text, uint16_t length) {
+    uint8_t first_char = fontData[FIRST_CHAR_POS];
+    uint16_t width = 0;
+    for (uint16_t i = 0; i < length; i++) {
+      uint8_t code = lookup(text[i]);
+      if (code >= first_char && code)
+        width += fontData[JUMPTABLE_START + (code - first_char) * JUMPTABLE_BYTES + 3];
+    }
+    return width;
+  }
+
+  void drawStringInternal(int16_t x_move, int16_t y_move, const char *text, uint16_t length, uint16_t text_width) {
+    uint8_t text_height = fontData[HEIGHT_POS];
+    uint8_t first_char = fontData[FIRST_CHAR_POS];
+    uint16_t jump_table_size = fontData[CHAR_NUM_POS] * JUMPTABLE_BYTES;
+    uint16_t cursor_x = 0;
+
+    switch (textAlignment) {
+      case TEXT_ALIGN_CENTER_BOTH:
+        y_move -= text_height >> 1;
+        // Fallthrough
+      case TEXT_ALIGN_CENTER:
+        x_move -= text_width >> 1;
+        break;
+      case TEXT_ALIGN_RIGHT:
+        x_move -= text_width;
+        break;
+      case TEXT_ALIGN_LEFT:
+        break;
+    }
+
+    if (x_move + text_width < 0 || x_move >= WIDTH)
+      return;
+    if (y_move + text_height < 0 || y_move >= HEIGHT)
+      return;
+
+    for (uint16_t j = 0; j < length; j++) {
+      int16_t x_pos = x_move + cursor_x;
+      if (x_pos > WIDTH)
+        break;
+      uint8_t code = lookup(text[j]);
+      if (code == 0)
+        continue;
+      if (code >= first_char) {
+        const uint8_t *jump = fontData + JUMPTABLE_START + (code - first_char) * JUMPTABLE_BYTES;
+        if (!(jump[0] == 255 && jump[1] == 255))
+          drawInternal(x_pos, y_move, jump[3], text_height, fontData,
+                       JUMPTABLE_START + jump_table_size + ((jump[0] << 8) + jump[1]), jump[2]);
+        cursor_x += jump[3];
+      }
+    }
+  }
+
+  void drawInternal(int16_t x_move, int16_t y_move, int16_t width, int16_t height, const uint8_t *data,
+                    uint16_t offset, uint16_t bytes) {
+    if (width < 0 || height < 0)
+      return;
+    if (y_move + height < 0 || y_move > HEIGHT)
+      return;
+    if (x_move + width < 0 || x_move > WIDTH)
+      return;
+
+    uint8_t raster_height = 1 + ((height - 1) >> 3);
+    int8_t y_offset = y_move & 7;
+    bytes = bytes == 0 ? width * raster_height : bytes;
+
+    for (uint16_t i = 0; i < bytes; i++) {
+      uint8_t current = data[offset + i];
+      int16_t x_pos = x_move + (i / raster_height);
+      int16_t y_pos = ((y_move >> 3) + (i % raster_height)) * WIDTH;
+      int16_t data_pos = x_pos + y_pos;
+
+      if (data_pos >= 0 && data_pos < BUFFER_SIZE && x_pos >= 0 && x_pos < WIDTH) {
+        switch (color) {
+          case WHITE:
+            buffer[data_pos] |= current << y_offset;
+            break;
+          case BLACK:
+            buffer[data_pos] &= ~(current << y_offset);
+            break;
+          case INVERSE:
+            buffer[data_pos] ^= current << y_offset;
+            break;
+        }
+        if (data_pos < BUFFER_SIZE - WIDTH) {
+          switch (color) {
+            case WHITE:
+              buffer[data_pos + WIDTH] |= current >> (8 - y_offset);
+              break;
+            case BLACK:
+              buffer[data_pos + WIDTH] &= ~(current >> (8 - y_offset));
+              break;
+            case INVERSE:
+              buffer[data_pos + WIDTH] ^= current >> (8 - y_offset);
+              break;
+          }
+        }
+      }
+    }
+  }
+};
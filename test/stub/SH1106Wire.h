@@ -0,0 +1,8 @@
+#pragma once
+
+#include "OLEDDisplay.h"
+
+class SH1106Wire : public OLEDDisplay {
+public:
+  SH1106Wire(uint8_t, int, int) {}
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "OLEDDisplay.h"
+
+class SSD1306Wire : public OLEDDisplay {
+public:
+  SSD1306Wire(uint8_t, int, int) {}
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+// The TinyGPS++ values the host build reads, set by the test
+
+#include <stdint.h>
+
+struct RawDegrees {
+  uint16_t deg;
+  uint32_t billionths;
+  bool negative;
+};
+
+struct TinyGPSInteger {
+  uint32_t val = 0;
+  uint32_t value(void) {
+    return val;
+  }
+};
+
+struct TinyGPSTime {
+  uint32_t val = 0;  // hhmmsscc
+  uint32_t value(void) {
+    return val;
+  }
+};
+
+struct TinyGPSHDOP {
+  int32_t val = 0;  // Hundredths
+  int32_t value(void) {
+    return val;
+  }
+};
+
+class TinyGPSPlus {
+public:
+  TinyGPSInteger satellites;
+  TinyGPSTime time;
+  TinyGPSHDOP hdop;
+};
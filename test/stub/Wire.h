@@ -0,0 +1,40 @@
+#pragma once
+
+// An I2C bus with one display on it whose memory reads back what was written
+// to it, as the SH1106 does, for display_get_type() in main/screen.cpp
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+  void begin(int, int) {}
+  void setClock(uint32_t) {}
+  void beginTransmission(uint8_t) {}
+  size_t write(const uint8_t *data, size_t length) {
+    if (length > 1 && data[0] == 0x40) {  // Display data
+      ram_length = length - 1 < sizeof(ram) ? length - 1 : sizeof(ram);
+      memcpy(ram, data + 1, ram_length);
+    }
+    return length;
+  }
+  size_t write(uint8_t) {
+    return 1;
+  }
+  uint8_t endTransmission(bool = true) {
+    return 0;
+  }
+  uint8_t requestFrom(int, int length, int) {
+    reads = 0;
+    return length;
+  }
+  int read(void) {
+    // A dummy byte comes first
+    return reads++ == 0 || !ram_length ? 0 : ram[(reads - 2) % ram_length];
+  }
+
+private:
+  uint8_t ram[2] = {};
+  size_t ram_length = 0;
+  uint8_t reads = 0;
+};
+inline TwoWire Wire;
@@ -0,0 +1,70 @@
+#pragma once
+
+// A PMU whose IRQ status stays latched until it is cleared, as on the AXP192
+// and AXP2101.  The is*Irq() tests look at the status getIrqStatus() last
+// read, as the library's do.
+
+#include <stdint.h>
+
+class XPowersLibInterface {
+public:
+  enum {
+    VBUS_INSERT = 1 << 0,
+    VBUS_REMOVE = 1 << 1,
+    BAT_INSERT = 1 << 2,
+    BAT_REMOVE = 1 << 3,
+    CHARGE_START = 1 << 4,
+    CHARGE_DONE = 1 << 5,
+    KEY_SHORT = 1 << 6,
+    KEY_LONG = 1 << 7,
+    OVER_TEMPERATURE = 1 << 8,  // One the Mapper has no event for
+  };
+
+  uint64_t status = 0;  // Latched
+  bool vbus = false;
+  int battery_percent = 0;
+  uint16_t battery_mv = 0;
+
+  int getBatteryPercent(void) {
+    return battery_percent;
+  }
+  uint16_t getBattVoltage(void) {
+    return battery_mv;
+  }
+  bool isVbusIn(void) {
+    return vbus;
+  }
+  uint64_t getIrqStatus(void) {
+    return read = status;
+  }
+  void clearIrqStatus(void) {
+    status = 0;
+  }
+  bool isVbusInsertIrq(void) {
+    return read & VBUS_INSERT;
+  }
+  bool isVbusRemoveIrq(void) {
+    return read & VBUS_REMOVE;
+  }
+  bool isBatInsertIrq(void) {
+    return read & BAT_INSERT;
+  }
+  bool isBatRemoveIrq(void) {
+    return read & BAT_REMOVE;
+  }
+  bool isBatChargeStartIrq(void) {
+    return read & CHARGE_START;
+  }
+  bool isBatChargeDoneIrq(void) {
+    return read & CHARGE_DONE;
+  }
+  bool isPekeyShortPressIrq(void) {
+    return read & KEY_SHORT;
+  }
+  bool isPekeyLongPressIrq(void) {
+    return read & KEY_LONG;
+  }
+
+private:
+  uint64_t read = 0;
+};
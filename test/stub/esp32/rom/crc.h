@@ -0,0 +1,16 @@
+#pragma once
+
+// crc32_le() of the ESP32 ROM, bitwise
+
+#include <stddef.h>
+#include <stdint.h>
+
+static inline uint32_t crc32_le(uint32_t crc, const uint8_t *buf, size_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *buf++;
+    for (int i = 0; i < 8; i++)
+      crc = crc >> 1 ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
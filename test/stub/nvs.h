@@ -0,0 +1,72 @@
+#pragma once
+
+// NVS of ESP-IDF in memory: enough of it for main/settings.cpp, with what is
+// committed kept apart from what is only staged until nvs_commit().
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+typedef int esp_err_t;
+typedef uint32_t nvs_handle_t;
+enum nvs_open_mode_t { NVS_READONLY, NVS_READWRITE };
+#define ESP_OK 0
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+
+typedef std::map<std::string, std::vector<uint8_t>> nvs_namespace;
+static std::map<std::string, nvs_namespace> nvs_flash, nvs_staged;
+static std::vector<std::string> nvs_handles;
+
+static inline esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *h) {
+  if (mode == NVS_READONLY && !nvs_flash.count(ns))
+    return ESP_ERR_NVS_NOT_FOUND;
+  nvs_staged[ns] = nvs_flash[ns];
+  nvs_handles.push_back(ns);
+  *h = nvs_handles.size() - 1;
+  return ESP_OK;
+}
+
+static inline void nvs_close(nvs_handle_t) {}
+
+static inline esp_err_t nvs_commit(nvs_handle_t h) {
+  nvs_flash[nvs_handles[h]] = nvs_staged[nvs_handles[h]];
+  return ESP_OK;
+}
+
+static inline esp_err_t nvs_erase_all(nvs_handle_t h) {
+  nvs_staged[nvs_handles[h]].clear();
+  return ESP_OK;
+}
+
+static inline esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *value, size_t len) {
+  nvs_staged[nvs_handles[h]][key].assign((const uint8_t *)value, (const uint8_t *)value + len);
+  return ESP_OK;
+}
+
+static inline esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *value, size_t *len) {
+  nvs_namespace &ns = nvs_staged[nvs_handles[h]];
+  if (!ns.count(key))
+    return ESP_ERR_NVS_NOT_FOUND;
+  if (value && *len < ns[key].size())
+    return ESP_ERR_NVS_NOT_FOUND;
+  if (value)
+    memcpy(value, ns[key].data(), ns[key].size());
+  *len = ns[key].size();
+  return ESP_OK;
+}
+
+#define NVS_STUB_INT(suffix, type)                                                          \
+  static inline esp_err_t nvs_set_##suffix(nvs_handle_t h, const char *key, type value) {   \
+    return nvs_set_blob(h, key, &value, sizeof(value));                                     \
+  }                                                                                         \
+  static inline esp_err_t nvs_get_##suffix(nvs_handle_t h, const char *key, type *value) {  \
+    size_t len = sizeof(*value);                                                            \
+    return nvs_get_blob(h, key, value, &len);                                               \
+  }
+NVS_STUB_INT(u8, uint8_t)
+NVS_STUB_INT(i32, int32_t)
+NVS_STUB_INT(u32, uint32_t)